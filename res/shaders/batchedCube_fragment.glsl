@@ -0,0 +1,51 @@
+#version 330 core
+out vec4 color;
+
+in vec3 v_fragPos;
+in vec3 v_normal;
+in vec2 v_texCoords;
+flat in uint v_material;
+
+uniform vec3 u_lightPos;
+uniform vec3 u_lightColor;
+uniform vec3 u_materialColors[4];
+// every material's texture is a region of one array, see TextureRegion in TextureArray.h
+uniform sampler2DArray u_materialTextures;
+uniform vec4 u_materialRects[4];
+uniform float u_materialLayers[4];
+uniform float u_materialMaxLevels[4];
+
+layout(std140) uniform Camera {
+    mat4 u_view;
+    mat4 u_projection;
+    mat4 u_viewProjection;
+    vec3 u_cameraPosition;
+    float u_time;
+};
+
+void main() {
+    float ambientStrength = 0.1f;
+    vec3 ambientLight = ambientStrength * u_lightColor;
+
+    vec3 normal = normalize(v_normal);
+    vec3 lightDirection = normalize(u_lightPos - v_fragPos);
+    vec3 diffuseLight = max(dot(normal, lightDirection), 0.0) * u_lightColor;
+
+    float specularStrength = 0.5f;
+    vec3 viewDirection = normalize(u_cameraPosition - v_fragPos);
+    vec3 reflectDirection = reflect(-lightDirection, normal);
+    float spec = pow(max(dot(viewDirection, reflectDirection), 0.0f), 32);
+    vec3 specularLight = specularStrength * spec * u_lightColor;
+
+    vec3 resLight = ambientLight + diffuseLight + specularLight;
+    uint material = v_material % 4u;
+    vec3 texCoords = vec3(v_texCoords * u_materialRects[material].zw + u_materialRects[material].xy,
+        u_materialLayers[material]);
+    // the level hardware filtering would pick, clamped to the levels the region has
+    vec2 texels = texCoords.xy * vec2(textureSize(u_materialTextures, 0).xy);
+    vec2 dx = dFdx(texels);
+    vec2 dy = dFdy(texels);
+    float level = min(0.5f * log2(max(max(dot(dx, dx), dot(dy, dy)), 1e-8f)), u_materialMaxLevels[material]);
+    vec3 albedo = textureLod(u_materialTextures, texCoords, level).rgb * u_materialColors[material];
+    color = vec4(resLight * albedo, 1.0f);
+}
\ No newline at end of file
@@ -0,0 +1,38 @@
+#version 330 core
+layout(location = 0) in vec3 a_position;
+layout(location = 1) in vec3 a_normal;
+layout(location = 2) in vec2 a_texCoords;
+
+// see DRAW_ID_ATTRIBUTE_LOCATION in DrawBatch.h
+layout(location = 15) in uint a_drawID;
+
+out vec3 v_fragPos;
+out vec3 v_normal;
+out vec2 v_texCoords;
+flat out uint v_material;
+
+// 5 texels per draw: the 4 columns of the model matrix, then the material index
+uniform samplerBuffer u_drawData;
+
+layout(std140) uniform Camera {
+    mat4 u_view;
+    mat4 u_projection;
+    mat4 u_viewProjection;
+    vec3 u_cameraPosition;
+    float u_time;
+};
+
+void main() {
+    int base = int(a_drawID) * 5;
+    mat4 model = mat4(
+        texelFetch(u_drawData, base + 0),
+        texelFetch(u_drawData, base + 1),
+        texelFetch(u_drawData, base + 2),
+        texelFetch(u_drawData, base + 3)
+    );
+    gl_Position = u_viewProjection * model * vec4(a_position, 1.0f);
+    v_fragPos = vec3(model * vec4(a_position, 1.0f));
+    v_normal = mat3(model) * a_normal;
+    v_texCoords = a_texCoords;
+    v_material = floatBitsToUint(texelFetch(u_drawData, base + 4).x);
+}
\ No newline at end of file
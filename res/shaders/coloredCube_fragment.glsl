@@ -3,11 +3,21 @@ out vec4 color;
 
 in vec3 v_fragPos;
 in vec3 v_normal;
+in vec2 v_texCoords;
 
 uniform vec3 u_lightPos;
 uniform vec3 u_lightColor;
 uniform vec3 u_objectColor;
-uniform vec3 u_viewPos;
+// bound by the TextureManager
+uniform sampler2D u_texture;
+
+layout(std140) uniform Camera {
+    mat4 u_view;
+    mat4 u_projection;
+    mat4 u_viewProjection;
+    vec3 u_cameraPosition;
+    float u_time;
+};
 
 void main() {
     float ambientStrength = 0.1f;
@@ -18,11 +28,12 @@ void main() {
     vec3 diffuseLight = max(dot(normal, lightDirection), 0.0) * u_lightColor;
 
     float specularStrength = 0.5f;
-    vec3 viewDirection = normalize(u_viewPos - v_fragPos);
+    vec3 viewDirection = normalize(u_cameraPosition - v_fragPos);
     vec3 reflectDirection = reflect(-lightDirection, normal); 
     float spec = pow(max(dot(viewDirection, reflectDirection), 0.0f), 32);
     vec3 specularLight = specularStrength * spec * u_lightColor;  
 
     vec3 resLight = ambientLight + diffuseLight + specularLight;
-    color = vec4(resLight * u_objectColor, 1.0f);
+    vec3 albedo = texture(u_texture, v_texCoords).rgb * u_objectColor;
+    color = vec4(resLight * albedo, 1.0f);
 }
\ No newline at end of file
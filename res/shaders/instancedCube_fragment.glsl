@@ -0,0 +1,35 @@
+#version 330 core
+out vec4 color;
+
+in vec3 v_fragPos;
+in vec3 v_normal;
+in vec3 v_color;
+
+uniform vec3 u_lightPos;
+uniform vec3 u_lightColor;
+
+layout(std140) uniform Camera {
+    mat4 u_view;
+    mat4 u_projection;
+    mat4 u_viewProjection;
+    vec3 u_cameraPosition;
+    float u_time;
+};
+
+void main() {
+    float ambientStrength = 0.1f;
+    vec3 ambientLight = ambientStrength * u_lightColor;
+
+    vec3 normal = normalize(v_normal);
+    vec3 lightDirection = normalize(u_lightPos - v_fragPos);
+    vec3 diffuseLight = max(dot(normal, lightDirection), 0.0) * u_lightColor;
+
+    float specularStrength = 0.5f;
+    vec3 viewDirection = normalize(u_cameraPosition - v_fragPos);
+    vec3 reflectDirection = reflect(-lightDirection, normal);
+    float spec = pow(max(dot(viewDirection, reflectDirection), 0.0f), 32);
+    vec3 specularLight = specularStrength * spec * u_lightColor;
+
+    vec3 resLight = ambientLight + diffuseLight + specularLight;
+    color = vec4(resLight * v_color, 1.0f);
+}
\ No newline at end of file
@@ -0,0 +1,26 @@
+#version 330 core
+layout(location = 0) in vec3 a_position;
+layout(location = 1) in vec3 a_normal;
+
+// per-instance attributes, see INSTANCE_ATTRIBUTE_LOCATION in Mesh.h
+layout(location = 8) in mat4 a_model;
+layout(location = 12) in vec4 a_color;
+
+out vec3 v_fragPos;
+out vec3 v_normal;
+out vec3 v_color;
+
+layout(std140) uniform Camera {
+    mat4 u_view;
+    mat4 u_projection;
+    mat4 u_viewProjection;
+    vec3 u_cameraPosition;
+    float u_time;
+};
+
+void main() {
+    gl_Position = u_viewProjection * a_model * vec4(a_position, 1.0f);
+    v_fragPos = vec3(a_model * vec4(a_position, 1.0f));
+    v_normal = mat3(a_model) * a_normal;
+    v_color = a_color.rgb;
+}
\ No newline at end of file
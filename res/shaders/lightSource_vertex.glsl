@@ -2,9 +2,15 @@
 layout(location = 0) in vec3 a_position;
 
 uniform mat4 u_model;
-uniform mat4 u_view;
-uniform mat4 u_projection;
+
+layout(std140) uniform Camera {
+    mat4 u_view;
+    mat4 u_projection;
+    mat4 u_viewProjection;
+    vec3 u_cameraPosition;
+    float u_time;
+};
 
 void main() {
-    gl_Position = u_projection * u_view * u_model * vec4(a_position, 1.0f);
+    gl_Position = u_viewProjection * u_model * vec4(a_position, 1.0f);
 }
\ No newline at end of file
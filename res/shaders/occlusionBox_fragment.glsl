@@ -0,0 +1,7 @@
+#version 330 core
+out vec4 color;
+
+// nothing is written, the box is only drawn to count the samples that pass the depth test
+void main() {
+    color = vec4(1.0f);
+}
\ No newline at end of file
@@ -0,0 +1,17 @@
+#version 330 core
+layout(location = 0) in vec3 a_position;
+
+// scales and moves the unit box (corners at -1 and 1) onto the bounds of an object
+uniform mat4 u_model;
+
+layout(std140) uniform Camera {
+    mat4 u_view;
+    mat4 u_projection;
+    mat4 u_viewProjection;
+    vec3 u_cameraPosition;
+    float u_time;
+};
+
+void main() {
+    gl_Position = u_viewProjection * u_model * vec4(a_position, 1.0f);
+}
\ No newline at end of file
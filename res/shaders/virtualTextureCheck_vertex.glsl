@@ -0,0 +1,14 @@
+#version 330 core
+layout(location = 0) in vec2 a_position;
+
+out vec3 v_fragPos;
+out vec3 v_normal;
+out vec2 v_texCoords;
+
+// a quad over the whole framebuffer, with the texture stretched over it
+void main() {
+    gl_Position = vec4(a_position, 0.0f, 1.0f);
+    v_fragPos = vec3(a_position, 0.0f);
+    v_normal = vec3(0.0f, 0.0f, 1.0f);
+    v_texCoords = a_position * 0.5f + 0.5f;
+}
\ No newline at end of file
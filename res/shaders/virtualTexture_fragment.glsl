@@ -0,0 +1,84 @@
+#version 330 core
+out vec4 color;
+
+in vec3 v_fragPos;
+in vec3 v_normal;
+in vec2 v_texCoords;
+
+uniform vec3 u_lightPos;
+uniform vec3 u_lightColor;
+// set by VirtualTexture::setUniforms()
+uniform sampler2D u_pageTable;
+uniform sampler2D u_pageCache;
+uniform vec2 u_virtualSize;
+uniform vec2 u_cacheSize;
+uniform float u_pagePayload;
+uniform float u_pageBorder;
+uniform float u_maxLevel;
+uniform float u_levelBias;
+uniform bool u_feedbackPass;
+// set by checkVirtualTexture(), which compares the texels themselves
+uniform bool u_unlit;
+
+layout(std140) uniform Camera {
+    mat4 u_view;
+    mat4 u_projection;
+    mat4 u_viewProjection;
+    vec3 u_cameraPosition;
+    float u_time;
+};
+
+// the level whose texels are closest to the size of a pixel
+float computeLevel(vec2 texels) {
+    vec2 dx = dFdx(texels);
+    vec2 dy = dFdy(texels);
+    float footprint = max(dot(dx, dx), dot(dy, dy));
+    return clamp(floor(0.5f * log2(max(footprint, 1e-8f)) + u_levelBias), 0.0f, u_maxLevel);
+}
+
+vec2 getLevelSize(float level) {
+    return max(floor(u_virtualSize / exp2(level)), vec2(1.0f));
+}
+
+// the page of a level the texture coordinates are in
+vec2 getPage(vec2 texCoords, vec2 levelSize) {
+    return min(floor(texCoords * levelSize / u_pagePayload), ceil(levelSize / u_pagePayload) - 1.0f);
+}
+
+void main() {
+    vec2 texCoords = clamp(v_texCoords, 0.0f, 1.0f);
+    float level = computeLevel(texCoords * u_virtualSize);
+    vec2 page = getPage(texCoords, getLevelSize(level));
+    if (u_feedbackPass) {
+        // read back by VirtualTexture, see PageRequestAnalyser
+        color = vec4(page, level, 255.0f) / 255.0f;
+        return;
+    }
+
+    // the page table points to the finest page there is at or above the wanted one
+    vec4 entry = floor(texelFetch(u_pageTable, ivec2(page), int(level)) * 255.0f + 0.5f);
+    vec2 mappedSize = getLevelSize(entry.b);
+    vec2 inPage = texCoords * mappedSize / u_pagePayload - getPage(texCoords, mappedSize);
+    vec2 texel = entry.rg * (u_pagePayload + 2.0f * u_pageBorder) + u_pageBorder + inPage * u_pagePayload;
+    vec3 albedo = texture(u_pageCache, texel / u_cacheSize).rgb;
+    if (u_unlit) {
+        color = vec4(albedo, 1.0f);
+        return;
+    }
+
+    float ambientStrength = 0.1f;
+    vec3 ambientLight = ambientStrength * u_lightColor;
+
+    vec3 normal = normalize(v_normal);
+    vec3 lightDirection = normalize(u_lightPos - v_fragPos);
+    vec3 diffuseLight = max(dot(normal, lightDirection), 0.0) * u_lightColor;
+
+    float specularStrength = 0.5f;
+    vec3 viewDirection = normalize(u_cameraPosition - v_fragPos);
+    vec3 reflectDirection = reflect(-lightDirection, normal);
+    float spec = pow(max(dot(viewDirection, reflectDirection), 0.0f), 32);
+    vec3 specularLight = specularStrength * spec * u_lightColor;
+
+    vec3 resLight = ambientLight + diffuseLight + specularLight;
+    color = vec4(resLight * albedo, 1.0f);
+}
\ No newline at end of file
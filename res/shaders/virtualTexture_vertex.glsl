@@ -0,0 +1,25 @@
+#version 330 core
+layout(location = 0) in vec3 a_position;
+layout(location = 1) in vec3 a_normal;
+layout(location = 2) in vec2 a_texCoords;
+
+out vec3 v_fragPos;
+out vec3 v_normal;
+out vec2 v_texCoords;
+
+uniform mat4 u_model;
+
+layout(std140) uniform Camera {
+    mat4 u_view;
+    mat4 u_projection;
+    mat4 u_viewProjection;
+    vec3 u_cameraPosition;
+    float u_time;
+};
+
+void main() {
+    gl_Position = u_viewProjection * u_model * vec4(a_position, 1.0f);
+    v_fragPos = vec3(u_model * vec4(a_position, 1.0f));
+    v_normal = mat3(transpose(inverse(u_model))) * a_normal;
+    v_texCoords = a_texCoords;
+}
\ No newline at end of file
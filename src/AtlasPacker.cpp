@@ -0,0 +1,89 @@
+#include "AtlasPacker.h"
+
+#include <algorithm>
+#include <limits>
+#include <vector>
+
+SkylinePacker::SkylinePacker(unsigned int width, unsigned int height)
+    : m_width{ width }, m_height{ height }, m_usedArea{ 0 } {
+    clear();
+}
+
+bool SkylinePacker::findY(unsigned int index, unsigned int width, unsigned int height, unsigned int& y) const {
+    unsigned int x = m_skyline[index].m_x;
+    if (x + width > m_width) {
+        return false;
+    }
+    // the rectangle rests on the highest segment below it
+    y = 0;
+    for (unsigned int covered = 0; covered < width; ++index) {
+        y = std::max(y, m_skyline[index].m_y);
+        covered += m_skyline[index].m_width;
+    }
+    return y + height <= m_height;
+}
+
+bool SkylinePacker::insert(unsigned int width, unsigned int height, unsigned int& x, unsigned int& y) {
+    if (width == 0 || height == 0) {
+        return false;
+    }
+    unsigned int bestIndex = 0;
+    unsigned int bestTop = std::numeric_limits<unsigned int>::max();
+    unsigned int bestWidth = std::numeric_limits<unsigned int>::max();
+    unsigned int bestY = 0;
+    for (unsigned int i = 0; i < m_skyline.size(); ++i) {
+        unsigned int segmentY;
+        if (!findY(i, width, height, segmentY)) {
+            continue;
+        }
+        // ties go to the narrower segment, which leaves the wide ones for wide rectangles
+        unsigned int top = segmentY + height;
+        if (top < bestTop || (top == bestTop && m_skyline[i].m_width < bestWidth)) {
+            bestIndex = i;
+            bestTop = top;
+            bestWidth = m_skyline[i].m_width;
+            bestY = segmentY;
+        }
+    }
+    if (bestTop == std::numeric_limits<unsigned int>::max()) {
+        return false;
+    }
+    x = m_skyline[bestIndex].m_x;
+    y = bestY;
+
+    // the new segment replaces the ones it covers, the last of those may stick out on the right
+    m_skyline.insert(m_skyline.begin() + bestIndex, { x, bestTop, width });
+    unsigned int right = x + width;
+    unsigned int next = bestIndex + 1;
+    while (next < m_skyline.size() && m_skyline[next].m_x < right) {
+        Segment& segment = m_skyline[next];
+        unsigned int segmentRight = segment.m_x + segment.m_width;
+        if (segmentRight <= right) {
+            m_skyline.erase(m_skyline.begin() + next);
+        } else {
+            segment.m_width = segmentRight - right;
+            segment.m_x = right;
+            break;
+        }
+    }
+    // neighbours at the same height are one segment
+    for (unsigned int i = 0; i + 1 < m_skyline.size();) {
+        if (m_skyline[i].m_y == m_skyline[i + 1].m_y) {
+            m_skyline[i].m_width += m_skyline[i + 1].m_width;
+            m_skyline.erase(m_skyline.begin() + i + 1);
+        } else {
+            ++i;
+        }
+    }
+    m_usedArea += static_cast<unsigned long long>(width) * height;
+    return true;
+}
+
+void SkylinePacker::clear() {
+    m_skyline.assign(1, { 0, 0, m_width });
+    m_usedArea = 0;
+}
+
+float SkylinePacker::getOccupancy() const {
+    return static_cast<float>(static_cast<double>(m_usedArea) / (static_cast<double>(m_width) * m_height));
+}
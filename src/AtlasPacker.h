@@ -0,0 +1,37 @@
+#ifndef ATLAS_PACKER_H_INCLUDED
+#define ATLAS_PACKER_H_INCLUDED
+
+#include <vector>
+
+// Packs rectangles into a fixed size area with the skyline bottom left heuristic: the
+// top edge of everything placed so far is kept as a list of horizontal segments, and a
+// rectangle goes where its own top ends up lowest. Packing is fast and wastes little
+// when rectangles are inserted from the tallest to the shortest.
+class SkylinePacker {
+	struct Segment {
+		unsigned int m_x;
+		unsigned int m_y;
+		unsigned int m_width;
+	};
+
+	unsigned int m_width;
+	unsigned int m_height;
+	std::vector<Segment> m_skyline;     // sorted by x, covering the whole width
+	unsigned long long m_usedArea;
+
+public:
+	SkylinePacker(unsigned int width, unsigned int height);
+
+	// false (and nothing changed) if the rectangle doesn't fit anywhere
+	bool insert(unsigned int width, unsigned int height, unsigned int& x, unsigned int& y);
+	void clear();
+	// the part of the area covered by rectangles
+	float getOccupancy() const;
+
+private:
+	// the lowest y a rectangle starting at segment index can be placed at, false if it
+	// would stick out of the area
+	bool findY(unsigned int index, unsigned int width, unsigned int height, unsigned int& y) const;
+};
+
+#endif
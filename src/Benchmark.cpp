@@ -0,0 +1,1771 @@
+#include "Benchmark.h"
+#include "RangeAllocator.h"
+#include "MeshOptimizer.h"
+#include "MeshSimplifier.h"
+#include "MeshClusters.h"
+#include "ClusterCuller.h"
+#include "Frustum.h"
+#include "Bounds.h"
+#include "ObjectCuller.h"
+#include "BoundsTree.h"
+#include "OcclusionCuller.h"
+#include "SceneGraph.h"
+#include "EntityRegistry.h"
+#include "RenderComponents.h"
+#include "RenderSystems.h"
+#include "SystemScheduler.h"
+#include "JobSystem.h"
+#include "TextureCompression.h"
+#include "Ktx2.h"
+#include "MipGenerator.h"
+#include "AtlasPacker.h"
+#include "TextureResidency.h"
+#include "VirtualPages.h"
+#include "PageFile.h"
+
+#include <glm/glm.hpp>
+#include <glm/gtc/constants.hpp>
+#include <glm/gtc/matrix_transform.hpp>
+#include "stb_image/stb_image.h"
+
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <cmath>
+#include <cstdio>
+#include <filesystem>
+#include <fstream>
+#include <iostream>
+#include <limits>
+#include <memory>
+#include <random>
+#include <string>
+#include <system_error>
+#include <thread>
+#include <vector>
+
+// interleaved positions and normals, like the lit cubes before compression
+const unsigned int BENCHMARK_VERTEX_SIZE = 6 * sizeof(float);
+
+struct BenchmarkMesh {
+    std::vector<float> m_vertices;
+    std::vector<unsigned int> m_indices;
+
+    unsigned int getVertexCount() const {
+        return static_cast<unsigned int>(m_vertices.size() * sizeof(float) / BENCHMARK_VERTEX_SIZE);
+    }
+};
+
+// a torus hides parts of itself from most directions, so unlike a sphere it has overdraw
+static BenchmarkMesh createTorus(unsigned int rings, unsigned int segments) {
+    const float majorRadius = 1.0f;
+    const float minorRadius = 0.4f;
+    BenchmarkMesh mesh;
+    for (unsigned int r = 0; r < rings; ++r) {
+        float u = glm::two_pi<float>() * r / rings;
+        glm::vec3 ringCenter(glm::cos(u) * majorRadius, 0.0f, glm::sin(u) * majorRadius);
+        for (unsigned int s = 0; s < segments; ++s) {
+            float v = glm::two_pi<float>() * s / segments;
+            glm::vec3 normal(glm::cos(u) * glm::cos(v), glm::sin(v), glm::sin(u) * glm::cos(v));
+            glm::vec3 position = ringCenter + normal * minorRadius;
+            mesh.m_vertices.insert(mesh.m_vertices.end(),
+                { position.x, position.y, position.z, normal.x, normal.y, normal.z });
+        }
+    }
+    for (unsigned int r = 0; r < rings; ++r) {
+        for (unsigned int s = 0; s < segments; ++s) {
+            unsigned int a = r * segments + s;
+            unsigned int b = ((r + 1) % rings) * segments + s;
+            unsigned int c = r * segments + (s + 1) % segments;
+            unsigned int d = ((r + 1) % rings) * segments + (s + 1) % segments;
+            mesh.m_indices.insert(mesh.m_indices.end(), { a, c, b, b, c, d });
+        }
+    }
+    return mesh;
+}
+
+// a height field with open borders, like a piece of an outdoor scene
+static BenchmarkMesh createTerrain(unsigned int size) {
+    BenchmarkMesh mesh;
+    for (unsigned int z = 0; z <= size; ++z) {
+        for (unsigned int x = 0; x <= size; ++x) {
+            float u = static_cast<float>(x) / size;
+            float v = static_cast<float>(z) / size;
+            float height = 0.1f * glm::sin(u * 7.0f) * glm::cos(v * 5.0f) + 0.02f * glm::sin(u * 31.0f + v * 17.0f);
+            mesh.m_vertices.insert(mesh.m_vertices.end(),
+                { u * 2.0f - 1.0f, height, v * 2.0f - 1.0f, 0.0f, 1.0f, 0.0f });
+        }
+    }
+    for (unsigned int z = 0; z < size; ++z) {
+        for (unsigned int x = 0; x < size; ++x) {
+            unsigned int a = z * (size + 1) + x;
+            unsigned int b = a + 1;
+            unsigned int c = a + size + 1;
+            unsigned int d = c + 1;
+            mesh.m_indices.insert(mesh.m_indices.end(), { a, c, b, b, c, d });
+        }
+    }
+    return mesh;
+}
+
+// the worst case for every optimization: triangles and vertices in random order,
+// like a mesh exported without any care for the GPU
+static void shuffleMesh(BenchmarkMesh& mesh, std::mt19937& random) {
+    const unsigned int numTriangles = static_cast<unsigned int>(mesh.m_indices.size() / 3);
+    std::vector<unsigned int> triangleOrder(numTriangles);
+    for (unsigned int t = 0; t < numTriangles; ++t) {
+        triangleOrder[t] = t;
+    }
+    std::shuffle(triangleOrder.begin(), triangleOrder.end(), random);
+
+    const unsigned int vertexCount = mesh.getVertexCount();
+    std::vector<unsigned int> vertexOrder(vertexCount);
+    for (unsigned int v = 0; v < vertexCount; ++v) {
+        vertexOrder[v] = v;
+    }
+    std::shuffle(vertexOrder.begin(), vertexOrder.end(), random);
+
+    std::vector<unsigned int> indices;
+    indices.reserve(mesh.m_indices.size());
+    for (unsigned int t : triangleOrder) {
+        for (unsigned int e = 0; e < 3; ++e) {
+            indices.push_back(vertexOrder[mesh.m_indices[t * 3 + e]]);
+        }
+    }
+    std::vector<float> vertices(mesh.m_vertices.size());
+    for (unsigned int v = 0; v < vertexCount; ++v) {
+        std::copy(mesh.m_vertices.begin() + v * 6, mesh.m_vertices.begin() + v * 6 + 6,
+            vertices.begin() + vertexOrder[v] * 6);
+    }
+    mesh.m_indices.swap(indices);
+    mesh.m_vertices.swap(vertices);
+}
+
+// every triangle as its vertex positions, rotated to start at the smallest one
+// so that the winding stays part of the comparison
+static std::vector<std::vector<float>> getTriangles(const BenchmarkMesh& mesh) {
+    std::vector<std::vector<float>> triangles;
+    for (unsigned int t = 0; t < mesh.m_indices.size() / 3; ++t) {
+        std::vector<std::vector<float>> corners;
+        for (unsigned int e = 0; e < 3; ++e) {
+            const float* vertex = mesh.m_vertices.data() + mesh.m_indices[t * 3 + e] * 6;
+            corners.emplace_back(vertex, vertex + 6);
+        }
+        std::rotate(corners.begin(), std::min_element(corners.begin(), corners.end()), corners.end());
+        std::vector<float> triangle;
+        for (const std::vector<float>& corner : corners) {
+            triangle.insert(triangle.end(), corner.begin(), corner.end());
+        }
+        triangles.push_back(triangle);
+    }
+    std::sort(triangles.begin(), triangles.end());
+    return triangles;
+}
+
+static void printStatistics(const char* stage, const BenchmarkMesh& mesh) {
+    const unsigned int count = static_cast<unsigned int>(mesh.m_indices.size());
+    const unsigned int vertexCount = mesh.getVertexCount();
+    VertexCacheStatistics cache = analyzeVertexCache(mesh.m_indices.data(), count, vertexCount);
+    OverdrawStatistics overdraw = analyzeOverdraw(mesh.m_indices.data(), count, mesh.m_vertices.data(),
+        vertexCount, BENCHMARK_VERTEX_SIZE);
+    VertexFetchStatistics fetch = analyzeVertexFetch(mesh.m_indices.data(), count, vertexCount,
+        BENCHMARK_VERTEX_SIZE);
+    std::cout << stage << ": ACMR " << cache.m_acmr << ", ATVR " << cache.m_atvr
+        << ", overdraw " << overdraw.m_overdraw << ", overfetch " << fetch.m_overfetch << "\n";
+}
+
+template <typename Function>
+static double measureMilliseconds(Function function) {
+    auto start = std::chrono::steady_clock::now();
+    function();
+    auto end = std::chrono::steady_clock::now();
+    return std::chrono::duration<double, std::milli>(end - start).count();
+}
+
+// Meshes of random sizes added to and freed from a geometry arena's allocator in a
+// random order, like streamed levels. The buffer is simulated with one value per
+// element (the handle it belongs to) and moved the way GeometryArena::applyMoves does.
+// Checks that compaction leaves no holes and every allocation keeps its elements.
+static int runArenaBenchmark() {
+    std::mt19937 random(42);
+    std::uniform_int_distribution<unsigned int> size(24, 4096);
+    const unsigned int operations = 20000;
+    RangeAllocator allocator;
+    std::vector<unsigned int> buffer;
+    std::vector<unsigned int> live;
+    for (unsigned int i = 0; i < operations; ++i) {
+        if (live.size() < 200 || random() % 2 == 0) {
+            unsigned int handle = allocator.allocate(size(random));
+            const GeometryRange& range = allocator.get(handle);
+            buffer.resize(std::max<size_t>(buffer.size(), range.m_first + range.m_count));
+            std::fill(buffer.begin() + range.m_first, buffer.begin() + range.m_first + range.m_count, handle);
+            live.push_back(handle);
+        } else {
+            unsigned int index = random() % live.size();
+            allocator.free(live[index]);
+            live[index] = live.back();
+            live.pop_back();
+        }
+    }
+
+    const unsigned int endBefore = allocator.getEnd();
+    const unsigned int used = allocator.getUsed();
+    std::vector<RangeAllocator::Move> moves;
+    double time = measureMilliseconds([&]() {
+        moves = allocator.compact();
+    });
+    // packed into a temporary buffer and copied back
+    std::vector<unsigned int> packed(used);
+    for (const RangeAllocator::Move& move : moves) {
+        std::copy(buffer.begin() + move.m_from, buffer.begin() + move.m_from + move.m_count,
+            packed.begin() + move.m_to);
+    }
+    buffer = packed;
+
+    bool valid = allocator.getEnd() == used && allocator.getUsed() == used;
+    for (unsigned int handle : live) {
+        const GeometryRange& range = allocator.get(handle);
+        valid = valid && range.m_first + range.m_count <= used && std::all_of(buffer.begin() + range.m_first,
+            buffer.begin() + range.m_first + range.m_count, [handle](unsigned int value) { return value == handle; });
+    }
+    // new allocations go after the packed ones
+    unsigned int appended = allocator.allocate(1);
+    valid = valid && allocator.get(appended).m_first == used;
+    std::printf("%u live allocations after %u adds and frees: %.1f%% of %u elements were holes, "
+        "compacted to %u elements in %.3f ms (%u moves)\n", static_cast<unsigned int>(live.size()), operations,
+        100.0 * (endBefore - used) / endBefore, endBefore, used, time, static_cast<unsigned int>(moves.size()));
+    std::cout << (valid ? "OK\n" : "FAILED: holes left or allocations lost their elements\n");
+    return valid ? 0 : 1;
+}
+
+static int runMeshOptimizerBenchmark() {
+    std::mt19937 random(42);
+    BenchmarkMesh mesh = createTorus(384, 192);
+    shuffleMesh(mesh, random);
+    const unsigned int count = static_cast<unsigned int>(mesh.m_indices.size());
+    const unsigned int vertexCount = mesh.getVertexCount();
+    std::cout << "Optimizing a shuffled torus with " << count / 3 << " triangles and "
+        << vertexCount << " vertices\n";
+    printStatistics("Before", mesh);
+    std::vector<std::vector<float>> originalTriangles = getTriangles(mesh);
+
+    std::vector<unsigned int> cacheOrder;
+    double cacheTime = measureMilliseconds([&]() {
+        cacheOrder = optimizeVertexCache(mesh.m_indices.data(), count, vertexCount);
+    });
+    mesh.m_indices = cacheOrder;
+    printStatistics("Vertex cache", mesh);
+
+    const float overdrawThreshold = 1.05f;
+    std::vector<unsigned int> overdrawOrder;
+    double overdrawTime = measureMilliseconds([&]() {
+        overdrawOrder = optimizeOverdraw(mesh.m_indices.data(), count, mesh.m_vertices.data(), vertexCount,
+            BENCHMARK_VERTEX_SIZE, overdrawThreshold);
+    });
+    const float cacheAcmr = analyzeVertexCache(cacheOrder.data(), count, vertexCount).m_acmr;
+    const float overdrawAcmr = analyzeVertexCache(overdrawOrder.data(), count, vertexCount).m_acmr;
+    mesh.m_indices = overdrawOrder;
+    printStatistics("Overdraw", mesh);
+
+    unsigned int newVertexCount = 0;
+    double fetchTime = measureMilliseconds([&]() {
+        newVertexCount = optimizeVertexFetch(mesh.m_vertices.data(), vertexCount, BENCHMARK_VERTEX_SIZE,
+            mesh.m_indices.data(), count);
+    });
+    printStatistics("Vertex fetch", mesh);
+
+    std::cout << "Vertex cache " << cacheTime << " ms, overdraw " << overdrawTime << " ms, vertex fetch "
+        << fetchTime << " ms\n";
+
+    // the optimizations may only change the order of triangles and vertices
+    if (newVertexCount != vertexCount || getTriangles(mesh) != originalTriangles) {
+        std::cout << "FAILED: the optimized mesh has different triangles\n";
+        return 1;
+    }
+    std::cout << "Overdraw order ACMR " << overdrawAcmr / cacheAcmr << " times the vertex cache order's\n";
+    if (overdrawAcmr > cacheAcmr * overdrawThreshold) {
+        std::cout << "FAILED: the overdraw order's ACMR is above " << overdrawThreshold << " times the original\n";
+        return 1;
+    }
+    std::cout << "OK\n";
+    return 0;
+}
+
+static bool checkLodChain(const BenchmarkMesh& mesh, const std::vector<LodLevel>& levels) {
+    size_t previousCount = mesh.m_indices.size();
+    float previousError = 0.0f;
+    for (const LodLevel& level : levels) {
+        if (level.m_indices.size() >= previousCount || level.m_error < previousError) {
+            return false;
+        }
+        for (size_t i = 0; i < level.m_indices.size(); i += 3) {
+            const unsigned int* tri = level.m_indices.data() + i;
+            if (tri[0] == tri[1] || tri[1] == tri[2] || tri[2] == tri[0]
+                || std::max({ tri[0], tri[1], tri[2] }) >= mesh.getVertexCount()) {
+                return false;
+            }
+        }
+        previousCount = level.m_indices.size();
+        previousError = level.m_error;
+    }
+    return !levels.empty();
+}
+
+// A terrain whose halves meet at x = 0, where the right half has its own copies of the
+// vertices with x = -0, like a texture seam. Checks that both halves keep the same
+// vertices along it, so the simplified terrain has no crack there.
+static bool checkSeam() {
+    const unsigned int size = 64;
+    BenchmarkMesh mesh = createTerrain(size);
+    const unsigned int vertexCount = mesh.getVertexCount();
+    std::vector<unsigned int> copies(vertexCount, 0);
+    for (unsigned int z = 0; z <= size; ++z) {
+        unsigned int original = z * (size + 1) + size / 2;
+        copies[original] = mesh.getVertexCount();
+        std::vector<float> vertex(mesh.m_vertices.begin() + original * 6, mesh.m_vertices.begin() + original * 6 + 6);
+        vertex[0] = -0.0f;
+        mesh.m_vertices.insert(mesh.m_vertices.end(), vertex.begin(), vertex.end());
+    }
+    for (unsigned int i = 0; i < mesh.m_indices.size(); i += 3) {
+        bool right = false;
+        for (unsigned int e = 0; e < 3; ++e) {
+            right = right || mesh.m_indices[i + e] % (size + 1) > size / 2;
+        }
+        for (unsigned int e = 0; right && e < 3; ++e) {
+            unsigned int& index = mesh.m_indices[i + e];
+            index = copies[index] != 0 ? copies[index] : index;
+        }
+    }
+    float error = 0.0f;
+    std::vector<unsigned int> simplified = simplifyMesh(mesh.m_indices.data(),
+        static_cast<unsigned int>(mesh.m_indices.size()), mesh.m_vertices.data(), mesh.getVertexCount(),
+        BENCHMARK_VERTEX_SIZE, static_cast<unsigned int>(mesh.m_indices.size()) / 8, std::numeric_limits<float>::max(),
+        error);
+
+    // the rows of the seam vertices each half still uses
+    std::vector<bool> left(size + 1, false);
+    std::vector<bool> right(size + 1, false);
+    for (unsigned int index : simplified) {
+        if (index >= vertexCount) {
+            right[index - vertexCount] = true;
+        } else if (index % (size + 1) == size / 2) {
+            left[index / (size + 1)] = true;
+        }
+    }
+    std::cout << "Terrain with a seam: " << mesh.m_indices.size() / 3 << " to " << simplified.size() / 3
+        << " triangles, " << std::count(left.begin(), left.end(), true) << " seam vertices on the left, "
+        << std::count(right.begin(), right.end(), true) << " on the right\n";
+    return !simplified.empty() && left == right;
+}
+
+static int runMeshSimplifierBenchmark() {
+    const std::pair<const char*, BenchmarkMesh> meshes[] = {
+        { "torus", createTorus(384, 192) },
+        { "terrain", createTerrain(256) },
+    };
+    int result = 0;
+    for (const auto& named : meshes) {
+        const BenchmarkMesh& mesh = named.second;
+        const unsigned int count = static_cast<unsigned int>(mesh.m_indices.size());
+        std::cout << "Building the LOD chain of a " << named.first << " with " << count / 3 << " triangles\n";
+        std::vector<LodLevel> levels;
+        double time = measureMilliseconds([&]() {
+            levels = buildLodChain(mesh.m_indices.data(), count, mesh.m_vertices.data(), mesh.getVertexCount(),
+                BENCHMARK_VERTEX_SIZE, 6);
+        });
+        for (unsigned int i = 0; i < levels.size(); ++i) {
+            std::cout << "  LOD " << i + 1 << ": " << levels[i].m_indices.size() / 3 << " triangles, error "
+                << levels[i].m_error << "\n";
+        }
+        std::cout << "  " << time << " ms\n";
+        if (!checkLodChain(mesh, levels)) {
+            std::cout << "FAILED: the LOD chain is not valid\n";
+            result = 1;
+        }
+    }
+    if (!checkSeam()) {
+        std::cout << "FAILED: the simplified halves don't meet at the seam\n";
+        result = 1;
+    }
+    if (result == 0) {
+        std::cout << "OK\n";
+    }
+    return result;
+}
+
+// cameras at random places around the origin, looking at random points near it
+static std::vector<CullingView> createRandomViews(unsigned int count, float distance, std::mt19937& random,
+    float farPlane = 100.0f) {
+    std::uniform_real_distribution<float> unit(-1.0f, 1.0f);
+    std::vector<CullingView> views(count);
+    for (CullingView& view : views) {
+        glm::vec3 direction = glm::normalize(glm::vec3(unit(random), unit(random), unit(random)) + glm::vec3(1e-4f));
+        view.m_cameraPosition = direction * distance;
+        glm::vec3 target = glm::vec3(unit(random), unit(random), unit(random)) * distance * 0.5f;
+        glm::mat4 viewMatrix = glm::lookAt(view.m_cameraPosition, target, glm::vec3(0.0f, 1.0f, 0.0f));
+        glm::mat4 projection = glm::perspective(glm::radians(45.0f), 16.0f / 9.0f, 0.1f, farPlane);
+        view.m_frustum = extractFrustum(projection * viewMatrix);
+    }
+    return views;
+}
+
+// the slow and certain test the cluster culling must agree with: true if a triangle of the
+// cluster faces the camera and is not completely outside of one of the frustum's planes
+static bool hasVisibleTriangle(const BenchmarkMesh& mesh, const ClusteredMesh& clusters, const Cluster& cluster,
+    const CullingView& view) {
+    const unsigned int floatsPerVertex = BENCHMARK_VERTEX_SIZE / sizeof(float);
+    for (unsigned int i = cluster.m_firstIndex; i < cluster.m_firstIndex + cluster.m_indexCount; i += 3) {
+        glm::vec3 corners[3];
+        for (unsigned int e = 0; e < 3; ++e) {
+            const float* position = &mesh.m_vertices[clusters.m_indices[i + e] * floatsPerVertex];
+            corners[e] = glm::vec3(position[0], position[1], position[2]);
+        }
+        glm::vec3 normal = glm::cross(corners[1] - corners[0], corners[2] - corners[0]);
+        if (glm::dot(normal, view.m_cameraPosition - corners[0]) <= 0.0f) {
+            continue;
+        }
+        bool outside = false;
+        for (const glm::vec4& plane : view.m_frustum.m_planes) {
+            bool allOutside = true;
+            for (const glm::vec3& corner : corners) {
+                allOutside = allOutside && glm::dot(glm::vec3(plane), corner) + plane.w < 0.0f;
+            }
+            outside = outside || allOutside;
+        }
+        if (!outside) {
+            return true;
+        }
+    }
+    return false;
+}
+
+static int runClusterBenchmark() {
+    std::mt19937 random(42);
+    BenchmarkMesh mesh = createTorus(384, 192);
+    const unsigned int vertexCount = mesh.getVertexCount();
+    mesh.m_indices = optimizeVertexCache(mesh.m_indices.data(), static_cast<unsigned int>(mesh.m_indices.size()),
+        vertexCount);
+    const unsigned int count = static_cast<unsigned int>(mesh.m_indices.size());
+
+    ClusteredMesh clusters;
+    double buildTime = measureMilliseconds([&]() {
+        clusters = buildClusters(mesh.m_indices.data(), count, mesh.m_vertices.data(), vertexCount,
+            BENCHMARK_VERTEX_SIZE);
+    });
+    std::cout << "Split " << count / 3 << " triangles into " << clusters.m_clusters.size() << " clusters ("
+        << static_cast<float>(count / 3) / clusters.m_clusters.size() << " triangles each) in " << buildTime << " ms\n";
+
+    // every cluster must stay within the limits and every triangle must be in one
+    bool valid = clusters.m_indices.size() == count;
+    unsigned int nextIndex = 0;
+    for (const Cluster& cluster : clusters.m_clusters) {
+        std::vector<unsigned int> vertices(clusters.m_indices.begin() + cluster.m_firstIndex,
+            clusters.m_indices.begin() + cluster.m_firstIndex + cluster.m_indexCount);
+        std::sort(vertices.begin(), vertices.end());
+        unsigned int uniqueVertices = static_cast<unsigned int>(std::unique(vertices.begin(), vertices.end())
+            - vertices.begin());
+        valid = valid && cluster.m_firstIndex == nextIndex && uniqueVertices <= MAX_CLUSTER_VERTICES
+            && cluster.m_indexCount <= MAX_CLUSTER_TRIANGLES * 3;
+        nextIndex += cluster.m_indexCount;
+    }
+
+    // the clusters must survive a round trip through a file
+    const std::string filePath = "benchmark.clusters";
+    ClusteredMesh loaded;
+    double saveTime = measureMilliseconds([&]() {
+        valid = saveClusters(filePath, clusters) && valid;
+    });
+    double loadTime = measureMilliseconds([&]() {
+        valid = loadClusters(filePath, clusters.m_sourceHash, loaded) && valid;
+    });
+    std::remove(filePath.c_str());
+    valid = valid && loaded.m_indices == clusters.m_indices && loaded.m_clusters.size() == clusters.m_clusters.size();
+    std::cout << "Saved in " << saveTime << " ms, loaded in " << loadTime << " ms\n";
+
+    // the SIMD and the scalar culling must agree
+    const unsigned int numViews = 2000;
+    std::vector<CullingView> views = createRandomViews(numViews, 3.0f, random);
+    ClusterCuller culler(clusters.m_clusters);
+    std::vector<unsigned int> visible;
+    std::vector<unsigned int> visibleScalar;
+    unsigned long long totalVisible = 0;
+    double simdTime = 0.0;
+    double scalarTime = 0.0;
+    for (const CullingView& view : views) {
+        visible.clear();
+        visibleScalar.clear();
+        simdTime += measureMilliseconds([&]() {
+            culler.cull(view.m_frustum, view.m_cameraPosition, visible);
+        });
+        scalarTime += measureMilliseconds([&]() {
+            culler.cullScalar(view.m_frustum, view.m_cameraPosition, visibleScalar);
+        });
+        valid = valid && visible == visibleScalar;
+        totalVisible += visible.size();
+    }
+    std::cout << "Culling: " << 100.0 * totalVisible / (static_cast<double>(numViews) * culler.getCount())
+        << "% of the clusters visible, SIMD " << simdTime / numViews * 1000.0 << " us, scalar "
+        << scalarTime / numViews * 1000.0 << " us per view\n";
+
+    // a culled cluster must not have a triangle that would have been drawn
+    const unsigned int numCheckedViews = 200;
+    bool conservative = true;
+    unsigned long long drawnClusters = 0;
+    unsigned long long neededClusters = 0;
+    for (unsigned int v = 0; v < numCheckedViews; ++v) {
+        visible.clear();
+        culler.cull(views[v].m_frustum, views[v].m_cameraPosition, visible);
+        std::vector<bool> isVisible(clusters.m_clusters.size(), false);
+        for (unsigned int index : visible) {
+            isVisible[index] = true;
+        }
+        for (unsigned int c = 0; c < clusters.m_clusters.size(); ++c) {
+            bool needed = hasVisibleTriangle(mesh, clusters, clusters.m_clusters[c], views[v]);
+            conservative = conservative && (isVisible[c] || !needed);
+            neededClusters += needed ? 1 : 0;
+        }
+        drawnClusters += visible.size();
+    }
+    std::cout << "Per triangle check of " << numCheckedViews << " views: " << drawnClusters << " clusters drawn, "
+        << neededClusters << " have a visible triangle\n";
+
+    if (!valid) {
+        std::cout << "FAILED: the clusters are not valid\n";
+    } else if (!conservative) {
+        std::cout << "FAILED: a culled cluster has a visible triangle\n";
+    } else {
+        std::cout << "OK\n";
+    }
+    return valid && conservative ? 0 : 1;
+}
+
+static int runObjectCullingBenchmark() {
+    std::mt19937 random(42);
+    std::uniform_real_distribution<float> position(-100.0f, 100.0f);
+    std::uniform_real_distribution<float> size(0.25f, 2.0f);
+    const unsigned int numViews = 20;
+    bool valid = true;
+    for (unsigned int count : { 1000u, 10000u, 100000u, 1000000u }) {
+        ObjectCuller culler;
+        for (unsigned int i = 0; i < count; ++i) {
+            Bounds bounds;
+            bounds.m_center = glm::vec3(position(random), position(random), position(random));
+            bounds.m_extents = glm::vec3(size(random), size(random), size(random));
+            bounds.m_radius = glm::length(bounds.m_extents);
+            culler.add(bounds);
+        }
+
+        // Every way culls all views in a row, so it finds its own data in the caches like from
+        // frame to frame. The far plane of the second views is closer, so fewer objects are visible
+        for (float farPlane : { 100.0f, 40.0f }) {
+            std::vector<CullingView> views = createRandomViews(numViews, 50.0f, random, farPlane);
+            std::vector<std::vector<unsigned int>> visible(numViews), visibleLinear(numViews), visibleScalar(numViews);
+            // the first calls find out whether the tree pays off and build it
+            for (const CullingView& view : views) {
+                std::vector<unsigned int> warmUp;
+                culler.cull(view.m_frustum, warmUp);
+            }
+            double cullTime = measureMilliseconds([&]() {
+                for (unsigned int v = 0; v < numViews; ++v) {
+                    culler.cull(views[v].m_frustum, visible[v]);
+                }
+            });
+            double simdTime = measureMilliseconds([&]() {
+                for (unsigned int v = 0; v < numViews; ++v) {
+                    culler.cullLinear(views[v].m_frustum, visibleLinear[v]);
+                }
+            });
+            double scalarTime = measureMilliseconds([&]() {
+                for (unsigned int v = 0; v < numViews; ++v) {
+                    culler.cullScalar(views[v].m_frustum, visibleScalar[v]);
+                }
+            });
+            unsigned long long totalVisible = 0;
+            for (unsigned int v = 0; v < numViews; ++v) {
+                valid = valid && visible[v] == visibleScalar[v] && visibleLinear[v] == visibleScalar[v];
+                totalVisible += visible[v].size();
+            }
+            double tested = static_cast<double>(count) * numViews;
+            std::cout << count << " objects (" << 100.0 * totalVisible / tested << "% visible): cull "
+                << cullTime * 1000.0 / numViews << " us, SIMD " << tested / (simdTime * 1000.0) << " objects/us ("
+                << simdTime * 1000.0 / numViews << " us), scalar " << tested / (scalarTime * 1000.0)
+                << " objects/us\n";
+
+            // a few objects move between the calls, which the tree (if there is one) catches up on
+            for (unsigned int v = 0; v < numViews; ++v) {
+                for (unsigned int i = v; i < count; i += 1000) {
+                    Bounds bounds;
+                    bounds.m_center = glm::vec3(position(random), position(random), position(random));
+                    bounds.m_extents = glm::vec3(size(random), size(random), size(random));
+                    bounds.m_radius = glm::length(bounds.m_extents);
+                    culler.set(i, bounds);
+                }
+                visible[v].clear();
+                visibleScalar[v].clear();
+                culler.cull(views[v].m_frustum, visible[v]);
+                culler.cullScalar(views[v].m_frustum, visibleScalar[v]);
+                valid = valid && visible[v] == visibleScalar[v];
+            }
+        }
+    }
+    std::cout << (valid ? "OK\n" : "FAILED: the tree, SIMD and scalar results differ\n");
+    return valid ? 0 : 1;
+}
+
+// true if every object of expected is also in found
+static bool containsAll(std::vector<unsigned int> found, const std::vector<unsigned int>& expected) {
+    std::sort(found.begin(), found.end());
+    return std::includes(found.begin(), found.end(), expected.begin(), expected.end());
+}
+
+// true if found has the objects of expected (which is sorted) and no others
+static bool sameObjects(std::vector<unsigned int> found, const std::vector<unsigned int>& expected) {
+    std::sort(found.begin(), found.end());
+    return found == expected;
+}
+
+static int runBoundsTreeBenchmark() {
+    std::mt19937 random(42);
+    std::uniform_real_distribution<float> position(-100.0f, 100.0f);
+    std::uniform_real_distribution<float> size(0.25f, 2.0f);
+    std::uniform_real_distribution<float> unit(-1.0f, 1.0f);
+    const unsigned int numFrames = 30;
+    const unsigned int numViews = 20;
+    bool valid = true;
+    for (unsigned int count : { 10000u, 100000u }) {
+        std::vector<Bounds> objects(count);
+        std::vector<glm::vec3> velocities(count);
+        for (unsigned int i = 0; i < count; ++i) {
+            objects[i].m_center = glm::vec3(position(random), position(random), position(random));
+            objects[i].m_extents = glm::vec3(size(random), size(random), size(random));
+            objects[i].m_radius = glm::length(objects[i].m_extents);
+            velocities[i] = glm::vec3(unit(random), unit(random), unit(random)) * 0.05f;
+        }
+
+        BoundsTree tree;
+        double buildTime = measureMilliseconds([&]() {
+            for (unsigned int i = 0; i < count; ++i) {
+                tree.insert(i, objects[i]);
+            }
+        });
+        std::cout << count << " objects: built in " << buildTime << " ms, height " << tree.getHeight() << "\n";
+
+        // every object moves every frame, like a crowd or particles
+        unsigned long long reinserted = 0;
+        double moveTime = 0.0;
+        for (unsigned int frame = 0; frame < numFrames; ++frame) {
+            moveTime += measureMilliseconds([&]() {
+                for (unsigned int i = 0; i < count; ++i) {
+                    objects[i].m_center += velocities[i];
+                    reinserted += tree.move(i, objects[i], velocities[i]) ? 1 : 0;
+                }
+            });
+        }
+        double moves = static_cast<double>(count) * numFrames;
+        std::cout << "  move: " << moveTime * 1e6 / moves << " ns per object, " << 100.0 * reinserted / moves
+            << "% reinserted, " << moveTime / numFrames << " ms per frame, height " << tree.getHeight() << "\n";
+
+        ObjectCuller culler;
+        for (const Bounds& bounds : objects) {
+            culler.add(bounds);
+        }
+        std::vector<CullingView> views = createRandomViews(numViews, 50.0f, random);
+        std::vector<CullingView> nearViews = createRandomViews(numViews, 50.0f, random, 40.0f);
+        std::vector<std::vector<unsigned int>> visible(numViews), expectedVisible(numViews);
+        // all views in a row for both, like the culling benchmark. The near views see fewer objects
+        auto queryViews = [&](const std::vector<CullingView>& queried, const char* name) {
+            for (unsigned int v = 0; v < numViews; ++v) {
+                visible[v].clear();
+                expectedVisible[v].clear();
+            }
+            double treeTime = measureMilliseconds([&]() {
+                for (unsigned int v = 0; v < numViews; ++v) {
+                    tree.queryFrustum(queried[v].m_frustum, visible[v]);
+                }
+            });
+            double linearTime = measureMilliseconds([&]() {
+                for (unsigned int v = 0; v < numViews; ++v) {
+                    culler.cullLinear(queried[v].m_frustum, expectedVisible[v]);
+                }
+            });
+            unsigned long long totalVisible = 0;
+            for (unsigned int v = 0; v < numViews; ++v) {
+                valid = valid && sameObjects(visible[v], expectedVisible[v]);
+                totalVisible += expectedVisible[v].size();
+            }
+            std::cout << "  " << name << " (" << 100.0 * totalVisible / (static_cast<double>(count) * numViews)
+                << "% visible): tree " << treeTime * 1000.0 / numViews << " us, SIMD linear "
+                << linearTime * 1000.0 / numViews << " us per view\n";
+        };
+        queryViews(views, "frustum query");
+        double compactTime = measureMilliseconds([&]() {
+            tree.compact();
+        });
+        std::cout << "  compacted in " << compactTime << " ms\n";
+        queryViews(views, "frustum query");
+        queryViews(nearViews, "near frustum query");
+
+        std::vector<unsigned int> found;
+        std::vector<unsigned int> expected;
+        // picking and light assignment, checked against brute force tests of every object
+        double sphereTime = 0.0;
+        double rayTime = 0.0;
+        unsigned long long axisRayHits = 0;
+        for (unsigned int q = 0; q < numViews; ++q) {
+            glm::vec3 center(position(random), position(random), position(random));
+            float radius = 10.0f;
+            found.clear();
+            expected.clear();
+            sphereTime += measureMilliseconds([&]() {
+                tree.querySphere(center, radius, found);
+            });
+            for (unsigned int i = 0; i < count; ++i) {
+                glm::vec3 offset = glm::clamp(center, objects[i].m_center - objects[i].m_extents,
+                    objects[i].m_center + objects[i].m_extents) - center;
+                if (glm::dot(offset, offset) <= radius * radius) {
+                    expected.push_back(i);
+                }
+            }
+            valid = valid && sameObjects(found, expected);
+
+            glm::vec3 direction = glm::normalize(glm::vec3(unit(random), unit(random), unit(random))
+                + glm::vec3(1e-4f));
+            found.clear();
+            expected.clear();
+            rayTime += measureMilliseconds([&]() {
+                tree.queryRay(center, direction, 200.0f, found);
+            });
+            for (unsigned int i = 0; i < count; ++i) {
+                // the boxes that contain the ray's point closest to their center, some of the hits
+                glm::vec3 toCenter = objects[i].m_center - center;
+                float along = glm::clamp(glm::dot(toCenter, direction), 0.0f, 200.0f);
+                glm::vec3 offset = glm::abs(toCenter - direction * along) - objects[i].m_extents;
+                if (glm::all(glm::lessThanEqual(offset, glm::vec3(0.0f)))) {
+                    expected.push_back(i);
+                }
+            }
+            valid = valid && containsAll(found, expected);
+
+            // an axis aligned ray has zero components, which must not turn the slab tests into NaN
+            found.clear();
+            expected.clear();
+            tree.queryRay(center, glm::vec3(1.0f, 0.0f, 0.0f), 200.0f, found);
+            for (unsigned int i = 0; i < count; ++i) {
+                glm::vec3 offset = glm::abs(objects[i].m_center - center) - objects[i].m_extents;
+                if (offset.y <= 0.0f && offset.z <= 0.0f && objects[i].m_center.x + objects[i].m_extents.x >= center.x
+                    && objects[i].m_center.x - objects[i].m_extents.x <= center.x + 200.0f) {
+                    expected.push_back(i);
+                }
+            }
+            valid = valid && sameObjects(found, expected);
+            axisRayHits += expected.size();
+        }
+        std::cout << "  sphere query " << sphereTime * 1000.0 / numViews << " us, ray query "
+            << rayTime * 1000.0 / numViews << " us, " << axisRayHits << " axis aligned ray hits\n";
+
+        // objects that aren't in the tree are left alone by remove() and inserted by move()
+        tree.remove(count);
+        valid = valid && tree.getObjectCount() == count && !tree.contains(count);
+        tree.move(count + 10, objects[0]);
+        valid = valid && tree.getObjectCount() == count + 1 && tree.contains(count + 10);
+        tree.remove(count + 10);
+        tree.remove(count + 10);
+        valid = valid && tree.getObjectCount() == count && !tree.contains(count + 10);
+    }
+    std::cout << (valid ? "OK\n" : "FAILED: the tree missed objects\n");
+    return valid ? 0 : 1;
+}
+
+static int runOcclusionBenchmark() {
+    std::mt19937 random(42);
+    // a wall facing the camera with a torus in front of it, and a grid of boxes all around
+    BenchmarkMesh wall = createTerrain(64);
+    BenchmarkMesh torus = createTorus(96, 48);
+    glm::mat4 wallModel = glm::scale(glm::rotate(glm::mat4(1.0f), glm::half_pi<float>(), glm::vec3(1.0f, 0.0f, 0.0f)),
+        glm::vec3(4.0f));
+    glm::mat4 torusModel = glm::rotate(glm::translate(glm::mat4(1.0f), glm::vec3(-2.0f, 0.0f, 2.0f)),
+        glm::half_pi<float>(), glm::vec3(1.0f, 0.0f, 0.0f));
+    glm::mat4 projection = glm::perspective(glm::radians(45.0f), 16.0f / 9.0f, 0.1f, 100.0f);
+    glm::mat4 viewProjection = projection * glm::lookAt(glm::vec3(0.0f, 0.0f, 10.0f), glm::vec3(0.0f),
+        glm::vec3(0.0f, 1.0f, 0.0f));
+
+    std::vector<Bounds> objects;
+    for (int z = 0; z < 20; ++z) {
+        for (int y = -20; y < 20; ++y) {
+            for (int x = -30; x < 30; ++x) {
+                Bounds bounds;
+                bounds.m_center = glm::vec3(x * 0.5f, y * 0.5f, 5.0f - z * 1.5f);
+                bounds.m_extents = glm::vec3(0.1f);
+                bounds.m_radius = glm::length(bounds.m_extents);
+                objects.push_back(bounds);
+            }
+        }
+    }
+
+    OcclusionCuller culler;
+    const unsigned int numFrames = 20;
+    std::vector<unsigned char> firstResult;
+    bool valid = true;
+    for (unsigned int threads : { 1u, 2u, 4u, 8u }) {
+        JobSystem jobs(threads);
+        culler.setJobSystem(&jobs);
+        std::vector<unsigned char> visible(objects.size());
+        double rasterTime = 0.0;
+        double testTime = 0.0;
+        for (unsigned int frame = 0; frame < numFrames; ++frame) {
+            rasterTime += measureMilliseconds([&]() {
+                culler.beginFrame(viewProjection);
+                culler.addOccluder(wall.m_vertices.data(), wall.getVertexCount(), BENCHMARK_VERTEX_SIZE,
+                    wall.m_indices.data(), static_cast<unsigned int>(wall.m_indices.size()), wallModel);
+                culler.addOccluder(torus.m_vertices.data(), torus.getVertexCount(), BENCHMARK_VERTEX_SIZE,
+                    torus.m_indices.data(), static_cast<unsigned int>(torus.m_indices.size()), torusModel);
+                culler.rasterize();
+            });
+            testTime += measureMilliseconds([&]() {
+                for (unsigned int i = 0; i < objects.size(); ++i) {
+                    visible[i] = culler.isVisible(objects[i]) ? 1 : 0;
+                }
+            });
+        }
+        unsigned int occluded = static_cast<unsigned int>(std::count(visible.begin(), visible.end(), 0));
+        std::cout << threads << " threads: rasterized " << culler.getTriangleCount() << " triangles in "
+            << rasterTime / numFrames << " ms, " << objects.size() * numFrames / (testTime * 1000.0)
+            << " objects tested per us, " << 100.0 * occluded / objects.size() << "% occluded\n";
+        if (firstResult.empty()) {
+            firstResult = visible;
+        }
+        valid = valid && visible == firstResult;
+    }
+
+    // in front of the wall, right behind its middle and beside it
+    Bounds probe{ glm::vec3(0.0f, 0.0f, 0.5f), glm::vec3(0.1f), 0.2f };
+    valid = valid && culler.isVisible(probe);
+    probe.m_center = glm::vec3(1.0f, 1.0f, -1.0f);
+    valid = valid && !culler.isVisible(probe);
+    probe.m_center = glm::vec3(7.0f, 0.0f, -1.0f);
+    valid = valid && culler.isVisible(probe);
+    std::cout << (valid ? "OK\n" : "FAILED: wrong visibility\n");
+    return valid ? 0 : 1;
+}
+
+// the world matrix of a node computed the slow way, walking up to the root
+static glm::mat4 computeWorldMatrix(const SceneGraph& graph, const std::vector<unsigned int>& parents,
+    unsigned int node) {
+    glm::mat4 world(1.0f);
+    for (; node != SceneGraph::NO_NODE; node = parents[node]) {
+        glm::mat4 local = glm::translate(glm::mat4(1.0f), graph.getPosition(node))
+            * glm::mat4_cast(graph.getRotation(node)) * glm::scale(glm::mat4(1.0f), graph.getScale(node));
+        world = local * world;
+    }
+    return world;
+}
+
+static int runSceneGraphBenchmark() {
+    std::mt19937 random(42);
+    std::uniform_real_distribution<float> unit(-1.0f, 1.0f);
+    const unsigned int numFrames = 10;
+    bool valid = true;
+    for (unsigned int roots : { 100u, 1000u }) {
+        // every root has 10 children, every child 10 children and so on, 4 levels deep
+        SceneGraph graph;
+        std::vector<unsigned int> parents;
+        std::vector<unsigned int> level(roots, SceneGraph::NO_NODE);
+        std::vector<unsigned int> leaves;
+        for (unsigned int depth = 0; depth < 4; ++depth) {
+            std::vector<unsigned int> next;
+            for (unsigned int parent : level) {
+                for (unsigned int child = 0; child < (depth == 0 ? 1u : 10u); ++child) {
+                    glm::vec3 position(unit(random), unit(random), unit(random));
+                    glm::quat rotation = glm::angleAxis(unit(random), glm::normalize(glm::vec3(unit(random),
+                        unit(random), unit(random)) + glm::vec3(1e-4f)));
+                    unsigned int node = graph.createNode(parent, position, rotation, glm::vec3(0.9f));
+                    parents.push_back(parent);
+                    next.push_back(node);
+                }
+            }
+            level = next;
+        }
+        leaves = level;
+        const unsigned int count = static_cast<unsigned int>(parents.size());
+        double sortTime = measureMilliseconds([&]() {
+            graph.update();
+        });
+        std::cout << count << " nodes: first update (with sorting) " << sortTime << " ms\n";
+
+        for (unsigned int threads : { 1u, 2u, 4u, 8u }) {
+            JobSystem jobs(threads);
+            graph.setJobSystem(&jobs);
+            graph.update();
+            double allTime = 0.0;
+            double someTime = 0.0;
+            double noneTime = 0.0;
+            for (unsigned int frame = 0; frame < numFrames; ++frame) {
+                // every root turns, so every node changes (the roots were created first)
+                for (unsigned int root = 0; root < roots; ++root) {
+                    graph.setRotation(root, glm::angleAxis(frame * 0.01f, glm::vec3(0.0f, 1.0f, 0.0f)));
+                }
+                allTime += measureMilliseconds([&]() {
+                    graph.update();
+                });
+                // 1% of the leaves move
+                for (unsigned int i = frame; i < leaves.size(); i += 100) {
+                    graph.setPosition(leaves[i], graph.getPosition(leaves[i]) + glm::vec3(0.01f));
+                }
+                someTime += measureMilliseconds([&]() {
+                    graph.update();
+                });
+                noneTime += measureMilliseconds([&]() {
+                    graph.update();
+                });
+            }
+            std::cout << "  " << threads << " threads: all changed " << allTime / numFrames << " ms, 1% changed "
+                << someTime / numFrames << " ms, nothing changed " << noneTime / numFrames << " ms\n";
+        }
+
+        for (unsigned int i = 0; i < 1000; ++i) {
+            unsigned int node = random() % count;
+            glm::mat4 expected = computeWorldMatrix(graph, parents, node);
+            const glm::mat4& world = graph.getWorldMatrix(node);
+            for (int column = 0; column < 4; ++column) {
+                valid = valid && glm::all(glm::lessThan(glm::abs(world[column] - expected[column]), glm::vec4(1e-4f)));
+            }
+        }
+    }
+    std::cout << (valid ? "OK\n" : "FAILED: wrong world matrices\n");
+    return valid ? 0 : 1;
+}
+
+// the usual object oriented layout the entity benchmark compares against: every object
+// and its parts are separate heap allocations, visited through pointers
+struct HeapRenderObject {
+    std::unique_ptr<TransformComponent> m_transform;
+    std::unique_ptr<Bounds> m_localBounds;
+    std::unique_ptr<Bounds> m_worldBounds;
+    std::unique_ptr<LightComponent> m_light;
+};
+
+static int runEntityBenchmark() {
+    std::mt19937 random(42);
+    std::uniform_real_distribution<float> position(-100.0f, 100.0f);
+    std::uniform_real_distribution<float> size(0.25f, 2.0f);
+    const unsigned int numFrames = 20;
+    bool valid = true;
+    bool faster = true;
+    for (unsigned int count : { 100000u, 500000u }) {
+        std::vector<TransformComponent> transforms;
+        std::vector<Bounds> localBounds;
+        for (unsigned int i = 0; i < count; ++i) {
+            transforms.push_back(makeTransform(glm::vec3(position(random), position(random), position(random))));
+            glm::vec3 extents(size(random), size(random), size(random));
+            localBounds.push_back({ glm::vec3(0.0f), extents, glm::length(extents) });
+        }
+
+        // the heap objects are allocated in random order, like objects created over time
+        std::vector<std::unique_ptr<HeapRenderObject>> objects(count);
+        std::vector<unsigned int> allocationOrder(count);
+        for (unsigned int i = 0; i < count; ++i) {
+            allocationOrder[i] = i;
+        }
+        std::shuffle(allocationOrder.begin(), allocationOrder.end(), random);
+        for (unsigned int i : allocationOrder) {
+            objects[i].reset(new HeapRenderObject());
+            objects[i]->m_transform.reset(new TransformComponent(transforms[i]));
+            objects[i]->m_localBounds.reset(new Bounds(localBounds[i]));
+            objects[i]->m_worldBounds.reset(new Bounds(localBounds[i]));
+            if (i % 1000 == 0) {
+                objects[i]->m_light.reset(new LightComponent{ glm::vec3(1.0f), 10.0f });
+            }
+        }
+
+        // entity i is object i, nothing is destroyed
+        EntityRegistry registry;
+        for (unsigned int i = 0; i < count; ++i) {
+            Entity entity = registry.create();
+            registry.add(entity, transforms[i]);
+            registry.add(entity, makeBounds(localBounds[i]));
+            if (i % 1000 == 0) {
+                registry.add(entity, LightComponent{ glm::vec3(1.0f), 10.0f });
+            }
+        }
+        std::vector<CullingView> views = createRandomViews(numFrames, 50.0f, random);
+        std::vector<Entity> visibleEntities;
+        std::vector<LightData> lights;
+        EntityCuller culler;
+        const CullingView* view = &views[0];
+        SystemScheduler scheduler;
+        scheduler.addSystem("transforms", [&registry]() {
+            updateTransforms(registry);
+        }, 0, EntityRegistry::getComponentMask<TransformComponent>());
+        scheduler.addSystem("bounds", [&registry]() {
+            updateBounds(registry);
+        }, EntityRegistry::getComponentMask<TransformComponent>(), EntityRegistry::getComponentMask<BoundsComponent>());
+        scheduler.addSystem("lights", [&registry, &lights]() {
+            gatherLights(registry, lights);
+        }, EntityRegistry::getComponentMask<TransformComponent, LightComponent>(), 0);
+        scheduler.addSystem("culling", [&]() {
+            culler.update(registry);
+            visibleEntities.clear();
+            culler.cull(view->m_frustum, visibleEntities);
+        }, EntityRegistry::getComponentMask<BoundsComponent>(), 0);
+
+        std::vector<unsigned int> visibleObjects;
+        std::vector<LightData> heapLights;
+        double heapTime = 0.0;
+        double entityTime = 0.0;
+        for (unsigned int frame = 0; frame < numFrames; ++frame) {
+            view = &views[frame];
+            // 10% of the objects move every frame
+            for (unsigned int i = frame; i < count; i += 10) {
+                glm::vec3 offset(0.0f, 0.1f, 0.0f);
+                objects[i]->m_transform->m_position += offset;
+                objects[i]->m_transform->m_dirty = 1;
+                TransformComponent& transform = registry.get<TransformComponent>(i);
+                transform.m_position += offset;
+                transform.m_dirty = 1;
+            }
+
+            heapTime += measureMilliseconds([&]() {
+                visibleObjects.clear();
+                heapLights.clear();
+                for (unsigned int i = 0; i < count; ++i) {
+                    HeapRenderObject& object = *objects[i];
+                    TransformComponent& transform = *object.m_transform;
+                    transform.m_changed = transform.m_dirty;
+                    if (transform.m_dirty) {
+                        transform.m_dirty = 0;
+                        transform.m_world = computeTransformMatrix(transform);
+                        *object.m_worldBounds = transformBounds(*object.m_localBounds, transform.m_world);
+                    }
+                    if (object.m_light) {
+                        heapLights.push_back({ glm::vec3(transform.m_world[3]), object.m_light->m_color,
+                            object.m_light->m_radius });
+                    }
+                    if (intersectsFrustum(view->m_frustum, *object.m_worldBounds)) {
+                        visibleObjects.push_back(i);
+                    }
+                }
+            });
+            entityTime += measureMilliseconds([&]() {
+                scheduler.run();
+            });
+
+            std::vector<unsigned int> visibleIndices;
+            for (Entity entity : visibleEntities) {
+                visibleIndices.push_back(getEntityIndex(entity));
+            }
+            std::sort(visibleIndices.begin(), visibleIndices.end());
+            valid = valid && visibleIndices == visibleObjects && lights.size() == heapLights.size();
+        }
+        std::cout << count << " entities (" << scheduler.getStageCount() << " stages): heap objects "
+            << heapTime / numFrames << " ms, sparse sets " << entityTime / numFrames << " ms per frame\n";
+        scheduler.printTimings();
+        // the point of the sparse sets, which culling that costs more than it saves once took away
+        faster = faster && entityTime < heapTime;
+    }
+    if (!valid) {
+        std::cout << "FAILED: the heap objects and entities differ\n";
+    } else if (!faster) {
+        std::cout << "FAILED: the sparse sets are slower than the heap objects\n";
+    } else {
+        std::cout << "OK\n";
+    }
+    return valid && faster ? 0 : 1;
+}
+
+static int runJobSystemBenchmark() {
+    std::mt19937 random(42);
+    std::uniform_real_distribution<float> position(-100.0f, 100.0f);
+    std::uniform_real_distribution<float> size(0.25f, 2.0f);
+    const unsigned int count = 1000000;
+    std::vector<Bounds> bounds(count);
+    for (Bounds& object : bounds) {
+        object.m_center = glm::vec3(position(random), position(random), position(random));
+        object.m_extents = glm::vec3(size(random), size(random), size(random));
+        object.m_radius = glm::length(object.m_extents);
+    }
+    glm::mat4 model = glm::rotate(glm::translate(glm::mat4(1.0f), glm::vec3(1.0f, 2.0f, 3.0f)), 0.5f,
+        glm::vec3(0.0f, 1.0f, 0.0f));
+    std::vector<Bounds> expected(count);
+    for (unsigned int i = 0; i < count; ++i) {
+        expected[i] = transformBounds(bounds[i], model);
+    }
+
+    const unsigned int numRuns = 10;
+    const unsigned int numJobs = 100000;
+    bool valid = true;
+    unsigned int maxThreads = std::max(8u, std::thread::hardware_concurrency());
+    std::cout << "transforming " << count << " bounds, " << std::thread::hardware_concurrency() << " cores\n";
+    for (unsigned int threads = 1; threads <= maxThreads; threads *= 2) {
+        JobSystem jobs(threads);
+        std::cout << threads << " threads:";
+        for (unsigned int grainSize : { 256u, 4096u, 65536u }) {
+            std::vector<Bounds> transformed(count);
+            double time = 0.0;
+            for (unsigned int run = 0; run < numRuns; ++run) {
+                time += measureMilliseconds([&]() {
+                    jobs.parallelFor(count, grainSize, [&](unsigned int begin, unsigned int end) {
+                        for (unsigned int i = begin; i < end; ++i) {
+                            transformed[i] = transformBounds(bounds[i], model);
+                        }
+                    });
+                });
+            }
+            for (unsigned int i = 0; i < count; ++i) {
+                valid = valid && transformed[i].m_center == expected[i].m_center
+                    && transformed[i].m_extents == expected[i].m_extents;
+            }
+            std::cout << " grain " << grainSize << " " << time / numRuns << " ms,";
+        }
+
+        // tiny jobs show what scheduling one costs
+        std::atomic<unsigned int> finished{ 0 };
+        JobCounter counter;
+        double jobTime = measureMilliseconds([&]() {
+            for (unsigned int i = 0; i < numJobs; ++i) {
+                jobs.run([&finished]() {
+                    ++finished;
+                }, &counter);
+            }
+            jobs.wait(counter);
+        });
+        valid = valid && finished == numJobs;
+        std::cout << " " << jobTime * 1000.0 / numJobs << " us per empty job\n";
+
+        // every sum waits for the jobs that fill the values, through the counter they share
+        for (unsigned int run = 0; run < 100; ++run) {
+            std::vector<unsigned int> values(64, 0);
+            unsigned long long sum = 0;
+            JobCounter filled;
+            JobCounter summed;
+            for (unsigned int i = 0; i < values.size(); ++i) {
+                jobs.run([&values, i]() {
+                    values[i] = i + 1;
+                }, &filled);
+            }
+            jobs.run([&values, &sum]() {
+                for (unsigned int value : values) {
+                    sum += value;
+                }
+            }, &summed, &filled);
+            jobs.wait(summed);
+            valid = valid && sum == 64 * 65 / 2;
+        }
+    }
+    std::cout << (valid ? "OK\n" : "FAILED: jobs ran wrong, twice or not at all\n");
+    return valid ? 0 : 1;
+}
+
+struct BenchmarkImage {
+    std::string m_name;
+    unsigned int m_width;
+    unsigned int m_height;
+    std::vector<unsigned char> m_pixels;
+};
+
+// the textures of the demo, or made up ones (smooth gradients, hard edges and noise) if
+// the program doesn't run from the repository
+static std::vector<BenchmarkImage> loadBenchmarkImages() {
+    std::vector<BenchmarkImage> images;
+    for (const char* path : { "res/textures/container.jpg", "res/textures/face.png", "res/textures/wall.jpg" }) {
+        int width, height, BPP;
+        unsigned char* pixels = stbi_load(path, &width, &height, &BPP, 4);
+        if (pixels) {
+            images.push_back({ path, static_cast<unsigned int>(width), static_cast<unsigned int>(height),
+                std::vector<unsigned char>(pixels, pixels + width * height * 4) });
+            stbi_image_free(pixels);
+        }
+    }
+    if (images.empty()) {
+        std::mt19937 random(42);
+        std::uniform_int_distribution<int> noise(-12, 12);
+        BenchmarkImage image{ "synthetic", 512, 512, std::vector<unsigned char>(512 * 512 * 4) };
+        for (unsigned int y = 0; y < image.m_height; ++y) {
+            for (unsigned int x = 0; x < image.m_width; ++x) {
+                unsigned char* pixel = &image.m_pixels[(y * image.m_width + x) * 4];
+                bool checker = ((x / 32) + (y / 32)) % 2 == 0;
+                pixel[0] = static_cast<unsigned char>(x / 2);
+                pixel[1] = static_cast<unsigned char>(std::clamp(static_cast<int>(y / 2) + noise(random), 0, 255));
+                pixel[2] = checker ? 200 : 40;
+                pixel[3] = static_cast<unsigned char>(255 - x / 4);
+            }
+        }
+        images.push_back(image);
+    }
+    return images;
+}
+
+// peak signal to noise ratio over the channels the format keeps
+static double computePsnr(const std::vector<unsigned char>& original, const std::vector<unsigned char>& decoded,
+    unsigned int channels) {
+    double squaredError = 0.0;
+    for (unsigned int i = 0; i < original.size(); i += 4) {
+        for (unsigned int c = 0; c < channels; ++c) {
+            double difference = static_cast<double>(original[i + c]) - decoded[i + c];
+            squaredError += difference * difference;
+        }
+    }
+    double meanSquaredError = squaredError / (original.size() / 4 * channels);
+    return meanSquaredError > 0.0 ? 10.0 * std::log10(255.0 * 255.0 / meanSquaredError) : 99.0;
+}
+
+static int runCompressionBenchmark() {
+    std::vector<BenchmarkImage> images = loadBenchmarkImages();
+    // lowest acceptable quality of every format, far below what the encoder reaches on
+    // ordinary images but above what a broken block layout gives
+    const double minPsnr[FORMAT_COUNT] = { 30.0, 30.0, 36.0, 34.0, 34.0, 28.0 };
+    JobSystem jobs;
+    bool valid = true;
+    std::cout << jobs.getThreadCount() << " threads\n";
+    for (const BenchmarkImage& image : images) {
+        std::cout << image.m_name << " (" << image.m_width << "x" << image.m_height << "):\n";
+        double megapixels = image.m_width * image.m_height / 1000000.0;
+        for (unsigned int f = 0; f < FORMAT_COUNT; ++f) {
+            CompressedFormat format = static_cast<CompressedFormat>(f);
+            const CompressedFormatInfo& info = getFormatInfo(format);
+            std::vector<unsigned char> blocks(getCompressedSize(format, image.m_width, image.m_height));
+            double serialTime = measureMilliseconds([&]() {
+                compressImage(image.m_pixels.data(), image.m_width, image.m_height, format, blocks.data());
+            });
+            std::vector<unsigned char> parallelBlocks(blocks.size());
+            double parallelTime = measureMilliseconds([&]() {
+                compressImage(image.m_pixels.data(), image.m_width, image.m_height, format, parallelBlocks.data(),
+                    &jobs);
+            });
+            std::vector<unsigned char> decoded(image.m_pixels.size());
+            decompressImage(blocks.data(), image.m_width, image.m_height, format, decoded.data());
+            double psnr = computePsnr(image.m_pixels, decoded, info.m_channels);
+            bool formatValid = psnr >= minPsnr[f] && blocks == parallelBlocks;
+
+            // the mip chain has to come back out of the file exactly as it went in
+            CompressedTexture texture = compressTexture(image.m_pixels.data(), image.m_width, image.m_height, format,
+                true, &jobs);
+            std::vector<unsigned char> file = writeKtx2(texture);
+            CompressedTexture loaded;
+            formatValid = formatValid && readKtx2(file.data(), static_cast<unsigned int>(file.size()), loaded)
+                && loaded.m_format == format && loaded.m_width == image.m_width
+                && loaded.m_height == image.m_height && loaded.m_levels == texture.m_levels;
+
+            std::printf("  %-5s PSNR %6.2f dB, %7.2f MPixels/s serial, %7.2f MPixels/s with jobs, "
+                "KTX2 %u levels %u bytes%s\n", info.m_name, psnr, megapixels * 1000.0 / serialTime,
+                megapixels * 1000.0 / parallelTime, static_cast<unsigned int>(texture.m_levels.size()),
+                static_cast<unsigned int>(file.size()), formatValid ? "" : " FAILED");
+            valid = valid && formatValid;
+        }
+    }
+    std::cout << (valid ? "OK\n" : "FAILED: the compressed textures are broken or too lossy\n");
+    return valid ? 0 : 1;
+}
+
+// how far every pixel of a level is from its mean, for the channels of the pattern
+static double computeDeviation(const std::vector<unsigned char>& pixels) {
+    double sum = 0.0;
+    double squaredSum = 0.0;
+    for (unsigned int i = 0; i < pixels.size(); i += 4) {
+        sum += pixels[i];
+        squaredSum += static_cast<double>(pixels[i]) * pixels[i];
+    }
+    double count = pixels.size() / 4.0;
+    return std::sqrt(std::max(0.0, squaredSum / count - (sum / count) * (sum / count)));
+}
+
+static int runMipBenchmark() {
+    const MipFilter filters[] = { MIP_FILTER_BOX, MIP_FILTER_KAISER };
+    const char* filterNames[] = { "box", "Kaiser" };
+    bool valid = true;
+
+    // a flat color has to stay exactly the same at every level, odd sizes included
+    const unsigned int flatWidth = 301, flatHeight = 157;
+    std::vector<unsigned char> flat(flatWidth * flatHeight * 4);
+    for (unsigned int i = 0; i < flat.size(); i += 4) {
+        flat[i] = 77;
+        flat[i + 1] = 150;
+        flat[i + 2] = 200;
+        flat[i + 3] = 128;
+    }
+    // a black and white checkerboard is 50% light, which is 188 in sRGB (not 128)
+    const unsigned int checkerSize = 64;
+    std::vector<unsigned char> checker(checkerSize * checkerSize * 4, 255);
+    // a sine above the Nyquist frequency of the next level, which a good filter removes
+    std::vector<unsigned char> stripes(checkerSize * checkerSize * 4, 255);
+    for (unsigned int y = 0; y < checkerSize; ++y) {
+        for (unsigned int x = 0; x < checkerSize; ++x) {
+            unsigned char value = (x + y) % 2 == 0 ? 0 : 255;
+            std::fill_n(&checker[(y * checkerSize + x) * 4], 3, value);
+            float stripe = 0.5f + 0.5f * std::sin(2.0f * glm::pi<float>() * x / 2.5f);
+            std::fill_n(&stripes[(y * checkerSize + x) * 4], 3, static_cast<unsigned char>(stripe * 255.0f + 0.5f));
+        }
+    }
+    for (unsigned int f = 0; f < 2; ++f) {
+        MipChain chain = generateMipChain(flat.data(), flatWidth, flatHeight, filters[f], true);
+        bool flatValid = chain.m_levels.back().size() == 4;
+        for (const std::vector<unsigned char>& level : chain.m_levels) {
+            flatValid = flatValid && std::equal(level.begin(), level.end(), flat.begin());
+        }
+        MipChain checkerChain = generateMipChain(checker.data(), checkerSize, checkerSize, filters[f], true);
+        // away from the edges, where the Kaiser filter's taps get clamped
+        unsigned int middle = checkerSize / 4;
+        unsigned char gray = checkerChain.m_levels[1][(middle * checkerSize / 2 + middle) * 4];
+        MipChain stripeChain = generateMipChain(stripes.data(), checkerSize, checkerSize, filters[f], false);
+        std::cout << filterNames[f] << ": flat color " << (flatValid ? "kept" : "CHANGED") << ", checkerboard "
+            << static_cast<int>(gray) << ", aliasing left from the sine " << computeDeviation(stripeChain.m_levels[1])
+            << " (" << computeDeviation(stripes) << " before)\n";
+        valid = valid && flatValid && gray >= 187 && gray <= 189;
+    }
+
+    std::vector<BenchmarkImage> images = loadBenchmarkImages();
+    const unsigned int numRuns = 10;
+    JobSystem jobs;
+    std::cout << jobs.getThreadCount() << " threads\n";
+    for (const BenchmarkImage& image : images) {
+        std::cout << image.m_name << " (" << image.m_width << "x" << image.m_height << "):";
+        double megapixels = image.m_width * image.m_height / 1000000.0;
+        for (unsigned int f = 0; f < 2; ++f) {
+            MipChain serial;
+            MipChain parallel;
+            double serialTime = 0.0;
+            double parallelTime = 0.0;
+            for (unsigned int run = 0; run < numRuns; ++run) {
+                serialTime += measureMilliseconds([&]() {
+                    serial = generateMipChain(image.m_pixels.data(), image.m_width, image.m_height, filters[f], true);
+                });
+                parallelTime += measureMilliseconds([&]() {
+                    parallel = generateMipChain(image.m_pixels.data(), image.m_width, image.m_height, filters[f], true,
+                        &jobs);
+                });
+            }
+            valid = valid && serial.m_levels == parallel.m_levels;
+            std::printf(" %s %.2f ms (%.1f MPixels/s), with jobs %.2f ms,", filterNames[f], serialTime / numRuns,
+                megapixels * 1000.0 * numRuns / serialTime, parallelTime / numRuns);
+        }
+        std::cout << '\n';
+    }
+
+    // the second load reads the cache the first one wrote, in a copy of the image so the
+    // repository stays clean
+    if (images[0].m_name != "synthetic") {
+        std::error_code error;
+        std::filesystem::path copy = std::filesystem::temp_directory_path(error) / "mip_benchmark_image";
+        std::filesystem::copy_file(images[0].m_name, copy, std::filesystem::copy_options::overwrite_existing, error);
+        std::filesystem::remove(getMipCachePath(copy.string()), error);
+        if (!error) {
+            MipChain generated;
+            MipChain cached;
+            double generateTime = measureMilliseconds([&]() {
+                loadMipChain(copy.string(), MIP_FILTER_KAISER, true, generated);
+            });
+            double cacheTime = measureMilliseconds([&]() {
+                loadMipChain(copy.string(), MIP_FILTER_KAISER, true, cached);
+            });
+            bool cacheValid = std::filesystem::exists(getMipCachePath(copy.string()))
+                && !generated.m_levels.empty() && generated.m_levels == cached.m_levels;
+            std::cout << "decoding and filtering " << generateTime << " ms, from the cache " << cacheTime
+                << " ms" << (cacheValid ? "\n" : " FAILED\n");
+            valid = valid && cacheValid;
+            std::filesystem::remove(getMipCachePath(copy.string()), error);
+            std::filesystem::remove(copy, error);
+        }
+    }
+    std::cout << (valid ? "OK\n" : "FAILED: the mip chains are wrong\n");
+    return valid ? 0 : 1;
+}
+
+struct PackedRect {
+    unsigned int m_bin;
+    unsigned int m_x, m_y, m_width, m_height;
+};
+
+// packs into as many bins as needed, false if a rectangle fit nowhere (not even an empty bin)
+static bool packRects(const std::vector<std::pair<unsigned int, unsigned int>>& sizes, unsigned int binSize,
+    std::vector<SkylinePacker>& bins, std::vector<PackedRect>& packed) {
+    for (const std::pair<unsigned int, unsigned int>& size : sizes) {
+        PackedRect rect{ 0, 0, 0, size.first, size.second };
+        while (rect.m_bin < bins.size() && !bins[rect.m_bin].insert(size.first, size.second, rect.m_x, rect.m_y)) {
+            ++rect.m_bin;
+        }
+        if (rect.m_bin == bins.size()) {
+            bins.emplace_back(binSize, binSize);
+            if (!bins.back().insert(size.first, size.second, rect.m_x, rect.m_y)) {
+                return false;
+            }
+        }
+        packed.push_back(rect);
+    }
+    return true;
+}
+
+static bool checkPacking(const std::vector<PackedRect>& packed, unsigned int binSize) {
+    for (unsigned int i = 0; i < packed.size(); ++i) {
+        const PackedRect& a = packed[i];
+        if (a.m_x + a.m_width > binSize || a.m_y + a.m_height > binSize) {
+            return false;
+        }
+        for (unsigned int j = i + 1; j < packed.size(); ++j) {
+            const PackedRect& b = packed[j];
+            bool overlap = a.m_bin == b.m_bin && a.m_x < b.m_x + b.m_width && b.m_x < a.m_x + a.m_width
+                && a.m_y < b.m_y + b.m_height && b.m_y < a.m_y + a.m_height;
+            if (overlap) {
+                return false;
+            }
+        }
+    }
+    return true;
+}
+
+static int runAtlasBenchmark() {
+    std::mt19937 random(42);
+    const unsigned int binSize = 2048;
+    const unsigned int count = 2000;
+    bool valid = true;
+    // square power of two icons and sprites, then arbitrary sizes like glyphs and decals
+    std::uniform_int_distribution<unsigned int> power(4, 8);
+    std::uniform_int_distribution<unsigned int> size(8, 200);
+    std::vector<std::pair<unsigned int, unsigned int>> squares(count);
+    std::vector<std::pair<unsigned int, unsigned int>> mixed(count);
+    for (unsigned int i = 0; i < count; ++i) {
+        unsigned int side = 1u << power(random);
+        squares[i] = { side, side };
+        mixed[i] = { size(random), size(random) };
+    }
+    const std::pair<const char*, std::vector<std::pair<unsigned int, unsigned int>>*> sets[] = {
+        { "power of two squares", &squares }, { "mixed sizes", &mixed } };
+    for (const auto& set : sets) {
+        for (bool sorted : { false, true }) {
+            std::vector<std::pair<unsigned int, unsigned int>> sizes = *set.second;
+            if (sorted) {
+                std::sort(sizes.begin(), sizes.end(), [](const std::pair<unsigned int, unsigned int>& a,
+                    const std::pair<unsigned int, unsigned int>& b) {
+                    return a.second > b.second;
+                });
+            }
+            std::vector<SkylinePacker> bins;
+            std::vector<PackedRect> packed;
+            bool packedAll = false;
+            double time = measureMilliseconds([&]() {
+                packedAll = packRects(sizes, binSize, bins, packed);
+            });
+            // every bin but the last is full, the last one's occupancy says nothing
+            double occupancy = 0.0;
+            for (unsigned int i = 0; i + 1 < bins.size(); ++i) {
+                occupancy += bins[i].getOccupancy();
+            }
+            occupancy = bins.size() > 1 ? occupancy / (bins.size() - 1) : bins[0].getOccupancy();
+            bool setValid = packedAll && checkPacking(packed, binSize);
+            std::printf("%s%s: %u bins of %ux%u, %.1f%% occupied, %.2f us per rectangle%s\n", set.first,
+                sorted ? " (tallest first)" : "", static_cast<unsigned int>(bins.size()), binSize, binSize,
+                occupancy * 100.0, time * 1000.0 / count, setValid ? "" : " FAILED");
+            valid = valid && setValid;
+        }
+    }
+    std::cout << (valid ? "OK\n" : "FAILED: rectangles overlap or stick out\n");
+    return valid ? 0 : 1;
+}
+
+// Many scenes one after the other, each drawing a changing part of its own textures.
+// Checks that the resident textures never exceed the budget and that a scene that fits
+// stops loading textures once everything it draws is resident.
+static int runBudgetBenchmark() {
+    std::mt19937 random(42);
+    const unsigned int textureCount = 1000;
+    const unsigned int sceneCount = 20;
+    const unsigned int sceneTextures = 80;
+    const unsigned int framesPerScene = 300;
+    const unsigned long long budget = 128ull * 1024 * 1024;
+    TextureResidency residency(budget);
+    std::uniform_int_distribution<unsigned int> sizePower(8, 11);
+    std::vector<unsigned long long> fullBytes(textureCount);
+    for (unsigned int i = 0; i < textureCount; ++i) {
+        unsigned int width = 1u << sizePower(random);
+        unsigned int height = 1u << sizePower(random);
+        residency.add(width, height);
+        fullBytes[i] = TextureResidency::computeBytes(width, height, 0);
+    }
+
+    bool valid = true;
+    std::vector<bool> everLoaded(textureCount, false);
+    unsigned long long peakBytes = 0;
+    unsigned long long draws = 0;
+    unsigned long long fullResolutionDraws = 0;
+    std::uniform_int_distribution<unsigned int> texture(0, textureCount - 1);
+    double time = measureMilliseconds([&]() {
+        for (unsigned int scene = 0; scene < sceneCount; ++scene) {
+            std::vector<unsigned int> textures(sceneTextures);
+            for (unsigned int& t : textures) {
+                t = texture(random);
+            }
+            for (unsigned int frame = 0; frame < framesPerScene; ++frame) {
+                residency.nextFrame();
+                // the camera moves through the scene, so a sliding window of its textures is drawn
+                unsigned int first = frame * sceneTextures / framesPerScene;
+                for (unsigned int i = 0; i < sceneTextures / 2; ++i) {
+                    unsigned int t = textures[(first + i) % sceneTextures];
+                    fullResolutionDraws += residency.request(t) == 0 ? 1 : 0;
+                    everLoaded[t] = true;
+                    ++draws;
+                }
+                peakBytes = std::max(peakBytes, residency.getResidentBytes());
+                valid = valid && residency.getResidentBytes() <= budget;
+            }
+        }
+    });
+    unsigned long long unbudgetedBytes = 0;
+    for (unsigned int i = 0; i < textureCount; ++i) {
+        unbudgetedBytes += everLoaded[i] ? fullBytes[i] : 0;
+    }
+    const double megabyte = 1024.0 * 1024.0;
+    std::printf("%u scenes of %u frames: %.2f us per frame, peak %.1f of %.1f MB (%.1f MB without a budget)\n",
+        sceneCount, framesPerScene, time * 1000.0 / (sceneCount * framesPerScene), peakBytes / megabyte,
+        budget / megabyte, unbudgetedBytes / megabyte);
+    std::printf("%u loads, %u evictions, %u dropped mip levels, %.1f%% of draws at full resolution\n",
+        residency.getLoads(), residency.getEvictions(), residency.getDroppedLevels(),
+        100.0 * fullResolutionDraws / draws);
+
+    // a scene that fits loads every texture once, even with other textures resident before
+    std::vector<unsigned int> fitting;
+    unsigned long long fittingBytes = 0;
+    for (unsigned int i = 0; i < textureCount && fittingBytes + fullBytes[i] <= budget / 2; ++i) {
+        fitting.push_back(i);
+        fittingBytes += fullBytes[i];
+    }
+    unsigned int loadsBefore = residency.getLoads();
+    bool steady = true;
+    for (unsigned int frame = 0; frame < 100; ++frame) {
+        residency.nextFrame();
+        for (unsigned int t : fitting) {
+            steady = steady && residency.request(t) == 0;
+        }
+    }
+    steady = steady && residency.getLoads() - loadsBefore <= fitting.size();
+    std::printf("a fitting scene of %u textures: %u loads in 100 frames\n", static_cast<unsigned int>(fitting.size()),
+        residency.getLoads() - loadsBefore);
+
+    // a lowered budget is enforced on the next frame
+    residency.setBudget(budget / 4);
+    residency.nextFrame();
+    bool lowered = residency.getResidentBytes() <= budget / 4;
+
+    // a texture that failed to load gives its bytes back and isn't made resident again
+    residency.nextFrame();
+    residency.request(fitting[0]);
+    unsigned long long withDropped = residency.getResidentBytes();
+    residency.drop(fitting[0]);
+    bool dropped = residency.getResidentBytes() < withDropped;
+    residency.nextFrame();
+    residency.request(fitting[0]);
+    dropped = dropped && !residency.isResident(fitting[0]);
+
+    valid = valid && steady && lowered && dropped;
+    std::cout << (valid ? "OK\n" : "FAILED: over budget, reloads in a scene that fits or a dropped texture kept\n");
+    return valid ? 0 : 1;
+}
+
+// What a feedback pass would write looking at a ground plane textured with the virtual
+// texture: pages of finer levels near the bottom of the screen, coarser ones towards
+// the horizon, and nothing above it.
+static void renderFeedback(const VirtualTextureLayout& layout, float cameraX, float cameraY, unsigned int width,
+    unsigned int height, std::vector<unsigned char>& feedback) {
+    feedback.assign(width * height * 4, 0);
+    const unsigned int payload = getPagePayload(layout);
+    // the screen is this much of the texture wide at a distance of 1
+    const float span = 0.02f;
+    for (unsigned int y = 0; y < height * 3 / 4; ++y) {
+        // the distance along the ground grows towards the horizon
+        float distance = 1.0f / (1.0f - static_cast<float>(y) / height);
+        // texels per pixel of a feedback framebuffer 8 times smaller than the screen
+        float level = std::floor(std::log2(distance * span * layout.m_width / width) - 3.0f);
+        level = std::min(std::max(level, 0.0f), static_cast<float>(layout.m_levels - 1));
+        unsigned int levelIndex = static_cast<unsigned int>(level);
+        unsigned int levelWidth = std::max(1u, layout.m_width >> levelIndex);
+        unsigned int levelHeight = std::max(1u, layout.m_height >> levelIndex);
+        for (unsigned int x = 0; x < width; ++x) {
+            float u = cameraX + (static_cast<float>(x) / width - 0.5f) * distance * span;
+            float v = cameraY + distance * span;
+            if (u < 0.0f || u >= 1.0f || v < 0.0f || v >= 1.0f) {
+                continue;
+            }
+            unsigned char* pixel = &feedback[(y * width + x) * 4];
+            pixel[0] = static_cast<unsigned char>(static_cast<unsigned int>(u * levelWidth) / payload);
+            pixel[1] = static_cast<unsigned char>(static_cast<unsigned int>(v * levelHeight) / payload);
+            pixel[2] = static_cast<unsigned char>(levelIndex);
+            pixel[3] = 255;
+        }
+    }
+}
+
+// the page table's texel for a page has to be the finest cached page at or above it
+static bool checkPageTable(const VirtualTextureLayout& layout, const PageCache& cache, const PageTable& table,
+    unsigned int cacheColumns) {
+    for (unsigned int level = 0; level < layout.m_levels; ++level) {
+        unsigned int pagesX, pagesY;
+        getPageCount(layout, level, pagesX, pagesY);
+        const std::vector<unsigned char>& texels = table.getLevel(level);
+        const unsigned int side = layout.m_tableSize >> level;
+        for (unsigned int y = 0; y < pagesY; ++y) {
+            for (unsigned int x = 0; x < pagesX; ++x) {
+                unsigned int slot = 0;
+                unsigned int mapped = level;
+                while (!cache.findSlot(makePageID(mapped, x >> (mapped - level), y >> (mapped - level)), slot)) {
+                    if (++mapped == layout.m_levels) {
+                        return false;
+                    }
+                }
+                const unsigned char* texel = &texels[(y * side + x) * 4];
+                if (texel[0] != slot % cacheColumns || texel[1] != slot / cacheColumns || texel[2] != mapped
+                    || texel[3] != 255) {
+                    return false;
+                }
+            }
+        }
+    }
+    return true;
+}
+
+// A camera flying over a 16k x 16k virtual texture. The feedback is analysed into page
+// requests and the missing pages are cached (as if they loaded at once, up to a limit
+// per frame) in a page texture of 16 x 16 pages.
+static int runVirtualTextureBenchmark() {
+    bool valid = true;
+    VirtualTextureLayout layout;
+    if (!computeVirtualTextureLayout(16384, 16384, 128, 4, layout)) {
+        std::cout << "FAILED: no layout for the virtual texture\n";
+        return 1;
+    }
+    const unsigned int cacheColumns = 16;
+    const unsigned int pagesPerFrame = 16;
+    const unsigned int feedbackWidth = 160, feedbackHeight = 90;
+    const unsigned int frames = 600;
+    PageRequestAnalyser analyser(layout);
+    PageCache cache(cacheColumns * cacheColumns);
+    PageTable table(layout, cacheColumns);
+    const PageID coarsest = makePageID(layout.m_levels - 1, 0, 0);
+    unsigned int slot;
+    PageID evicted;
+    cache.insert(coarsest, true, slot, evicted);
+    table.update(coarsest, cache);
+
+    std::vector<unsigned char> feedback;
+    double analyseTime = 0.0, cacheTime = 0.0;
+    unsigned long long requests = 0, misses = 0, uploads = 0;
+    for (unsigned int frame = 0; frame < frames; ++frame) {
+        float t = static_cast<float>(frame) / frames;
+        renderFeedback(layout, 0.2f + 0.6f * t, 0.1f + 0.3f * std::sin(t * 6.28f) * 0.5f + 0.15f, feedbackWidth,
+            feedbackHeight, feedback);
+        const std::vector<PageRequest>* analysed = nullptr;
+        analyseTime += measureMilliseconds([&]() {
+            analysed = &analyser.analyse(feedback.data(), feedbackWidth * feedbackHeight);
+        });
+        // every request's parent is requested too, and comes before it
+        for (unsigned int i = 0; i < analysed->size(); ++i) {
+            PageID page = (*analysed)[i].m_page;
+            valid = valid && isValidPage(layout, page);
+            if (getPageLevel(page) + 1 < layout.m_levels) {
+                PageID parent = makePageID(getPageLevel(page) + 1, getPageX(page) / 2, getPageY(page) / 2);
+                auto found = std::find_if(analysed->begin(), analysed->begin() + i, [parent](const PageRequest& r) {
+                    return r.m_page == parent;
+                });
+                valid = valid && found != analysed->begin() + i && found->m_pixels >= (*analysed)[i].m_pixels;
+            }
+        }
+        requests += analysed->size();
+        cacheTime += measureMilliseconds([&]() {
+            cache.nextFrame();
+            unsigned int uploaded = 0;
+            for (const PageRequest& request : *analysed) {
+                if (cache.touch(request.m_page)) {
+                    continue;
+                }
+                ++misses;
+                if (uploaded == pagesPerFrame || !cache.insert(request.m_page, false, slot, evicted)) {
+                    continue;
+                }
+                ++uploaded;
+                if (evicted != NO_PAGE) {
+                    table.update(evicted, cache);
+                }
+                table.update(request.m_page, cache);
+            }
+            table.clearChanges();
+            uploads += uploaded;
+        });
+        if (frame % 50 == 0) {
+            valid = valid && checkPageTable(layout, cache, table, cacheColumns);
+        }
+    }
+    valid = valid && cache.findSlot(coarsest, slot) && checkPageTable(layout, cache, table, cacheColumns);
+    std::printf("%ux%u virtual texture, %u levels, %ux%u feedback: %.1f us analysing and %.1f us caching per frame\n",
+        layout.m_width, layout.m_height, layout.m_levels, feedbackWidth, feedbackHeight, analyseTime * 1000.0 / frames,
+        cacheTime * 1000.0 / frames);
+    std::printf("%.1f pages requested per frame, %.1f%% cached, %llu uploaded, %u evicted\n",
+        static_cast<double>(requests) / frames, 100.0 * (requests - misses) / requests, uploads,
+        cache.getEvictions());
+
+    // the pages of the page file are the texels of the mip chain around them
+    const std::string imagePath = "res/textures/gradient.png";
+    VirtualTextureLayout fileLayout;
+    MipChain chain;
+    if (loadPageFile(imagePath, 128, 4, fileLayout) && loadMipChain(imagePath, MIP_FILTER_KAISER, true, chain)) {
+        std::ifstream file(getPageFilePath(imagePath), std::ios::binary);
+        bool pagesValid = true;
+        std::vector<unsigned char> texels;
+        for (unsigned int level = 0; level < fileLayout.m_levels; ++level) {
+            unsigned int pagesX, pagesY;
+            getPageCount(fileLayout, level, pagesX, pagesY);
+            const unsigned int width = std::max(1u, chain.m_width >> level);
+            const unsigned int payload = getPagePayload(fileLayout);
+            for (unsigned int y = 0; y < pagesY; ++y) {
+                for (unsigned int x = 0; x < pagesX; ++x) {
+                    pagesValid = pagesValid && readPage(file, fileLayout, makePageID(level, x, y), texels);
+                    // the first texel inside the border
+                    const unsigned char* texel = &texels[(4 * 128 + 4) * 4];
+                    const unsigned char* source = &chain.m_levels[level][((y * payload) * width + x * payload) * 4];
+                    pagesValid = pagesValid && std::equal(texel, texel + 4, source);
+                }
+            }
+        }
+        std::printf("%s: %u levels of pages read back %s\n", imagePath.c_str(), fileLayout.m_levels,
+            pagesValid ? "correctly" : "WRONG");
+        valid = valid && pagesValid;
+    } else {
+        std::cout << "No " << imagePath << ", the page file is not checked\n";
+    }
+
+    std::cout << (valid ? "OK\n" : "FAILED: wrong requests, page table or pages\n");
+    return valid ? 0 : 1;
+}
+
+int runBenchmark(const std::string& name) {
+    if (name == "arena") {
+        return runArenaBenchmark();
+    } else if (name == "optimizer") {
+        return runMeshOptimizerBenchmark();
+    } else if (name == "simplifier") {
+        return runMeshSimplifierBenchmark();
+    } else if (name == "clusters") {
+        return runClusterBenchmark();
+    } else if (name == "culling") {
+        return runObjectCullingBenchmark();
+    } else if (name == "tree") {
+        return runBoundsTreeBenchmark();
+    } else if (name == "occlusion") {
+        return runOcclusionBenchmark();
+    } else if (name == "scenegraph") {
+        return runSceneGraphBenchmark();
+    } else if (name == "ecs") {
+        return runEntityBenchmark();
+    } else if (name == "jobs") {
+        return runJobSystemBenchmark();
+    } else if (name == "compression") {
+        return runCompressionBenchmark();
+    } else if (name == "mips") {
+        return runMipBenchmark();
+    } else if (name == "atlas") {
+        return runAtlasBenchmark();
+    } else if (name == "budget") {
+        return runBudgetBenchmark();
+    } else if (name == "virtual") {
+        return runVirtualTextureBenchmark();
+    }
+    std::cout << "Unknown benchmark " << name
+        << " (available: arena, optimizer, simplifier, clusters, culling, tree, occlusion, scenegraph, ecs, jobs,"
+        << " compression, mips, atlas, budget, virtual)\n";
+    return 1;
+}
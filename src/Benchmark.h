@@ -0,0 +1,12 @@
+#ifndef BENCHMARK_H_INCLUDED
+#define BENCHMARK_H_INCLUDED
+
+#include <string>
+
+// CPU-only benchmarks that run without a window or OpenGL context, so they also
+// work on machines without a GPU (run the program with --benchmark <name>).
+// Every benchmark also checks its results and returns a non-zero exit code if
+// they are wrong.
+int runBenchmark(const std::string& name);
+
+#endif
@@ -0,0 +1,47 @@
+#include "Bounds.h"
+
+#include <glm/glm.hpp>
+
+#include <algorithm>
+#include <cmath>
+#include <limits>
+
+Bounds computeBounds(const float* positions, unsigned int count, unsigned int stride) {
+    Bounds bounds{ glm::vec3(0.0f), glm::vec3(0.0f), 0.0f };
+    if (count == 0) {
+        return bounds;
+    }
+    const char* data = reinterpret_cast<const char*>(positions);
+    glm::vec3 minimum(std::numeric_limits<float>::max());
+    glm::vec3 maximum(-std::numeric_limits<float>::max());
+    for (unsigned int i = 0; i < count; ++i) {
+        const float* position = reinterpret_cast<const float*>(data + i * stride);
+        glm::vec3 point(position[0], position[1], position[2]);
+        minimum = glm::min(minimum, point);
+        maximum = glm::max(maximum, point);
+    }
+    bounds.m_center = (minimum + maximum) * 0.5f;
+    bounds.m_extents = (maximum - minimum) * 0.5f;
+
+    // the farthest point from the box center, usually much closer than the box's corners
+    float radiusSquared = 0.0f;
+    for (unsigned int i = 0; i < count; ++i) {
+        const float* position = reinterpret_cast<const float*>(data + i * stride);
+        glm::vec3 offset = glm::vec3(position[0], position[1], position[2]) - bounds.m_center;
+        radiusSquared = std::max(radiusSquared, glm::dot(offset, offset));
+    }
+    bounds.m_radius = std::sqrt(radiusSquared);
+    return bounds;
+}
+
+Bounds transformBounds(const Bounds& bounds, const glm::mat4& model) {
+    // every axis of the new box gets the absolute contributions of the old axes (Arvo)
+    glm::mat3 absolute(glm::abs(glm::vec3(model[0])), glm::abs(glm::vec3(model[1])), glm::abs(glm::vec3(model[2])));
+    float scale = std::max({ glm::length(glm::vec3(model[0])), glm::length(glm::vec3(model[1])),
+        glm::length(glm::vec3(model[2])) });
+    Bounds result;
+    result.m_center = glm::vec3(model * glm::vec4(bounds.m_center, 1.0f));
+    result.m_extents = absolute * bounds.m_extents;
+    result.m_radius = std::min(bounds.m_radius * scale, glm::length(result.m_extents));
+    return result;
+}
@@ -0,0 +1,21 @@
+#ifndef BOUNDS_H_INCLUDED
+#define BOUNDS_H_INCLUDED
+
+#include <glm/glm.hpp>
+
+// An axis aligned bounding box and a bounding sphere around the same center.
+// Sharing the center keeps them small, and lets SIMD culling test both with
+// the same loaded values.
+struct Bounds {
+	glm::vec3 m_center;
+	glm::vec3 m_extents;    // half the size of the box along each axis
+	float m_radius;
+};
+
+// bounds of count points with stride bytes between them
+Bounds computeBounds(const float* positions, unsigned int count, unsigned int stride);
+
+// the bounds of the transformed box and sphere (the box is only exact for rotations of 90 degrees)
+Bounds transformBounds(const Bounds& bounds, const glm::mat4& model);
+
+#endif
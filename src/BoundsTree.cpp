@@ -0,0 +1,525 @@
+#include "BoundsTree.h"
+#include "Bounds.h"
+#include "Frustum.h"
+#include "Simd.h"
+
+#include <glm/glm.hpp>
+
+#include <algorithm>
+#include <cstddef>
+#include <vector>
+
+const unsigned int BoundsTree::NULL_NODE;
+const unsigned int BoundsTree::QUERY_STACK_SIZE;
+
+// all six frustum planes are known to be passed
+const unsigned int ALL_PLANES_INSIDE = (1 << 6) - 1;
+
+// half the surface area of a box, what the cost of a tree is measured in
+static float getArea(const glm::vec3& minimum, const glm::vec3& maximum) {
+    glm::vec3 size = maximum - minimum;
+    return size.x * size.y + size.y * size.z + size.z * size.x;
+}
+
+#if USE_SSE
+// x, y, z and 0 from a vec3 that is followed by 4 more bytes
+static __m128 loadVec3(const float* values) {
+    __m128 loaded = _mm_loadu_ps(values);
+    return _mm_movelh_ps(loaded, _mm_unpackhi_ps(loaded, _mm_setzero_ps()));
+}
+#endif
+
+static bool touchesSphere(const glm::vec3& minimum, const glm::vec3& maximum, const glm::vec3& center,
+    float radius) {
+    glm::vec3 offset = glm::clamp(center, minimum, maximum) - center;
+    return glm::dot(offset, offset) <= radius * radius;
+}
+
+// Slab test: the ray hits a box if it is inside of all three slabs at the same time.
+// A ray parallel to a slab is inside of it everywhere or nowhere, which the division
+// can't tell (0 * infinity is NaN), so those axes only test the origin.
+static bool hitsBox(const glm::vec3& minimum, const glm::vec3& maximum, const glm::vec3& origin,
+    const glm::vec3& inverseDirection, const glm::bvec3& parallel, float maxDistance) {
+    glm::bvec3 outside = glm::lessThan(origin, minimum) || glm::greaterThan(origin, maximum);
+    if (glm::any(parallel && outside)) {
+        return false;
+    }
+    glm::vec3 first = (minimum - origin) * inverseDirection;
+    glm::vec3 second = (maximum - origin) * inverseDirection;
+    glm::vec3 entry = glm::mix(glm::min(first, second), glm::vec3(0.0f), parallel);
+    glm::vec3 exit = glm::mix(glm::max(first, second), glm::vec3(maxDistance), parallel);
+    float entryDistance = std::max({ entry.x, entry.y, entry.z, 0.0f });
+    float exitDistance = std::min({ exit.x, exit.y, exit.z, maxDistance });
+    return entryDistance <= exitDistance;
+}
+
+BoundsTree::BoundsTree(float margin, float displacementScale)
+    : m_root{ NULL_NODE }, m_freeList{ NULL_NODE }, m_objectCount{ 0 }, m_margin{ margin },
+    m_displacementScale{ displacementScale } {}
+
+unsigned int BoundsTree::allocateNode() {
+    unsigned int node = m_freeList;
+    if (node == NULL_NODE) {
+        node = static_cast<unsigned int>(m_nodes.size());
+        m_nodes.emplace_back();
+    } else {
+        m_freeList = m_nodes[node].m_parent;
+    }
+    Node& result = m_nodes[node];
+    result.m_parent = NULL_NODE;
+    result.m_children[0] = NULL_NODE;
+    result.m_children[1] = NULL_NODE;
+    result.m_height = 0;
+    return node;
+}
+
+void BoundsTree::freeNode(unsigned int node) {
+    m_nodes[node].m_parent = m_freeList;
+    m_nodes[node].m_height = -1;
+    m_freeList = node;
+}
+
+void BoundsTree::insert(unsigned int object, const Bounds& worldBounds) {
+    if (object >= m_objectLeaves.size()) {
+        m_objectLeaves.resize(object + 1, NULL_NODE);
+    }
+    if (m_objectLeaves[object] != NULL_NODE) {
+        move(object, worldBounds);
+        return;
+    }
+    unsigned int leaf = allocateNode();
+    Node& node = m_nodes[leaf];
+    node.m_min = worldBounds.m_center - worldBounds.m_extents - m_margin;
+    node.m_max = worldBounds.m_center + worldBounds.m_extents + m_margin;
+    node.m_children[1] = object;
+    m_objectLeaves[object] = leaf;
+    node.m_bounds = worldBounds;
+    insertLeaf(leaf);
+    ++m_objectCount;
+}
+
+bool BoundsTree::move(unsigned int object, const Bounds& worldBounds, const glm::vec3& displacement) {
+    if (!contains(object)) {
+        insert(object, worldBounds);
+        return true;
+    }
+    unsigned int leaf = m_objectLeaves[object];
+    m_nodes[leaf].m_bounds = worldBounds;
+    glm::vec3 minimum = worldBounds.m_center - worldBounds.m_extents;
+    glm::vec3 maximum = worldBounds.m_center + worldBounds.m_extents;
+    Node& node = m_nodes[leaf];
+    if (glm::all(glm::greaterThanEqual(minimum, node.m_min)) && glm::all(glm::lessThanEqual(maximum, node.m_max))) {
+        return false;
+    }
+
+    removeLeaf(leaf);
+    // enlarge the box towards where the object is heading
+    glm::vec3 predicted = displacement * m_displacementScale;
+    node.m_min = minimum - m_margin + glm::min(predicted, glm::vec3(0.0f));
+    node.m_max = maximum + m_margin + glm::max(predicted, glm::vec3(0.0f));
+    insertLeaf(leaf);
+    return true;
+}
+
+void BoundsTree::remove(unsigned int object) {
+    if (!contains(object)) {
+        return;
+    }
+    unsigned int leaf = m_objectLeaves[object];
+    removeLeaf(leaf);
+    freeNode(leaf);
+    m_objectLeaves[object] = NULL_NODE;
+    --m_objectCount;
+}
+
+bool BoundsTree::contains(unsigned int object) const {
+    return object < m_objectLeaves.size() && m_objectLeaves[object] != NULL_NODE;
+}
+
+void BoundsTree::clear() {
+    m_nodes.clear();
+    m_objectLeaves.clear();
+    m_root = NULL_NODE;
+    m_freeList = NULL_NODE;
+    m_objectCount = 0;
+}
+
+void BoundsTree::insertLeaf(unsigned int leaf) {
+    if (m_root == NULL_NODE) {
+        m_root = leaf;
+        m_nodes[leaf].m_parent = NULL_NODE;
+        return;
+    }
+
+    // Walk down to the sibling that makes the tree's total area grow the least. Every
+    // node on the way grows to include the leaf, which is the cost of going deeper.
+    glm::vec3 leafMin = m_nodes[leaf].m_min;
+    glm::vec3 leafMax = m_nodes[leaf].m_max;
+    unsigned int sibling = m_root;
+    while (!m_nodes[sibling].isLeaf()) {
+        const Node& node = m_nodes[sibling];
+        float area = getArea(node.m_min, node.m_max);
+        float combinedArea = getArea(glm::min(node.m_min, leafMin), glm::max(node.m_max, leafMax));
+        float cost = 2.0f * combinedArea;
+        float inheritedCost = 2.0f * (combinedArea - area);
+
+        float childCosts[2];
+        for (int i = 0; i < 2; ++i) {
+            const Node& child = m_nodes[node.m_children[i]];
+            float childArea = getArea(glm::min(child.m_min, leafMin), glm::max(child.m_max, leafMax));
+            if (!child.isLeaf()) {
+                childArea -= getArea(child.m_min, child.m_max);
+            }
+            childCosts[i] = childArea + inheritedCost;
+        }
+        if (cost < childCosts[0] && cost < childCosts[1]) {
+            break;
+        }
+        sibling = node.m_children[childCosts[0] < childCosts[1] ? 0 : 1];
+    }
+
+    // a new parent takes the place of the sibling
+    unsigned int oldParent = m_nodes[sibling].m_parent;
+    unsigned int newParent = allocateNode();
+    Node& parent = m_nodes[newParent];
+    parent.m_parent = oldParent;
+    parent.m_min = glm::min(leafMin, m_nodes[sibling].m_min);
+    parent.m_max = glm::max(leafMax, m_nodes[sibling].m_max);
+    parent.m_height = m_nodes[sibling].m_height + 1;
+    parent.m_children[0] = sibling;
+    parent.m_children[1] = leaf;
+    m_nodes[sibling].m_parent = newParent;
+    m_nodes[leaf].m_parent = newParent;
+    if (oldParent == NULL_NODE) {
+        m_root = newParent;
+    } else {
+        Node& grandParent = m_nodes[oldParent];
+        grandParent.m_children[grandParent.m_children[0] == sibling ? 0 : 1] = newParent;
+    }
+    refit(oldParent);
+}
+
+void BoundsTree::removeLeaf(unsigned int leaf) {
+    if (leaf == m_root) {
+        m_root = NULL_NODE;
+        return;
+    }
+
+    // the sibling takes the place of the parent
+    unsigned int parent = m_nodes[leaf].m_parent;
+    unsigned int grandParent = m_nodes[parent].m_parent;
+    unsigned int sibling = m_nodes[parent].m_children[m_nodes[parent].m_children[0] == leaf ? 1 : 0];
+    m_nodes[sibling].m_parent = grandParent;
+    freeNode(parent);
+    if (grandParent == NULL_NODE) {
+        m_root = sibling;
+    } else {
+        Node& node = m_nodes[grandParent];
+        node.m_children[node.m_children[0] == parent ? 0 : 1] = sibling;
+        refit(grandParent);
+    }
+}
+
+// rebalances and recomputes the boxes and heights from node up to the root
+void BoundsTree::refit(unsigned int node) {
+    while (node != NULL_NODE) {
+        node = balance(node);
+        Node& current = m_nodes[node];
+        const Node& first = m_nodes[current.m_children[0]];
+        const Node& second = m_nodes[current.m_children[1]];
+        current.m_min = glm::min(first.m_min, second.m_min);
+        current.m_max = glm::max(first.m_max, second.m_max);
+        current.m_height = 1 + std::max(first.m_height, second.m_height);
+        node = current.m_parent;
+    }
+}
+
+// If one child of node is more than one level higher than the other, the higher
+// child is rotated up to take node's place. The taller of its children stays with
+// it, the shorter one moves down to node. Returns the node now at node's place.
+unsigned int BoundsTree::balance(unsigned int node) {
+    Node& top = m_nodes[node];
+    if (top.isLeaf() || top.m_height < 2) {
+        return node;
+    }
+    int difference = m_nodes[top.m_children[1]].m_height - m_nodes[top.m_children[0]].m_height;
+    if (difference >= -1 && difference <= 1) {
+        return node;
+    }
+    int side = difference > 1 ? 1 : 0;
+    unsigned int lifted = top.m_children[side];
+    unsigned int other = top.m_children[1 - side];
+    Node& up = m_nodes[lifted];
+    unsigned int taller = up.m_children[0];
+    unsigned int shorter = up.m_children[1];
+    if (m_nodes[taller].m_height < m_nodes[shorter].m_height) {
+        std::swap(taller, shorter);
+    }
+
+    up.m_parent = top.m_parent;
+    top.m_parent = lifted;
+    if (up.m_parent == NULL_NODE) {
+        m_root = lifted;
+    } else {
+        Node& parent = m_nodes[up.m_parent];
+        parent.m_children[parent.m_children[0] == node ? 0 : 1] = lifted;
+    }
+    up.m_children[0] = node;
+    up.m_children[1] = taller;
+    top.m_children[side] = shorter;
+    m_nodes[shorter].m_parent = node;
+
+    const Node& otherNode = m_nodes[other];
+    const Node& shorterNode = m_nodes[shorter];
+    const Node& tallerNode = m_nodes[taller];
+    top.m_min = glm::min(otherNode.m_min, shorterNode.m_min);
+    top.m_max = glm::max(otherNode.m_max, shorterNode.m_max);
+    top.m_height = 1 + std::max(otherNode.m_height, shorterNode.m_height);
+    up.m_min = glm::min(top.m_min, tallerNode.m_min);
+    up.m_max = glm::max(top.m_max, tallerNode.m_max);
+    up.m_height = 1 + std::max(top.m_height, tallerNode.m_height);
+    return lifted;
+}
+
+#if USE_SSE
+// the frustum's planes as a structure of arrays, four per register. Planes 6 and 7 repeat plane 5
+struct QueryPlanes {
+    __m128 m_x[2], m_y[2], m_z[2], m_w[2];
+    __m128 m_absX[2], m_absY[2], m_absZ[2];
+
+    explicit QueryPlanes(const Frustum& frustum) {
+        const glm::vec4* planes = frustum.m_planes;
+        const glm::vec4 padded[8] = { planes[0], planes[1], planes[2], planes[3], planes[4], planes[5], planes[5],
+            planes[5] };
+        const __m128 signBit = _mm_set1_ps(-0.0f);
+        for (unsigned int h = 0; h < 2; ++h) {
+            const glm::vec4* four = &padded[h * 4];
+            m_x[h] = _mm_setr_ps(four[0].x, four[1].x, four[2].x, four[3].x);
+            m_y[h] = _mm_setr_ps(four[0].y, four[1].y, four[2].y, four[3].y);
+            m_z[h] = _mm_setr_ps(four[0].z, four[1].z, four[2].z, four[3].z);
+            m_w[h] = _mm_setr_ps(four[0].w, four[1].w, four[2].w, four[3].w);
+            m_absX[h] = _mm_andnot_ps(signBit, m_x[h]);
+            m_absY[h] = _mm_andnot_ps(signBit, m_y[h]);
+            m_absZ[h] = _mm_andnot_ps(signBit, m_z[h]);
+        }
+    }
+};
+#else
+// the scalar path tests the frustum's planes one by one
+using QueryPlanes = Frustum;
+#endif
+
+#if USE_SSE
+// the distances of the center to four of the planes (h = 0 or 1), and the box's extents along their normals,
+// summed in the same order as intersectsFrustum() does
+static void projectBox(const QueryPlanes& planes, unsigned int h, __m128 center, __m128 extents, __m128& distance,
+    __m128& radius) {
+    __m128 centerX = _mm_shuffle_ps(center, center, _MM_SHUFFLE(0, 0, 0, 0));
+    __m128 centerY = _mm_shuffle_ps(center, center, _MM_SHUFFLE(1, 1, 1, 1));
+    __m128 centerZ = _mm_shuffle_ps(center, center, _MM_SHUFFLE(2, 2, 2, 2));
+    __m128 extentX = _mm_shuffle_ps(extents, extents, _MM_SHUFFLE(0, 0, 0, 0));
+    __m128 extentY = _mm_shuffle_ps(extents, extents, _MM_SHUFFLE(1, 1, 1, 1));
+    __m128 extentZ = _mm_shuffle_ps(extents, extents, _MM_SHUFFLE(2, 2, 2, 2));
+    distance = _mm_add_ps(_mm_add_ps(_mm_add_ps(_mm_mul_ps(planes.m_x[h], centerX),
+        _mm_mul_ps(planes.m_y[h], centerY)), _mm_mul_ps(planes.m_z[h], centerZ)), planes.m_w[h]);
+    radius = _mm_add_ps(_mm_add_ps(_mm_mul_ps(planes.m_absX[h], extentX), _mm_mul_ps(planes.m_absY[h], extentY)),
+        _mm_mul_ps(planes.m_absZ[h], extentZ));
+}
+#endif
+
+// True if the box is outside of a plane, otherwise adds the planes it is inside of to inside
+static bool isOutside(const QueryPlanes& planes, const glm::vec3& minimum, const glm::vec3& maximum,
+    unsigned int& inside) {
+#if USE_SSE
+    const __m128 half = _mm_set1_ps(0.5f);
+    __m128 low = loadVec3(&minimum.x);
+    __m128 high = loadVec3(&maximum.x);
+    __m128 center = _mm_mul_ps(_mm_add_ps(high, low), half);
+    __m128 extents = _mm_mul_ps(_mm_sub_ps(high, low), half);
+    int outside = 0;
+    int insideMask = 0;
+    for (unsigned int h = 0; h < 2; ++h) {
+        __m128 distance, radius;
+        projectBox(planes, h, center, extents, distance, radius);
+        outside |= _mm_movemask_ps(_mm_cmplt_ps(distance, _mm_sub_ps(_mm_setzero_ps(), radius))) << h * 4;
+        insideMask |= _mm_movemask_ps(_mm_cmpge_ps(distance, radius)) << h * 4;
+    }
+    inside |= insideMask & ALL_PLANES_INSIDE;
+    return outside != 0;
+#else
+    glm::vec3 center = (minimum + maximum) * 0.5f;
+    glm::vec3 extents = (maximum - minimum) * 0.5f;
+    for (unsigned int p = 0; p < 6; ++p) {
+        if (inside & (1 << p)) {
+            continue;
+        }
+        const glm::vec4& plane = planes.m_planes[p];
+        float distance = glm::dot(glm::vec3(plane), center) + plane.w;
+        float radius = glm::dot(glm::abs(glm::vec3(plane)), extents);
+        if (distance < -radius) {
+            return true;
+        }
+        inside |= distance >= radius ? 1 << p : 0;
+    }
+    return false;
+#endif
+}
+
+// intersectsFrustum() with the planes already laid out for the query
+static bool intersects(const QueryPlanes& planes, const Bounds& bounds) {
+#if USE_SSE
+    __m128 center = loadVec3(&bounds.m_center.x);
+    __m128 extents = loadVec3(&bounds.m_extents.x);
+    __m128 sphereRadius = _mm_set1_ps(bounds.m_radius);
+    int outside = 0;
+    for (unsigned int h = 0; h < 2; ++h) {
+        __m128 distance, radius;
+        projectBox(planes, h, center, extents, distance, radius);
+        __m128 limit = _mm_sub_ps(_mm_setzero_ps(), _mm_min_ps(sphereRadius, radius));
+        outside |= _mm_movemask_ps(_mm_cmplt_ps(distance, limit));
+    }
+    return outside == 0;
+#else
+    return intersectsFrustum(planes, bounds);
+#endif
+}
+
+// A node is only put on the stack if its box isn't outside of the frustum, and both
+// children of a node are tested together, so the tests don't wait for each other.
+// Once a box is inside of all planes, its whole subtree is visible without more tests.
+// The leaves that are left are tested with the objects' own bounds like
+// intersectsFrustum() does, so the result doesn't depend on the enlarged boxes
+void BoundsTree::queryFrustum(const Frustum& frustum, std::vector<unsigned int>& objects) const {
+    static_assert(offsetof(Node, m_parent) == offsetof(Node, m_min) + sizeof(glm::vec3)
+        && offsetof(Node, m_height) == offsetof(Node, m_max) + sizeof(glm::vec3),
+        "a node's boxes are loaded as 4 floats");
+    if (m_root == NULL_NODE) {
+        return;
+    }
+    const Node& root = m_nodes[m_root];
+    if (root.isLeaf()) {
+        if (intersectsFrustum(frustum, root.m_bounds)) {
+            objects.push_back(root.getObject());
+        }
+        return;
+    }
+    const QueryPlanes planes(frustum);
+    unsigned int rootInside = 0;
+    if (isOutside(planes, root.m_min, root.m_max, rootInside)) {
+        return;
+    }
+
+    unsigned int stack[QUERY_STACK_SIZE];
+    unsigned int stackInside[QUERY_STACK_SIZE];
+    unsigned int size = 0;
+    stack[size] = m_root;
+    stackInside[size++] = rootInside;
+    while (size > 0) {
+        --size;
+        const Node& node = m_nodes[stack[size]];
+        unsigned int inside = stackInside[size];
+        for (unsigned int child : node.m_children) {
+            const Node& childNode = m_nodes[child];
+            if (childNode.isLeaf()) {
+                if (inside == ALL_PLANES_INSIDE || intersects(planes, childNode.m_bounds)) {
+                    objects.push_back(childNode.getObject());
+                }
+                continue;
+            }
+            unsigned int childInside = inside;
+            if (inside == ALL_PLANES_INSIDE || !isOutside(planes, childNode.m_min, childNode.m_max, childInside)) {
+                stack[size] = child;
+                stackInside[size++] = childInside;
+#if USE_SSE
+                _mm_prefetch(reinterpret_cast<const char*>(&m_nodes[childNode.m_children[0]]), _MM_HINT_T0);
+                _mm_prefetch(reinterpret_cast<const char*>(&m_nodes[childNode.m_children[1]]), _MM_HINT_T0);
+#endif
+            }
+        }
+    }
+}
+
+void BoundsTree::querySphere(const glm::vec3& center, float radius, std::vector<unsigned int>& objects) const {
+    if (m_root == NULL_NODE) {
+        return;
+    }
+    unsigned int stack[QUERY_STACK_SIZE];
+    unsigned int size = 0;
+    stack[size++] = m_root;
+    while (size > 0) {
+        const Node& node = m_nodes[stack[--size]];
+        if (!touchesSphere(node.m_min, node.m_max, center, radius)) {
+            continue;
+        }
+        if (!node.isLeaf()) {
+            stack[size++] = node.m_children[0];
+            stack[size++] = node.m_children[1];
+            continue;
+        }
+        const Bounds& bounds = node.m_bounds;
+        if (touchesSphere(bounds.m_center - bounds.m_extents, bounds.m_center + bounds.m_extents, center, radius)) {
+            objects.push_back(node.getObject());
+        }
+    }
+}
+
+void BoundsTree::queryRay(const glm::vec3& origin, const glm::vec3& direction, float maxDistance,
+    std::vector<unsigned int>& objects) const {
+    if (m_root == NULL_NODE) {
+        return;
+    }
+    glm::bvec3 parallel = glm::equal(direction, glm::vec3(0.0f));
+    glm::vec3 inverseDirection = 1.0f / glm::mix(direction, glm::vec3(1.0f), parallel);
+    unsigned int stack[QUERY_STACK_SIZE];
+    unsigned int size = 0;
+    stack[size++] = m_root;
+    while (size > 0) {
+        const Node& node = m_nodes[stack[--size]];
+        if (!hitsBox(node.m_min, node.m_max, origin, inverseDirection, parallel, maxDistance)) {
+            continue;
+        }
+        if (!node.isLeaf()) {
+            stack[size++] = node.m_children[0];
+            stack[size++] = node.m_children[1];
+            continue;
+        }
+        const Bounds& bounds = node.m_bounds;
+        if (hitsBox(bounds.m_center - bounds.m_extents, bounds.m_center + bounds.m_extents, origin, inverseDirection,
+            parallel, maxDistance)) {
+            objects.push_back(node.getObject());
+        }
+    }
+}
+
+unsigned int BoundsTree::copyDepthFirst(unsigned int node, unsigned int parent, std::vector<Node>& nodes) {
+    unsigned int index = static_cast<unsigned int>(nodes.size());
+    nodes.push_back(m_nodes[node]);
+    nodes[index].m_parent = parent;
+    if (nodes[index].isLeaf()) {
+        m_objectLeaves[nodes[index].getObject()] = index;
+    } else {
+        unsigned int first = copyDepthFirst(m_nodes[node].m_children[0], index, nodes);
+        unsigned int second = copyDepthFirst(m_nodes[node].m_children[1], index, nodes);
+        nodes[index].m_children[0] = first;
+        nodes[index].m_children[1] = second;
+    }
+    return index;
+}
+
+void BoundsTree::compact() {
+    std::vector<Node> nodes;
+    nodes.reserve(m_objectCount * 2);
+    if (m_root != NULL_NODE) {
+        m_root = copyDepthFirst(m_root, NULL_NODE, nodes);
+    }
+    m_nodes.swap(nodes);
+    m_freeList = NULL_NODE;
+}
+
+unsigned int BoundsTree::getObjectCount() const {
+    return m_objectCount;
+}
+
+int BoundsTree::getHeight() const {
+    return m_root == NULL_NODE ? 0 : m_nodes[m_root].m_height;
+}
@@ -0,0 +1,91 @@
+#ifndef BOUNDS_TREE_H_INCLUDED
+#define BOUNDS_TREE_H_INCLUDED
+
+#include "Bounds.h"
+#include "Frustum.h"
+
+#include <glm/glm.hpp>
+
+#include <vector>
+
+// A dynamic bounding volume hierarchy of axis aligned boxes (like the one in Box2D).
+// Objects are leaves, every inner node has two children and the box around both.
+// Insert, move and remove are O(log n): the tree is kept balanced with rotations on
+// the way back up from every change, so there is never a full rebuild.
+//
+// Leaves store a box enlarged by a margin (and by the last displacement, in the
+// direction the object moves), so objects that move a little don't change the tree
+// at all. Queries walk the tree with the enlarged boxes, then test the leaves with
+// the objects' own bounds, so they return the same objects as a test of every one.
+//
+// Objects are referred to by the index the caller gives them (like the indices of
+// an ObjectCuller), so compact() can reorder the nodes for faster traversal.
+class BoundsTree {
+	static const unsigned int NULL_NODE = 0xFFFFFFFF;
+	// The children of a node never differ in height by more than one, so a tree of
+	// 2^32 objects is at most 46 nodes high. A query's stack holds at most one node
+	// more than the height.
+	static const unsigned int QUERY_STACK_SIZE = 64;
+
+	// a node is one cache line
+	struct alignas(64) Node {
+		glm::vec3 m_min;
+		unsigned int m_parent;      // the next free node for nodes on the free list
+		glm::vec3 m_max;
+		int m_height;               // 0 for leaves, -1 for free nodes
+		unsigned int m_children[2]; // NULL_NODE and the object for leaves
+		Bounds m_bounds;            // only for leaves, the object's own bounds
+
+		bool isLeaf() const { return m_children[0] == NULL_NODE; }
+		unsigned int getObject() const { return m_children[1]; }
+	};
+
+	std::vector<Node> m_nodes;
+	std::vector<unsigned int> m_objectLeaves;   // the leaf of every object, NULL_NODE if it isn't in the tree
+	unsigned int m_root;
+	unsigned int m_freeList;
+	unsigned int m_objectCount;
+	float m_margin;
+	float m_displacementScale;
+
+	unsigned int allocateNode();
+	void freeNode(unsigned int node);
+	void insertLeaf(unsigned int leaf);
+	void removeLeaf(unsigned int leaf);
+	unsigned int balance(unsigned int node);
+	void refit(unsigned int node);
+	unsigned int copyDepthFirst(unsigned int node, unsigned int parent, std::vector<Node>& nodes);
+
+public:
+	// margin is added to every side of the leaf boxes, the displacement passed to move()
+	// is scaled by displacementScale to predict where the object will be next
+	explicit BoundsTree(float margin = 0.1f, float displacementScale = 2.0f);
+
+	void insert(unsigned int object, const Bounds& worldBounds);
+	// returns true if the tree had to change because the object left its enlarged box,
+	// objects that aren't in the tree are inserted
+	bool move(unsigned int object, const Bounds& worldBounds, const glm::vec3& displacement = glm::vec3(0.0f));
+	// does nothing for objects that aren't in the tree
+	void remove(unsigned int object);
+	bool contains(unsigned int object) const;
+	void clear();
+
+	// Append the objects that intersect the volume, in no particular order. The frustum
+	// query uses the box and sphere like intersectsFrustum(), the others only the box
+	void queryFrustum(const Frustum& frustum, std::vector<unsigned int>& objects) const;
+	void querySphere(const glm::vec3& center, float radius, std::vector<unsigned int>& objects) const;
+	// objects whose boxes the ray hits between origin and origin + direction * maxDistance,
+	// direction may have zero components
+	void queryRay(const glm::vec3& origin, const glm::vec3& direction, float maxDistance,
+		std::vector<unsigned int>& objects) const;
+
+	// Stores the nodes in depth first order, so a query mostly walks forward through
+	// memory and a subtree is one block of nodes. Worth doing after many changes.
+	void compact();
+
+	unsigned int getObjectCount() const;
+	// the height of the tree, the most nodes a query walks down
+	int getHeight() const;
+};
+
+#endif
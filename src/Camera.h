@@ -3,6 +3,18 @@
 
 #include <glm/glm.hpp>
 
+// all shader programs read the camera from the uniform block at this binding point
+const unsigned int CAMERA_BLOCK_BINDING = 0;
+
+// matches the std140 layout of the Camera uniform block in the shaders
+struct CameraBlock {
+	glm::mat4 m_view;
+	glm::mat4 m_projection;
+	glm::mat4 m_viewProjection;
+	glm::vec3 m_position;
+	float m_time;
+};
+
 class Camera {
 	glm::vec3 m_position;
 	glm::vec3 m_forward, m_right, m_up;                 // the camera's local axes
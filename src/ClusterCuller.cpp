@@ -0,0 +1,111 @@
+#include "ClusterCuller.h"
+#include "Simd.h"
+
+#include <glm/glm.hpp>
+
+#include <cmath>
+#include <limits>
+#include <vector>
+
+ClusterCuller::ClusterCuller() : m_count{ 0 } {}
+
+ClusterCuller::ClusterCuller(const std::vector<Cluster>& clusters)
+    : m_count{ static_cast<unsigned int>(clusters.size()) } {
+    // the padding clusters have a radius so negative that they are outside of every plane
+    const unsigned int padded = padToSimdWidth(m_count);
+    m_centerX.assign(padded, 0.0f);
+    m_centerY.assign(padded, 0.0f);
+    m_centerZ.assign(padded, 0.0f);
+    m_radius.assign(padded, -std::numeric_limits<float>::max());
+    m_axisX.assign(padded, 0.0f);
+    m_axisY.assign(padded, 0.0f);
+    m_axisZ.assign(padded, 0.0f);
+    m_cutoff.assign(padded, 1.0f);
+    for (unsigned int i = 0; i < m_count; ++i) {
+        const Cluster& cluster = clusters[i];
+        m_centerX[i] = cluster.m_center.x;
+        m_centerY[i] = cluster.m_center.y;
+        m_centerZ[i] = cluster.m_center.z;
+        m_radius[i] = cluster.m_radius;
+        m_axisX[i] = cluster.m_coneAxis.x;
+        m_axisY[i] = cluster.m_coneAxis.y;
+        m_axisZ[i] = cluster.m_coneAxis.z;
+        m_cutoff[i] = cluster.m_coneCutoff;
+    }
+}
+
+// A cluster is culled if its bounding sphere is completely outside of one plane, or if
+// every triangle faces away from the camera wherever it is inside the sphere. The second
+// holds when the direction from the camera to the sphere is inside the normal cone
+// by more than the sphere's radius (the bounded variant of the cone test)
+void ClusterCuller::cullScalar(const Frustum& frustum, const glm::vec3& cameraPosition,
+    std::vector<unsigned int>& visible) const {
+    for (unsigned int i = 0; i < m_count; ++i) {
+        glm::vec3 center(m_centerX[i], m_centerY[i], m_centerZ[i]);
+        bool outside = false;
+        for (const glm::vec4& plane : frustum.m_planes) {
+            outside = outside || glm::dot(glm::vec3(plane), center) + plane.w < -m_radius[i];
+        }
+        glm::vec3 toCenter = center - cameraPosition;
+        glm::vec3 axis(m_axisX[i], m_axisY[i], m_axisZ[i]);
+        bool backfacing = glm::dot(toCenter, axis) >= m_cutoff[i] * glm::length(toCenter) + m_radius[i];
+        if (!outside && !backfacing) {
+            visible.push_back(i);
+        }
+    }
+}
+
+void ClusterCuller::cull(const Frustum& frustum, const glm::vec3& cameraPosition,
+    std::vector<unsigned int>& visible) const {
+#if USE_SSE
+    __m128 planeX[6], planeY[6], planeZ[6], planeW[6];
+    for (unsigned int p = 0; p < 6; ++p) {
+        planeX[p] = _mm_set1_ps(frustum.m_planes[p].x);
+        planeY[p] = _mm_set1_ps(frustum.m_planes[p].y);
+        planeZ[p] = _mm_set1_ps(frustum.m_planes[p].z);
+        planeW[p] = _mm_set1_ps(frustum.m_planes[p].w);
+    }
+    const __m128 cameraX = _mm_set1_ps(cameraPosition.x);
+    const __m128 cameraY = _mm_set1_ps(cameraPosition.y);
+    const __m128 cameraZ = _mm_set1_ps(cameraPosition.z);
+
+    for (unsigned int i = 0; i < m_count; i += SSE_WIDTH) {
+        __m128 centerX = _mm_loadu_ps(&m_centerX[i]);
+        __m128 centerY = _mm_loadu_ps(&m_centerY[i]);
+        __m128 centerZ = _mm_loadu_ps(&m_centerZ[i]);
+        __m128 radius = _mm_loadu_ps(&m_radius[i]);
+        __m128 negativeRadius = _mm_sub_ps(_mm_setzero_ps(), radius);
+
+        __m128 culled = _mm_setzero_ps();
+        for (unsigned int p = 0; p < 6; ++p) {
+            __m128 distance = _mm_add_ps(_mm_add_ps(_mm_add_ps(_mm_mul_ps(planeX[p], centerX),
+                _mm_mul_ps(planeY[p], centerY)), _mm_mul_ps(planeZ[p], centerZ)), planeW[p]);
+            culled = _mm_or_ps(culled, _mm_cmplt_ps(distance, negativeRadius));
+        }
+
+        __m128 toCenterX = _mm_sub_ps(centerX, cameraX);
+        __m128 toCenterY = _mm_sub_ps(centerY, cameraY);
+        __m128 toCenterZ = _mm_sub_ps(centerZ, cameraZ);
+        __m128 length = _mm_sqrt_ps(_mm_add_ps(_mm_add_ps(_mm_mul_ps(toCenterX, toCenterX),
+            _mm_mul_ps(toCenterY, toCenterY)), _mm_mul_ps(toCenterZ, toCenterZ)));
+        __m128 alongAxis = _mm_add_ps(_mm_add_ps(_mm_mul_ps(toCenterX, _mm_loadu_ps(&m_axisX[i])),
+            _mm_mul_ps(toCenterY, _mm_loadu_ps(&m_axisY[i]))), _mm_mul_ps(toCenterZ, _mm_loadu_ps(&m_axisZ[i])));
+        __m128 limit = _mm_add_ps(_mm_mul_ps(_mm_loadu_ps(&m_cutoff[i]), length), radius);
+        culled = _mm_or_ps(culled, _mm_cmpge_ps(alongAxis, limit));
+
+        // one bit per lane, a cleared bit is a visible cluster
+        int culledMask = _mm_movemask_ps(culled);
+        for (unsigned int lane = 0; lane < SSE_WIDTH; ++lane) {
+            if (!(culledMask & (1 << lane))) {
+                visible.push_back(i + lane);
+            }
+        }
+    }
+#else
+    cullScalar(frustum, cameraPosition, visible);
+#endif
+}
+
+unsigned int ClusterCuller::getCount() const {
+    return m_count;
+}
@@ -0,0 +1,32 @@
+#ifndef CLUSTER_CULLER_H_INCLUDED
+#define CLUSTER_CULLER_H_INCLUDED
+
+#include "MeshClusters.h"
+#include "Frustum.h"
+
+#include <glm/glm.hpp>
+
+#include <vector>
+
+// Tests the clusters of one mesh against a view, four at a time with SSE where
+// available. The cluster bounds are kept as a structure of arrays so that every
+// SIMD lane works on a different cluster.
+class ClusterCuller {
+	std::vector<float> m_centerX, m_centerY, m_centerZ, m_radius;
+	std::vector<float> m_axisX, m_axisY, m_axisZ, m_cutoff;
+	unsigned int m_count;
+
+public:
+	ClusterCuller();
+	explicit ClusterCuller(const std::vector<Cluster>& clusters);
+
+	// frustum and camera position must be in the mesh's object space (see transformFrustum).
+	// The normal cone test assumes the model matrix has no non-uniform scale.
+	// Appends the indices of the visible clusters, in ascending order
+	void cull(const Frustum& frustum, const glm::vec3& cameraPosition, std::vector<unsigned int>& visible) const;
+	void cullScalar(const Frustum& frustum, const glm::vec3& cameraPosition, std::vector<unsigned int>& visible) const;
+
+	unsigned int getCount() const;
+};
+
+#endif
@@ -0,0 +1,205 @@
+#include "DrawBatch.h"
+#include "ShaderProgram.h"
+#include "GLExtensions.h"
+#include "GLState.h"
+#include "GeometryArena.h"
+#include "RenderQueue.h"
+
+#include <glad/glad.h>
+#include <glm/glm.hpp>
+
+#include <algorithm>
+#include <cstring>
+#include <memory>
+#include <numeric>
+#include <vector>
+
+// initial size of the per-frame segments of the stream buffers (they grow when needed)
+const unsigned int INITIAL_DRAWS_PER_FRAME = 4096;
+
+DrawBatch::DrawBatch()
+    : m_drawDataStream{ GL_TEXTURE_BUFFER, INITIAL_DRAWS_PER_FRAME * sizeof(DrawData) },
+      m_indirectOffset{ 0 }, m_drawDataGeneration{ 0 }, m_drawIDCapacity{ 0 }, m_drawCalls{ 0 } {
+    m_useIndirect = GLExtensions::supportsMultiDrawIndirect();
+    if (m_useIndirect) {
+        m_indirectStream = std::make_unique<StreamBuffer>(GL_DRAW_INDIRECT_BUFFER,
+            INITIAL_DRAWS_PER_FRAME * sizeof(DrawElementsIndirectCommand));
+    }
+    glGenBuffers(1, &m_drawIDBufferID);
+
+    // the draw data is read in the shaders through a texture buffer
+    glGenTextures(1, &m_drawDataTextureID);
+}
+
+DrawBatch::~DrawBatch() {
+    GLState::forgetBuffer(m_drawIDBufferID);
+    glDeleteBuffers(1, &m_drawIDBufferID);
+    GLState::forgetTexture(m_drawDataTextureID);
+    glDeleteTextures(1, &m_drawDataTextureID);
+}
+
+void DrawBatch::add(unsigned int vertexArrayID, const ShaderProgram* shader, unsigned int primitive,
+    unsigned int indexType, const DrawElementsIndirectCommand& command, const glm::mat4& model, unsigned int material,
+    unsigned int conditionQuery) {
+    Draw draw;
+    draw.m_vertexArrayID = vertexArrayID;
+    draw.m_shader = shader;
+    draw.m_primitive = primitive;
+    draw.m_indexType = indexType;
+    draw.m_command = command;
+    draw.m_data.m_model = model;
+    draw.m_data.m_material = material;
+    draw.m_conditionQuery = conditionQuery;
+    m_draws.push_back(draw);
+}
+
+void DrawBatch::flush() {
+    m_drawCalls = 0;
+    if (m_draws.empty()) {
+        return;
+    }
+
+    // group the draws so that each run of equal state becomes one multi draw
+    std::stable_sort(m_draws.begin(), m_draws.end(), [](const Draw& a, const Draw& b) {
+        if (a.m_shader != b.m_shader) {
+            return a.m_shader->getID() < b.m_shader->getID();
+        }
+        if (a.m_vertexArrayID != b.m_vertexArrayID) {
+            return a.m_vertexArrayID < b.m_vertexArrayID;
+        }
+        if (a.m_indexType != b.m_indexType) {
+            return a.m_indexType < b.m_indexType;
+        }
+        if (a.m_primitive != b.m_primitive) {
+            return a.m_primitive < b.m_primitive;
+        }
+        return a.m_conditionQuery < b.m_conditionQuery;
+    });
+
+    unsigned int first = upload() ? 0 : static_cast<unsigned int>(m_draws.size());
+    while (first < m_draws.size()) {
+        const Draw& draw = m_draws[first];
+        unsigned int last = first + 1;
+        while (last < m_draws.size() && !draw.m_conditionQuery && !m_draws[last].m_conditionQuery
+            && m_draws[last].m_shader == draw.m_shader
+            && m_draws[last].m_vertexArrayID == draw.m_vertexArrayID && m_draws[last].m_indexType == draw.m_indexType
+            && m_draws[last].m_primitive == draw.m_primitive) {
+            ++last;
+        }
+
+        draw.m_shader->addUniform1i("u_drawData", DRAW_DATA_TEXTURE_UNIT);
+        GLState::bindVertexArray(draw.m_vertexArrayID);
+        setPrimitiveRestart(draw.m_primitive, draw.m_indexType);
+        if (draw.m_conditionQuery) {
+            glBeginConditionalRender(draw.m_conditionQuery, GL_QUERY_NO_WAIT);
+        }
+        if (m_useIndirect) {
+            submitIndirect(first, last - first);
+        } else {
+            submitFallback(first, last - first);
+        }
+        if (draw.m_conditionQuery) {
+            glEndConditionalRender();
+        }
+        first = last;
+    }
+    GLState::bindVertexArray(0);
+
+    if (m_useIndirect) {
+        m_indirectStream->endFrame();
+    }
+    m_drawDataStream.endFrame();
+    m_draws.clear();
+}
+
+bool DrawBatch::upload() {
+    const unsigned int drawCount = static_cast<unsigned int>(m_draws.size());
+    const unsigned int drawDataSize = drawCount * sizeof(DrawData);
+    const unsigned int commandsSize = drawCount * sizeof(DrawElementsIndirectCommand);
+
+    // the draw data is aligned to whole DrawData records, so the draw ID
+    // of each draw is its index into the texture buffer
+    m_drawDataStream.beginFrame(drawDataSize + sizeof(DrawData));
+    StreamAllocation drawData = m_drawDataStream.allocate(drawDataSize, sizeof(DrawData));
+    if (!drawData.m_data) {
+        return false;
+    }
+    const unsigned int firstDrawID = drawData.m_offset / sizeof(DrawData);
+    DrawData* drawDataPtr = static_cast<DrawData*>(drawData.m_data);
+    m_commands.clear();
+    for (unsigned int i = 0; i < drawCount; ++i) {
+        std::memcpy(drawDataPtr + i, &m_draws[i].m_data, sizeof(DrawData));
+        DrawElementsIndirectCommand command = m_draws[i].m_command;
+        command.m_instanceCount = 1;
+        command.m_baseInstance = firstDrawID + i;
+        m_commands.push_back(command);
+    }
+    m_drawDataStream.unmap();
+
+    // the stream buffer is recreated when it grows, possibly with the same ID
+    GLState::bindTexture(DRAW_DATA_TEXTURE_UNIT, GL_TEXTURE_BUFFER, m_drawDataTextureID);
+    if (m_drawDataGeneration != m_drawDataStream.getGeneration()) {
+        m_drawDataGeneration = m_drawDataStream.getGeneration();
+        glTexBuffer(GL_TEXTURE_BUFFER, GL_RGBA32F, m_drawDataStream.getID());
+    }
+
+    if (m_useIndirect) {
+        m_indirectStream->beginFrame(commandsSize + sizeof(DrawElementsIndirectCommand));
+        StreamAllocation commands = m_indirectStream->allocate(commandsSize, sizeof(unsigned int));
+        if (!commands.m_data) {
+            return false;
+        }
+        std::memcpy(commands.m_data, m_commands.data(), commandsSize);
+        m_indirectStream->unmap();
+        m_indirectOffset = commands.m_offset;
+        GLState::bindBuffer(GL_DRAW_INDIRECT_BUFFER, m_indirectStream->getID());
+        growDrawIDBuffer(firstDrawID + drawCount);
+    }
+    return true;
+}
+
+unsigned int DrawBatch::getDrawCalls() const {
+    return m_drawCalls;
+}
+
+void DrawBatch::growDrawIDBuffer(unsigned int count) {
+    if (count <= m_drawIDCapacity) {
+        return;
+    }
+    m_drawIDCapacity = std::max(count, m_drawIDCapacity * 2);
+    std::vector<unsigned int> drawIDs(m_drawIDCapacity);
+    std::iota(drawIDs.begin(), drawIDs.end(), 0);
+    GLState::bindBuffer(GL_ARRAY_BUFFER, m_drawIDBufferID);
+    glBufferData(GL_ARRAY_BUFFER, m_drawIDCapacity * sizeof(unsigned int), drawIDs.data(), GL_STATIC_DRAW);
+}
+
+void DrawBatch::submitIndirect(unsigned int first, unsigned int count) {
+    // each draw is a single instance whose baseInstance is the draw ID, so an
+    // instanced attribute over the buffer [0, 1, 2, ...] reads back the draw ID
+    GLState::bindBuffer(GL_ARRAY_BUFFER, m_drawIDBufferID);
+    glEnableVertexAttribArray(DRAW_ID_ATTRIBUTE_LOCATION);
+    glVertexAttribIPointer(DRAW_ID_ATTRIBUTE_LOCATION, 1, GL_UNSIGNED_INT, sizeof(unsigned int), nullptr);
+    glVertexAttribDivisor(DRAW_ID_ATTRIBUTE_LOCATION, 1);
+
+    unsigned long long offset = m_indirectOffset + first * sizeof(DrawElementsIndirectCommand);
+    const void* offsetPtr = reinterpret_cast<const void*>(offset);
+    const Draw& draw = m_draws[first];
+    GLExtensions::multiDrawElementsIndirect(draw.m_primitive, draw.m_indexType, offsetPtr, count, 0);
+    ++m_drawCalls;
+
+    // leave the vertex array the way the mesh set it up
+    glDisableVertexAttribArray(DRAW_ID_ATTRIBUTE_LOCATION);
+}
+
+void DrawBatch::submitFallback(unsigned int first, unsigned int count) {
+    // a disabled attribute reads the current generic value, which is set per draw
+    const Draw& draw = m_draws[first];
+    const unsigned long long indexSize = getIndexSize(draw.m_indexType);
+    for (unsigned int i = first; i < first + count; ++i) {
+        const DrawElementsIndirectCommand& command = m_commands[i];
+        glVertexAttribI1ui(DRAW_ID_ATTRIBUTE_LOCATION, command.m_baseInstance);
+        const void* offsetPtr = reinterpret_cast<const void*>(command.m_firstIndex * indexSize);
+        glDrawElementsBaseVertex(draw.m_primitive, command.m_count, draw.m_indexType, offsetPtr, command.m_baseVertex);
+    }
+    m_drawCalls += count;
+}
\ No newline at end of file
@@ -0,0 +1,82 @@
+#ifndef DRAW_BATCH_H_INCLUDED
+#define DRAW_BATCH_H_INCLUDED
+
+#include "ShaderProgram.h"
+#include "StreamBuffer.h"
+
+#include <glm/glm.hpp>
+
+#include <memory>
+#include <vector>
+
+// the layout OpenGL expects for each draw in the indirect buffer
+struct DrawElementsIndirectCommand {
+	unsigned int m_count;
+	unsigned int m_instanceCount;
+	unsigned int m_firstIndex;
+	int m_baseVertex;
+	unsigned int m_baseInstance;
+};
+
+// per-draw data that shaders look up with their draw ID. It is stored in a
+// texture buffer as 5 RGBA32F texels: 4 columns of the model matrix, then the
+// material index (read back in the shader with floatBitsToUint)
+struct DrawData {
+	glm::mat4 m_model;
+	unsigned int m_material;
+	unsigned int m_padding[3];
+};
+
+// batched shaders read their draw ID from this attribute and the draw data from this texture unit
+const unsigned int DRAW_ID_ATTRIBUTE_LOCATION = 15;
+const unsigned int DRAW_DATA_TEXTURE_UNIT = 15;
+
+// Collects draws of submeshes and submits all draws that share a shader program and
+// vertex array with a single glMultiDrawElementsIndirect call. If the context does not
+// support it (the 3.3 context we ask for), it falls back to one glDrawElementsBaseVertex
+// per draw, which still avoids all per-draw uniform uploads. Draws that depend on an
+// occlusion query (conditional rendering) can't be part of a multi draw and are
+// submitted one by one after the others of their state.
+class DrawBatch {
+
+	struct Draw {
+		unsigned int m_vertexArrayID;
+		const ShaderProgram* m_shader;
+		unsigned int m_primitive;
+		unsigned int m_indexType;
+		DrawElementsIndirectCommand m_command;
+		DrawData m_data;
+		unsigned int m_conditionQuery;
+	};
+
+	std::vector<Draw> m_draws;
+	std::vector<DrawElementsIndirectCommand> m_commands;
+	std::unique_ptr<StreamBuffer> m_indirectStream;   // only with multi draw indirect, 3.3 has no such target
+	StreamBuffer m_drawDataStream;
+	unsigned int m_indirectOffset;            // where this frame's commands start in the indirect stream
+	unsigned int m_drawDataTextureID;
+	unsigned int m_drawDataGeneration;        // the stream buffer's generation attached to the texture
+	unsigned int m_drawIDBufferID;
+	unsigned int m_drawIDCapacity;
+	unsigned int m_drawCalls;
+	bool m_useIndirect;
+
+public:
+	DrawBatch();
+	~DrawBatch();
+
+	void add(unsigned int vertexArrayID, const ShaderProgram* shader, unsigned int primitive, unsigned int indexType,
+		const DrawElementsIndirectCommand& command, const glm::mat4& model, unsigned int material,
+		unsigned int conditionQuery = 0);
+	// call at most once per frame, every flush uses a new segment of the stream buffers
+	void flush();
+	unsigned int getDrawCalls() const;
+
+private:
+	bool upload();
+	void growDrawIDBuffer(unsigned int count);
+	void submitIndirect(unsigned int first, unsigned int count);
+	void submitFallback(unsigned int first, unsigned int count);
+};
+
+#endif
\ No newline at end of file
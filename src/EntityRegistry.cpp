@@ -0,0 +1,58 @@
+#include "EntityRegistry.h"
+
+#include <atomic>
+#include <iostream>
+#include <vector>
+
+EntityRegistry::EntityRegistry() : m_aliveCount{ 0 } {}
+
+unsigned int EntityRegistry::nextComponentType() {
+    static std::atomic<unsigned int> nextType{ 0 };
+    unsigned int type = nextType++;
+    if (type == MAX_COMPONENT_TYPES) {
+        std::cerr << "More than " << MAX_COMPONENT_TYPES << " component types, systems using the others are "
+            "scheduled alone\n";
+    }
+    return type;
+}
+
+Entity EntityRegistry::create() {
+    unsigned int index;
+    if (m_freeIndices.empty()) {
+        if (m_versions.size() >= MAX_ENTITIES) {
+            std::cerr << "Failed to create an entity, all " << MAX_ENTITIES << " are alive\n";
+            return NULL_ENTITY;
+        }
+        index = static_cast<unsigned int>(m_versions.size());
+        m_versions.push_back(0);
+    } else {
+        index = m_freeIndices.back();
+        m_freeIndices.pop_back();
+    }
+    ++m_aliveCount;
+    return (m_versions[index] << ENTITY_INDEX_BITS) | index;
+}
+
+void EntityRegistry::destroy(Entity entity) {
+    if (!isAlive(entity)) {
+        return;
+    }
+    for (const std::unique_ptr<ComponentPoolBase>& pool : m_pools) {
+        if (pool) {
+            pool->remove(entity);
+        }
+    }
+    unsigned int index = getEntityIndex(entity);
+    m_versions[index] = (m_versions[index] + 1) & (0xFFFFFFFF >> ENTITY_INDEX_BITS);
+    m_freeIndices.push_back(index);
+    --m_aliveCount;
+}
+
+bool EntityRegistry::isAlive(Entity entity) const {
+    unsigned int index = getEntityIndex(entity);
+    return index < m_versions.size() && m_versions[index] == getEntityVersion(entity);
+}
+
+unsigned int EntityRegistry::getAliveCount() const {
+    return m_aliveCount;
+}
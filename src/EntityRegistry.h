@@ -0,0 +1,227 @@
+#ifndef ENTITY_REGISTRY_H_INCLUDED
+#define ENTITY_REGISTRY_H_INCLUDED
+
+#include <memory>
+#include <vector>
+
+// An entity is an index and a version. The version changes every time an index is
+// reused, so a destroyed entity never finds the components of a new one.
+typedef unsigned int Entity;
+
+const Entity NULL_ENTITY = 0xFFFFFFFF;
+const unsigned int ENTITY_INDEX_BITS = 24;
+const unsigned int ENTITY_INDEX_MASK = (1u << ENTITY_INDEX_BITS) - 1;
+// the last index is never handed out, its entity with the last version would be NULL_ENTITY
+const unsigned int MAX_ENTITIES = ENTITY_INDEX_MASK;
+// component types with a bit of their own in component masks
+const unsigned int MAX_COMPONENT_TYPES = 64;
+
+inline unsigned int getEntityIndex(Entity entity) {
+	return entity & ENTITY_INDEX_MASK;
+}
+
+inline unsigned int getEntityVersion(Entity entity) {
+	return entity >> ENTITY_INDEX_BITS;
+}
+
+class ComponentPoolBase {
+public:
+	virtual ~ComponentPoolBase() = default;
+	virtual bool has(Entity entity) const = 0;
+	virtual void remove(Entity entity) = 0;
+};
+
+// A sparse set: the components of one type are packed into one array without holes,
+// and a sparse array maps entity indices to their place in it. Removing moves the
+// last component into the hole, so iterating over a pool never skips anything.
+template <typename T>
+class ComponentPool : public ComponentPoolBase {
+	static const unsigned int NO_COMPONENT = 0xFFFFFFFF;
+
+	std::vector<unsigned int> m_sparse;   // entity index -> position in the packed arrays
+	std::vector<Entity> m_entities;       // the entity of every component
+	std::vector<T> m_components;
+
+public:
+	T& add(Entity entity, const T& component) {
+		unsigned int index = getEntityIndex(entity);
+		if (index >= m_sparse.size()) {
+			m_sparse.resize(index + 1, NO_COMPONENT);
+		}
+		if (has(entity)) {
+			return m_components[m_sparse[index]] = component;
+		}
+		m_sparse[index] = static_cast<unsigned int>(m_components.size());
+		m_entities.push_back(entity);
+		m_components.push_back(component);
+		return m_components.back();
+	}
+
+	void remove(Entity entity) override {
+		if (!has(entity)) {
+			return;
+		}
+		unsigned int position = m_sparse[getEntityIndex(entity)];
+		m_components[position] = std::move(m_components.back());
+		m_entities[position] = m_entities.back();
+		m_sparse[getEntityIndex(m_entities[position])] = position;
+		m_sparse[getEntityIndex(entity)] = NO_COMPONENT;
+		m_components.pop_back();
+		m_entities.pop_back();
+	}
+
+	bool has(Entity entity) const override {
+		unsigned int index = getEntityIndex(entity);
+		return index < m_sparse.size() && m_sparse[index] != NO_COMPONENT && m_entities[m_sparse[index]] == entity;
+	}
+
+	T& get(Entity entity) {
+		return m_components[m_sparse[getEntityIndex(entity)]];
+	}
+
+	const T& get(Entity entity) const {
+		return m_components[m_sparse[getEntityIndex(entity)]];
+	}
+
+	// the packed arrays, in the same order
+	unsigned int size() const {
+		return static_cast<unsigned int>(m_components.size());
+	}
+
+	const Entity* getEntities() const {
+		return m_entities.data();
+	}
+
+	T* getComponents() {
+		return m_components.data();
+	}
+
+	const T* getComponents() const {
+		return m_components.data();
+	}
+};
+
+template <typename T>
+const unsigned int ComponentPool<T>::NO_COMPONENT;
+
+// Creates entities and stores their components, one ComponentPool per component type.
+// Systems iterate over the packed arrays of a pool (see each()), so a pass over all
+// entities with a component reads memory front to back instead of chasing pointers.
+class EntityRegistry {
+	std::vector<unsigned int> m_versions;     // the current version of every index
+	std::vector<unsigned int> m_freeIndices;
+	std::vector<std::unique_ptr<ComponentPoolBase>> m_pools;
+	unsigned int m_aliveCount;
+
+	static unsigned int nextComponentType();
+
+public:
+	EntityRegistry();
+
+	// NULL_ENTITY (with a message on std::cerr) once MAX_ENTITIES are alive
+	Entity create();
+	// removes all components of the entity
+	void destroy(Entity entity);
+	bool isAlive(Entity entity) const;
+	unsigned int getAliveCount() const;
+
+	// every component type gets a small number the first time it is used, for pools and masks
+	template <typename T>
+	static unsigned int getComponentType() {
+		static const unsigned int type = nextComponentType();
+		return type;
+	}
+
+	// One bit per component type, to describe what a system reads and writes. Types past
+	// MAX_COMPONENT_TYPES set every bit, so systems using them never run next to others.
+	template <typename T>
+	static unsigned long long getComponentBit() {
+		unsigned int type = getComponentType<T>();
+		return type < MAX_COMPONENT_TYPES ? 1ull << type : ~0ull;
+	}
+
+	template <typename... Components>
+	static unsigned long long getComponentMask() {
+		return (0ull | ... | getComponentBit<Components>());
+	}
+
+	template <typename T>
+	ComponentPool<T>& getPool() {
+		unsigned int type = getComponentType<T>();
+		if (type >= m_pools.size()) {
+			m_pools.resize(type + 1);
+		}
+		if (!m_pools[type]) {
+			m_pools[type].reset(new ComponentPool<T>());
+		}
+		return *static_cast<ComponentPool<T>*>(m_pools[type].get());
+	}
+
+	// the pools are created when a component type is first added, so other threads
+	// only read the pool list while systems run
+	template <typename T>
+	const ComponentPool<T>& getPool() const {
+		static const ComponentPool<T> empty;
+		unsigned int type = getComponentType<T>();
+		if (type >= m_pools.size() || !m_pools[type]) {
+			return empty;
+		}
+		return *static_cast<const ComponentPool<T>*>(m_pools[type].get());
+	}
+
+	template <typename T>
+	T& add(Entity entity, const T& component = T()) {
+		return getPool<T>().add(entity, component);
+	}
+
+	template <typename T>
+	void remove(Entity entity) {
+		getPool<T>().remove(entity);
+	}
+
+	template <typename T>
+	bool has(Entity entity) const {
+		return getPool<T>().has(entity);
+	}
+
+	template <typename T>
+	T& get(Entity entity) {
+		return getPool<T>().get(entity);
+	}
+
+	template <typename T>
+	const T& get(Entity entity) const {
+		return getPool<T>().get(entity);
+	}
+
+	// Calls function(entity, first, others...) for every entity that has all of the
+	// components. It walks the packed array of the first type, so that should be the
+	// rarest one, the others are looked up through their sparse arrays.
+	template <typename First, typename... Others, typename Function>
+	void each(Function function) {
+		ComponentPool<First>& pool = getPool<First>();
+		const Entity* entities = pool.getEntities();
+		First* components = pool.getComponents();
+		for (unsigned int i = 0; i < pool.size(); ++i) {
+			Entity entity = entities[i];
+			if ((getPool<Others>().has(entity) && ...)) {
+				function(entity, components[i], getPool<Others>().get(entity)...);
+			}
+		}
+	}
+
+	template <typename First, typename... Others, typename Function>
+	void each(Function function) const {
+		const ComponentPool<First>& pool = getPool<First>();
+		const Entity* entities = pool.getEntities();
+		const First* components = pool.getComponents();
+		for (unsigned int i = 0; i < pool.size(); ++i) {
+			Entity entity = entities[i];
+			if ((getPool<Others>().has(entity) && ...)) {
+				function(entity, components[i], getPool<Others>().get(entity)...);
+			}
+		}
+	}
+};
+
+#endif
@@ -0,0 +1,45 @@
+#include "Frustum.h"
+#include "Bounds.h"
+
+#include <glm/glm.hpp>
+
+#include <algorithm>
+
+static glm::vec4 normalizePlane(const glm::vec4& plane) {
+    return plane / glm::length(glm::vec3(plane));
+}
+
+Frustum extractFrustum(const glm::mat4& viewProjection) {
+    // a point is inside if -w <= x, y, z <= w in clip space, every inequality is a plane
+    glm::mat4 rows = glm::transpose(viewProjection);
+    Frustum frustum;
+    frustum.m_planes[0] = normalizePlane(rows[3] + rows[0]);
+    frustum.m_planes[1] = normalizePlane(rows[3] - rows[0]);
+    frustum.m_planes[2] = normalizePlane(rows[3] + rows[1]);
+    frustum.m_planes[3] = normalizePlane(rows[3] - rows[1]);
+    frustum.m_planes[4] = normalizePlane(rows[3] + rows[2]);
+    frustum.m_planes[5] = normalizePlane(rows[3] - rows[2]);
+    return frustum;
+}
+
+Frustum transformFrustum(const Frustum& frustum, const glm::mat4& model) {
+    // dot(plane, model * p) == dot(transpose(model) * plane, p)
+    glm::mat4 transform = glm::transpose(model);
+    Frustum result;
+    for (unsigned int i = 0; i < 6; ++i) {
+        result.m_planes[i] = normalizePlane(transform * frustum.m_planes[i]);
+    }
+    return result;
+}
+
+bool intersectsFrustum(const Frustum& frustum, const Bounds& bounds) {
+    for (const glm::vec4& plane : frustum.m_planes) {
+        // the sphere and the box are outside if their point closest to the plane's inside is outside
+        float distance = glm::dot(glm::vec3(plane), bounds.m_center) + plane.w;
+        float boxRadius = glm::dot(glm::abs(glm::vec3(plane)), bounds.m_extents);
+        if (distance < -std::min(bounds.m_radius, boxRadius)) {
+            return false;
+        }
+    }
+    return true;
+}
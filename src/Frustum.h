@@ -0,0 +1,31 @@
+#ifndef FRUSTUM_H_INCLUDED
+#define FRUSTUM_H_INCLUDED
+
+#include "Bounds.h"
+
+#include <glm/glm.hpp>
+
+// The six planes of a view frustum (left, right, bottom, top, near, far). They
+// point inwards and are normalized, so dot(plane, vec4(p, 1)) is the signed
+// distance of p to the plane and is negative outside.
+struct Frustum {
+	glm::vec4 m_planes[6];
+};
+
+// what is needed to cull against a camera
+struct CullingView {
+	Frustum m_frustum;
+	glm::vec3 m_cameraPosition;
+};
+
+// reads the planes out of a (view) projection matrix (Gribb and Hartmann)
+Frustum extractFrustum(const glm::mat4& viewProjection);
+
+// moves a world space frustum into the object space of a model matrix, so objects
+// can be tested without transforming their bounds
+Frustum transformFrustum(const Frustum& frustum, const glm::mat4& model);
+
+// false if the bounds are completely outside of one of the planes
+bool intersectsFrustum(const Frustum& frustum, const Bounds& bounds);
+
+#endif
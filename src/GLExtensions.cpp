@@ -0,0 +1,87 @@
+#include "GLExtensions.h"
+
+#include <glad/glad.h>
+
+#include <iostream>
+#include <string>
+#include <unordered_set>
+
+GLExtensions::MultiDrawElementsIndirectProc GLExtensions::multiDrawElementsIndirect = nullptr;
+GLExtensions::BufferStorageProc GLExtensions::bufferStorage = nullptr;
+GLExtensions::TexStorage2DProc GLExtensions::texStorage2D = nullptr;
+GLExtensions::TexStorage3DProc GLExtensions::texStorage3D = nullptr;
+GLExtensions::CopyImageSubDataProc GLExtensions::copyImageSubData = nullptr;
+std::unordered_set<std::string> GLExtensions::s_extensions;
+
+void GLExtensions::load(GLADloadproc loader) {
+    int numExtensions = 0;
+    glGetIntegerv(GL_NUM_EXTENSIONS, &numExtensions);
+    for (int i = 0; i < numExtensions; ++i) {
+        s_extensions.insert(reinterpret_cast<const char*>(glGetStringi(GL_EXTENSIONS, i)));
+    }
+
+    if (hasVersion(4, 3) || hasExtension("GL_ARB_multi_draw_indirect")) {
+        multiDrawElementsIndirect = reinterpret_cast<MultiDrawElementsIndirectProc>(
+            loader("glMultiDrawElementsIndirect"));
+    }
+    if (hasVersion(4, 4) || hasExtension("GL_ARB_buffer_storage")) {
+        bufferStorage = reinterpret_cast<BufferStorageProc>(loader("glBufferStorage"));
+    }
+    if (hasVersion(4, 2) || hasExtension("GL_ARB_texture_storage")) {
+        texStorage2D = reinterpret_cast<TexStorage2DProc>(loader("glTexStorage2D"));
+        texStorage3D = reinterpret_cast<TexStorage3DProc>(loader("glTexStorage3D"));
+    }
+    if (hasVersion(4, 3) || hasExtension("GL_ARB_copy_image")) {
+        copyImageSubData = reinterpret_cast<CopyImageSubDataProc>(loader("glCopyImageSubData"));
+    }
+
+    std::cout << "Multi draw indirect: " << (supportsMultiDrawIndirect() ? "yes" : "no") << '\n';
+    std::cout << "Persistently mapped buffers: " << (supportsBufferStorage() ? "yes" : "no") << '\n';
+    std::cout << "Conservative occlusion queries: " << (supportsConservativeOcclusionQueries() ? "yes" : "no") << '\n';
+    std::cout << "Immutable texture storage: " << (supportsTextureStorage() ? "yes" : "no") << '\n';
+    std::cout << "Texture copies: " << (supportsCopyImage() ? "yes" : "no") << '\n';
+    std::cout << "Compressed textures: BC1/BC3 " << (supportsS3TC() ? "yes" : "no") << ", BC7 "
+        << (supportsBPTC() ? "yes" : "no") << ", ETC2 " << (supportsETC2() ? "yes" : "no") << '\n';
+}
+
+bool GLExtensions::hasVersion(int major, int minor) {
+    return GLVersion.major > major || (GLVersion.major == major && GLVersion.minor >= minor);
+}
+
+bool GLExtensions::hasExtension(const std::string& name) {
+    return s_extensions.count(name) > 0;
+}
+
+bool GLExtensions::supportsMultiDrawIndirect() {
+    // baseInstance (used to pass in the draw ID) needs OpenGL 4.2 or ARB_base_instance
+    bool baseInstance = hasVersion(4, 2) || hasExtension("GL_ARB_base_instance");
+    return multiDrawElementsIndirect && baseInstance;
+}
+
+bool GLExtensions::supportsBufferStorage() {
+    return bufferStorage != nullptr;
+}
+
+bool GLExtensions::supportsConservativeOcclusionQueries() {
+    return hasVersion(4, 3) || hasExtension("GL_ARB_ES3_compatibility");
+}
+
+bool GLExtensions::supportsTextureStorage() {
+    return texStorage2D != nullptr && texStorage3D != nullptr;
+}
+
+bool GLExtensions::supportsCopyImage() {
+    return copyImageSubData != nullptr;
+}
+
+bool GLExtensions::supportsS3TC() {
+    return hasExtension("GL_EXT_texture_compression_s3tc");
+}
+
+bool GLExtensions::supportsBPTC() {
+    return hasVersion(4, 2) || hasExtension("GL_ARB_texture_compression_bptc");
+}
+
+bool GLExtensions::supportsETC2() {
+    return hasVersion(4, 3) || hasExtension("GL_ARB_ES3_compatibility");
+}
\ No newline at end of file
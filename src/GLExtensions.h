@@ -0,0 +1,77 @@
+#ifndef GL_EXTENSIONS_H_INCLUDED
+#define GL_EXTENSIONS_H_INCLUDED
+
+#include <glad/glad.h>
+
+#include <string>
+#include <unordered_set>
+
+// GLAD is only generated for OpenGL 3.3, but the driver usually gives us a newer
+// context than we ask for. Functions from newer versions (or extensions) are
+// loaded here so that faster paths can be used when they exist. Callers must
+// check the supports*() functions before using any of the function pointers.
+
+#ifndef GL_DRAW_INDIRECT_BUFFER
+#define GL_DRAW_INDIRECT_BUFFER 0x8F3F
+#endif
+#ifndef GL_MAP_PERSISTENT_BIT
+#define GL_MAP_PERSISTENT_BIT 0x0040
+#define GL_MAP_COHERENT_BIT 0x0080
+#define GL_DYNAMIC_STORAGE_BIT 0x0100
+#endif
+#ifndef GL_ANY_SAMPLES_PASSED_CONSERVATIVE
+#define GL_ANY_SAMPLES_PASSED_CONSERVATIVE 0x8D6A
+#endif
+#ifndef GL_COMPRESSED_RGB_S3TC_DXT1_EXT
+#define GL_COMPRESSED_RGB_S3TC_DXT1_EXT 0x83F0
+#define GL_COMPRESSED_RGBA_S3TC_DXT5_EXT 0x83F3
+#endif
+#ifndef GL_COMPRESSED_RGBA_BPTC_UNORM
+#define GL_COMPRESSED_RGBA_BPTC_UNORM 0x8E8C
+#endif
+#ifndef GL_COMPRESSED_RGB8_ETC2
+#define GL_COMPRESSED_RGB8_ETC2 0x9274
+#endif
+
+class GLExtensions {
+public:
+	typedef void (APIENTRYP MultiDrawElementsIndirectProc)(GLenum mode, GLenum type, const void* indirect,
+		GLsizei drawCount, GLsizei stride);
+	typedef void (APIENTRYP BufferStorageProc)(GLenum target, GLsizeiptr size, const void* data, GLbitfield flags);
+	typedef void (APIENTRYP TexStorage2DProc)(GLenum target, GLsizei levels, GLenum internalFormat, GLsizei width,
+		GLsizei height);
+	typedef void (APIENTRYP TexStorage3DProc)(GLenum target, GLsizei levels, GLenum internalFormat, GLsizei width,
+		GLsizei height, GLsizei depth);
+	typedef void (APIENTRYP CopyImageSubDataProc)(GLuint srcName, GLenum srcTarget, GLint srcLevel, GLint srcX,
+		GLint srcY, GLint srcZ, GLuint dstName, GLenum dstTarget, GLint dstLevel, GLint dstX, GLint dstY, GLint dstZ,
+		GLsizei width, GLsizei height, GLsizei depth);
+
+	static MultiDrawElementsIndirectProc multiDrawElementsIndirect;
+	static BufferStorageProc bufferStorage;
+	static TexStorage2DProc texStorage2D;
+	static TexStorage3DProc texStorage3D;
+	static CopyImageSubDataProc copyImageSubData;
+
+private:
+	static std::unordered_set<std::string> s_extensions;
+
+public:
+	static void load(GLADloadproc loader);
+	static bool hasVersion(int major, int minor);
+	static bool hasExtension(const std::string& name);
+
+	static bool supportsMultiDrawIndirect();
+	static bool supportsBufferStorage();
+	// GL_ANY_SAMPLES_PASSED_CONSERVATIVE queries, which may skip the exact per sample depth test
+	static bool supportsConservativeOcclusionQueries();
+	// immutable texture storage, allocated once with all mip levels
+	static bool supportsTextureStorage();
+	// copies between textures without a framebuffer
+	static bool supportsCopyImage();
+	// block compressed texture formats, RGTC (BC4 and BC5) is core since OpenGL 3.0
+	static bool supportsS3TC();
+	static bool supportsBPTC();
+	static bool supportsETC2();
+};
+
+#endif
\ No newline at end of file
@@ -0,0 +1,186 @@
+#include "GLState.h"
+
+#include <glad/glad.h>
+
+#include <iterator>
+#include <unordered_map>
+
+// 0 is a valid binding, so a value that OpenGL never hands out marks state as unknown
+const unsigned int UNKNOWN = 0xFFFFFFFF;
+
+unsigned int GLState::s_program = UNKNOWN;
+unsigned int GLState::s_vertexArray = UNKNOWN;
+unsigned int GLState::s_activeTextureUnit = UNKNOWN;
+unsigned int GLState::s_restartIndex = 0;
+unsigned int GLState::s_colorMask = UNKNOWN;
+unsigned int GLState::s_depthMask = UNKNOWN;
+bool GLState::s_restartIndexKnown = false;
+std::unordered_map<unsigned int, unsigned int> GLState::s_buffers;
+std::unordered_map<unsigned long long, unsigned int> GLState::s_indexedBuffers;
+std::unordered_map<unsigned long long, unsigned int> GLState::s_textures;
+std::unordered_map<unsigned int, bool> GLState::s_capabilities;
+unsigned int GLState::s_callsIssued = 0;
+unsigned int GLState::s_callsElided = 0;
+
+bool GLState::track(bool changed) {
+    if (changed) {
+        ++s_callsIssued;
+    } else {
+        ++s_callsElided;
+    }
+    return changed;
+}
+
+void GLState::useProgram(unsigned int program) {
+    if (track(s_program != program)) {
+        glUseProgram(program);
+        s_program = program;
+    }
+}
+
+void GLState::bindVertexArray(unsigned int vertexArray) {
+    if (track(s_vertexArray != vertexArray)) {
+        glBindVertexArray(vertexArray);
+        s_vertexArray = vertexArray;
+
+        // the element array buffer binding is part of the vertex array's state
+        s_buffers.erase(GL_ELEMENT_ARRAY_BUFFER);
+    }
+}
+
+void GLState::bindBuffer(unsigned int target, unsigned int buffer) {
+    auto bound = s_buffers.find(target);
+    if (track(bound == s_buffers.end() || bound->second != buffer)) {
+        glBindBuffer(target, buffer);
+        s_buffers[target] = buffer;
+    }
+}
+
+void GLState::bindBufferBase(unsigned int target, unsigned int index, unsigned int buffer) {
+    unsigned long long key = (static_cast<unsigned long long>(target) << 32) | index;
+    auto bound = s_indexedBuffers.find(key);
+    if (track(bound == s_indexedBuffers.end() || bound->second != buffer)) {
+        glBindBufferBase(target, index, buffer);
+        s_indexedBuffers[key] = buffer;
+
+        // glBindBufferBase also binds the buffer to the generic binding point
+        s_buffers[target] = buffer;
+    }
+}
+
+void GLState::bindBufferRange(unsigned int target, unsigned int index, unsigned int buffer,
+    unsigned int offset, unsigned int size) {
+    // ranges usually move every frame, so they are always bound
+    track(true);
+    glBindBufferRange(target, index, buffer, offset, size);
+    unsigned long long key = (static_cast<unsigned long long>(target) << 32) | index;
+    s_indexedBuffers.erase(key);
+    s_buffers[target] = buffer;
+}
+
+void GLState::bindTexture(unsigned int unit, unsigned int target, unsigned int texture) {
+    unsigned long long key = (static_cast<unsigned long long>(unit) << 32) | target;
+    auto bound = s_textures.find(key);
+    bool changed = track(bound == s_textures.end() || bound->second != texture);
+    // the unit is made active even if the texture is bound already, since the texture
+    // calls that usually follow (glTexSubImage2D, glTexParameteri) act on the active unit
+    if (s_activeTextureUnit != unit) {
+        glActiveTexture(GL_TEXTURE0 + unit);
+        s_activeTextureUnit = unit;
+    }
+    if (changed) {
+        glBindTexture(target, texture);
+        s_textures[key] = texture;
+    }
+}
+
+void GLState::setCapability(unsigned int capability, bool enabled) {
+    auto current = s_capabilities.find(capability);
+    if (track(current == s_capabilities.end() || current->second != enabled)) {
+        if (enabled) {
+            glEnable(capability);
+        } else {
+            glDisable(capability);
+        }
+        s_capabilities[capability] = enabled;
+    }
+}
+
+void GLState::setPrimitiveRestartIndex(unsigned int index) {
+    if (track(!s_restartIndexKnown || s_restartIndex != index)) {
+        glPrimitiveRestartIndex(index);
+        s_restartIndex = index;
+        s_restartIndexKnown = true;
+    }
+}
+
+void GLState::setColorMask(bool enabled) {
+    unsigned int mask = enabled ? 1 : 0;
+    if (track(s_colorMask != mask)) {
+        GLboolean value = enabled ? GL_TRUE : GL_FALSE;
+        glColorMask(value, value, value, value);
+        s_colorMask = mask;
+    }
+}
+
+void GLState::setDepthMask(bool enabled) {
+    unsigned int mask = enabled ? 1 : 0;
+    if (track(s_depthMask != mask)) {
+        glDepthMask(enabled ? GL_TRUE : GL_FALSE);
+        s_depthMask = mask;
+    }
+}
+
+void GLState::forgetProgram(unsigned int program) {
+    if (s_program == program) {
+        s_program = UNKNOWN;
+    }
+}
+
+void GLState::forgetVertexArray(unsigned int vertexArray) {
+    if (s_vertexArray == vertexArray) {
+        s_vertexArray = UNKNOWN;
+        s_buffers.erase(GL_ELEMENT_ARRAY_BUFFER);
+    }
+}
+
+void GLState::forgetBuffer(unsigned int buffer) {
+    for (auto it = s_buffers.begin(); it != s_buffers.end();) {
+        it = it->second == buffer ? s_buffers.erase(it) : std::next(it);
+    }
+    for (auto it = s_indexedBuffers.begin(); it != s_indexedBuffers.end();) {
+        it = it->second == buffer ? s_indexedBuffers.erase(it) : std::next(it);
+    }
+}
+
+void GLState::forgetTexture(unsigned int texture) {
+    for (auto it = s_textures.begin(); it != s_textures.end();) {
+        it = it->second == texture ? s_textures.erase(it) : std::next(it);
+    }
+}
+
+void GLState::invalidate() {
+    s_program = UNKNOWN;
+    s_vertexArray = UNKNOWN;
+    s_activeTextureUnit = UNKNOWN;
+    s_restartIndexKnown = false;
+    s_colorMask = UNKNOWN;
+    s_depthMask = UNKNOWN;
+    s_buffers.clear();
+    s_indexedBuffers.clear();
+    s_textures.clear();
+    s_capabilities.clear();
+}
+
+unsigned int GLState::getCallsIssued() {
+    return s_callsIssued;
+}
+
+unsigned int GLState::getCallsElided() {
+    return s_callsElided;
+}
+
+void GLState::resetCounters() {
+    s_callsIssued = 0;
+    s_callsElided = 0;
+}
\ No newline at end of file
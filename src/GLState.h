@@ -0,0 +1,55 @@
+#ifndef GL_STATE_H_INCLUDED
+#define GL_STATE_H_INCLUDED
+
+#include <unordered_map>
+
+// Shadows the OpenGL binding state so that calls which would not change
+// anything are never sent to the driver. All binds of programs, vertex arrays,
+// buffers and textures (and toggling of capabilities) should go through here,
+// otherwise the shadowed state goes out of sync and invalidate() must be called.
+class GLState {
+	static unsigned int s_program;
+	static unsigned int s_vertexArray;
+	static unsigned int s_activeTextureUnit;
+	static unsigned int s_restartIndex;
+	static unsigned int s_colorMask;    // 1 if every channel is written, 0 if none, unknown otherwise
+	static unsigned int s_depthMask;
+	static bool s_restartIndexKnown;    // every restart index is valid, so unknown needs its own flag
+	static std::unordered_map<unsigned int, unsigned int> s_buffers;              // target -> buffer
+	static std::unordered_map<unsigned long long, unsigned int> s_indexedBuffers; // (target, index) -> buffer
+	static std::unordered_map<unsigned long long, unsigned int> s_textures;       // (unit, target) -> texture
+	static std::unordered_map<unsigned int, bool> s_capabilities;                 // capability -> enabled
+	static unsigned int s_callsIssued;
+	static unsigned int s_callsElided;
+
+public:
+	static void useProgram(unsigned int program);
+	static void bindVertexArray(unsigned int vertexArray);
+	static void bindBuffer(unsigned int target, unsigned int buffer);
+	static void bindBufferBase(unsigned int target, unsigned int index, unsigned int buffer);
+	static void bindBufferRange(unsigned int target, unsigned int index, unsigned int buffer,
+		unsigned int offset, unsigned int size);
+	// leaves the unit active, so calls that change the bound texture can follow
+	static void bindTexture(unsigned int unit, unsigned int target, unsigned int texture);
+	static void setCapability(unsigned int capability, bool enabled);
+	static void setPrimitiveRestartIndex(unsigned int index);
+	// all channels or none, the masks also decide what glClear writes
+	static void setColorMask(bool enabled);
+	static void setDepthMask(bool enabled);
+
+	// deleting a bound object resets that binding to 0 inside OpenGL
+	static void forgetProgram(unsigned int program);
+	static void forgetVertexArray(unsigned int vertexArray);
+	static void forgetBuffer(unsigned int buffer);
+	static void forgetTexture(unsigned int texture);
+	static void invalidate();
+
+	static unsigned int getCallsIssued();
+	static unsigned int getCallsElided();
+	static void resetCounters();
+
+private:
+	static bool track(bool changed);
+};
+
+#endif
\ No newline at end of file
@@ -0,0 +1,192 @@
+#include "GeometryArena.h"
+#include "GLState.h"
+#include "VertexLayout.h"
+
+#include <glad/glad.h>
+
+#include <map>
+#include <memory>
+#include <vector>
+
+// the buffers start out this large (in elements) and double in size when they are full
+const unsigned int INITIAL_VERTEX_CAPACITY = 4096;
+const unsigned int INITIAL_INDEX_CAPACITY = 16384;
+
+std::map<VertexLayout, std::unique_ptr<GeometryArena>> GeometryArena::s_arenas;
+
+unsigned int getIndexSize(unsigned int indexType) {
+    switch (indexType) {
+        case GL_UNSIGNED_BYTE:  return 1;
+        case GL_UNSIGNED_SHORT: return 2;
+        default:                return 4;
+    }
+}
+
+unsigned int getRestartIndex(unsigned int indexType) {
+    switch (indexType) {
+        case GL_UNSIGNED_BYTE:  return 0xFF;
+        case GL_UNSIGNED_SHORT: return 0xFFFF;
+        default:                return 0xFFFFFFFF;
+    }
+}
+
+GeometryArena::GeometryArena(const VertexLayout& layout)
+    : m_layout{ layout }, m_vertexSize{ layout.getStride() }, m_vertexCapacity{ INITIAL_VERTEX_CAPACITY },
+      m_indexCapacity{ INITIAL_INDEX_CAPACITY } {
+
+    glGenBuffers(1, &m_vertexBufferID);
+    GLState::bindBuffer(GL_COPY_WRITE_BUFFER, m_vertexBufferID);
+    glBufferData(GL_COPY_WRITE_BUFFER, m_vertexCapacity * m_vertexSize, nullptr, GL_STATIC_DRAW);
+    glGenBuffers(1, &m_indexBufferID);
+    GLState::bindBuffer(GL_COPY_WRITE_BUFFER, m_indexBufferID);
+    glBufferData(GL_COPY_WRITE_BUFFER, m_indexCapacity * INDEX_WORD_SIZE, nullptr, GL_STATIC_DRAW);
+
+    // the buffers keep their names when they grow, so the vertex array stays valid
+    glGenVertexArrays(1, &m_vertexArrayID);
+    GLState::bindVertexArray(m_vertexArrayID);
+    setupVertexArray();
+    GLState::bindVertexArray(0);
+}
+
+GeometryArena::~GeometryArena() {
+    GLState::forgetVertexArray(m_vertexArrayID);
+    GLState::forgetBuffer(m_vertexBufferID);
+    GLState::forgetBuffer(m_indexBufferID);
+    glDeleteVertexArrays(1, &m_vertexArrayID);
+    glDeleteBuffers(1, &m_vertexBufferID);
+    glDeleteBuffers(1, &m_indexBufferID);
+}
+
+GeometryArena& GeometryArena::get(const VertexLayout& layout) {
+    std::unique_ptr<GeometryArena>& arena = s_arenas[layout];
+    if (!arena) {
+        arena.reset(new GeometryArena(layout));
+    }
+    return *arena;
+}
+
+void GeometryArena::shutdown() {
+    s_arenas.clear();
+}
+
+void GeometryArena::compactFragmented() {
+    for (auto& arena : s_arenas) {
+        RangeAllocator& vertices = arena.second->m_vertices;
+        RangeAllocator& indices = arena.second->m_indices;
+        if ((vertices.getEnd() - vertices.getUsed()) * 4 > vertices.getEnd()
+            || (indices.getEnd() - indices.getUsed()) * 4 > indices.getEnd()) {
+            arena.second->compact();
+        }
+    }
+}
+
+unsigned int GeometryArena::addVertices(const void* data, unsigned int count) {
+    unsigned int handle = m_vertices.allocate(count);
+    reserve(m_vertexBufferID, m_vertexCapacity, m_vertices.getEnd(), m_vertexSize);
+    GLState::bindBuffer(GL_COPY_WRITE_BUFFER, m_vertexBufferID);
+    glBufferSubData(GL_COPY_WRITE_BUFFER, m_vertices.get(handle).m_first * m_vertexSize, count * m_vertexSize, data);
+    return handle;
+}
+
+unsigned int GeometryArena::addIndices(const void* data, unsigned int size) {
+    unsigned int handle = m_indices.allocate((size + INDEX_WORD_SIZE - 1) / INDEX_WORD_SIZE);
+    reserve(m_indexBufferID, m_indexCapacity, m_indices.getEnd(), INDEX_WORD_SIZE);
+    GLState::bindBuffer(GL_COPY_WRITE_BUFFER, m_indexBufferID);
+    glBufferSubData(GL_COPY_WRITE_BUFFER, getIndexOffset(handle), size, data);
+    return handle;
+}
+
+void GeometryArena::freeVertices(unsigned int handle) {
+    m_vertices.free(handle);
+}
+
+void GeometryArena::freeIndices(unsigned int handle) {
+    m_indices.free(handle);
+}
+
+const GeometryRange& GeometryArena::getVertexRange(unsigned int handle) const {
+    return m_vertices.get(handle);
+}
+
+const GeometryRange& GeometryArena::getIndexRange(unsigned int handle) const {
+    return m_indices.get(handle);
+}
+
+unsigned long long GeometryArena::getIndexOffset(unsigned int handle) const {
+    return static_cast<unsigned long long>(m_indices.get(handle).m_first) * INDEX_WORD_SIZE;
+}
+
+void GeometryArena::compact() {
+    unsigned int usedVertices = m_vertices.getUsed();
+    unsigned int usedIndices = m_indices.getUsed();
+    applyMoves(m_vertexBufferID, m_vertices.compact(), usedVertices, m_vertexSize);
+    applyMoves(m_indexBufferID, m_indices.compact(), usedIndices, INDEX_WORD_SIZE);
+}
+
+unsigned int GeometryArena::getVertexArrayID() const {
+    return m_vertexArrayID;
+}
+
+void GeometryArena::setupVertexArray() const {
+    GLState::bindBuffer(GL_ARRAY_BUFFER, m_vertexBufferID);
+    GLState::bindBuffer(GL_ELEMENT_ARRAY_BUFFER, m_indexBufferID);
+
+    // tell openGL the layout of our vertex data.
+    m_layout.setupAttributes();
+}
+
+unsigned int GeometryArena::getVertexSize() const {
+    return m_vertexSize;
+}
+
+void GeometryArena::reserve(unsigned int buffer, unsigned int& capacity, unsigned int needed, unsigned int elementSize) {
+    if (needed <= capacity) {
+        return;
+    }
+    unsigned int newCapacity = capacity;
+    while (newCapacity < needed) {
+        newCapacity *= 2;
+    }
+
+    // copy the contents out, reallocate the storage under the same name, and copy them back
+    unsigned int tempBufferID;
+    glGenBuffers(1, &tempBufferID);
+    GLState::bindBuffer(GL_COPY_READ_BUFFER, buffer);
+    GLState::bindBuffer(GL_COPY_WRITE_BUFFER, tempBufferID);
+    glBufferData(GL_COPY_WRITE_BUFFER, capacity * elementSize, nullptr, GL_STREAM_COPY);
+    glCopyBufferSubData(GL_COPY_READ_BUFFER, GL_COPY_WRITE_BUFFER, 0, 0, capacity * elementSize);
+
+    GLState::bindBuffer(GL_COPY_READ_BUFFER, tempBufferID);
+    GLState::bindBuffer(GL_COPY_WRITE_BUFFER, buffer);
+    glBufferData(GL_COPY_WRITE_BUFFER, newCapacity * elementSize, nullptr, GL_STATIC_DRAW);
+    glCopyBufferSubData(GL_COPY_READ_BUFFER, GL_COPY_WRITE_BUFFER, 0, 0, capacity * elementSize);
+
+    GLState::forgetBuffer(tempBufferID);
+    glDeleteBuffers(1, &tempBufferID);
+    capacity = newCapacity;
+}
+
+void GeometryArena::applyMoves(unsigned int buffer, const std::vector<RangeAllocator::Move>& moves,
+    unsigned int usedCount, unsigned int elementSize) {
+    if (usedCount == 0) {
+        return;
+    }
+
+    // the ranges may overlap their new positions, so they are packed into a temporary buffer first
+    unsigned int tempBufferID;
+    glGenBuffers(1, &tempBufferID);
+    GLState::bindBuffer(GL_COPY_READ_BUFFER, buffer);
+    GLState::bindBuffer(GL_COPY_WRITE_BUFFER, tempBufferID);
+    glBufferData(GL_COPY_WRITE_BUFFER, usedCount * elementSize, nullptr, GL_STREAM_COPY);
+    for (const RangeAllocator::Move& move : moves) {
+        glCopyBufferSubData(GL_COPY_READ_BUFFER, GL_COPY_WRITE_BUFFER, move.m_from * elementSize,
+            move.m_to * elementSize, move.m_count * elementSize);
+    }
+
+    GLState::bindBuffer(GL_COPY_READ_BUFFER, tempBufferID);
+    GLState::bindBuffer(GL_COPY_WRITE_BUFFER, buffer);
+    glCopyBufferSubData(GL_COPY_READ_BUFFER, GL_COPY_WRITE_BUFFER, 0, 0, usedCount * elementSize);
+
+    GLState::forgetBuffer(tempBufferID);
+    glDeleteBuffers(1, &tempBufferID);
+}
\ No newline at end of file
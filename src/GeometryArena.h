@@ -0,0 +1,77 @@
+#ifndef GEOMETRY_ARENA_H_INCLUDED
+#define GEOMETRY_ARENA_H_INCLUDED
+
+#include "RangeAllocator.h"
+#include "VertexLayout.h"
+
+#include <map>
+#include <memory>
+#include <vector>
+
+// index ranges are allocated in 4 byte words, so indices of every type stay aligned
+const unsigned int INDEX_WORD_SIZE = 4;
+
+// the size in bytes of GL_UNSIGNED_BYTE, GL_UNSIGNED_SHORT and GL_UNSIGNED_INT indices
+unsigned int getIndexSize(unsigned int indexType);
+// the largest value of the index type, which ends a strip when primitive restart is enabled
+unsigned int getRestartIndex(unsigned int indexType);
+
+// Shared storage for the geometry of all meshes with the same vertex layout.
+// Vertices of every mesh go into one big vertex buffer and indices into one big
+// index buffer, so all of them can be drawn with the same vertex array. Indices
+// stay relative to their mesh's first vertex and are drawn with a base vertex.
+// Allocations are referred to by handles because compact() moves them around.
+class GeometryArena {
+
+	VertexLayout m_layout;
+	unsigned int m_vertexSize;              // in bytes
+	unsigned int m_vertexArrayID;
+	unsigned int m_vertexBufferID;
+	unsigned int m_indexBufferID;
+	unsigned int m_vertexCapacity;          // in vertices
+	unsigned int m_indexCapacity;           // in index words
+	RangeAllocator m_vertices;
+	RangeAllocator m_indices;
+
+	static std::map<VertexLayout, std::unique_ptr<GeometryArena>> s_arenas;
+
+	GeometryArena(const VertexLayout& layout);
+
+public:
+	~GeometryArena();
+	GeometryArena(const GeometryArena&) = delete;
+	GeometryArena& operator=(const GeometryArena&) = delete;
+
+	// the one arena for this vertex layout (created on first use)
+	static GeometryArena& get(const VertexLayout& layout);
+	// Deletes every arena. Call after the last mesh is gone and before the context is
+	// destroyed, the arenas would outlive it otherwise.
+	static void shutdown();
+	// compacts the arenas whose holes take more than a quarter of their buffers' used
+	// range, call between frames as it moves the geometry of meshes that are drawn
+	static void compactFragmented();
+
+	// the data is uploaded immediately and can be freed by the caller afterwards
+	unsigned int addVertices(const void* data, unsigned int count);
+	unsigned int addIndices(const void* data, unsigned int size);
+	void freeVertices(unsigned int handle);
+	void freeIndices(unsigned int handle);
+	const GeometryRange& getVertexRange(unsigned int handle) const;
+	const GeometryRange& getIndexRange(unsigned int handle) const;
+	unsigned long long getIndexOffset(unsigned int handle) const;   // in bytes
+
+	// move all allocations together to get rid of the holes left by freed meshes
+	void compact();
+
+	unsigned int getVertexArrayID() const;
+	// sets up the arena's vertex and index buffers on the bound vertex array
+	void setupVertexArray() const;
+	unsigned int getVertexSize() const;
+
+private:
+	void reserve(unsigned int buffer, unsigned int& capacity, unsigned int needed, unsigned int elementSize);
+	void applyMoves(unsigned int buffer, const std::vector<RangeAllocator::Move>& moves,
+		unsigned int usedCount, unsigned int elementSize);
+};
+
+#endif
\ No newline at end of file
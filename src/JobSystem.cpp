@@ -0,0 +1,185 @@
+#include "JobSystem.h"
+
+#include <algorithm>
+#include <atomic>
+#include <functional>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+// the job system and deque of the current thread, a thread that isn't a worker uses the first deque
+static thread_local const JobSystem* t_jobSystem = nullptr;
+static thread_local unsigned int t_queueIndex = 0;
+
+JobCounter::JobCounter() : m_count{ 0 } {}
+
+bool JobCounter::isDone() const {
+    return m_count.load() == 0;
+}
+
+JobSystem::JobSystem(unsigned int threadCount) : m_queuedJobs{ 0 }, m_stop{ false } {
+    if (threadCount == 0) {
+        threadCount = std::max(1u, std::thread::hardware_concurrency());
+    }
+    for (unsigned int i = 0; i < threadCount; ++i) {
+        m_queues.emplace_back(new Queue());
+    }
+    for (unsigned int i = 1; i < threadCount; ++i) {
+        m_workers.emplace_back(&JobSystem::workerLoop, this, i);
+    }
+}
+
+JobSystem::~JobSystem() {
+    // jobs that are still queued are dropped
+    {
+        std::lock_guard<std::mutex> lock(m_sleepMutex);
+        m_stop = true;
+    }
+    m_wake.notify_all();
+    for (std::thread& worker : m_workers) {
+        worker.join();
+    }
+}
+
+unsigned int JobSystem::getQueueIndex() const {
+    return t_jobSystem == this ? t_queueIndex : 0;
+}
+
+void JobSystem::push(Job job) {
+    Queue& queue = *m_queues[getQueueIndex()];
+    {
+        std::lock_guard<std::mutex> lock(queue.m_mutex);
+        queue.m_jobs.push_back(std::move(job));
+    }
+    // taking the sleep mutex makes sure a worker that just found nothing to do is
+    // either still awake or already waiting, so the notification isn't lost
+    {
+        std::lock_guard<std::mutex> lock(m_sleepMutex);
+        ++m_queuedJobs;
+    }
+    m_wake.notify_one();
+}
+
+bool JobSystem::tryRunJob(unsigned int queueIndex) {
+    if (m_queuedJobs.load() == 0) {
+        return false;
+    }
+    Job job;
+    bool found = false;
+    {
+        Queue& own = *m_queues[queueIndex];
+        std::lock_guard<std::mutex> lock(own.m_mutex);
+        if (!own.m_jobs.empty()) {
+            job = std::move(own.m_jobs.back());
+            own.m_jobs.pop_back();
+            found = true;
+        }
+    }
+    for (unsigned int i = 1; !found && i < m_queues.size(); ++i) {
+        Queue& victim = *m_queues[(queueIndex + i) % m_queues.size()];
+        std::lock_guard<std::mutex> lock(victim.m_mutex);
+        if (!victim.m_jobs.empty()) {
+            job = std::move(victim.m_jobs.front());
+            victim.m_jobs.pop_front();
+            found = true;
+        }
+    }
+    if (!found) {
+        return false;
+    }
+    --m_queuedJobs;
+    job.m_function();
+    if (job.m_counter) {
+        finish(job.m_counter);
+    }
+    return true;
+}
+
+void JobSystem::finish(JobCounter* counter) {
+    // Only the last job takes the mutex, and it doesn't touch the counter after
+    // unlocking it. wait() takes the mutex too before it returns, so the counter
+    // can't be destroyed while the last job still uses it.
+    unsigned int count = counter->m_count.load();
+    while (count > 1 && !counter->m_count.compare_exchange_weak(count, count - 1)) {
+    }
+    if (count > 1) {
+        return;
+    }
+    std::vector<Job> continuations;
+    {
+        std::lock_guard<std::mutex> lock(counter->m_mutex);
+        if (--counter->m_count == 0) {
+            continuations.swap(counter->m_continuations);
+        }
+    }
+    for (Job& job : continuations) {
+        push(std::move(job));
+    }
+}
+
+void JobSystem::workerLoop(unsigned int queueIndex) {
+    t_jobSystem = this;
+    t_queueIndex = queueIndex;
+    while (true) {
+        if (tryRunJob(queueIndex)) {
+            continue;
+        }
+        std::unique_lock<std::mutex> lock(m_sleepMutex);
+        m_wake.wait(lock, [this]() {
+            return m_stop || m_queuedJobs.load() > 0;
+        });
+        if (m_stop) {
+            return;
+        }
+    }
+}
+
+void JobSystem::run(const std::function<void()>& function, JobCounter* counter, JobCounter* dependency) {
+    if (counter) {
+        ++counter->m_count;
+    }
+    Job job{ function, counter };
+    if (dependency) {
+        std::lock_guard<std::mutex> lock(dependency->m_mutex);
+        if (dependency->m_count.load() != 0) {
+            dependency->m_continuations.push_back(std::move(job));
+            return;
+        }
+    }
+    push(std::move(job));
+}
+
+void JobSystem::wait(JobCounter& counter) {
+    unsigned int queueIndex = getQueueIndex();
+    while (counter.m_count.load() != 0) {
+        if (!tryRunJob(queueIndex)) {
+            std::this_thread::yield();
+        }
+    }
+    std::lock_guard<std::mutex> lock(counter.m_mutex);
+}
+
+void JobSystem::parallelFor(unsigned int count, unsigned int grainSize,
+    const std::function<void(unsigned int, unsigned int)>& function) {
+    grainSize = std::max(1u, grainSize);
+    if (m_workers.empty() || count <= grainSize) {
+        for (unsigned int begin = 0; begin < count; begin += grainSize) {
+            function(begin, std::min(begin + grainSize, count));
+        }
+        return;
+    }
+    // the calling thread takes the first range itself instead of waiting idle
+    JobCounter counter;
+    for (unsigned int begin = grainSize; begin < count; begin += grainSize) {
+        unsigned int end = std::min(begin + grainSize, count);
+        run([&function, begin, end]() {
+            function(begin, end);
+        }, &counter);
+    }
+    function(0, grainSize);
+    wait(counter);
+}
+
+unsigned int JobSystem::getThreadCount() const {
+    return static_cast<unsigned int>(m_queues.size());
+}
@@ -0,0 +1,85 @@
+#ifndef JOB_SYSTEM_H_INCLUDED
+#define JOB_SYSTEM_H_INCLUDED
+
+#include <atomic>
+#include <condition_variable>
+#include <deque>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+class JobCounter;
+
+struct Job {
+	std::function<void()> m_function;
+	JobCounter* m_counter;      // decremented when the job finished, can be null
+};
+
+// Counts unfinished jobs. Jobs can wait for a counter before they start (see
+// JobSystem::run()), and threads can wait for it with JobSystem::wait().
+class JobCounter {
+	friend class JobSystem;
+
+	std::atomic<unsigned int> m_count;
+	std::mutex m_mutex;
+	std::vector<Job> m_continuations;   // jobs that start when the count drops to 0
+
+public:
+	JobCounter();
+	JobCounter(const JobCounter&) = delete;
+	JobCounter& operator=(const JobCounter&) = delete;
+
+	bool isDone() const;
+};
+
+// A pool of worker threads that share the per-frame CPU work. Every thread has its
+// own deque of jobs: it pushes and pops new jobs at the back, so the jobs it just
+// created run while their data is still in its cache, and threads that ran out of
+// work steal from the front of the others, where the oldest (usually biggest) jobs
+// are. The thread that created the job system counts as one of its threads: it owns
+// the first deque and works on jobs while it waits for them.
+class JobSystem {
+	struct Queue {
+		std::mutex m_mutex;
+		std::deque<Job> m_jobs;
+	};
+
+	std::vector<std::unique_ptr<Queue>> m_queues;   // one per thread, the first is the creating thread's
+	std::vector<std::thread> m_workers;
+	std::atomic<unsigned int> m_queuedJobs;
+	std::atomic<bool> m_stop;
+	std::mutex m_sleepMutex;
+	std::condition_variable m_wake;                 // idle workers sleep until jobs are pushed
+
+	unsigned int getQueueIndex() const;
+	void push(Job job);
+	bool tryRunJob(unsigned int queueIndex);
+	void finish(JobCounter* counter);
+	void workerLoop(unsigned int queueIndex);
+
+public:
+	// 0 threads means one per core, the creating thread included
+	explicit JobSystem(unsigned int threadCount = 0);
+	~JobSystem();
+	JobSystem(const JobSystem&) = delete;
+	JobSystem& operator=(const JobSystem&) = delete;
+
+	// Adds a job. The counter (if any) is incremented now and decremented when the
+	// job finished. The job doesn't start before the dependency (if any) is done.
+	void run(const std::function<void()>& function, JobCounter* counter = nullptr,
+		JobCounter* dependency = nullptr);
+	// runs jobs (any jobs, not only the counted ones) until the counter is done
+	void wait(JobCounter& counter);
+
+	// Calls function(begin, end) for ranges of at most grainSize indices that cover
+	// [0, count) and returns when all are done. Larger grains cost less scheduling,
+	// smaller ones balance uneven work better.
+	void parallelFor(unsigned int count, unsigned int grainSize,
+		const std::function<void(unsigned int, unsigned int)>& function);
+
+	unsigned int getThreadCount() const;
+};
+
+#endif
@@ -0,0 +1,185 @@
+#include "Ktx2.h"
+#include "TextureCompression.h"
+
+#include <algorithm>
+#include <cstring>
+#include <fstream>
+#include <iostream>
+#include <iterator>
+#include <string>
+#include <vector>
+
+static const unsigned char KTX2_IDENTIFIER[12] = { 0xAB, 0x4B, 0x54, 0x58, 0x20, 0x32, 0x30, 0xBB, 0x0D, 0x0A,
+    0x1A, 0x0A };
+const unsigned int KTX2_HEADER_SIZE = 80;
+const unsigned int KTX2_LEVEL_INDEX_SIZE = 24;
+
+// how every format is described in the file: its Vulkan format, the color model of the
+// data format descriptor and one channel per 64 bits of a block
+struct Ktx2Format {
+    unsigned int m_vkFormat;
+    unsigned int m_colorModel;
+    unsigned int m_channels[2];
+    unsigned int m_sampleCount;
+};
+
+static const Ktx2Format KTX2_FORMATS[FORMAT_COUNT] = {
+    { 131, 128, { 0, 0 }, 1 },      // VK_FORMAT_BC1_RGB_UNORM_BLOCK, color
+    { 137, 130, { 15, 0 }, 2 },     // VK_FORMAT_BC3_UNORM_BLOCK, alpha then color
+    { 139, 131, { 0, 0 }, 1 },      // VK_FORMAT_BC4_UNORM_BLOCK, red
+    { 141, 132, { 0, 1 }, 2 },      // VK_FORMAT_BC5_UNORM_BLOCK, red then green
+    { 145, 134, { 0, 0 }, 1 },      // VK_FORMAT_BC7_UNORM_BLOCK, color
+    { 147, 161, { 2, 0 }, 1 },      // VK_FORMAT_ETC2_R8G8B8_UNORM_BLOCK, color
+};
+
+static void writeUint32(std::vector<unsigned char>& out, unsigned int value) {
+    for (unsigned int k = 0; k < 4; ++k) {
+        out.push_back(static_cast<unsigned char>(value >> (k * 8)));
+    }
+}
+
+static void writeUint64(std::vector<unsigned char>& out, unsigned long long value) {
+    for (unsigned int k = 0; k < 8; ++k) {
+        out.push_back(static_cast<unsigned char>(value >> (k * 8)));
+    }
+}
+
+static unsigned int readUint32(const unsigned char* data) {
+    return data[0] | (data[1] << 8) | (data[2] << 16) | (static_cast<unsigned int>(data[3]) << 24);
+}
+
+static unsigned long long readUint64(const unsigned char* data) {
+    return readUint32(data) | (static_cast<unsigned long long>(readUint32(data + 4)) << 32);
+}
+
+std::vector<unsigned char> writeKtx2(const CompressedTexture& texture) {
+    const Ktx2Format& format = KTX2_FORMATS[texture.m_format];
+    const unsigned int blockBytes = getFormatInfo(texture.m_format).m_blockBytes;
+    const unsigned int levelCount = static_cast<unsigned int>(texture.m_levels.size());
+
+    // the data format descriptor: its total size, then one basic descriptor block
+    std::vector<unsigned char> descriptor;
+    unsigned int blockSize = 24 + 16 * format.m_sampleCount;
+    writeUint32(descriptor, 4 + blockSize);
+    writeUint32(descriptor, 0);                                    // Khronos vendor, basic descriptor
+    writeUint32(descriptor, 2 | (blockSize << 16));                // version 2
+    writeUint32(descriptor, format.m_colorModel | (1 << 8) | (1 << 16));   // BT.709 primaries, linear
+    writeUint32(descriptor, 3 | (3 << 8));                         // 4x4 texel blocks
+    writeUint32(descriptor, blockBytes);                           // bytes of plane 0
+    writeUint32(descriptor, 0);
+    for (unsigned int sample = 0; sample < format.m_sampleCount; ++sample) {
+        writeUint32(descriptor, (sample * 64) | (63 << 16) | (format.m_channels[sample] << 24));
+        writeUint32(descriptor, 0);                                // sample position
+        writeUint32(descriptor, 0);                                // lower
+        writeUint32(descriptor, 0xFFFFFFFF);                       // upper
+    }
+
+    const unsigned int descriptorOffset = KTX2_HEADER_SIZE + KTX2_LEVEL_INDEX_SIZE * levelCount;
+    // the levels are stored from the smallest to the largest, each aligned to its block size
+    std::vector<unsigned long long> levelOffsets(levelCount);
+    unsigned long long offset = descriptorOffset + descriptor.size();
+    for (unsigned int level = levelCount; level-- > 0;) {
+        offset = (offset + blockBytes - 1) / blockBytes * blockBytes;
+        levelOffsets[level] = offset;
+        offset += texture.m_levels[level].size();
+    }
+
+    std::vector<unsigned char> out(KTX2_IDENTIFIER, KTX2_IDENTIFIER + 12);
+    writeUint32(out, format.m_vkFormat);
+    writeUint32(out, 1);                    // type size
+    writeUint32(out, texture.m_width);
+    writeUint32(out, texture.m_height);
+    writeUint32(out, 0);                    // depth
+    writeUint32(out, 0);                    // layers
+    writeUint32(out, 1);                    // faces
+    writeUint32(out, levelCount);
+    writeUint32(out, 0);                    // no supercompression
+    writeUint32(out, descriptorOffset);
+    writeUint32(out, static_cast<unsigned int>(descriptor.size()));
+    writeUint32(out, 0);                    // no key/value data
+    writeUint32(out, 0);
+    writeUint64(out, 0);                    // no supercompression global data
+    writeUint64(out, 0);
+    for (unsigned int level = 0; level < levelCount; ++level) {
+        writeUint64(out, levelOffsets[level]);
+        writeUint64(out, texture.m_levels[level].size());
+        writeUint64(out, texture.m_levels[level].size());
+    }
+    out.insert(out.end(), descriptor.begin(), descriptor.end());
+    for (unsigned int level = levelCount; level-- > 0;) {
+        out.resize(static_cast<size_t>(levelOffsets[level]), 0);
+        out.insert(out.end(), texture.m_levels[level].begin(), texture.m_levels[level].end());
+    }
+    return out;
+}
+
+bool readKtx2(const unsigned char* data, unsigned int size, CompressedTexture& texture) {
+    if (size < KTX2_HEADER_SIZE || std::memcmp(data, KTX2_IDENTIFIER, 12) != 0) {
+        std::cerr << "Not a KTX2 file\n";
+        return false;
+    }
+    unsigned int vkFormat = readUint32(data + 12);
+    unsigned int width = readUint32(data + 20);
+    unsigned int height = readUint32(data + 24);
+    unsigned int depth = readUint32(data + 28);
+    unsigned int layers = readUint32(data + 32);
+    unsigned int faces = readUint32(data + 36);
+    unsigned int levelCount = std::max(1u, readUint32(data + 40));
+    unsigned int supercompression = readUint32(data + 44);
+
+    const Ktx2Format* format = std::find_if(KTX2_FORMATS, KTX2_FORMATS + FORMAT_COUNT,
+        [vkFormat](const Ktx2Format& candidate) {
+            return candidate.m_vkFormat == vkFormat;
+        });
+    if (format == KTX2_FORMATS + FORMAT_COUNT) {
+        std::cerr << "Unsupported KTX2 format " << vkFormat << '\n';
+        return false;
+    }
+    if (width == 0 || height == 0 || depth > 1 || layers > 1 || faces != 1 || supercompression != 0) {
+        std::cerr << "Only single 2D KTX2 textures without supercompression are supported\n";
+        return false;
+    }
+    if (size < KTX2_HEADER_SIZE + KTX2_LEVEL_INDEX_SIZE * levelCount) {
+        std::cerr << "The KTX2 file is cut off\n";
+        return false;
+    }
+
+    texture.m_format = static_cast<CompressedFormat>(format - KTX2_FORMATS);
+    texture.m_width = width;
+    texture.m_height = height;
+    texture.m_levels.clear();
+    for (unsigned int level = 0; level < levelCount; ++level) {
+        const unsigned char* index = data + KTX2_HEADER_SIZE + KTX2_LEVEL_INDEX_SIZE * level;
+        unsigned long long offset = readUint64(index);
+        unsigned long long length = readUint64(index + 8);
+        unsigned int expected = getCompressedSize(texture.m_format, std::max(1u, width >> level),
+            std::max(1u, height >> level));
+        if (length != expected || offset + length > size) {
+            std::cerr << "KTX2 mip level " << level << " has the wrong size\n";
+            return false;
+        }
+        texture.m_levels.emplace_back(data + offset, data + offset + length);
+    }
+    return true;
+}
+
+bool writeKtx2File(const std::string& filePath, const CompressedTexture& texture) {
+    std::vector<unsigned char> data = writeKtx2(texture);
+    std::ofstream file(filePath, std::ios::binary);
+    file.write(reinterpret_cast<const char*>(data.data()), data.size());
+    if (!file) {
+        std::cerr << "Failed to write " << filePath << '\n';
+        return false;
+    }
+    return true;
+}
+
+bool readKtx2File(const std::string& filePath, CompressedTexture& texture) {
+    std::ifstream file(filePath, std::ios::binary);
+    if (!file) {
+        std::cerr << "Failed to open " << filePath << '\n';
+        return false;
+    }
+    std::vector<unsigned char> data((std::istreambuf_iterator<char>(file)), std::istreambuf_iterator<char>());
+    return readKtx2(data.data(), static_cast<unsigned int>(data.size()), texture);
+}
@@ -0,0 +1,19 @@
+#ifndef KTX2_H_INCLUDED
+#define KTX2_H_INCLUDED
+
+#include "TextureCompression.h"
+
+#include <string>
+#include <vector>
+
+// KTX2 containers for compressed 2D textures with their mip chain. Only what the
+// texture compressor writes is supported: one layer, one face, no supercompression,
+// and the UNORM Vulkan formats of CompressedFormat.
+std::vector<unsigned char> writeKtx2(const CompressedTexture& texture);
+// false (with a message on std::cerr) if the data isn't a KTX2 file this can read
+bool readKtx2(const unsigned char* data, unsigned int size, CompressedTexture& texture);
+
+bool writeKtx2File(const std::string& filePath, const CompressedTexture& texture);
+bool readKtx2File(const std::string& filePath, CompressedTexture& texture);
+
+#endif
@@ -0,0 +1,40 @@
+#include "LodSelector.h"
+#include "Camera.h"
+
+#include <glm/glm.hpp>
+
+#include <algorithm>
+#include <cmath>
+
+// objects closer than this are treated as if they were this far away
+const float MIN_LOD_DISTANCE = 0.01f;
+
+LodSelector::LodSelector(float maxPixelError)
+    : m_cameraPosition{ 0.0f }, m_pixelsPerUnit{ 1.0f }, m_maxPixelError{ maxPixelError } {}
+
+void LodSelector::update(const Camera& camera, unsigned int viewportHeight) {
+    // the projection maps a height of 2 * tan(fov / 2) at distance 1 onto the viewport
+    m_cameraPosition = camera.getCameraPosition();
+    float halfFov = glm::radians(camera.getZoom()) * 0.5f;
+    m_pixelsPerUnit = static_cast<float>(viewportHeight) / (2.0f * std::tan(halfFov));
+}
+
+void LodSelector::setMaxPixelError(float maxPixelError) {
+    m_maxPixelError = maxPixelError;
+}
+
+unsigned int LodSelector::select(const float* errors, unsigned int count, const glm::mat4& model) const {
+    unsigned int level = 0;
+    while (level + 1 < count && getPixelError(errors[level + 1], model) <= m_maxPixelError) {
+        ++level;
+    }
+    return level;
+}
+
+float LodSelector::getPixelError(float error, const glm::mat4& model) const {
+    // the error grows with the largest scale of the model matrix and shrinks with distance
+    float scale = std::max({ glm::length(glm::vec3(model[0])), glm::length(glm::vec3(model[1])),
+        glm::length(glm::vec3(model[2])) });
+    float distance = std::max(glm::length(glm::vec3(model[3]) - m_cameraPosition), MIN_LOD_DISTANCE);
+    return error * scale / distance * m_pixelsPerUnit;
+}
@@ -0,0 +1,29 @@
+#ifndef LOD_SELECTOR_H_INCLUDED
+#define LOD_SELECTOR_H_INCLUDED
+
+#include "Camera.h"
+
+#include <glm/glm.hpp>
+
+// Picks the least detailed level of detail whose error, projected onto the
+// screen, stays below a number of pixels. Has to be updated every frame with
+// the camera and the viewport, since both zooming and resizing change how
+// big an error looks.
+class LodSelector {
+	glm::vec3 m_cameraPosition;
+	float m_pixelsPerUnit;      // size in pixels of one unit at a distance of one unit
+	float m_maxPixelError;
+
+public:
+	LodSelector(float maxPixelError = 1.0f);
+
+	void update(const Camera& camera, unsigned int viewportHeight);
+	void setMaxPixelError(float maxPixelError);
+
+	// errors are in object space, ordered from the most to the least detailed
+	// level, and never decrease. Returns the index of the selected level
+	unsigned int select(const float* errors, unsigned int count, const glm::mat4& model) const;
+	float getPixelError(float error, const glm::mat4& model) const;
+};
+
+#endif
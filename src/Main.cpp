@@ -1,15 +1,48 @@
 #include "ShaderProgram.h"
 #include "Mesh.h"
+#include "GeometryArena.h"
 #include "Texture.h"
+#include "TextureLoader.h"
+#include "TextureArray.h"
+#include "TextureManager.h"
+#include "VirtualTexture.h"
+#include "VirtualTextureCheck.h"
+#include "MipGenerator.h"
 #include "Camera.h"
+#include "RenderQueue.h"
+#include "GLState.h"
+#include "UniformBuffer.h"
+#include "GLExtensions.h"
+#include "DrawBatch.h"
+#include "VertexCompression.h"
+#include "MeshOptimizer.h"
+#include "MeshSimplifier.h"
+#include "Benchmark.h"
+#include "LodSelector.h"
+#include "Frustum.h"
+#include "OcclusionCuller.h"
+#include "OcclusionQueries.h"
+#include "SceneGraph.h"
+#include "EntityRegistry.h"
+#include "RenderComponents.h"
+#include "RenderSystems.h"
+#include "SystemScheduler.h"
+#include "JobSystem.h"
+#include "TextureCompression.h"
+#include "Ktx2.h"
 
 #include <glad/glad.h>
 #include <GLFW/GLFW3.h>
 #include <glm/glm.hpp>
+#include <glm/gtc/constants.hpp>
 #include <glm/gtc/matrix_transform.hpp>
+#include "stb_image/stb_image.h"
 
+#include <cmath>
 #include <iostream>
+#include <memory>
 #include <string>
+#include <vector>
 
 static unsigned int scrWidth = 800;
 static unsigned int scrHeight = 600;
@@ -19,6 +52,39 @@ const std::string COLORED_CUBE_VS = "res/shaders/coloredCube_vertex.glsl";
 const std::string COLORED_CUBE_FS = "res/shaders/coloredCube_fragment.glsl";
 const std::string LIGHT_SOURCE_VS = "res/shaders/lightSource_vertex.glsl";
 const std::string LIGHT_SOURCE_FS = "res/shaders/lightSource_fragment.glsl";
+const std::string INSTANCED_CUBE_VS = "res/shaders/instancedCube_vertex.glsl";
+const std::string INSTANCED_CUBE_FS = "res/shaders/instancedCube_fragment.glsl";
+const std::string BATCHED_CUBE_VS = "res/shaders/batchedCube_vertex.glsl";
+const std::string BATCHED_CUBE_FS = "res/shaders/batchedCube_fragment.glsl";
+const std::string OCCLUSION_BOX_VS = "res/shaders/occlusionBox_vertex.glsl";
+const std::string OCCLUSION_BOX_FS = "res/shaders/occlusionBox_fragment.glsl";
+const std::string VIRTUAL_TEXTURE_VS = "res/shaders/virtualTexture_vertex.glsl";
+const std::string VIRTUAL_TEXTURE_FS = "res/shaders/virtualTexture_fragment.glsl";
+const std::string TEXTURE_FILES[] = { "res/textures/container.jpg", "res/textures/face.png",
+    "res/textures/gradient.png", "res/textures/wall.jpg" };
+// the texture array of the batched cubes' materials stays bound to this unit
+const unsigned int MATERIAL_TEXTURE_UNIT = 1;
+// the units the TextureManager hands out, between the material array and the draw data
+const unsigned int MANAGED_TEXTURE_FIRST_UNIT = 2;
+const unsigned int MANAGED_TEXTURE_UNITS = 11;
+// the virtual texture's pages and page table
+const unsigned int VIRTUAL_PAGE_CACHE_UNIT = 13;
+const unsigned int VIRTUAL_PAGE_TABLE_UNIT = 14;
+// 128 texel pages with a 4 texel border, in a page texture of 16 x 16 pages (2048 x 2048)
+const unsigned int VIRTUAL_PAGE_SIZE = 128;
+const unsigned int VIRTUAL_PAGE_BORDER = 4;
+const unsigned int VIRTUAL_CACHE_PAGES_PER_SIDE = 16;
+// the lit cube shows the next texture after this many seconds
+const double TEXTURE_SWITCH_SECONDS = 2.0;
+// the lit cubes' vertices, positions, normals and texture coordinates
+const unsigned int LIT_CUBE_VERTEX_SIZE = 8 * sizeof(float);
+// the torus next to the lit cube, positions, normals and texture coordinates
+const unsigned int TORUS_RINGS = 96;
+const unsigned int TORUS_SEGMENTS = 48;
+const unsigned int TORUS_VERTEX_SIZE = 8 * sizeof(float);
+const unsigned int TORUS_LOD_LEVELS = 4;
+// the clusters of every level of the torus are kept in <prefix><level>.clusters
+const std::string TORUS_CLUSTER_PREFIX = "res/torus_lod";
 
 // create camera object with initial position
 static Camera g_camera(glm::vec3(0.0f, 0.65f, 4.0f));
@@ -65,25 +131,141 @@ static void processInput(GLFWwindow* window, float deltaTime) {
     }
 }
 
-// print the FPS to the screen every second
+// print the FPS and the number of issued/skipped state changes to the screen every second
 static void displayFPS() {
     static int FPS = 0;
     static double previousTime = glfwGetTime();
     double currentTime = glfwGetTime();
     ++FPS;
     if (currentTime - previousTime >= 1.0) {
-        std::cout << "FPS: " << FPS << '\n';
+        std::cout << "FPS: " << FPS << ", GL state calls issued: " << GLState::getCallsIssued()
+                  << ", elided: " << GLState::getCallsElided() << '\n';
+        GLState::resetCounters();
         FPS = 0;
         previousTime = currentTime;
     }
 }
 
-int main() {
+// Lay out count small cubes in a grid in front of the camera for the
+// stress tests (run the program with --stress <count> or --batch <count>)
+static std::vector<InstanceData> createStressInstances(unsigned int count) {
+    std::vector<InstanceData> instances(count);
+    const unsigned int side = static_cast<unsigned int>(std::ceil(std::cbrt(static_cast<double>(count))));
+    const float spacing = 0.5f;
+    for (unsigned int i = 0; i < count; ++i) {
+        unsigned int x = i % side;
+        unsigned int y = (i / side) % side;
+        unsigned int z = i / (side * side);
+        glm::vec3 position = glm::vec3(x - side * 0.5f, y - side * 0.5f, -2.0f - z) * spacing;
+        instances[i].m_model = glm::scale(glm::translate(glm::mat4(1.0f), position), glm::vec3(0.25f));
+        instances[i].m_color = glm::vec4(x, y, z, side) / static_cast<float>(side);
+    }
+    return instances;
+}
+
+// A torus with its texture wrapped around it once, so the vertices where the texture
+// coordinates wrap are there twice. The triangles go around one ring after the other,
+// the order most modelling tools export, whose rows are too long for the vertex cache.
+static void createTorus(unsigned int rings, unsigned int segments, std::vector<float>& vertices,
+    std::vector<unsigned int>& indices) {
+    const float majorRadius = 0.5f;
+    const float minorRadius = 0.2f;
+    for (unsigned int r = 0; r <= rings; ++r) {
+        // the last ring and segment are the first ones again with other texture coordinates
+        float u = static_cast<float>(r) / rings;
+        float ringAngle = glm::two_pi<float>() * (r % rings) / rings;
+        glm::vec3 ringCenter(glm::cos(ringAngle) * majorRadius, 0.0f, glm::sin(ringAngle) * majorRadius);
+        for (unsigned int s = 0; s <= segments; ++s) {
+            float v = static_cast<float>(s) / segments;
+            float segmentAngle = glm::two_pi<float>() * (s % segments) / segments;
+            glm::vec3 normal(glm::cos(ringAngle) * glm::cos(segmentAngle), glm::sin(segmentAngle),
+                glm::sin(ringAngle) * glm::cos(segmentAngle));
+            glm::vec3 position = ringCenter + normal * minorRadius;
+            vertices.insert(vertices.end(), { position.x, position.y, position.z, normal.x, normal.y, normal.z, u, v });
+        }
+    }
+    for (unsigned int r = 0; r < rings; ++r) {
+        for (unsigned int s = 0; s < segments; ++s) {
+            unsigned int a = r * (segments + 1) + s;
+            unsigned int b = a + segments + 1;
+            indices.insert(indices.end(), { a, a + 1, b, b, a + 1, b + 1 });
+        }
+    }
+}
+
+// Declared right after GLFW is initialized, so that when main returns it runs after every
+// GL object of main is gone: the mesh arenas are deleted while the context still exists.
+struct ContextLifetime {
+    ~ContextLifetime() {
+        GeometryArena::shutdown();
+        glfwTerminate();
+    }
+};
+
+// Compress an image file with its mip chain into a KTX2 file that Texture can load
+// (run the program with --compress <format> <input> <output.ktx2>)
+static int compressTextureFile(const std::string& formatName, const std::string& inputPath,
+    const std::string& outputPath) {
+    CompressedFormat format;
+    if (!findFormat(formatName, format)) {
+        std::cerr << "Unknown texture format " << formatName << ", use one of:";
+        for (unsigned int i = 0; i < FORMAT_COUNT; ++i) {
+            std::cerr << ' ' << getFormatInfo(static_cast<CompressedFormat>(i)).m_name;
+        }
+        std::cerr << '\n';
+        return -1;
+    }
+    // flipped the same way Texture flips the images it loads
+    stbi_set_flip_vertically_on_load(1);
+    int width, height, BPP;
+    unsigned char* pixels = stbi_load(inputPath.c_str(), &width, &height, &BPP, 4);
+    if (!pixels) {
+        std::cerr << "Failed to load texture at " << inputPath << '\n';
+        return -1;
+    }
+    JobSystem jobSystem;
+    CompressedTexture texture = compressTexture(pixels, width, height, format, true, &jobSystem);
+    stbi_image_free(pixels);
+    return writeKtx2File(outputPath, texture) ? 0 : -1;
+}
+
+int main(int argc, char* argv[]) {
+    // --stress <count> draws count extra cubes with a single instanced draw call
+    // --batch <count> draws count extra cubes as separate draws of one multi draw batch
+    // --benchmark <name> runs a CPU benchmark instead of opening a window
+    // --compress <format> <input> <output.ktx2> writes a compressed texture instead of opening a window
+    // --texture-budget <MB> is how much GPU memory the managed textures may use (64 MB by default)
+    // --virtual-texture <image> draws a floor with the image as a virtual texture
+    // --check-virtual-texture <image> compares the texels the virtual texture draws with its page file
+    unsigned int stressCount = 0;
+    unsigned int batchCount = 0;
+    unsigned long long textureBudget = 64ull * 1024 * 1024;
+    std::string virtualTexturePath;
+    std::string checkTexturePath;
+    for (int i = 1; i + 1 < argc; ++i) {
+        if (std::string(argv[i]) == "--benchmark") {
+            return runBenchmark(argv[i + 1]);
+        } else if (std::string(argv[i]) == "--compress" && i + 3 < argc) {
+            return compressTextureFile(argv[i + 1], argv[i + 2], argv[i + 3]);
+        } else if (std::string(argv[i]) == "--stress") {
+            stressCount = static_cast<unsigned int>(std::stoul(argv[i + 1]));
+        } else if (std::string(argv[i]) == "--batch") {
+            batchCount = static_cast<unsigned int>(std::stoul(argv[i + 1]));
+        } else if (std::string(argv[i]) == "--texture-budget") {
+            textureBudget = std::stoull(argv[i + 1]) * 1024 * 1024;
+        } else if (std::string(argv[i]) == "--virtual-texture") {
+            virtualTexturePath = argv[i + 1];
+        } else if (std::string(argv[i]) == "--check-virtual-texture") {
+            checkTexturePath = argv[i + 1];
+        }
+    }
+
     // initialize GLFW
     if (!glfwInit()) {
         std::cerr << "Failed to initialize GLFW\n";
         return -1;
     }
+    ContextLifetime contextLifetime;
     glfwWindowHint(GLFW_CONTEXT_VERSION_MAJOR, 3);
     glfwWindowHint(GLFW_CONTEXT_VERSION_MINOR, 3);
     glfwWindowHint(GLFW_OPENGL_PROFILE, GLFW_OPENGL_CORE_PROFILE);
@@ -95,7 +277,6 @@ int main() {
     GLFWwindow* window = glfwCreateWindow(scrWidth, scrHeight, SCR_TITLE, nullptr, nullptr);
     if (!window) {
         std::cerr << "Failed to create GLFW window\n";
-        glfwTerminate();
         return -1;
     }
     glfwMakeContextCurrent(window);
@@ -107,23 +288,67 @@ int main() {
     glfwSetInputMode(window, GLFW_CURSOR, GLFW_CURSOR_DISABLED);
 
     // Tie the buffer swap rate (the FPS) to your monitor's refresh rate
-    glfwSwapInterval(1);
+    // (except when stress testing, where we want to see the real frame rate)
+    glfwSwapInterval(stressCount > 0 || batchCount > 0 ? 0 : 1);
 
     // initialize GLAD
     if (!gladLoadGLLoader((GLADloadproc) glfwGetProcAddress)) {
         std::cerr << "Failed to initialize GLAD\n";
-        glfwTerminate();
         return -1;
     }
 
     std::cout << "OpenGL version: " << glGetString(GL_VERSION) << '\n';
 
+    // load the functions GLAD was not generated with, if the context has them
+    GLExtensions::load((GLADloadproc) glfwGetProcAddress);
+
+    if (!checkTexturePath.empty()) {
+        return checkVirtualTexture(checkTexturePath, VIRTUAL_PAGE_SIZE, VIRTUAL_PAGE_BORDER,
+            VIRTUAL_CACHE_PAGES_PER_SIDE, VIRTUAL_PAGE_CACHE_UNIT, VIRTUAL_PAGE_TABLE_UNIT);
+    }
+
+    // The batched cubes' materials use regions of one texture array, so draws with
+    // different textures need no binds in between. The 512x512 images take a layer
+    // each, the larger gradient is packed into an atlas layer from its second mip level.
+    // This is done before the TextureLoader starts, so both read the same cached mips.
+    TextureArray materialTextures(512, 4, 0, MATERIAL_TEXTURE_UNIT);
+    std::vector<TextureRegion> materialRegions;
+    for (const std::string& file : TEXTURE_FILES) {
+        MipChain chain;
+        TextureRegion region;
+        if (loadMipChain(file, MIP_FILTER_KAISER, true, chain) && materialTextures.add(chain, region)) {
+            materialRegions.push_back(region);
+        }
+    }
+    if (materialRegions.empty()) {
+        // white, so the materials keep their colors without textures
+        TextureRegion region;
+        materialTextures.add(MipChain{ 1, 1, { { 255, 255, 255, 255 } } }, region);
+        materialRegions.push_back(region);
+    }
+
+    // the textures load in the background while the rest is set up and the first frames are drawn
+    TextureLoader textureLoader;
+    for (const std::string& file : TEXTURE_FILES) {
+        textureLoader.load(file);
+    }
+    bool texturesReported = false;
+
+    // the lit cube's textures are loaded when drawn and kept within the budget
+    TextureManager textureManager(textureBudget, MANAGED_TEXTURE_FIRST_UNIT, MANAGED_TEXTURE_UNITS);
+    std::vector<ManagedTexture> cubeTextures;
+    for (const std::string& file : TEXTURE_FILES) {
+        cubeTextures.push_back(textureManager.add(file));
+    }
+    unsigned int cubeTexture = 0;
+    double textureSwitchTime = glfwGetTime();
+
     // draw over objects further away, but not over closer objects
-    glEnable(GL_DEPTH_TEST);
+    GLState::setCapability(GL_DEPTH_TEST, true);
 
     // don't render the back faces of triangles
     // the back face has vertices with a clockwise winding order
-    glEnable(GL_CULL_FACE);
+    GLState::setCapability(GL_CULL_FACE, true);
 
     const float CUBE_DATA[] = {
          // front
@@ -160,35 +385,35 @@ int main() {
 
     const float CUBE_DATA2[] = {
         // front
-       -0.5f, -0.5f,  0.5f,   0.0f,  0.0f,  1.0f,
-        0.5f, -0.5f,  0.5f,   0.0f,  0.0f,  1.0f,
-       -0.5f,  0.5f,  0.5f,   0.0f,  0.0f,  1.0f,
-        0.5f,  0.5f,  0.5f,   0.0f,  0.0f,  1.0f,
+       -0.5f, -0.5f,  0.5f,   0.0f,  0.0f,  1.0f,   0.0f, 0.0f,
+        0.5f, -0.5f,  0.5f,   0.0f,  0.0f,  1.0f,   1.0f, 0.0f,
+       -0.5f,  0.5f,  0.5f,   0.0f,  0.0f,  1.0f,   0.0f, 1.0f,
+        0.5f,  0.5f,  0.5f,   0.0f,  0.0f,  1.0f,   1.0f, 1.0f,
         // left                            
-       -0.5f, -0.5f, -0.5f,  -1.0f,  0.0f,  0.0f,
-       -0.5f, -0.5f,  0.5f,  -1.0f,  0.0f,  0.0f,
-       -0.5f,  0.5f, -0.5f,  -1.0f,  0.0f,  0.0f,
-       -0.5f,  0.5f,  0.5f,  -1.0f,  0.0f,  0.0f,
+       -0.5f, -0.5f, -0.5f,  -1.0f,  0.0f,  0.0f,   0.0f, 0.0f,
+       -0.5f, -0.5f,  0.5f,  -1.0f,  0.0f,  0.0f,   1.0f, 0.0f,
+       -0.5f,  0.5f, -0.5f,  -1.0f,  0.0f,  0.0f,   0.0f, 1.0f,
+       -0.5f,  0.5f,  0.5f,  -1.0f,  0.0f,  0.0f,   1.0f, 1.0f,
         // right                           
-        0.5f, -0.5f,  0.5f,   1.0f,  0.0f,  0.0f,
-        0.5f, -0.5f, -0.5f,   1.0f,  0.0f,  0.0f,
-        0.5f,  0.5f,  0.5f,   1.0f,  0.0f,  0.0f,
-        0.5f,  0.5f, -0.5f,   1.0f,  0.0f,  0.0f,
+        0.5f, -0.5f,  0.5f,   1.0f,  0.0f,  0.0f,   0.0f, 0.0f,
+        0.5f, -0.5f, -0.5f,   1.0f,  0.0f,  0.0f,   1.0f, 0.0f,
+        0.5f,  0.5f,  0.5f,   1.0f,  0.0f,  0.0f,   0.0f, 1.0f,
+        0.5f,  0.5f, -0.5f,   1.0f,  0.0f,  0.0f,   1.0f, 1.0f,
         // back                     
-        0.5f, -0.5f, -0.5f,   0.0f,  0.0f, -1.0f,
-       -0.5f, -0.5f, -0.5f,   0.0f,  0.0f, -1.0f,
-        0.5f,  0.5f, -0.5f,   0.0f,  0.0f, -1.0f,
-       -0.5f,  0.5f, -0.5f,   0.0f,  0.0f, -1.0f,
+        0.5f, -0.5f, -0.5f,   0.0f,  0.0f, -1.0f,   0.0f, 0.0f,
+       -0.5f, -0.5f, -0.5f,   0.0f,  0.0f, -1.0f,   1.0f, 0.0f,
+        0.5f,  0.5f, -0.5f,   0.0f,  0.0f, -1.0f,   0.0f, 1.0f,
+       -0.5f,  0.5f, -0.5f,   0.0f,  0.0f, -1.0f,   1.0f, 1.0f,
         // top                      
-       -0.5f,  0.5f,  0.5f,   0.0f,  1.0f,  0.0f,
-        0.5f,  0.5f,  0.5f,   0.0f,  1.0f,  0.0f,
-       -0.5f,  0.5f, -0.5f,   0.0f,  1.0f,  0.0f,
-        0.5f,  0.5f, -0.5f,   0.0f,  1.0f,  0.0f,
+       -0.5f,  0.5f,  0.5f,   0.0f,  1.0f,  0.0f,   0.0f, 0.0f,
+        0.5f,  0.5f,  0.5f,   0.0f,  1.0f,  0.0f,   1.0f, 0.0f,
+       -0.5f,  0.5f, -0.5f,   0.0f,  1.0f,  0.0f,   0.0f, 1.0f,
+        0.5f,  0.5f, -0.5f,   0.0f,  1.0f,  0.0f,   1.0f, 1.0f,
         // bottom
-       -0.5f, -0.5f, -0.5f,   0.0f, -1.0f,  0.0f,
-        0.5f, -0.5f, -0.5f,   0.0f, -1.0f,  0.0f,
-       -0.5f, -0.5f,  0.5f,   0.0f, -1.0f,  0.0f,
-        0.5f, -0.5f,  0.5f,   0.0f, -1.0f,  0.0f,
+       -0.5f, -0.5f, -0.5f,   0.0f, -1.0f,  0.0f,   0.0f, 0.0f,
+        0.5f, -0.5f, -0.5f,   0.0f, -1.0f,  0.0f,   1.0f, 0.0f,
+       -0.5f, -0.5f,  0.5f,   0.0f, -1.0f,  0.0f,   0.0f, 1.0f,
+        0.5f, -0.5f,  0.5f,   0.0f, -1.0f,  0.0f,   1.0f, 1.0f,
     };
 
     const unsigned int CUBE_INDICES[] = {
@@ -201,17 +426,181 @@ int main() {
     };
     const int NUM_INDICES = sizeof(CUBE_INDICES) / sizeof(unsigned int);
 
+    // reorder the lit cube's triangles and vertices for the GPU's caches
+    std::vector<float> litCubeData(CUBE_DATA2, CUBE_DATA2 + sizeof(CUBE_DATA2) / sizeof(float));
+    std::vector<unsigned int> litCubeIndices(CUBE_INDICES, CUBE_INDICES + NUM_INDICES);
+    const unsigned int CUBE_VERTICES = optimizeMesh(litCubeData.data(), sizeof(CUBE_DATA2) / LIT_CUBE_VERTEX_SIZE,
+        LIT_CUBE_VERTEX_SIZE, litCubeIndices);
+
+    // store the lit cubes with half float positions, packed normals and normalized short texture
+    // coordinates (16 instead of 32 bytes per vertex)
+    QuantizationError quantizationError;
+    std::vector<unsigned char> compressedCube;
+    const VertexLayout COMPRESSED_LAYOUT = compressVertices(litCubeData.data(), CUBE_VERTICES, { 3, 3, 2 }, 0.001f,
+        compressedCube, quantizationError);
+    const unsigned int COMPRESSED_CUBE_SIZE = static_cast<unsigned int>(compressedCube.size());
+
+    // the torus is reordered for the vertex cache, overdraw and vertex fetches like the cube,
+    // but unlike the cube's 12 triangles its order makes a difference
+    std::vector<float> torusData;
+    std::vector<unsigned int> torusIndices;
+    createTorus(TORUS_RINGS, TORUS_SEGMENTS, torusData, torusIndices);
+    const unsigned int TORUS_INDICES = static_cast<unsigned int>(torusIndices.size());
+    unsigned int torusVertices = static_cast<unsigned int>(torusData.size() * sizeof(float) / TORUS_VERTEX_SIZE);
+    const float torusAcmr = analyzeVertexCache(torusIndices.data(), TORUS_INDICES, torusVertices).m_acmr;
+    torusVertices = optimizeMesh(torusData.data(), torusVertices, TORUS_VERTEX_SIZE, torusIndices);
+    std::cout << "Torus vertex cache ACMR: " << torusAcmr << " exported, "
+        << analyzeVertexCache(torusIndices.data(), TORUS_INDICES, torusVertices).m_acmr << " optimized\n";
+    QuantizationError torusQuantizationError;
+    std::vector<unsigned char> compressedTorus;
+    const VertexLayout TORUS_LAYOUT = compressVertices(torusData.data(), torusVertices, { 3, 3, 2 }, 0.001f,
+        compressedTorus, torusQuantizationError);
+
+    // the view and projection matrices are shared by every shader program
+    UniformBuffer cameraBuffer(sizeof(CameraBlock), CAMERA_BLOCK_BINDING);
+
     // light source
     ShaderProgram lightSourceShader(LIGHT_SOURCE_VS, LIGHT_SOURCE_FS);
+    lightSourceShader.bindUniformBlock("Camera", CAMERA_BLOCK_BINDING);
     Mesh lightSourceMesh(CUBE_DATA, sizeof(CUBE_DATA), { 3 });
     lightSourceMesh.addSubmesh(CUBE_INDICES, NUM_INDICES, &lightSourceShader);
 
     // colored cube
     ShaderProgram coloredCubeShader(COLORED_CUBE_VS, COLORED_CUBE_FS);
+    coloredCubeShader.bindUniformBlock("Camera", CAMERA_BLOCK_BINDING);
     coloredCubeShader.addUniform3f("u_objectColor", 1.0f, 0.5f, 0.31f);
     coloredCubeShader.addUniform3f("u_lightColor", 1.0f, 1.0f, 1.0f);
-    Mesh coloredCubeMesh(CUBE_DATA2, sizeof(CUBE_DATA2), { 3, 3 });
-    coloredCubeMesh.addSubmesh(CUBE_INDICES, NUM_INDICES, &coloredCubeShader);
+    Mesh coloredCubeMesh(compressedCube.data(), COMPRESSED_CUBE_SIZE, COMPRESSED_LAYOUT);
+    coloredCubeMesh.addSubmesh(litCubeIndices.data(), NUM_INDICES, &coloredCubeShader, {}, true);
+
+    // a torus with the lit cube's shader and texture to its left
+    Mesh torusMesh(compressedTorus.data(), static_cast<unsigned int>(compressedTorus.size()), TORUS_LAYOUT);
+    // every level is split into clusters, so the side facing away and what is off screen aren't drawn
+    const std::string torusClusterFile = TORUS_CLUSTER_PREFIX + "0.clusters";
+    ClusteredMesh torusClusters = loadOrBuildClusters(torusClusterFile, torusIndices.data(), TORUS_INDICES,
+        torusData.data(), torusVertices, TORUS_VERTEX_SIZE);
+    unsigned int torusSubmesh = torusMesh.addClusteredSubmesh(torusClusters, &coloredCubeShader);
+    // its levels of detail keep the vertices, the seam where the texture wraps doesn't open
+    std::vector<LodLevel> torusLods = buildLodChain(torusIndices.data(), TORUS_INDICES, torusData.data(),
+        torusVertices, TORUS_VERTEX_SIZE, TORUS_LOD_LEVELS);
+    for (unsigned int level = 0; level < torusLods.size(); ++level) {
+        LodLevel& lod = torusLods[level];
+        unsigned int count = static_cast<unsigned int>(lod.m_indices.size());
+        lod.m_indices = optimizeVertexCache(lod.m_indices.data(), count, torusVertices);
+        ClusteredMesh lodClusters = loadOrBuildClusters(TORUS_CLUSTER_PREFIX + std::to_string(level + 1) + ".clusters",
+            lod.m_indices.data(), count, torusData.data(), torusVertices, TORUS_VERTEX_SIZE);
+        torusMesh.addClusteredLod(torusSubmesh, lodClusters, lod.m_error);
+        std::cout << "Torus LOD: " << count / 3 << " triangles in " << lodClusters.m_clusters.size()
+            << " clusters, error " << lod.m_error << '\n';
+    }
+    const glm::mat4 torusModel = glm::rotate(glm::translate(glm::mat4(1.0f), glm::vec3(-1.5f, 0.2f, -0.5f)),
+        glm::radians(60.0f), glm::vec3(1.0f, 0.0f, 0.0f));
+
+    // instanced cubes for the stress test
+    ShaderProgram instancedCubeShader(INSTANCED_CUBE_VS, INSTANCED_CUBE_FS);
+    instancedCubeShader.bindUniformBlock("Camera", CAMERA_BLOCK_BINDING);
+    instancedCubeShader.addUniform3f("u_lightColor", 1.0f, 1.0f, 1.0f);
+    Mesh instancedCubeMesh(compressedCube.data(), COMPRESSED_CUBE_SIZE, COMPRESSED_LAYOUT);
+    if (stressCount > 0) {
+        unsigned int submesh = instancedCubeMesh.addInstancedSubmesh(litCubeIndices.data(), NUM_INDICES,
+            &instancedCubeShader, stressCount);
+        std::vector<InstanceData> instances = createStressInstances(stressCount);
+        instancedCubeMesh.setInstances(submesh, instances.data(), stressCount);
+        std::cout << "Drawing " << stressCount << " instanced cubes\n";
+    }
+
+    // separately drawn cubes for the multi draw stress test
+    ShaderProgram batchedCubeShader(BATCHED_CUBE_VS, BATCHED_CUBE_FS);
+    batchedCubeShader.bindUniformBlock("Camera", CAMERA_BLOCK_BINDING);
+    batchedCubeShader.addUniform3f("u_lightColor", 1.0f, 1.0f, 1.0f);
+    batchedCubeShader.addUniform3f("u_materialColors[0]", 1.0f, 0.5f, 0.31f);
+    batchedCubeShader.addUniform3f("u_materialColors[1]", 0.31f, 1.0f, 0.5f);
+    batchedCubeShader.addUniform3f("u_materialColors[2]", 0.5f, 0.31f, 1.0f);
+    batchedCubeShader.addUniform3f("u_materialColors[3]", 1.0f, 1.0f, 0.31f);
+    batchedCubeShader.addTexture(&materialTextures, "u_materialTextures");
+    for (unsigned int i = 0; i < 4; ++i) {
+        const TextureRegion& region = materialRegions[i % materialRegions.size()];
+        const std::string index = "[" + std::to_string(i) + "]";
+        batchedCubeShader.addUniform4f("u_materialRects" + index, region.m_rect.x, region.m_rect.y, region.m_rect.z,
+            region.m_rect.w);
+        batchedCubeShader.addUniform1f("u_materialLayers" + index, static_cast<float>(region.m_layer));
+        batchedCubeShader.addUniform1f("u_materialMaxLevels" + index, static_cast<float>(region.m_maxLevel));
+    }
+    Mesh batchedCubeMesh(compressedCube.data(), COMPRESSED_CUBE_SIZE, COMPRESSED_LAYOUT);
+    std::vector<InstanceData> batchedCubes;
+    if (batchCount > 0) {
+        batchedCubeMesh.addSubmesh(litCubeIndices.data(), NUM_INDICES, &batchedCubeShader);
+        batchedCubes = createStressInstances(batchCount);
+        std::cout << "Drawing " << batchCount << " batched cubes\n";
+    }
+
+    // culling, transform updates and systems spread their work over all cores
+    JobSystem jobSystem;
+
+    // the batched cubes are entities, entity i is batched cube i
+    EntityRegistry registry;
+    for (unsigned int i = 0; i < batchedCubes.size(); ++i) {
+        Entity entity = registry.create();
+        registry.add(entity, makeTransform(glm::vec3(batchedCubes[i].m_model[3]), glm::quat(1.0f, 0.0f, 0.0f, 0.0f),
+            glm::vec3(0.25f)));
+        registry.add(entity, MeshComponent{ &batchedCubeMesh });
+        registry.add(entity, MaterialComponent{ i });
+        registry.add(entity, makeBounds(batchedCubeMesh.getBounds()));
+    }
+
+    // world matrices and bounds are only recomputed for entities that moved
+    SystemScheduler systems(&jobSystem);
+    systems.addSystem("transforms", [&registry, &jobSystem]() {
+        updateTransforms(registry, &jobSystem);
+    }, 0, EntityRegistry::getComponentMask<TransformComponent>());
+    systems.addSystem("bounds", [&registry, &jobSystem]() {
+        updateBounds(registry, &jobSystem);
+    }, EntityRegistry::getComponentMask<TransformComponent>(), EntityRegistry::getComponentMask<BoundsComponent>());
+    systems.run();
+    EntityCuller entityCuller;
+    std::vector<Entity> visibleCubes;
+
+    // the lit cube in the middle hides the batched cubes behind it
+    OcclusionCuller occlusionCuller(256, 128, &jobSystem);
+
+    // what the CPU can't tell is occluded is left to occlusion queries against the depth buffer
+    ShaderProgram occlusionBoxShader(OCCLUSION_BOX_VS, OCCLUSION_BOX_FS);
+    occlusionBoxShader.bindUniformBlock("Camera", CAMERA_BLOCK_BINDING);
+    OcclusionQueries occlusionQueries(&occlusionBoxShader);
+    for (unsigned int i = 0; i < batchedCubes.size(); ++i) {
+        occlusionQueries.addObject(registry.get<BoundsComponent>(i).m_world);
+    }
+    DrawBatch drawBatch;
+
+    // draws are collected here every frame and submitted sorted by state
+    RenderQueue renderQueue;
+
+    // the transforms of the lit cube and the light that circles around it
+    SceneGraph sceneGraph(&jobSystem);
+    const unsigned int coloredCubeNode = sceneGraph.createNode();
+    const unsigned int lightSourceNode = sceneGraph.createNode(SceneGraph::NO_NODE, glm::vec3(0.0f),
+        glm::quat(1.0f, 0.0f, 0.0f, 0.0f), glm::vec3(0.2f));
+
+    // meshes with levels of detail are drawn with the coarsest one that is off by at most a pixel
+    LodSelector lodSelector(1.0f);
+
+    // a floor under the scene streams its texture's pages as they are needed
+    ShaderProgram virtualTextureShader(VIRTUAL_TEXTURE_VS, VIRTUAL_TEXTURE_FS);
+    virtualTextureShader.bindUniformBlock("Camera", CAMERA_BLOCK_BINDING);
+    virtualTextureShader.addUniform3f("u_lightColor", 1.0f, 1.0f, 1.0f);
+    Mesh floorMesh(compressedCube.data(), COMPRESSED_CUBE_SIZE, COMPRESSED_LAYOUT);
+    floorMesh.addSubmesh(litCubeIndices.data(), NUM_INDICES, &virtualTextureShader, {}, true);
+    const glm::mat4 floorModel = glm::scale(glm::translate(glm::mat4(1.0f), glm::vec3(0.0f, -2.0f, 0.0f)),
+        glm::vec3(20.0f, 0.1f, 20.0f));
+    std::unique_ptr<VirtualTexture> virtualTexture;
+    if (!virtualTexturePath.empty()) {
+        virtualTexture = std::make_unique<VirtualTexture>(virtualTexturePath, VIRTUAL_PAGE_SIZE, VIRTUAL_PAGE_BORDER,
+            VIRTUAL_CACHE_PAGES_PER_SIDE, VIRTUAL_CACHE_PAGES_PER_SIDE, VIRTUAL_PAGE_CACHE_UNIT,
+            VIRTUAL_PAGE_TABLE_UNIT, 0, &jobSystem);
+        if (!virtualTexture->isLoaded()) {
+            virtualTexture.reset();
+        }
+    }
 
     // variables for deltaTime
     double previousTime = glfwGetTime();
@@ -227,41 +616,109 @@ int main() {
 
         displayFPS();
 
+        textureLoader.update();
+        textureManager.beginFrame();
+        GeometryArena::compactFragmented();
+        if (currentTime - textureSwitchTime > TEXTURE_SWITCH_SECONDS) {
+            cubeTexture = (cubeTexture + 1) % cubeTextures.size();
+            textureSwitchTime = currentTime;
+            textureManager.printStatistics();
+            if (virtualTexture) {
+                virtualTexture->printStatistics();
+            }
+        }
+        if (!texturesReported && textureLoader.getPendingCount() == 0) {
+            textureLoader.printLatencies();
+            texturesReported = true;
+        }
+
         // clear the screen and the depth buffer
         glClear(GL_COLOR_BUFFER_BIT | GL_DEPTH_BUFFER_BIT);
 
-        const glm::vec3 viewPos = g_camera.getCameraPosition();
-        coloredCubeShader.addUniform3f("u_viewPos", viewPos.x, viewPos.y, viewPos.z);
         float x = glm::sin(static_cast<float>(glfwGetTime())) * 2.0f;
         float z = glm::cos(static_cast<float>(glfwGetTime())) * 2.0f;
         glm::vec3 lightPos = glm::vec3(x, 1.0f, z);
         coloredCubeShader.addUniform3f("u_lightPos", lightPos.x, lightPos.y, lightPos.z);
-
-        glm::mat4 model = glm::mat4(1.0f);
-        coloredCubeShader.addUniformMat4f("u_model", model);
-        
-        model = glm::translate(model, lightPos);
-        model = glm::scale(model, glm::vec3(0.2f));
-        lightSourceShader.addUniformMat4f("u_model", model);
+        virtualTextureShader.addUniform3f("u_lightPos", lightPos.x, lightPos.y, lightPos.z);
+        instancedCubeShader.addUniform3f("u_lightPos", lightPos.x, lightPos.y, lightPos.z);
+        batchedCubeShader.addUniform3f("u_lightPos", lightPos.x, lightPos.y, lightPos.z);
+
+        sceneGraph.setPosition(lightSourceNode, lightPos);
+        sceneGraph.update();
+        const glm::mat4& coloredCubeModel = sceneGraph.getWorldMatrix(coloredCubeNode);
+        const glm::mat4& lightSourceModel = sceneGraph.getWorldMatrix(lightSourceNode);
         
-        glm::mat4 view = g_camera.getViewMatrix();
-        coloredCubeShader.addUniformMat4f("u_view", view);
-        lightSourceShader.addUniformMat4f("u_view", view);
-
+        // upload the camera once for all shader programs
         float scrRatio = static_cast<float>(scrWidth) / static_cast<float>(scrHeight);
-        glm::mat4 projection = glm::perspective(glm::radians(g_camera.getZoom()), scrRatio, 0.1f, 100.0f);
-        coloredCubeShader.addUniformMat4f("u_projection", projection);
-        lightSourceShader.addUniformMat4f("u_projection", projection);
-
-        coloredCubeMesh.render();
-        lightSourceMesh.render();
+        CameraBlock cameraBlock;
+        cameraBlock.m_view = g_camera.getViewMatrix();
+        cameraBlock.m_projection = glm::perspective(glm::radians(g_camera.getZoom()), scrRatio, 0.1f, 100.0f);
+        cameraBlock.m_viewProjection = cameraBlock.m_projection * cameraBlock.m_view;
+        cameraBlock.m_position = g_camera.getCameraPosition();
+        cameraBlock.m_time = static_cast<float>(currentTime);
+        cameraBuffer.update(&cameraBlock, sizeof(CameraBlock));
+        renderQueue.setViewMatrix(cameraBlock.m_view);
+        lodSelector.update(g_camera, scrHeight);
+        CullingView cullingView;
+        cullingView.m_frustum = extractFrustum(cameraBlock.m_viewProjection);
+        cullingView.m_cameraPosition = cameraBlock.m_position;
+
+        // the feedback pass draws the floor once more into a small framebuffer, with the
+        // pages it needs instead of colors
+        if (virtualTexture) {
+            virtualTexture->update();
+            virtualTexture->beginFeedback(scrWidth, scrHeight);
+            virtualTexture->setUniforms(virtualTextureShader, true);
+            floorMesh.render(renderQueue, floorModel, &lodSelector, &cullingView);
+            renderQueue.flush();
+            virtualTexture->endFeedback(scrWidth, scrHeight);
+            virtualTexture->setUniforms(virtualTextureShader, false);
+            floorMesh.render(renderQueue, floorModel, &lodSelector, &cullingView);
+        }
+
+        // the lit cube and the torus share the only managed texture, so its unit stays bound until the flush
+        textureManager.beginDraw();
+        unsigned int cubeTextureUnit = 0;
+        if (textureManager.bind(cubeTextures[cubeTexture], cubeTextureUnit)) {
+            coloredCubeShader.addUniform1i("u_texture", cubeTextureUnit);
+        }
+        coloredCubeMesh.render(renderQueue, coloredCubeModel, &lodSelector, &cullingView);
+        torusMesh.render(renderQueue, torusModel, &lodSelector, &cullingView);
+        lightSourceMesh.render(renderQueue, lightSourceModel, &lodSelector, &cullingView);
+        instancedCubeMesh.render(renderQueue, glm::mat4(1.0f));
+        renderQueue.flush();
+
+        // all batched cubes are culled in one call, so they don't need the view again
+        systems.run();
+        entityCuller.update(registry);
+        visibleCubes.clear();
+        entityCuller.cull(cullingView.m_frustum, visibleCubes);
+        if (!visibleCubes.empty()) {
+            occlusionCuller.beginFrame(cameraBlock.m_viewProjection);
+            occlusionCuller.addOccluder(litCubeData.data(), CUBE_VERTICES, LIT_CUBE_VERTEX_SIZE, litCubeIndices.data(),
+                NUM_INDICES, coloredCubeModel);
+            occlusionCuller.rasterize();
+        }
+        occlusionQueries.beginFrame(cameraBlock.m_position);
+        for (Entity entity : visibleCubes) {
+            if (!occlusionCuller.isVisible(registry.get<BoundsComponent>(entity).m_world)) {
+                continue;
+            }
+            OcclusionResult occlusion = occlusionQueries.test(getEntityIndex(entity));
+            if (occlusion.m_draw) {
+                const glm::mat4& model = registry.get<TransformComponent>(entity).m_world;
+                unsigned int material = registry.get<MaterialComponent>(entity).m_material;
+                registry.get<MeshComponent>(entity).m_mesh->render(drawBatch, model, material, &lodSelector, nullptr,
+                    occlusion.m_conditionQuery);
+            }
+        }
+        drawBatch.flush();
+        occlusionQueries.issueQueries();
 
         glfwSwapBuffers(window);
         glfwPollEvents();
     }
-    
-    // clean up
-    glfwTerminate();
 
+    // the GL objects are deleted and GLFW terminated on the way out, see ContextLifetime
     return 0;
 }
\ No newline at end of file
@@ -1,85 +1,291 @@
 #include "Mesh.h"
 #include "ShaderProgram.h"
+#include "Texture.h"
+#include "RenderQueue.h"
+#include "DrawBatch.h"
+#include "GeometryArena.h"
+#include "VertexLayout.h"
+#include "TriangleStrips.h"
+#include "GLState.h"
 
 #include <glad/glad.h>
+#include <glm/glm.hpp>
 
+#include <algorithm>
+#include <cstring>
+#include <iostream>
 #include <vector>
-#include <numeric>
 
-Mesh::Submesh::Submesh(unsigned int vao, unsigned int ibo, unsigned int count, const ShaderProgram* shader)
-    : m_vertexArrayID{ vao }, m_indexBufferID{ ibo }, m_indexBufferCount{ count }, m_shader{ shader } {}
+// copies the indices into the smaller index type T, keeping the restart index a restart index
+template <typename T>
+static std::vector<unsigned char> narrowIndices(const std::vector<unsigned int>& indices) {
+    std::vector<unsigned char> data(indices.size() * sizeof(T));
+    for (unsigned int i = 0; i < indices.size(); ++i) {
+        T index = static_cast<T>(indices[i]);
+        std::memcpy(data.data() + i * sizeof(T), &index, sizeof(T));
+    }
+    return data;
+}
+
+Mesh::Submesh::Submesh(unsigned int vao, const SubmeshLod& lod, const ShaderProgram* shader,
+    const std::vector<const Texture*>& textures)
+    : m_vertexArrayID{ vao }, m_lods{ lod }, m_lodErrors{ 0.0f }, m_shader{ shader }, m_textures{ textures },
+      m_instanceBufferID{ 0 }, m_instanceCount{ 0 }, m_instanceCapacity{ 0 } {}
 
-Mesh::Mesh(const void* data, unsigned int size, const std::vector<unsigned int>& layout) 
-    : m_vbData{ data }, m_vbSize{ size }, m_vbLayout{ layout } {
-    glGenBuffers(1, &m_vbID);
+Mesh::Mesh(const void* data, unsigned int size, const VertexLayout& layout)
+    : m_arena{ &GeometryArena::get(layout) } {
+    const unsigned int vertexCount = size / m_arena->getVertexSize();
+    m_vertexHandle = m_arena->addVertices(data, vertexCount);
+
+    // the vertices may be compressed, so the positions are decoded first
+    std::vector<glm::vec3> positions(vertexCount);
+    for (unsigned int i = 0; i < vertexCount; ++i) {
+        positions[i] = layout.readPosition(static_cast<const char*>(data) + i * layout.getStride());
+    }
+    m_bounds = computeBounds(&positions.data()->x, vertexCount, sizeof(glm::vec3));
 }
 
 Mesh::~Mesh() {
     // delete submeshes
     for (const Submesh& mesh : m_meshes) {
-        glDeleteVertexArrays(1, &mesh.m_vertexArrayID);
-        glDeleteBuffers(1, &mesh.m_indexBufferID);
+        for (const SubmeshLod& lod : mesh.m_lods) {
+            m_arena->freeIndices(lod.m_indexHandle);
+        }
+        if (mesh.m_instanceBufferID) {
+            GLState::forgetVertexArray(mesh.m_vertexArrayID);
+            GLState::forgetBuffer(mesh.m_instanceBufferID);
+            glDeleteVertexArrays(1, &mesh.m_vertexArrayID);
+            glDeleteBuffers(1, &mesh.m_instanceBufferID);
+        }
+    }
+
+    // free the vertices in the arena
+    m_arena->freeVertices(m_vertexHandle);
+}
+
+unsigned int Mesh::addSubmesh(const void* ibData, unsigned int count, const ShaderProgram* shader,
+    const std::vector<const Texture*>& textures, bool triangleStrips) {
+    // all submeshes with the same vertex layout share the arena's vertex array
+    SubmeshLod lod = addIndices(static_cast<const unsigned int*>(ibData), count, triangleStrips);
+    m_meshes.emplace_back(m_arena->getVertexArrayID(), lod, shader, textures);
+    return static_cast<unsigned int>(m_meshes.size() - 1);
+}
+
+void Mesh::addLods(unsigned int submesh, const std::vector<LodLevel>& lods) {
+    // the levels are drawn the same way as the full detail one
+    Submesh& mesh = m_meshes[submesh];
+    bool triangleStrips = mesh.m_lods.front().m_primitive == GL_TRIANGLE_STRIP;
+    for (const LodLevel& level : lods) {
+        mesh.m_lods.push_back(addIndices(level.m_indices.data(), static_cast<unsigned int>(level.m_indices.size()),
+            triangleStrips));
+        mesh.m_lodErrors.push_back(level.m_error);
     }
+}
 
-    // delete vertex buffer
-    glDeleteBuffers(1, &m_vbID);
+unsigned int Mesh::addClusteredSubmesh(const ClusteredMesh& clusters, const ShaderProgram* shader,
+    const std::vector<const Texture*>& textures) {
+    unsigned int count = static_cast<unsigned int>(clusters.m_indices.size());
+    SubmeshLod& lod = m_meshes[addSubmesh(clusters.m_indices.data(), count, shader, textures)].m_lods.front();
+    lod.m_clusters = clusters.m_clusters;
+    lod.m_clusterCuller = ClusterCuller(clusters.m_clusters);
+    return static_cast<unsigned int>(m_meshes.size() - 1);
+}
+
+void Mesh::addClusteredLod(unsigned int submesh, const ClusteredMesh& clusters, float error) {
+    Submesh& mesh = m_meshes[submesh];
+    if (mesh.m_lods.front().m_primitive == GL_TRIANGLE_STRIP) {
+        // the clusters are index ranges of a triangle list
+        std::cerr << "Submesh " << submesh << " is drawn with triangle strips and can't have clusters\n";
+        return;
+    }
+    unsigned int count = static_cast<unsigned int>(clusters.m_indices.size());
+    mesh.m_lods.push_back(addIndices(clusters.m_indices.data(), count, false));
+    mesh.m_lods.back().m_clusters = clusters.m_clusters;
+    mesh.m_lods.back().m_clusterCuller = ClusterCuller(clusters.m_clusters);
+    mesh.m_lodErrors.push_back(error);
 }
 
-void Mesh::addSubmesh(const void* ibData, unsigned int count, const ShaderProgram* shader) {
-    // create and bind vertex array
-    unsigned int vertexArrayID;
-    glGenVertexArrays(1, &vertexArrayID);
-    glBindVertexArray(vertexArrayID);
+Mesh::SubmeshLod Mesh::addIndices(const unsigned int* indexPtr, unsigned int count, bool triangleStrips) {
+    std::vector<unsigned int> indices(indexPtr, indexPtr + count);
+    unsigned int maxIndex = indices.empty() ? 0 : *std::max_element(indices.begin(), indices.end());
 
-    // bind and set up vertex buffer
-    setVertexBuffer();
+    // strips are separated by the largest value of the index type, so that value can't be a vertex
+    unsigned int primitive = GL_TRIANGLES;
+    if (triangleStrips) {
+        indices = convertToStrips(indexPtr, count, 0xFFFFFFFF);
+        primitive = GL_TRIANGLE_STRIP;
+    }
 
-    // create and bind index buffer
-    unsigned int indexBufferID = setIndexBuffer(ibData, count);
+    // smaller indices take up less memory and bandwidth
+    unsigned int indexType = GL_UNSIGNED_INT;
+    std::vector<unsigned char> indexData;
+    if (maxIndex < 0xFF) {
+        indexType = GL_UNSIGNED_BYTE;
+        indexData = narrowIndices<unsigned char>(indices);
+    } else if (maxIndex < 0xFFFF) {
+        indexType = GL_UNSIGNED_SHORT;
+        indexData = narrowIndices<unsigned short>(indices);
+    } else {
+        indexData = narrowIndices<unsigned int>(indices);
+    }
 
-    // unbind everything (vertex array first)
-    glBindVertexArray(0);
-    glBindBuffer(GL_ARRAY_BUFFER, 0);
-    glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, 0);
-    
-    m_meshes.emplace_back(vertexArrayID, indexBufferID, count, shader);
+    SubmeshLod lod;
+    lod.m_indexHandle = m_arena->addIndices(indexData.data(), static_cast<unsigned int>(indexData.size()));
+    lod.m_indexBufferCount = static_cast<unsigned int>(indices.size());
+    lod.m_indexType = indexType;
+    lod.m_primitive = primitive;
+    return lod;
 }
 
-void Mesh::render() const {
-    for (const Submesh& mesh : m_meshes) {
-        glBindVertexArray(mesh.m_vertexArrayID);
-        mesh.m_shader->bind();
-        glDrawElements(GL_TRIANGLES, mesh.m_indexBufferCount, GL_UNSIGNED_INT, nullptr);
+unsigned int Mesh::addInstancedSubmesh(const void* ibData, unsigned int count, const ShaderProgram* shader,
+    unsigned int maxInstances, const std::vector<const Texture*>& textures) {
+    Submesh& mesh = m_meshes[addSubmesh(ibData, count, shader, textures)];
+
+    // the per-instance attributes need a vertex array of their own, which
+    // reads the vertices and indices from the arena's buffers
+    glGenVertexArrays(1, &mesh.m_vertexArrayID);
+    GLState::bindVertexArray(mesh.m_vertexArrayID);
+    m_arena->setupVertexArray();
+    mesh.m_instanceBufferID = setInstanceBuffer(maxInstances);
+    mesh.m_instanceCapacity = maxInstances;
+    GLState::bindVertexArray(0);
+    GLState::bindBuffer(GL_ARRAY_BUFFER, 0);
+
+    return static_cast<unsigned int>(m_meshes.size() - 1);
+}
+
+void Mesh::setInstances(unsigned int submesh, const InstanceData* instances, unsigned int count) {
+    Submesh& mesh = m_meshes[submesh];
+    if (!mesh.m_instanceBufferID) {
+        std::cerr << "Submesh " << submesh << " is not instanced\n";
+        return;
+    }
+    GLState::bindBuffer(GL_ARRAY_BUFFER, mesh.m_instanceBufferID);
+    if (count > mesh.m_instanceCapacity) {
+        // the vertex array refers to the buffer by name, so its storage can be replaced
+        glBufferData(GL_ARRAY_BUFFER, count * sizeof(InstanceData), instances, GL_DYNAMIC_DRAW);
+        mesh.m_instanceCapacity = count;
+    } else {
+        // orphan the old storage so we don't wait for draws that still read from it
+        glBufferData(GL_ARRAY_BUFFER, mesh.m_instanceCapacity * sizeof(InstanceData), nullptr, GL_DYNAMIC_DRAW);
+        glBufferSubData(GL_ARRAY_BUFFER, 0, count * sizeof(InstanceData), instances);
+    }
+    mesh.m_instanceCount = count;
+}
+
+const Bounds& Mesh::getBounds() const {
+    return m_bounds;
+}
+
+const Mesh::SubmeshLod& Mesh::selectLod(const Submesh& mesh, const glm::mat4& model,
+    const LodSelector* lodSelector) const {
+    if (!lodSelector) {
+        return mesh.m_lods.front();
     }
+    unsigned int count = static_cast<unsigned int>(mesh.m_lodErrors.size());
+    return mesh.m_lods[lodSelector->select(mesh.m_lodErrors.data(), count, model)];
 }
 
-void Mesh::setVertexBuffer() const {
-    // bind vertex buffer
-    glBindBuffer(GL_ARRAY_BUFFER, m_vbID);
+const std::vector<GeometryRange>& Mesh::getDrawRanges(const SubmeshLod& lod, const glm::mat4& model,
+    const CullingView* view) const {
+    m_drawRanges.clear();
+    if (!view || lod.m_clusters.empty()) {
+        m_drawRanges.push_back({ 0, lod.m_indexBufferCount });
+        return m_drawRanges;
+    }
+
+    // cull in object space, then merge neighboring visible clusters into one range
+    Frustum frustum = transformFrustum(view->m_frustum, model);
+    glm::vec3 cameraPosition = glm::vec3(glm::inverse(model) * glm::vec4(view->m_cameraPosition, 1.0f));
+    m_visibleClusters.clear();
+    lod.m_clusterCuller.cull(frustum, cameraPosition, m_visibleClusters);
+    for (unsigned int index : m_visibleClusters) {
+        const Cluster& cluster = lod.m_clusters[index];
+        GeometryRange* last = m_drawRanges.empty() ? nullptr : &m_drawRanges.back();
+        if (last && last->m_first + last->m_count == cluster.m_firstIndex) {
+            last->m_count += cluster.m_indexCount;
+        } else {
+            m_drawRanges.push_back({ cluster.m_firstIndex, cluster.m_indexCount });
+        }
+    }
+    return m_drawRanges;
+}
 
-    // pass in vertex data to OpenGL
-    glBufferData(GL_ARRAY_BUFFER, m_vbSize, m_vbData, GL_STATIC_DRAW);
+void Mesh::render(RenderQueue& queue, const glm::mat4& model, const LodSelector* lodSelector,
+    const CullingView* view, unsigned int conditionQuery) const {
+    // the draws are only recorded here, the queue sorts and submits them later
+    bool visible = !view || intersectsFrustum(view->m_frustum, transformBounds(m_bounds, model));
+    for (const Submesh& mesh : m_meshes) {
+        const SubmeshLod& lod = selectLod(mesh, model, lodSelector);
+        if (mesh.m_instanceBufferID ? mesh.m_instanceCount == 0 : !visible) {
+            continue;
+        }
+        DrawPacket packet;
+        packet.m_vertexArrayID = mesh.m_vertexArrayID;
+        packet.m_indexType = lod.m_indexType;
+        packet.m_primitive = lod.m_primitive;
+        packet.m_baseVertex = static_cast<int>(m_arena->getVertexRange(m_vertexHandle).m_first);
+        packet.m_shader = mesh.m_shader;
+        packet.m_textures = &mesh.m_textures;
+        packet.m_model = model;
+        packet.m_depth = 0.0f;
+        packet.m_translucent = false;
+        packet.m_instanceCount = mesh.m_instanceBufferID ? mesh.m_instanceCount : 0;
+        packet.m_conditionQuery = conditionQuery;
+        unsigned long long lodOffset = m_arena->getIndexOffset(lod.m_indexHandle);
+        for (const GeometryRange& range : getDrawRanges(lod, model, mesh.m_instanceBufferID ? nullptr : view)) {
+            packet.m_indexCount = range.m_count;
+            packet.m_indexOffset = lodOffset + range.m_first * getIndexSize(lod.m_indexType);
+            queue.submit(packet);
+        }
+    }
+}
 
-    // calculate the number of bytes of each vertex
-    // std::accumulate sums up the values in the vertex buffer layout
-    int stride = std::accumulate(m_vbLayout.begin(), m_vbLayout.end(), 0) * sizeof(float);
+void Mesh::render(DrawBatch& batch, const glm::mat4& model, unsigned int material,
+    const LodSelector* lodSelector, const CullingView* view, unsigned int conditionQuery) const {
+    if (view && !intersectsFrustum(view->m_frustum, transformBounds(m_bounds, model))) {
+        return;
+    }
 
-    // tell openGL the layout of our vertex data.
-    unsigned long long offset = 0;
-    for (unsigned int i = 0; i < m_vbLayout.size(); ++i) {
-        // offset is the number of bytes from the start of the data, but OpenGL
-        // reads this information in as a const void pointer
-        const void* offsetPtr = reinterpret_cast<const void*>(offset);
-        glEnableVertexAttribArray(i);
-        glVertexAttribPointer(i, m_vbLayout[i], GL_FLOAT, false, stride, offsetPtr);
-        offset += m_vbLayout[i] * sizeof(float);
+    // the submesh shaders must read the model matrix from the batch's draw data
+    for (const Submesh& mesh : m_meshes) {
+        const SubmeshLod& lod = selectLod(mesh, model, lodSelector);
+        unsigned int lodFirstIndex = static_cast<unsigned int>(m_arena->getIndexOffset(lod.m_indexHandle)
+            / getIndexSize(lod.m_indexType));
+        DrawElementsIndirectCommand command;
+        command.m_instanceCount = 1;
+        command.m_baseVertex = static_cast<int>(m_arena->getVertexRange(m_vertexHandle).m_first);
+        command.m_baseInstance = 0;
+        for (const GeometryRange& range : getDrawRanges(lod, model, view)) {
+            command.m_count = range.m_count;
+            command.m_firstIndex = lodFirstIndex + range.m_first;
+            batch.add(mesh.m_vertexArrayID, mesh.m_shader, lod.m_primitive, lod.m_indexType, command, model, material,
+                conditionQuery);
+        }
     }
 }
 
-unsigned int Mesh::setIndexBuffer(const void* data, unsigned int count) const {
-    unsigned int indexBufferID;
-    glGenBuffers(1, &indexBufferID);
-    glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, indexBufferID);
-    glBufferData(GL_ELEMENT_ARRAY_BUFFER, count * sizeof(unsigned int), data, GL_STATIC_DRAW);
-    return indexBufferID;
+unsigned int Mesh::setInstanceBuffer(unsigned int maxInstances) const {
+    unsigned int instanceBufferID;
+    glGenBuffers(1, &instanceBufferID);
+    GLState::bindBuffer(GL_ARRAY_BUFFER, instanceBufferID);
+    glBufferData(GL_ARRAY_BUFFER, maxInstances * sizeof(InstanceData), nullptr, GL_DYNAMIC_DRAW);
+
+    // a mat4 attribute is passed in as 4 vec4 columns. The divisor makes
+    // OpenGL advance these attributes once per instance instead of per vertex
+    const int stride = sizeof(InstanceData);
+    for (unsigned int column = 0; column < 4; ++column) {
+        unsigned int location = INSTANCE_ATTRIBUTE_LOCATION + column;
+        const void* offsetPtr = reinterpret_cast<const void*>(column * sizeof(glm::vec4));
+        glEnableVertexAttribArray(location);
+        glVertexAttribPointer(location, 4, GL_FLOAT, false, stride, offsetPtr);
+        glVertexAttribDivisor(location, 1);
+    }
+    unsigned int colorLocation = INSTANCE_ATTRIBUTE_LOCATION + 4;
+    const void* colorOffsetPtr = reinterpret_cast<const void*>(sizeof(glm::mat4));
+    glEnableVertexAttribArray(colorLocation);
+    glVertexAttribPointer(colorLocation, 4, GL_FLOAT, false, stride, colorOffsetPtr);
+    glVertexAttribDivisor(colorLocation, 1);
+
+    return instanceBufferID;
 }
\ No newline at end of file
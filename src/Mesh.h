@@ -2,35 +2,101 @@
 #define MESH_H_INCLUDED
 
 #include "ShaderProgram.h"
+#include "Texture.h"
+#include "RenderQueue.h"
+#include "DrawBatch.h"
+#include "GeometryArena.h"
+#include "VertexLayout.h"
+#include "MeshSimplifier.h"
+#include "LodSelector.h"
+#include "MeshClusters.h"
+#include "ClusterCuller.h"
+#include "Frustum.h"
+#include "Bounds.h"
+
+#include <glm/glm.hpp>
 
 #include <vector>
 
+// per-instance attributes of instanced submeshes. They are read by the vertex
+// shader starting at INSTANCE_ATTRIBUTE_LOCATION (the model matrix takes up 4 locations)
+struct InstanceData {
+	glm::mat4 m_model;
+	glm::vec4 m_color;
+};
+
+const unsigned int INSTANCE_ATTRIBUTE_LOCATION = 8;
+
 class Mesh {
 
-	struct Submesh {
-		unsigned int m_vertexArrayID;
-		unsigned int m_indexBufferID;
+	// one level of detail of a submesh, all levels index the same vertices
+	struct SubmeshLod {
+		unsigned int m_indexHandle;       // the level's indices in the arena
 		unsigned int m_indexBufferCount;
+		unsigned int m_indexType;         // the smallest of GL_UNSIGNED_BYTE/SHORT/INT that fits
+		unsigned int m_primitive;         // GL_TRIANGLES, or GL_TRIANGLE_STRIP with primitive restart
+		std::vector<Cluster> m_clusters;  // index ranges of the level, empty if not clustered
+		ClusterCuller m_clusterCuller;
+	};
+
+	struct Submesh {
+		unsigned int m_vertexArrayID;     // the arena's vertex array, or its own if instanced
+		std::vector<SubmeshLod> m_lods;   // the full detail level first
+		std::vector<float> m_lodErrors;   // the object space error of each level, 0 for the first
 		const ShaderProgram* m_shader;
-		Submesh(unsigned int vao, unsigned int ibo, unsigned int count, const ShaderProgram* shader);
+		std::vector<const Texture*> m_textures;
+		unsigned int m_instanceBufferID;  // 0 if the submesh is not instanced
+		unsigned int m_instanceCount;
+		unsigned int m_instanceCapacity;
+		Submesh(unsigned int vao, const SubmeshLod& lod, const ShaderProgram* shader,
+			const std::vector<const Texture*>& textures);
 	};
 
-	unsigned int m_vbID;
-	const void* m_vbData;
-	unsigned int m_vbSize;
-	std::vector<unsigned int> m_vbLayout;
+	// the vertex data is uploaded into the arena for this layout and not kept on the CPU
+	GeometryArena* m_arena;
+	unsigned int m_vertexHandle;
+	Bounds m_bounds;                  // of all vertices, in object space
 	std::vector<Submesh> m_meshes;
 
+	// reused every frame by getDrawRanges
+	mutable std::vector<unsigned int> m_visibleClusters;
+	mutable std::vector<GeometryRange> m_drawRanges;
+
 public:
-	Mesh(const void* data, unsigned int size, const std::vector<unsigned int>& layout);
+	Mesh(const void* data, unsigned int size, const VertexLayout& layout);
 	~Mesh();
 
-	void addSubmesh(const void* ibData, unsigned int count, const ShaderProgram* shader);
-	void render() const;
+	// ibData is an array of unsigned ints, it is stored with the smallest index type that fits
+	unsigned int addSubmesh(const void* ibData, unsigned int count, const ShaderProgram* shader,
+		const std::vector<const Texture*>& textures = {}, bool triangleStrips = false);
+	// the clusters are culled one by one when the level is drawn with a view
+	unsigned int addClusteredSubmesh(const ClusteredMesh& clusters, const ShaderProgram* shader,
+		const std::vector<const Texture*>& textures = {});
+	unsigned int addInstancedSubmesh(const void* ibData, unsigned int count, const ShaderProgram* shader,
+		unsigned int maxInstances, const std::vector<const Texture*>& textures = {});
+	// adds less detailed levels (see buildLodChain) after the ones the submesh already has
+	void addLods(unsigned int submesh, const std::vector<LodLevel>& lods);
+	// adds a less detailed level split into clusters (see buildClusters) with the error of its LodLevel
+	void addClusteredLod(unsigned int submesh, const ClusteredMesh& clusters, float error);
+	void setInstances(unsigned int submesh, const InstanceData* instances, unsigned int count);
+	const Bounds& getBounds() const;
+
+	// Without a selector every submesh is drawn with full detail. With a view, the mesh is
+	// frustum culled by its bounds and clustered levels cluster by cluster (instanced
+	// submeshes are never culled, their instances can be anywhere). With a condition query
+	// (see OcclusionQueries) the GPU skips the draws if the query found the mesh occluded
+	void render(RenderQueue& queue, const glm::mat4& model, const LodSelector* lodSelector = nullptr,
+		const CullingView* view = nullptr, unsigned int conditionQuery = 0) const;
+	void render(DrawBatch& batch, const glm::mat4& model, unsigned int material,
+		const LodSelector* lodSelector = nullptr, const CullingView* view = nullptr,
+		unsigned int conditionQuery = 0) const;
 
 private:
-	void setVertexBuffer() const;
-	unsigned int setIndexBuffer(const void* data, unsigned int count) const;
+	SubmeshLod addIndices(const unsigned int* indices, unsigned int count, bool triangleStrips);
+	const SubmeshLod& selectLod(const Submesh& mesh, const glm::mat4& model, const LodSelector* lodSelector) const;
+	const std::vector<GeometryRange>& getDrawRanges(const SubmeshLod& lod, const glm::mat4& model,
+		const CullingView* view) const;
+	unsigned int setInstanceBuffer(unsigned int maxInstances) const;
 };
 
 #endif
\ No newline at end of file
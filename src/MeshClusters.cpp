@@ -0,0 +1,255 @@
+#include "MeshClusters.h"
+
+#include <glm/glm.hpp>
+
+#include <algorithm>
+#include <cmath>
+#include <fstream>
+#include <iostream>
+#include <string>
+#include <vector>
+
+const char CLUSTER_FILE_MAGIC[4] = { 'C', 'L', 'S', 'T' };
+const unsigned int CLUSTER_FILE_VERSION = 1;
+
+// normal cones wider than this (the smallest dot product of a normal with the axis)
+// are backfacing from too few places to be worth testing
+const float MIN_CONE_DOT = 0.1f;
+
+// clusters are written to the file as they are in memory
+static_assert(sizeof(Cluster) == 2 * sizeof(unsigned int) + 8 * sizeof(float), "Cluster must not have padding");
+
+static glm::vec3 getPosition(const float* positions, unsigned int stride, unsigned int vertex) {
+    const float* position = reinterpret_cast<const float*>(reinterpret_cast<const char*>(positions) + vertex * stride);
+    return glm::vec3(position[0], position[1], position[2]);
+}
+
+// Ritter's bounding sphere: start with the two points farthest apart along an
+// axis, then grow the sphere to include every point outside of it
+static void computeBoundingSphere(const std::vector<glm::vec3>& points, glm::vec3& center, float& radius) {
+    glm::vec3 minPoints[3] = { points[0], points[0], points[0] };
+    glm::vec3 maxPoints[3] = { points[0], points[0], points[0] };
+    for (const glm::vec3& point : points) {
+        for (int axis = 0; axis < 3; ++axis) {
+            if (point[axis] < minPoints[axis][axis]) {
+                minPoints[axis] = point;
+            }
+            if (point[axis] > maxPoints[axis][axis]) {
+                maxPoints[axis] = point;
+            }
+        }
+    }
+    int widest = 0;
+    for (int axis = 1; axis < 3; ++axis) {
+        if (glm::distance(minPoints[axis], maxPoints[axis]) > glm::distance(minPoints[widest], maxPoints[widest])) {
+            widest = axis;
+        }
+    }
+    center = (minPoints[widest] + maxPoints[widest]) * 0.5f;
+    radius = glm::distance(minPoints[widest], maxPoints[widest]) * 0.5f;
+    for (const glm::vec3& point : points) {
+        float distance = glm::distance(point, center);
+        if (distance > radius) {
+            float newRadius = (radius + distance) * 0.5f;
+            center += (point - center) * ((newRadius - radius) / distance);
+            radius = newRadius;
+        }
+    }
+}
+
+static Cluster computeClusterBounds(const unsigned int* indices, unsigned int first, unsigned int count,
+    const float* positions, unsigned int stride) {
+    Cluster cluster;
+    cluster.m_firstIndex = first;
+    cluster.m_indexCount = count;
+
+    std::vector<glm::vec3> points;
+    std::vector<glm::vec3> normals;
+    glm::vec3 axis(0.0f);
+    for (unsigned int i = first; i < first + count; i += 3) {
+        glm::vec3 a = getPosition(positions, stride, indices[i]);
+        glm::vec3 b = getPosition(positions, stride, indices[i + 1]);
+        glm::vec3 c = getPosition(positions, stride, indices[i + 2]);
+        points.insert(points.end(), { a, b, c });
+        glm::vec3 normal = glm::cross(b - a, c - a);
+        float length = glm::length(normal);
+        if (length > 0.0f) {
+            normals.push_back(normal / length);
+            axis += normals.back();
+        }
+    }
+    computeBoundingSphere(points, cluster.m_center, cluster.m_radius);
+
+    // the cone around the average normal that contains every normal
+    float axisLength = glm::length(axis);
+    cluster.m_coneAxis = axisLength > 0.0f ? axis / axisLength : glm::vec3(0.0f, 0.0f, 1.0f);
+    float minDot = axisLength > 0.0f ? 1.0f : -1.0f;
+    for (const glm::vec3& normal : normals) {
+        minDot = std::min(minDot, glm::dot(normal, cluster.m_coneAxis));
+    }
+    cluster.m_coneCutoff = minDot < MIN_CONE_DOT ? 1.0f : std::sqrt(1.0f - minDot * minDot);
+    return cluster;
+}
+
+ClusteredMesh buildClusters(const unsigned int* indices, unsigned int count, const float* positions,
+    unsigned int vertexCount, unsigned int positionStride) {
+    const unsigned int numTriangles = count / 3;
+
+    // the triangles of every vertex, packed into one array
+    std::vector<unsigned int> firstTriangle(vertexCount + 1, 0);
+    for (unsigned int i = 0; i < numTriangles * 3; ++i) {
+        ++firstTriangle[indices[i] + 1];
+    }
+    for (unsigned int v = 0; v < vertexCount; ++v) {
+        firstTriangle[v + 1] += firstTriangle[v];
+    }
+    std::vector<unsigned int> adjacency(numTriangles * 3);
+    std::vector<unsigned int> filled(firstTriangle.begin(), firstTriangle.end() - 1);
+    for (unsigned int i = 0; i < numTriangles * 3; ++i) {
+        adjacency[filled[indices[i]]++] = i / 3;
+    }
+
+    ClusteredMesh result;
+    result.m_indices.reserve(numTriangles * 3);
+    result.m_sourceHash = hashClusterSource(indices, count, positions, vertexCount, positionStride);
+
+    // vertexCluster[v] == clusterID marks the vertices of the cluster being built
+    std::vector<unsigned int> vertexCluster(vertexCount, 0xFFFFFFFF);
+    std::vector<bool> used(numTriangles, false);
+    std::vector<unsigned int> clusterVertices;
+    unsigned int cursor = 0;
+    unsigned int clusterID = 0;
+    auto countNewVertices = [&](unsigned int t) {
+        unsigned int newVertices = 0;
+        for (unsigned int e = 0; e < 3; ++e) {
+            newVertices += vertexCluster[indices[t * 3 + e]] != clusterID ? 1 : 0;
+        }
+        return newVertices;
+    };
+    auto addTriangle = [&](unsigned int t) {
+        used[t] = true;
+        for (unsigned int e = 0; e < 3; ++e) {
+            unsigned int v = indices[t * 3 + e];
+            result.m_indices.push_back(v);
+            if (vertexCluster[v] != clusterID) {
+                vertexCluster[v] = clusterID;
+                clusterVertices.push_back(v);
+            }
+        }
+    };
+
+    while (cursor < numTriangles) {
+        if (used[cursor]) {
+            ++cursor;
+            continue;
+        }
+        unsigned int first = static_cast<unsigned int>(result.m_indices.size());
+        clusterVertices.clear();
+        addTriangle(cursor);
+        unsigned int clusterTriangles = 1;
+
+        // grow with the neighboring triangle that adds the fewest new vertices
+        while (clusterTriangles < MAX_CLUSTER_TRIANGLES) {
+            unsigned int best = 0xFFFFFFFF;
+            unsigned int bestNewVertices = 3;
+            for (unsigned int v : clusterVertices) {
+                for (unsigned int k = firstTriangle[v]; k < firstTriangle[v + 1] && bestNewVertices > 0; ++k) {
+                    unsigned int t = adjacency[k];
+                    if (used[t]) {
+                        continue;
+                    }
+                    unsigned int newVertices = countNewVertices(t);
+                    if (newVertices < bestNewVertices || best == 0xFFFFFFFF) {
+                        best = t;
+                        bestNewVertices = newVertices;
+                    }
+                }
+            }
+            if (best == 0xFFFFFFFF || clusterVertices.size() + bestNewVertices > MAX_CLUSTER_VERTICES) {
+                break;
+            }
+            addTriangle(best);
+            ++clusterTriangles;
+        }
+
+        unsigned int clusterCount = static_cast<unsigned int>(result.m_indices.size()) - first;
+        result.m_clusters.push_back(computeClusterBounds(result.m_indices.data(), first, clusterCount,
+            positions, positionStride));
+        ++clusterID;
+    }
+    return result;
+}
+
+unsigned int hashClusterSource(const unsigned int* indices, unsigned int count, const float* positions,
+    unsigned int vertexCount, unsigned int positionStride) {
+    // FNV-1a over the indices and the positions
+    unsigned int hash = 2166136261u;
+    auto addBytes = [&hash](const void* data, unsigned int size) {
+        const unsigned char* bytes = static_cast<const unsigned char*>(data);
+        for (unsigned int i = 0; i < size; ++i) {
+            hash = (hash ^ bytes[i]) * 16777619u;
+        }
+    };
+    addBytes(indices, count * sizeof(unsigned int));
+    for (unsigned int v = 0; v < vertexCount; ++v) {
+        addBytes(reinterpret_cast<const char*>(positions) + v * positionStride, 3 * sizeof(float));
+    }
+    return hash;
+}
+
+bool saveClusters(const std::string& filePath, const ClusteredMesh& clusters) {
+    std::ofstream file(filePath, std::ios::binary);
+    if (!file) {
+        std::cerr << "Failed to write clusters to " << filePath << "\n";
+        return false;
+    }
+    unsigned int header[4] = { CLUSTER_FILE_VERSION, clusters.m_sourceHash,
+        static_cast<unsigned int>(clusters.m_indices.size()), static_cast<unsigned int>(clusters.m_clusters.size()) };
+    file.write(CLUSTER_FILE_MAGIC, sizeof(CLUSTER_FILE_MAGIC));
+    file.write(reinterpret_cast<const char*>(header), sizeof(header));
+    file.write(reinterpret_cast<const char*>(clusters.m_indices.data()),
+        clusters.m_indices.size() * sizeof(unsigned int));
+    file.write(reinterpret_cast<const char*>(clusters.m_clusters.data()),
+        clusters.m_clusters.size() * sizeof(Cluster));
+    return static_cast<bool>(file);
+}
+
+bool loadClusters(const std::string& filePath, unsigned int sourceHash, ClusteredMesh& clusters) {
+    std::ifstream file(filePath, std::ios::binary);
+    if (!file) {
+        return false;
+    }
+    char magic[4];
+    unsigned int header[4];
+    file.read(magic, sizeof(magic));
+    file.read(reinterpret_cast<char*>(header), sizeof(header));
+    if (!file || !std::equal(magic, magic + 4, CLUSTER_FILE_MAGIC) || header[0] != CLUSTER_FILE_VERSION) {
+        std::cerr << filePath << " is not a cluster file of version " << CLUSTER_FILE_VERSION << "\n";
+        return false;
+    }
+    if (header[1] != sourceHash) {
+        std::cerr << filePath << " was built from different mesh data\n";
+        return false;
+    }
+    clusters.m_sourceHash = header[1];
+    clusters.m_indices.resize(header[2]);
+    clusters.m_clusters.resize(header[3]);
+    file.read(reinterpret_cast<char*>(clusters.m_indices.data()), clusters.m_indices.size() * sizeof(unsigned int));
+    file.read(reinterpret_cast<char*>(clusters.m_clusters.data()), clusters.m_clusters.size() * sizeof(Cluster));
+    if (!file) {
+        std::cerr << filePath << " is truncated\n";
+        return false;
+    }
+    return true;
+}
+
+ClusteredMesh loadOrBuildClusters(const std::string& filePath, const unsigned int* indices, unsigned int count,
+    const float* positions, unsigned int vertexCount, unsigned int positionStride) {
+    ClusteredMesh clusters;
+    unsigned int sourceHash = hashClusterSource(indices, count, positions, vertexCount, positionStride);
+    if (!loadClusters(filePath, sourceHash, clusters)) {
+        clusters = buildClusters(indices, count, positions, vertexCount, positionStride);
+        saveClusters(filePath, clusters);
+    }
+    return clusters;
+}
@@ -0,0 +1,50 @@
+#ifndef MESH_CLUSTERS_H_INCLUDED
+#define MESH_CLUSTERS_H_INCLUDED
+
+#include <glm/glm.hpp>
+
+#include <string>
+#include <vector>
+
+// limits of one cluster, small enough to cull big meshes piece by piece
+const unsigned int MAX_CLUSTER_VERTICES = 64;
+const unsigned int MAX_CLUSTER_TRIANGLES = 124;
+
+// A group of neighboring triangles of a mesh. All clusters of a mesh are stored one
+// after another in one index list, so a run of visible clusters is one index range.
+struct Cluster {
+	unsigned int m_firstIndex;
+	unsigned int m_indexCount;
+	glm::vec3 m_center;         // bounding sphere of the vertices
+	float m_radius;
+	glm::vec3 m_coneAxis;       // average direction of the triangle normals
+	float m_coneCutoff;         // sine of the normal cone's half angle, 1 if it can't be backface culled
+};
+
+struct ClusteredMesh {
+	std::vector<unsigned int> m_indices;
+	std::vector<Cluster> m_clusters;
+	unsigned int m_sourceHash;  // hash of the indices and positions the clusters were built from
+};
+
+// Splits an indexed triangle list into clusters of up to MAX_CLUSTER_VERTICES vertices
+// and MAX_CLUSTER_TRIANGLES triangles. Clusters grow over shared vertices so they stay
+// compact, which keeps their bounds and normal cones tight. Works best on the output of
+// optimizeVertexCache. positionStride is in bytes.
+ClusteredMesh buildClusters(const unsigned int* indices, unsigned int count, const float* positions,
+	unsigned int vertexCount, unsigned int positionStride);
+
+// Binary files with the clusters of a mesh, so they don't have to be built at every start.
+// loadClusters fails (and prints why) if the file was built from different source data.
+bool saveClusters(const std::string& filePath, const ClusteredMesh& clusters);
+bool loadClusters(const std::string& filePath, unsigned int sourceHash, ClusteredMesh& clusters);
+
+// loads the clusters from filePath if they are up to date, builds and saves them otherwise
+ClusteredMesh loadOrBuildClusters(const std::string& filePath, const unsigned int* indices, unsigned int count,
+	const float* positions, unsigned int vertexCount, unsigned int positionStride);
+
+// the hash stored with the clusters to detect changed source data
+unsigned int hashClusterSource(const unsigned int* indices, unsigned int count, const float* positions,
+	unsigned int vertexCount, unsigned int positionStride);
+
+#endif
@@ -0,0 +1,410 @@
+#include "MeshOptimizer.h"
+
+#include <glm/glm.hpp>
+
+#include <algorithm>
+#include <cmath>
+#include <cstring>
+#include <limits>
+#include <vector>
+
+const unsigned int INVALID_INDEX = 0xFFFFFFFF;
+
+// Forsyth's scoring: vertices near the front of the (larger, modelled) cache and
+// vertices with few triangles left are preferred. The last triangle's vertices
+// get a lower score so the strip-like order does not reuse them immediately
+const int FORSYTH_CACHE_SIZE = 32;
+const float CACHE_DECAY_POWER = 1.5f;
+const float LAST_TRIANGLE_SCORE = 0.75f;
+const float VALENCE_BOOST_SCALE = 2.0f;
+const float VALENCE_BOOST_POWER = 0.5f;
+
+// used by optimizeMesh
+const float OVERDRAW_THRESHOLD = 1.05f;
+// how often optimizeOverdraw makes its clusters larger before it keeps the cache order
+const unsigned int OVERDRAW_ATTEMPTS = 8;
+
+// the resolution of each of the six views that overdraw is measured from
+const int OVERDRAW_GRID_SIZE = 256;
+
+const unsigned int CACHE_LINE_SIZE = 64;
+const unsigned int FETCH_CACHE_LINES = 32;
+
+static float getVertexScore(int cachePosition, unsigned int remainingTriangles) {
+    if (remainingTriangles == 0) {
+        return -1.0f;
+    }
+    float score = 0.0f;
+    if (cachePosition >= 0 && cachePosition < 3) {
+        score = LAST_TRIANGLE_SCORE;
+    } else if (cachePosition >= 3) {
+        float scale = 1.0f - static_cast<float>(cachePosition - 3) / (FORSYTH_CACHE_SIZE - 3);
+        score = std::pow(scale, CACHE_DECAY_POWER);
+    }
+    return score + VALENCE_BOOST_SCALE * std::pow(static_cast<float>(remainingTriangles), -VALENCE_BOOST_POWER);
+}
+
+static glm::vec3 getPosition(const float* positions, unsigned int stride, unsigned int vertex) {
+    const float* position = reinterpret_cast<const float*>(reinterpret_cast<const char*>(positions) + vertex * stride);
+    return glm::vec3(position[0], position[1], position[2]);
+}
+
+std::vector<unsigned int> optimizeVertexCache(const unsigned int* indices, unsigned int count,
+    unsigned int vertexCount) {
+    const unsigned int numTriangles = count / 3;
+
+    // the not yet emitted triangles of every vertex, packed into one array
+    std::vector<unsigned int> remaining(vertexCount, 0);
+    for (unsigned int i = 0; i < numTriangles * 3; ++i) {
+        ++remaining[indices[i]];
+    }
+    std::vector<unsigned int> firstTriangle(vertexCount + 1, 0);
+    for (unsigned int v = 0; v < vertexCount; ++v) {
+        firstTriangle[v + 1] = firstTriangle[v] + remaining[v];
+    }
+    std::vector<unsigned int> adjacency(numTriangles * 3);
+    std::vector<unsigned int> filled(firstTriangle.begin(), firstTriangle.end() - 1);
+    for (unsigned int i = 0; i < numTriangles * 3; ++i) {
+        adjacency[filled[indices[i]]++] = i / 3;
+    }
+
+    std::vector<float> vertexScores(vertexCount);
+    for (unsigned int v = 0; v < vertexCount; ++v) {
+        vertexScores[v] = getVertexScore(-1, remaining[v]);
+    }
+    auto getTriangleScore = [&](unsigned int t) {
+        const unsigned int* tri = indices + t * 3;
+        return vertexScores[tri[0]] + vertexScores[tri[1]] + vertexScores[tri[2]];
+    };
+
+    std::vector<bool> emitted(numTriangles, false);
+    std::vector<unsigned int> cache;
+    std::vector<unsigned int> newCache;
+    std::vector<unsigned int> result;
+    result.reserve(numTriangles * 3);
+    unsigned int best = INVALID_INDEX;
+    unsigned int cursor = 0;
+    while (result.size() < numTriangles * 3) {
+        // nothing in the cache has triangles left, continue with the next unused triangle
+        if (best == INVALID_INDEX) {
+            while (emitted[cursor]) {
+                ++cursor;
+            }
+            best = cursor;
+        }
+        const unsigned int* tri = indices + best * 3;
+        result.insert(result.end(), tri, tri + 3);
+        emitted[best] = true;
+
+        for (unsigned int e = 0; e < 3; ++e) {
+            unsigned int* triangles = adjacency.data() + firstTriangle[tri[e]];
+            unsigned int& left = remaining[tri[e]];
+            for (unsigned int k = 0; k < left; ++k) {
+                if (triangles[k] == best) {
+                    triangles[k] = triangles[left - 1];
+                    --left;
+                    break;
+                }
+            }
+        }
+
+        // the triangle's vertices move to the front of the cache and push the rest back
+        newCache.clear();
+        for (unsigned int e = 0; e < 3; ++e) {
+            if (std::find(newCache.begin(), newCache.end(), tri[e]) == newCache.end()) {
+                newCache.push_back(tri[e]);
+            }
+        }
+        for (unsigned int v : cache) {
+            if (v != tri[0] && v != tri[1] && v != tri[2]) {
+                newCache.push_back(v);
+            }
+        }
+        for (unsigned int i = 0; i < newCache.size(); ++i) {
+            int position = static_cast<int>(i) < FORSYTH_CACHE_SIZE ? static_cast<int>(i) : -1;
+            vertexScores[newCache[i]] = getVertexScore(position, remaining[newCache[i]]);
+        }
+
+        // only the triangles of vertices whose score changed need new scores
+        best = INVALID_INDEX;
+        float bestScore = -1.0f;
+        for (unsigned int v : newCache) {
+            const unsigned int* triangles = adjacency.data() + firstTriangle[v];
+            for (unsigned int k = 0; k < remaining[v]; ++k) {
+                float score = getTriangleScore(triangles[k]);
+                if (score > bestScore) {
+                    bestScore = score;
+                    best = triangles[k];
+                }
+            }
+        }
+
+        if (newCache.size() > static_cast<unsigned int>(FORSYTH_CACHE_SIZE)) {
+            newCache.resize(static_cast<unsigned int>(FORSYTH_CACHE_SIZE));
+        }
+        std::swap(cache, newCache);
+    }
+    return result;
+}
+
+// Sorts clusters of the triangles by how far out they face. Clusters end where the
+// cache order misses every vertex or where their own ACMR is at most splitAcmr.
+static std::vector<unsigned int> sortClusters(const unsigned int* indices, unsigned int count,
+    const float* positions, unsigned int vertexCount, unsigned int positionStride, float splitAcmr) {
+    const unsigned int numTriangles = count / 3;
+
+    // Split the triangles into clusters that each start with a cold cache. A new
+    // cluster starts where the cache order already misses every vertex (a hard
+    // boundary, free to split at) or where the cluster's own ACMR is low enough
+    // (a soft boundary, splitting there costs no more than the threshold allows)
+    std::vector<unsigned int> clusterStarts;
+    std::vector<unsigned int> cacheTime(vertexCount, 0);
+    unsigned int time = VERTEX_CACHE_SIZE + 1;
+    unsigned int clusterMisses = 0;
+    unsigned int clusterStart = 0;
+    for (unsigned int t = 0; t < numTriangles; ++t) {
+        unsigned int misses = 0;
+        for (unsigned int e = 0; e < 3; ++e) {
+            unsigned int v = indices[t * 3 + e];
+            if (time - cacheTime[v] > VERTEX_CACHE_SIZE) {
+                cacheTime[v] = time++;
+                ++misses;
+            }
+        }
+        if (t == clusterStart || (misses == 3 && clusterMisses > 0)) {
+            clusterStarts.push_back(t);
+            clusterStart = t;
+            clusterMisses = 0;
+        }
+        clusterMisses += misses;
+        if (static_cast<float>(clusterMisses) / (t - clusterStart + 1) <= splitAcmr) {
+            // forget the cache, the next cluster may be drawn after any other
+            time += VERTEX_CACHE_SIZE + 1;
+            clusterStart = t + 1;
+            clusterMisses = 0;
+        }
+    }
+    clusterStarts.push_back(numTriangles);
+
+    // clusters facing away from the mesh's center are on the outside and likely to occlude the rest
+    struct Cluster {
+        unsigned int m_first;
+        unsigned int m_end;
+        float m_sortKey;
+    };
+    std::vector<Cluster> clusters;
+    std::vector<glm::vec3> centroids;
+    std::vector<glm::vec3> normals;
+    glm::vec3 meshCentroid(0.0f);
+    float meshArea = 0.0f;
+    for (unsigned int c = 0; c + 1 < clusterStarts.size(); ++c) {
+        glm::vec3 centroid(0.0f);
+        glm::vec3 normal(0.0f);
+        float area = 0.0f;
+        for (unsigned int t = clusterStarts[c]; t < clusterStarts[c + 1]; ++t) {
+            glm::vec3 a = getPosition(positions, positionStride, indices[t * 3]);
+            glm::vec3 b = getPosition(positions, positionStride, indices[t * 3 + 1]);
+            glm::vec3 d = getPosition(positions, positionStride, indices[t * 3 + 2]);
+            glm::vec3 cross = glm::cross(b - a, d - a);
+            float triangleArea = glm::length(cross) * 0.5f;
+            centroid += (a + b + d) / 3.0f * triangleArea;
+            normal += cross;
+            area += triangleArea;
+        }
+        meshCentroid += centroid;
+        meshArea += area;
+        centroids.push_back(area > 0.0f ? centroid / area : centroid);
+        normals.push_back(glm::length(normal) > 0.0f ? glm::normalize(normal) : normal);
+        clusters.push_back({ clusterStarts[c], clusterStarts[c + 1], 0.0f });
+    }
+    if (meshArea > 0.0f) {
+        meshCentroid /= meshArea;
+    }
+    for (unsigned int c = 0; c < clusters.size(); ++c) {
+        clusters[c].m_sortKey = glm::dot(centroids[c] - meshCentroid, normals[c]);
+    }
+    std::stable_sort(clusters.begin(), clusters.end(), [](const Cluster& a, const Cluster& b) {
+        return a.m_sortKey > b.m_sortKey;
+    });
+
+    std::vector<unsigned int> result;
+    result.reserve(numTriangles * 3);
+    for (const Cluster& cluster : clusters) {
+        result.insert(result.end(), indices + cluster.m_first * 3, indices + cluster.m_end * 3);
+    }
+    return result;
+}
+
+std::vector<unsigned int> optimizeOverdraw(const unsigned int* indices, unsigned int count,
+    const float* positions, unsigned int vertexCount, unsigned int positionStride, float threshold) {
+    const float acmr = analyzeVertexCache(indices, count, vertexCount).m_acmr;
+    const float maxAcmr = acmr * threshold;
+    // Every cluster starts with a cold cache once they are sorted, so the whole mesh can
+    // miss the threshold that each cluster meets. Clusters get larger until it doesn't.
+    float splitAcmr = maxAcmr;
+    for (unsigned int attempt = 0; attempt < OVERDRAW_ATTEMPTS; ++attempt) {
+        std::vector<unsigned int> result = sortClusters(indices, count, positions, vertexCount, positionStride,
+            splitAcmr);
+        if (analyzeVertexCache(result.data(), count, vertexCount).m_acmr <= maxAcmr) {
+            return result;
+        }
+        splitAcmr = acmr + (splitAcmr - acmr) * 0.5f;
+    }
+    return std::vector<unsigned int>(indices, indices + count);
+}
+
+unsigned int optimizeVertexFetch(void* vertices, unsigned int vertexCount, unsigned int vertexSize,
+    unsigned int* indices, unsigned int count) {
+    std::vector<unsigned int> remap(vertexCount, INVALID_INDEX);
+    unsigned int nextVertex = 0;
+    for (unsigned int i = 0; i < count; ++i) {
+        unsigned int& index = indices[i];
+        if (remap[index] == INVALID_INDEX) {
+            remap[index] = nextVertex++;
+        }
+        index = remap[index];
+    }
+
+    unsigned char* data = static_cast<unsigned char*>(vertices);
+    std::vector<unsigned char> original(data, data + vertexCount * vertexSize);
+    for (unsigned int v = 0; v < vertexCount; ++v) {
+        if (remap[v] != INVALID_INDEX) {
+            std::memcpy(data + remap[v] * vertexSize, original.data() + v * vertexSize, vertexSize);
+        }
+    }
+    return nextVertex;
+}
+
+unsigned int optimizeMesh(float* vertices, unsigned int vertexCount, unsigned int vertexSize,
+    std::vector<unsigned int>& indices) {
+    const unsigned int count = static_cast<unsigned int>(indices.size());
+    std::vector<unsigned int> cacheOrder = optimizeVertexCache(indices.data(), count, vertexCount);
+    indices = optimizeOverdraw(cacheOrder.data(), count, vertices, vertexCount, vertexSize, OVERDRAW_THRESHOLD);
+    return optimizeVertexFetch(vertices, vertexCount, vertexSize, indices.data(), count);
+}
+
+VertexCacheStatistics analyzeVertexCache(const unsigned int* indices, unsigned int count,
+    unsigned int vertexCount, unsigned int cacheSize) {
+    // a vertex is in the FIFO if fewer than cacheSize misses happened since it was added
+    std::vector<unsigned int> cacheTime(vertexCount, 0);
+    std::vector<bool> used(vertexCount, false);
+    unsigned int time = cacheSize + 1;
+    unsigned int usedVertices = 0;
+    VertexCacheStatistics statistics{ 0, 0.0f, 0.0f };
+    for (unsigned int i = 0; i < count; ++i) {
+        unsigned int v = indices[i];
+        if (time - cacheTime[v] > cacheSize) {
+            cacheTime[v] = time++;
+            ++statistics.m_vertexTransforms;
+        }
+        if (!used[v]) {
+            used[v] = true;
+            ++usedVertices;
+        }
+    }
+    if (count >= 3) {
+        statistics.m_acmr = static_cast<float>(statistics.m_vertexTransforms) / (count / 3);
+        statistics.m_atvr = static_cast<float>(statistics.m_vertexTransforms) / usedVertices;
+    }
+    return statistics;
+}
+
+OverdrawStatistics analyzeOverdraw(const unsigned int* indices, unsigned int count,
+    const float* positions, unsigned int vertexCount, unsigned int positionStride) {
+    OverdrawStatistics statistics{ 0, 0, 0.0f };
+    if (count < 3) {
+        return statistics;
+    }
+
+    // fit the mesh into the views
+    glm::vec3 minimum(std::numeric_limits<float>::max());
+    glm::vec3 maximum(-std::numeric_limits<float>::max());
+    for (unsigned int i = 0; i < count; ++i) {
+        glm::vec3 position = getPosition(positions, positionStride, indices[i]);
+        minimum = glm::min(minimum, position);
+        maximum = glm::max(maximum, position);
+    }
+    glm::vec3 center = (minimum + maximum) * 0.5f;
+    glm::vec3 halfSize = (maximum - minimum) * 0.5f;
+    float scale = std::max(std::max(halfSize.x, halfSize.y), std::max(halfSize.z, 1e-6f));
+
+    std::vector<float> depthBuffer(OVERDRAW_GRID_SIZE * OVERDRAW_GRID_SIZE);
+    std::vector<glm::vec3> projected(vertexCount);
+    for (int axis = 0; axis < 3; ++axis) {
+        for (float flip : { 1.0f, -1.0f }) {
+            // looking down the axis from its positive or negative side, with x and y
+            // from the other two axes. Mirroring two axes at once keeps the winding
+            for (unsigned int i = 0; i < count; ++i) {
+                unsigned int v = indices[i];
+                glm::vec3 p = (getPosition(positions, positionStride, v) - center) / scale;
+                glm::vec3 view(p[(axis + 1) % 3] * flip, p[(axis + 2) % 3], p[axis] * flip);
+                projected[v] = glm::vec3((view.x * 0.5f + 0.5f) * OVERDRAW_GRID_SIZE,
+                    (view.y * 0.5f + 0.5f) * OVERDRAW_GRID_SIZE, view.z);
+            }
+
+            // larger depths are closer to the viewer
+            std::fill(depthBuffer.begin(), depthBuffer.end(), -std::numeric_limits<float>::max());
+            for (unsigned int t = 0; t < count / 3; ++t) {
+                const glm::vec3& a = projected[indices[t * 3]];
+                const glm::vec3& b = projected[indices[t * 3 + 1]];
+                const glm::vec3& c = projected[indices[t * 3 + 2]];
+                float area = (b.x - a.x) * (c.y - a.y) - (b.y - a.y) * (c.x - a.x);
+                if (area <= 0.0f) {
+                    continue;
+                }
+                int minX = std::max(static_cast<int>(std::floor(std::min({ a.x, b.x, c.x }))), 0);
+                int minY = std::max(static_cast<int>(std::floor(std::min({ a.y, b.y, c.y }))), 0);
+                int maxX = std::min(static_cast<int>(std::ceil(std::max({ a.x, b.x, c.x }))), OVERDRAW_GRID_SIZE - 1);
+                int maxY = std::min(static_cast<int>(std::ceil(std::max({ a.y, b.y, c.y }))), OVERDRAW_GRID_SIZE - 1);
+                for (int y = minY; y <= maxY; ++y) {
+                    for (int x = minX; x <= maxX; ++x) {
+                        float px = x + 0.5f;
+                        float py = y + 0.5f;
+                        float wa = (c.x - b.x) * (py - b.y) - (c.y - b.y) * (px - b.x);
+                        float wb = (a.x - c.x) * (py - c.y) - (a.y - c.y) * (px - c.x);
+                        float wc = (b.x - a.x) * (py - a.y) - (b.y - a.y) * (px - a.x);
+                        if (wa < 0.0f || wb < 0.0f || wc < 0.0f) {
+                            continue;
+                        }
+                        float depth = (wa * a.z + wb * b.z + wc * c.z) / area;
+                        float& stored = depthBuffer[y * OVERDRAW_GRID_SIZE + x];
+                        if (depth > stored) {
+                            if (stored == -std::numeric_limits<float>::max()) {
+                                ++statistics.m_pixelsCovered;
+                            }
+                            stored = depth;
+                            ++statistics.m_pixelsShaded;
+                        }
+                    }
+                }
+            }
+        }
+    }
+    if (statistics.m_pixelsCovered > 0) {
+        statistics.m_overdraw = static_cast<float>(statistics.m_pixelsShaded) / statistics.m_pixelsCovered;
+    }
+    return statistics;
+}
+
+VertexFetchStatistics analyzeVertexFetch(const unsigned int* indices, unsigned int count,
+    unsigned int vertexCount, unsigned int vertexSize) {
+    // the same FIFO trick as analyzeVertexCache, per cache line
+    const unsigned int numLines = (vertexCount * vertexSize + CACHE_LINE_SIZE - 1) / CACHE_LINE_SIZE;
+    std::vector<unsigned int> lineTime(numLines, 0);
+    unsigned int time = FETCH_CACHE_LINES + 1;
+    VertexFetchStatistics statistics{ 0, 0.0f };
+    for (unsigned int i = 0; i < count; ++i) {
+        unsigned int first = indices[i] * vertexSize / CACHE_LINE_SIZE;
+        unsigned int last = (indices[i] * vertexSize + vertexSize - 1) / CACHE_LINE_SIZE;
+        for (unsigned int line = first; line <= last; ++line) {
+            if (time - lineTime[line] > FETCH_CACHE_LINES) {
+                lineTime[line] = time++;
+                statistics.m_bytesFetched += CACHE_LINE_SIZE;
+            }
+        }
+    }
+    if (vertexCount > 0) {
+        statistics.m_overfetch = static_cast<float>(statistics.m_bytesFetched) / (vertexCount * vertexSize);
+    }
+    return statistics;
+}
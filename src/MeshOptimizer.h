@@ -0,0 +1,63 @@
+#ifndef MESH_OPTIMIZER_H_INCLUDED
+#define MESH_OPTIMIZER_H_INCLUDED
+
+#include <vector>
+
+// the size of the post-transform vertex cache that the statistics are measured
+// with. Real GPUs differ, but 16 entries is a common conservative estimate
+const unsigned int VERTEX_CACHE_SIZE = 16;
+
+struct VertexCacheStatistics {
+	unsigned int m_vertexTransforms;  // vertex shader invocations (cache misses)
+	float m_acmr;                     // average cache miss ratio: transforms per triangle, 0.5 to 3
+	float m_atvr;                     // average transform to vertex ratio: transforms per used vertex, 1 or more
+};
+
+struct OverdrawStatistics {
+	unsigned int m_pixelsCovered;
+	unsigned int m_pixelsShaded;
+	float m_overdraw;                 // shaded / covered, 1 means no pixel is shaded twice
+};
+
+struct VertexFetchStatistics {
+	unsigned int m_bytesFetched;
+	float m_overfetch;                // fetched bytes / vertex buffer bytes, 1 at best
+};
+
+// Reorders triangles so that they reuse recently transformed vertices (Forsyth's
+// linear-speed vertex cache optimization). The winding of every triangle is kept.
+std::vector<unsigned int> optimizeVertexCache(const unsigned int* indices, unsigned int count,
+	unsigned int vertexCount);
+
+// Reorders groups of triangles so that outward facing parts of the mesh are drawn
+// first and hide what is behind them (Sander et al., "Fast triangle reordering").
+// Works on the output of optimizeVertexCache and keeps its ACMR within threshold times
+// the original (1.05 is a good start), returning the triangles unchanged if it can't.
+// positionStride is in bytes.
+std::vector<unsigned int> optimizeOverdraw(const unsigned int* indices, unsigned int count,
+	const float* positions, unsigned int vertexCount, unsigned int positionStride, float threshold);
+
+// Moves the vertices into the order in which the indices first use them, so
+// that vertex fetches walk through memory linearly, and rewrites the indices to
+// match. Unused vertices are dropped. Returns the new number of vertices.
+unsigned int optimizeVertexFetch(void* vertices, unsigned int vertexCount, unsigned int vertexSize,
+	unsigned int* indices, unsigned int count);
+
+// Runs all three optimizations in order on interleaved float vertices whose first
+// three floats are the position. Returns the new number of vertices.
+unsigned int optimizeMesh(float* vertices, unsigned int vertexCount, unsigned int vertexSize,
+	std::vector<unsigned int>& indices);
+
+// simulates a FIFO vertex cache of the given size
+VertexCacheStatistics analyzeVertexCache(const unsigned int* indices, unsigned int count,
+	unsigned int vertexCount, unsigned int cacheSize = VERTEX_CACHE_SIZE);
+
+// rasterizes the mesh from the six axis directions in triangle order
+OverdrawStatistics analyzeOverdraw(const unsigned int* indices, unsigned int count,
+	const float* positions, unsigned int vertexCount, unsigned int positionStride);
+
+// simulates a small cache of 64 byte lines in front of the vertex buffer
+VertexFetchStatistics analyzeVertexFetch(const unsigned int* indices, unsigned int count,
+	unsigned int vertexCount, unsigned int vertexSize);
+
+#endif
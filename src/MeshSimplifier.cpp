@@ -0,0 +1,325 @@
+#include "MeshSimplifier.h"
+
+#include <glm/glm.hpp>
+
+#include <algorithm>
+#include <cmath>
+#include <limits>
+#include <string>
+#include <unordered_map>
+#include <unordered_set>
+#include <vector>
+
+// border edges get a plane perpendicular to their triangle, weighted this much
+// more than the triangles' own planes, so borders keep their shape
+const double BORDER_WEIGHT = 10.0;
+
+// positions closer than the mesh's size divided by this are the same point
+const double SEAM_GRID_SIZE = 1 << 20;
+
+// buildLodChain stops once a level has more than this fraction of the previous level's triangles
+const float MIN_LOD_REDUCTION = 0.95f;
+
+enum VertexKind {
+    MANIFOLD,   // free to collapse onto any neighbor
+    BORDER,     // on an open edge, only collapses along the border
+    LOCKED,     // at an attribute seam or a non-manifold edge, never moves
+};
+
+// the symmetric 4x4 matrix of the plane equations' products, summed over all
+// planes around a vertex. Evaluating it at a point gives the weighted sum of the
+// squared distances to those planes
+struct Quadric {
+    double m_a2, m_b2, m_c2, m_ab, m_ac, m_bc, m_ad, m_bd, m_cd, m_d2;
+    double m_weight;
+};
+
+static Quadric makePlaneQuadric(const glm::dvec3& normal, double d, double weight) {
+    Quadric q;
+    q.m_a2 = normal.x * normal.x * weight;
+    q.m_b2 = normal.y * normal.y * weight;
+    q.m_c2 = normal.z * normal.z * weight;
+    q.m_ab = normal.x * normal.y * weight;
+    q.m_ac = normal.x * normal.z * weight;
+    q.m_bc = normal.y * normal.z * weight;
+    q.m_ad = normal.x * d * weight;
+    q.m_bd = normal.y * d * weight;
+    q.m_cd = normal.z * d * weight;
+    q.m_d2 = d * d * weight;
+    q.m_weight = weight;
+    return q;
+}
+
+static void addQuadric(Quadric& q, const Quadric& other) {
+    q.m_a2 += other.m_a2;
+    q.m_b2 += other.m_b2;
+    q.m_c2 += other.m_c2;
+    q.m_ab += other.m_ab;
+    q.m_ac += other.m_ac;
+    q.m_bc += other.m_bc;
+    q.m_ad += other.m_ad;
+    q.m_bd += other.m_bd;
+    q.m_cd += other.m_cd;
+    q.m_d2 += other.m_d2;
+    q.m_weight += other.m_weight;
+}
+
+// the weighted mean squared distance of p to the quadric's planes
+static double evaluateQuadric(const Quadric& q, const glm::dvec3& p) {
+    double sum = q.m_a2 * p.x * p.x + q.m_b2 * p.y * p.y + q.m_c2 * p.z * p.z
+        + 2.0 * (q.m_ab * p.x * p.y + q.m_ac * p.x * p.z + q.m_bc * p.y * p.z)
+        + 2.0 * (q.m_ad * p.x + q.m_bd * p.y + q.m_cd * p.z) + q.m_d2;
+    return q.m_weight > 0.0 ? std::fabs(sum) / q.m_weight : 0.0;
+}
+
+static unsigned long long edgeKey(unsigned int a, unsigned int b) {
+    return (static_cast<unsigned long long>(a) << 32) | b;
+}
+
+std::vector<unsigned int> simplifyMesh(const unsigned int* indices, unsigned int count, const float* positions,
+    unsigned int vertexCount, unsigned int positionStride, unsigned int targetIndexCount, float maxError,
+    float& error) {
+    std::vector<unsigned int> result(indices, indices + count / 3 * 3);
+    error = 0.0f;
+    if (result.empty()) {
+        return result;
+    }
+
+    // work in a unit sized box so the quadrics have the same precision for every mesh
+    std::vector<glm::dvec3> points(vertexCount);
+    glm::dvec3 minimum(std::numeric_limits<double>::max());
+    glm::dvec3 maximum(-std::numeric_limits<double>::max());
+    for (unsigned int v = 0; v < vertexCount; ++v) {
+        const float* position = reinterpret_cast<const float*>(
+            reinterpret_cast<const char*>(positions) + v * positionStride);
+        points[v] = glm::dvec3(position[0], position[1], position[2]);
+        minimum = glm::min(minimum, points[v]);
+        maximum = glm::max(maximum, points[v]);
+    }
+    glm::dvec3 extent = maximum - minimum;
+    double scale = std::max(std::max(extent.x, extent.y), std::max(extent.z, 1e-12));
+    for (glm::dvec3& point : points) {
+        point = (point - minimum) / scale;
+    }
+    const double maxCost = static_cast<double>(maxError) / scale * (static_cast<double>(maxError) / scale);
+
+    // vertices at the same position (with different normals or texture coordinates)
+    // are one point of the surface, represented by the first of them. Positions are
+    // compared on a grid, so -0 and 0, or a seam computed twice, are the same point
+    std::vector<unsigned int> canonical(vertexCount);
+    std::vector<unsigned int> wedges(vertexCount, 0);
+    std::unordered_map<std::string, unsigned int> positionToVertex;
+    for (unsigned int v = 0; v < vertexCount; ++v) {
+        const long long cell[3] = { std::llround(points[v].x * SEAM_GRID_SIZE),
+            std::llround(points[v].y * SEAM_GRID_SIZE), std::llround(points[v].z * SEAM_GRID_SIZE) };
+        std::string key(reinterpret_cast<const char*>(cell), sizeof(cell));
+        canonical[v] = positionToVertex.emplace(key, v).first->second;
+    }
+    std::vector<bool> referenced(vertexCount, false);
+    for (unsigned int index : result) {
+        if (!referenced[index]) {
+            referenced[index] = true;
+            ++wedges[canonical[index]];
+        }
+    }
+
+    // an edge is on the border if no triangle uses it in the other direction
+    std::unordered_map<unsigned long long, unsigned int> edgeUses;
+    for (unsigned int i = 0; i < result.size(); i += 3) {
+        for (unsigned int e = 0; e < 3; ++e) {
+            ++edgeUses[edgeKey(canonical[result[i + e]], canonical[result[i + (e + 1) % 3]])];
+        }
+    }
+    std::vector<VertexKind> kinds(vertexCount, MANIFOLD);
+    std::unordered_set<unsigned long long> borderEdges;
+    for (const auto& edge : edgeUses) {
+        unsigned int a = static_cast<unsigned int>(edge.first >> 32);
+        unsigned int b = static_cast<unsigned int>(edge.first & 0xFFFFFFFF);
+        if (edge.second > 1) {
+            kinds[a] = LOCKED;
+            kinds[b] = LOCKED;
+        } else if (edgeUses.find(edgeKey(b, a)) == edgeUses.end()) {
+            borderEdges.insert(edgeKey(a, b));
+            borderEdges.insert(edgeKey(b, a));
+            kinds[a] = kinds[a] == LOCKED ? LOCKED : BORDER;
+            kinds[b] = kinds[b] == LOCKED ? LOCKED : BORDER;
+        }
+    }
+    for (unsigned int v = 0; v < vertexCount; ++v) {
+        if (wedges[v] > 1) {
+            kinds[v] = LOCKED;
+        }
+    }
+
+    // every vertex starts with the planes of its triangles, weighted by area
+    std::vector<Quadric> quadrics(vertexCount, Quadric{});
+    for (unsigned int i = 0; i < result.size(); i += 3) {
+        unsigned int tri[3] = { canonical[result[i]], canonical[result[i + 1]], canonical[result[i + 2]] };
+        glm::dvec3 normal = glm::cross(points[tri[1]] - points[tri[0]], points[tri[2]] - points[tri[0]]);
+        double length = glm::length(normal);
+        if (length == 0.0) {
+            continue;
+        }
+        normal /= length;
+        Quadric plane = makePlaneQuadric(normal, -glm::dot(normal, points[tri[0]]), length * 0.5);
+        for (unsigned int e = 0; e < 3; ++e) {
+            addQuadric(quadrics[tri[e]], plane);
+            if (borderEdges.count(edgeKey(tri[e], tri[(e + 1) % 3]))) {
+                const glm::dvec3& a = points[tri[e]];
+                const glm::dvec3& b = points[tri[(e + 1) % 3]];
+                glm::dvec3 borderNormal = glm::cross(b - a, normal);
+                double borderLength = glm::length(borderNormal);
+                if (borderLength > 0.0) {
+                    borderNormal /= borderLength;
+                    Quadric border = makePlaneQuadric(borderNormal, -glm::dot(borderNormal, a),
+                        glm::dot(b - a, b - a) * BORDER_WEIGHT);
+                    addQuadric(quadrics[tri[e]], border);
+                    addQuadric(quadrics[tri[(e + 1) % 3]], border);
+                }
+            }
+        }
+    }
+
+    struct Collapse {
+        unsigned int m_from;
+        unsigned int m_to;
+        double m_cost;
+    };
+    std::vector<Collapse> collapses;
+    std::vector<unsigned int> firstTriangle(vertexCount + 1);
+    std::vector<unsigned int> adjacency;
+    std::vector<unsigned int> remap(vertexCount);
+    std::vector<bool> locked(vertexCount);
+    double largestCost = 0.0;
+
+    // Every pass does the cheapest collapses whose neighborhoods don't overlap,
+    // then rebuilds the index list. Collapsing vertex u onto v moves all of u's
+    // triangles to v and removes the ones that had both
+    while (result.size() > targetIndexCount) {
+        const unsigned int numTriangles = static_cast<unsigned int>(result.size() / 3);
+        std::fill(firstTriangle.begin(), firstTriangle.end(), 0);
+        for (unsigned int index : result) {
+            ++firstTriangle[index + 1];
+        }
+        for (unsigned int v = 0; v < vertexCount; ++v) {
+            firstTriangle[v + 1] += firstTriangle[v];
+        }
+        adjacency.resize(result.size());
+        std::vector<unsigned int> filled(firstTriangle.begin(), firstTriangle.end() - 1);
+        for (unsigned int i = 0; i < result.size(); ++i) {
+            adjacency[filled[result[i]]++] = i / 3;
+        }
+
+        collapses.clear();
+        auto addCollapse = [&](unsigned int u, unsigned int v) {
+            unsigned int cu = canonical[u];
+            unsigned int cv = canonical[v];
+            if (cu == cv || kinds[cu] == LOCKED || (kinds[cu] == BORDER && !borderEdges.count(edgeKey(cu, cv)))) {
+                return;
+            }
+            Quadric combined = quadrics[cu];
+            addQuadric(combined, quadrics[cv]);
+            collapses.push_back({ u, v, evaluateQuadric(combined, points[cv]) });
+        };
+        for (unsigned int i = 0; i < result.size(); i += 3) {
+            for (unsigned int e = 0; e < 3; ++e) {
+                addCollapse(result[i + e], result[i + (e + 1) % 3]);
+                addCollapse(result[i + (e + 1) % 3], result[i + e]);
+            }
+        }
+        std::sort(collapses.begin(), collapses.end(), [](const Collapse& a, const Collapse& b) {
+            return a.m_cost < b.m_cost;
+        });
+
+        for (unsigned int v = 0; v < vertexCount; ++v) {
+            remap[v] = v;
+        }
+        std::fill(locked.begin(), locked.end(), false);
+        unsigned int removedTriangles = 0;
+        unsigned int collapsed = 0;
+        for (const Collapse& collapse : collapses) {
+            if (collapse.m_cost > maxCost || numTriangles - removedTriangles <= targetIndexCount / 3) {
+                break;
+            }
+            const unsigned int u = collapse.m_from;
+            const unsigned int v = collapse.m_to;
+            if (locked[u] || locked[v]) {
+                continue;
+            }
+
+            // the collapse must not turn any of the remaining triangles around
+            bool flips = false;
+            unsigned int degenerate = 0;
+            for (unsigned int k = firstTriangle[u]; k < firstTriangle[u + 1] && !flips; ++k) {
+                const unsigned int* tri = result.data() + adjacency[k] * 3;
+                if (tri[0] == v || tri[1] == v || tri[2] == v) {
+                    ++degenerate;
+                    continue;
+                }
+                glm::dvec3 before = glm::cross(points[tri[1]] - points[tri[0]], points[tri[2]] - points[tri[0]]);
+                glm::dvec3 corners[3];
+                for (unsigned int e = 0; e < 3; ++e) {
+                    corners[e] = points[tri[e] == u ? v : tri[e]];
+                }
+                glm::dvec3 after = glm::cross(corners[1] - corners[0], corners[2] - corners[0]);
+                flips = glm::dot(before, after) <= 0.0;
+            }
+            if (flips) {
+                continue;
+            }
+
+            remap[u] = v;
+            addQuadric(quadrics[canonical[v]], quadrics[canonical[u]]);
+            largestCost = std::max(largestCost, collapse.m_cost);
+            removedTriangles += degenerate;
+            ++collapsed;
+            for (unsigned int k = firstTriangle[u]; k < firstTriangle[u + 1]; ++k) {
+                const unsigned int* tri = result.data() + adjacency[k] * 3;
+                locked[tri[0]] = locked[tri[1]] = locked[tri[2]] = true;
+            }
+        }
+        if (collapsed == 0) {
+            break;
+        }
+
+        unsigned int write = 0;
+        for (unsigned int i = 0; i < result.size(); i += 3) {
+            unsigned int a = remap[result[i]];
+            unsigned int b = remap[result[i + 1]];
+            unsigned int c = remap[result[i + 2]];
+            if (a != b && b != c && c != a) {
+                result[write++] = a;
+                result[write++] = b;
+                result[write++] = c;
+            }
+        }
+        result.resize(write);
+    }
+
+    error = static_cast<float>(std::sqrt(largestCost) * scale);
+    return result;
+}
+
+std::vector<LodLevel> buildLodChain(const unsigned int* indices, unsigned int count, const float* positions,
+    unsigned int vertexCount, unsigned int positionStride, unsigned int maxLevels, float reduction) {
+    std::vector<LodLevel> levels;
+    unsigned int previousCount = count;
+    float target = static_cast<float>(count);
+    for (unsigned int level = 0; level < maxLevels; ++level) {
+        target *= reduction;
+        LodLevel lod;
+        lod.m_indices = simplifyMesh(indices, count, positions, vertexCount, positionStride,
+            static_cast<unsigned int>(target), std::numeric_limits<float>::max(), lod.m_error);
+        if (lod.m_indices.empty() || lod.m_indices.size() > previousCount * MIN_LOD_REDUCTION) {
+            break;
+        }
+
+        // a coarser level must never be selected where a finer one wasn't good enough
+        if (!levels.empty()) {
+            lod.m_error = std::max(lod.m_error, levels.back().m_error);
+        }
+        previousCount = static_cast<unsigned int>(lod.m_indices.size());
+        levels.push_back(std::move(lod));
+    }
+    return levels;
+}
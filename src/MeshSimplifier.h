@@ -0,0 +1,31 @@
+#ifndef MESH_SIMPLIFIER_H_INCLUDED
+#define MESH_SIMPLIFIER_H_INCLUDED
+
+#include <vector>
+
+// one level of detail: indices into the original vertices and how far (in the
+// units of the positions) the simplified surface may be from the original one
+struct LodLevel {
+	std::vector<unsigned int> m_indices;
+	float m_error;
+};
+
+// Simplifies an indexed triangle list with quadric error metrics (Garland and
+// Heckbert) until it has at most targetIndexCount indices, or no collapse with an
+// error below maxError is left. Only edge collapses onto existing vertices are
+// done, so the result indexes the same vertices and needs no new vertex buffer.
+// Vertices at attribute seams (different vertices at the same position) are kept
+// in place and border vertices only move along the border, so there are no cracks.
+// positionStride is in bytes. error is set to the largest error of the result.
+std::vector<unsigned int> simplifyMesh(const unsigned int* indices, unsigned int count, const float* positions,
+	unsigned int vertexCount, unsigned int positionStride, unsigned int targetIndexCount, float maxError,
+	float& error);
+
+// Builds up to maxLevels levels of detail, each with about reduction times the
+// triangles of the previous one. Every level is simplified from the original so
+// its error is measured against the original. Stops early once a level can't be
+// made noticeably smaller. Level 0, the original, is not part of the result.
+std::vector<LodLevel> buildLodChain(const unsigned int* indices, unsigned int count, const float* positions,
+	unsigned int vertexCount, unsigned int positionStride, unsigned int maxLevels, float reduction = 0.5f);
+
+#endif
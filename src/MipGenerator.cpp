@@ -0,0 +1,348 @@
+#include "MipGenerator.h"
+#include "JobSystem.h"
+#include "Simd.h"
+
+#include "stb_image/stb_image.h"
+
+#include <algorithm>
+#include <cmath>
+#include <cstring>
+#include <filesystem>
+#include <fstream>
+#include <functional>
+#include <iostream>
+#include <string>
+#include <system_error>
+#include <utility>
+#include <vector>
+
+// the Kaiser filter reaches this far, in pixels of the smaller level
+const float KAISER_RADIUS = 1.5f;
+// how quickly the window falls off, higher is smoother but blurrier
+const float KAISER_ALPHA = 4.0f;
+// about how many pixels one job filters
+const unsigned int ROW_GRAIN_PIXELS = 16384;
+const unsigned int MIP_CACHE_VERSION = 1;
+const unsigned int SRGB_GUESS_COUNT = 4096;
+
+// the source pixels and weights that make every pixel of a smaller row or column,
+// pixels that need fewer than m_taps have weight 0 for the rest
+struct FilterKernel {
+    unsigned int m_taps;
+    std::vector<unsigned int> m_indices;
+    std::vector<float> m_weights;
+};
+
+struct SrgbTables {
+    float m_toLinear[256];
+    // the linear value halfway (in sRGB) between two bytes, so encoding is a search
+    // that gives every byte back exactly
+    float m_thresholds[255];
+    // the byte at the bottom of every range of linear values, the search starts there
+    // and is at most a step or two away from the answer
+    unsigned char m_guesses[SRGB_GUESS_COUNT];
+};
+
+static float srgbToLinear(float value) {
+    return value <= 0.04045f ? value / 12.92f : std::pow((value + 0.055f) / 1.055f, 2.4f);
+}
+
+static const SrgbTables& getSrgbTables() {
+    static const SrgbTables tables = []() {
+        SrgbTables result;
+        for (unsigned int i = 0; i < 256; ++i) {
+            result.m_toLinear[i] = srgbToLinear(i / 255.0f);
+        }
+        for (unsigned int i = 0; i < 255; ++i) {
+            result.m_thresholds[i] = srgbToLinear((i + 0.5f) / 255.0f);
+        }
+        for (unsigned int i = 0; i < SRGB_GUESS_COUNT; ++i) {
+            float value = static_cast<float>(i) / (SRGB_GUESS_COUNT - 1);
+            result.m_guesses[i] = static_cast<unsigned char>(std::upper_bound(result.m_thresholds,
+                result.m_thresholds + 255, value) - result.m_thresholds);
+        }
+        return result;
+    }();
+    return tables;
+}
+
+static float besselI0(float x) {
+    // the power series converges quickly for the small arguments of the window
+    float sum = 1.0f;
+    float term = 1.0f;
+    for (unsigned int k = 1; k < 16; ++k) {
+        float factor = x / (2.0f * k);
+        term *= factor * factor;
+        sum += term;
+    }
+    return sum;
+}
+
+static float evaluateKaiser(float t) {
+    if (std::fabs(t) >= KAISER_RADIUS) {
+        return 0.0f;
+    }
+    float sinc = 1.0f;
+    if (t != 0.0f) {
+        float x = 3.14159265f * t;
+        sinc = std::sin(x) / x;
+    }
+    float window = t / KAISER_RADIUS;
+    return sinc * besselI0(KAISER_ALPHA * std::sqrt(1.0f - window * window)) / besselI0(KAISER_ALPHA);
+}
+
+static FilterKernel createKernel(unsigned int sourceSize, unsigned int size, MipFilter filter) {
+    const float scale = static_cast<float>(sourceSize) / size;
+    const float radius = (filter == MIP_FILTER_BOX ? 0.5f : KAISER_RADIUS) * scale;
+    std::vector<std::vector<std::pair<unsigned int, float>>> pixels(size);
+    FilterKernel kernel{ 1, {}, {} };
+    for (unsigned int x = 0; x < size; ++x) {
+        float center = (x + 0.5f) * scale;
+        int first = static_cast<int>(std::floor(center - radius));
+        int last = static_cast<int>(std::ceil(center + radius));
+        float total = 0.0f;
+        for (int i = first; i <= last; ++i) {
+            float weight = 0.0f;
+            if (filter == MIP_FILTER_BOX) {
+                weight = std::min(center + radius, i + 1.0f) - std::max(center - radius, static_cast<float>(i));
+            } else {
+                weight = evaluateKaiser((i + 0.5f - center) / scale);
+            }
+            // the zeros of the sinc come out as tiny values
+            if (std::fabs(weight) > 1e-6f) {
+                unsigned int index = static_cast<unsigned int>(std::clamp(i, 0, static_cast<int>(sourceSize) - 1));
+                pixels[x].push_back({ index, weight });
+                total += weight;
+            }
+        }
+        for (std::pair<unsigned int, float>& tap : pixels[x]) {
+            tap.second /= total;
+        }
+        kernel.m_taps = std::max(kernel.m_taps, static_cast<unsigned int>(pixels[x].size()));
+    }
+    kernel.m_indices.assign(size * kernel.m_taps, 0);
+    kernel.m_weights.assign(size * kernel.m_taps, 0.0f);
+    for (unsigned int x = 0; x < size; ++x) {
+        for (unsigned int k = 0; k < pixels[x].size(); ++k) {
+            kernel.m_indices[x * kernel.m_taps + k] = pixels[x][k].first;
+            kernel.m_weights[x * kernel.m_taps + k] = pixels[x][k].second;
+        }
+    }
+    return kernel;
+}
+
+// one RGBA pixel of the smaller row for every group of taps
+static void filterRow(const float* source, const FilterKernel& kernel, unsigned int width, float* destination) {
+    const unsigned int* indices = kernel.m_indices.data();
+    const float* weights = kernel.m_weights.data();
+    for (unsigned int x = 0; x < width; ++x, indices += kernel.m_taps, weights += kernel.m_taps) {
+#if USE_SSE
+        __m128 sum = _mm_setzero_ps();
+        for (unsigned int k = 0; k < kernel.m_taps; ++k) {
+            sum = _mm_add_ps(sum, _mm_mul_ps(_mm_loadu_ps(source + indices[k] * 4), _mm_set1_ps(weights[k])));
+        }
+        _mm_storeu_ps(destination + x * 4, sum);
+#else
+        float sum[4] = { 0.0f, 0.0f, 0.0f, 0.0f };
+        for (unsigned int k = 0; k < kernel.m_taps; ++k) {
+            for (unsigned int c = 0; c < 4; ++c) {
+                sum[c] += source[indices[k] * 4 + c] * weights[k];
+            }
+        }
+        std::memcpy(destination + x * 4, sum, sizeof(sum));
+#endif
+    }
+}
+
+// adds a weighted source row to the destination, count is a multiple of 4
+static void accumulateRow(const float* source, float weight, unsigned int count, float* destination) {
+#if USE_SSE
+    const __m128 weights = _mm_set1_ps(weight);
+    for (unsigned int i = 0; i < count; i += SSE_WIDTH) {
+        _mm_storeu_ps(destination + i, _mm_add_ps(_mm_loadu_ps(destination + i),
+            _mm_mul_ps(_mm_loadu_ps(source + i), weights)));
+    }
+#else
+    for (unsigned int i = 0; i < count; ++i) {
+        destination[i] += source[i] * weight;
+    }
+#endif
+}
+
+static void decodeRow(const unsigned char* source, unsigned int width, bool srgb, float* destination) {
+    const SrgbTables& tables = getSrgbTables();
+    for (unsigned int i = 0; i < width * 4; ++i) {
+        bool color = srgb && i % 4 != 3;
+        destination[i] = color ? tables.m_toLinear[source[i]] : source[i] / 255.0f;
+    }
+}
+
+static void encodeRow(const float* source, unsigned int width, bool srgb, unsigned char* destination) {
+    const SrgbTables& tables = getSrgbTables();
+    for (unsigned int i = 0; i < width * 4; ++i) {
+        // the sinc's negative lobes can overshoot next to hard edges
+        float value = std::clamp(source[i], 0.0f, 1.0f);
+        if (srgb && i % 4 != 3) {
+            unsigned int guess = static_cast<unsigned int>(value * (SRGB_GUESS_COUNT - 1));
+            unsigned int encoded = tables.m_guesses[guess];
+            while (encoded < 255 && value >= tables.m_thresholds[encoded]) {
+                ++encoded;
+            }
+            destination[i] = static_cast<unsigned char>(encoded);
+        } else {
+            destination[i] = static_cast<unsigned char>(value * 255.0f + 0.5f);
+        }
+    }
+}
+
+static void forRows(unsigned int rows, unsigned int width, JobSystem* jobs,
+    const std::function<void(unsigned int, unsigned int)>& function) {
+    if (jobs) {
+        jobs->parallelFor(rows, std::max(1u, ROW_GRAIN_PIXELS / width), function);
+    } else {
+        function(0, rows);
+    }
+}
+
+MipChain generateMipChain(const unsigned char* rgba, unsigned int width, unsigned int height, MipFilter filter,
+    bool srgb, JobSystem* jobs) {
+    MipChain chain{ width, height, {} };
+    chain.m_levels.emplace_back(rgba, rgba + width * height * 4);
+
+    // the levels are filtered from the linear values of the level before, so rounding
+    // to bytes doesn't add up over the chain
+    std::vector<float> level(width * height * 4);
+    forRows(height, width, jobs, [&](unsigned int begin, unsigned int end) {
+        for (unsigned int y = begin; y < end; ++y) {
+            decodeRow(rgba + y * width * 4, width, srgb, &level[y * width * 4]);
+        }
+    });
+
+    std::vector<float> narrow;
+    std::vector<float> next;
+    while (width > 1 || height > 1) {
+        unsigned int nextWidth = std::max(1u, width / 2);
+        unsigned int nextHeight = std::max(1u, height / 2);
+        FilterKernel horizontal = createKernel(width, nextWidth, filter);
+        FilterKernel vertical = createKernel(height, nextHeight, filter);
+
+        // separable: every row gets narrower first, then the columns get shorter
+        narrow.resize(nextWidth * height * 4);
+        forRows(height, width, jobs, [&](unsigned int begin, unsigned int end) {
+            for (unsigned int y = begin; y < end; ++y) {
+                filterRow(&level[y * width * 4], horizontal, nextWidth, &narrow[y * nextWidth * 4]);
+            }
+        });
+
+        next.assign(nextWidth * nextHeight * 4, 0.0f);
+        chain.m_levels.emplace_back(nextWidth * nextHeight * 4);
+        unsigned char* bytes = chain.m_levels.back().data();
+        forRows(nextHeight, nextWidth * vertical.m_taps, jobs, [&](unsigned int begin, unsigned int end) {
+            for (unsigned int y = begin; y < end; ++y) {
+                float* row = &next[y * nextWidth * 4];
+                for (unsigned int k = 0; k < vertical.m_taps; ++k) {
+                    unsigned int sourceRow = vertical.m_indices[y * vertical.m_taps + k];
+                    accumulateRow(&narrow[sourceRow * nextWidth * 4], vertical.m_weights[y * vertical.m_taps + k],
+                        nextWidth * 4, row);
+                }
+                encodeRow(row, nextWidth, srgb, bytes + y * nextWidth * 4);
+            }
+        });
+
+        level.swap(next);
+        width = nextWidth;
+        height = nextHeight;
+    }
+    return chain;
+}
+
+// Written as it is in memory, the cache is only read on the machine that made it. The
+// source's size and modification time tell if the image changed since.
+struct MipCacheHeader {
+    char m_magic[4];
+    unsigned int m_version;
+    unsigned int m_filter;
+    unsigned int m_srgb;
+    unsigned long long m_sourceSize;
+    long long m_sourceTime;
+    unsigned int m_width;
+    unsigned int m_height;
+};
+
+static bool isSameSource(const MipCacheHeader& a, const MipCacheHeader& b) {
+    return std::memcmp(a.m_magic, b.m_magic, 4) == 0 && a.m_version == b.m_version && a.m_filter == b.m_filter
+        && a.m_srgb == b.m_srgb && a.m_sourceSize == b.m_sourceSize && a.m_sourceTime == b.m_sourceTime;
+}
+
+static bool readMipCache(const std::string& cachePath, const MipCacheHeader& key, MipChain& chain) {
+    std::ifstream file(cachePath, std::ios::binary);
+    MipCacheHeader header;
+    if (!file.read(reinterpret_cast<char*>(&header), sizeof(header)) || !isSameSource(header, key)) {
+        return false;
+    }
+    // the chain is only changed once the whole file was read
+    MipChain cached{ header.m_width, header.m_height, {} };
+    unsigned int width = header.m_width;
+    unsigned int height = header.m_height;
+    while (true) {
+        cached.m_levels.emplace_back(width * height * 4);
+        if (!file.read(reinterpret_cast<char*>(cached.m_levels.back().data()), cached.m_levels.back().size())) {
+            return false;
+        }
+        if (width == 1 && height == 1) {
+            chain = std::move(cached);
+            return true;
+        }
+        width = std::max(1u, width / 2);
+        height = std::max(1u, height / 2);
+    }
+}
+
+static void writeMipCache(const std::string& cachePath, MipCacheHeader header, const MipChain& chain) {
+    header.m_width = chain.m_width;
+    header.m_height = chain.m_height;
+    std::ofstream file(cachePath, std::ios::binary);
+    file.write(reinterpret_cast<const char*>(&header), sizeof(header));
+    for (const std::vector<unsigned char>& level : chain.m_levels) {
+        file.write(reinterpret_cast<const char*>(level.data()), level.size());
+    }
+    if (!file) {
+        std::cerr << "Failed to write " << cachePath << '\n';
+    }
+}
+
+bool loadMipChain(const std::string& imagePath, MipFilter filter, bool srgb, MipChain& chain, JobSystem* jobs) {
+    MipCacheHeader key;
+    std::memset(&key, 0, sizeof(key));
+    std::memcpy(key.m_magic, "MIPS", 4);
+    key.m_version = MIP_CACHE_VERSION;
+    key.m_filter = filter;
+    key.m_srgb = srgb ? 1 : 0;
+    std::error_code error;
+    key.m_sourceSize = std::filesystem::file_size(imagePath, error);
+    if (!error) {
+        key.m_sourceTime = std::filesystem::last_write_time(imagePath, error).time_since_epoch().count();
+    }
+    const std::string cachePath = getMipCachePath(imagePath);
+    if (!error && readMipCache(cachePath, key, chain)) {
+        return true;
+    }
+
+    // only changes how this thread loads images
+    stbi_set_flip_vertically_on_load_thread(1);
+    int width, height, BPP;
+    unsigned char* pixels = stbi_load(imagePath.c_str(), &width, &height, &BPP, 4);
+    if (!pixels) {
+        return false;
+    }
+    chain = generateMipChain(pixels, width, height, filter, srgb, jobs);
+    stbi_image_free(pixels);
+    if (!error) {
+        writeMipCache(cachePath, key, chain);
+    }
+    return true;
+}
+
+std::string getMipCachePath(const std::string& imagePath) {
+    return imagePath + ".mips";
+}
@@ -0,0 +1,35 @@
+#ifndef MIP_GENERATOR_H_INCLUDED
+#define MIP_GENERATOR_H_INCLUDED
+
+#include <string>
+#include <vector>
+
+class JobSystem;
+
+enum MipFilter {
+	MIP_FILTER_BOX,     // the average of the pixels a smaller pixel covers
+	MIP_FILTER_KAISER   // a Kaiser windowed sinc, sharper and with less aliasing than the box
+};
+
+// an RGBA image with all its smaller levels down to 1x1, level 0 first
+struct MipChain {
+	unsigned int m_width;
+	unsigned int m_height;
+	std::vector<std::vector<unsigned char>> m_levels;
+};
+
+// Makes every level from the one before it. With srgb set the color channels are
+// filtered in linear light (averaging black and white gives 188, not 128), alpha is
+// always linear. With a job system, rows of every level are filtered as separate jobs.
+MipChain generateMipChain(const unsigned char* rgba, unsigned int width, unsigned int height, MipFilter filter,
+	bool srgb, JobSystem* jobs = nullptr);
+
+// The mip chain of an image file with its first row at the bottom (like OpenGL reads
+// them). The chain is read from getMipCachePath() if that was made from the same file
+// with the same settings, otherwise the image is decoded, filtered and the cache
+// written for the next time. false if the image can't be loaded.
+bool loadMipChain(const std::string& imagePath, MipFilter filter, bool srgb, MipChain& chain,
+	JobSystem* jobs = nullptr);
+std::string getMipCachePath(const std::string& imagePath);
+
+#endif
@@ -0,0 +1,247 @@
+#include "ObjectCuller.h"
+#include "Bounds.h"
+#include "Frustum.h"
+#include "Simd.h"
+
+#include <glm/glm.hpp>
+
+#include <algorithm>
+#include <limits>
+#include <vector>
+
+const unsigned int ObjectCuller::TREE_OBJECTS;
+const unsigned int ObjectCuller::TREE_VISIBLE_DIVISOR;
+const unsigned int ObjectCuller::TREE_CHANGE_DIVISOR;
+// compacting only reorders the nodes, so it waits until a quarter of the objects were reinserted
+const unsigned int COMPACT_DIVISOR = 4;
+
+ObjectCuller::ObjectCuller() : m_count{ 0 }, m_changes{ 0 }, m_lastVisible{ 0 }, m_treeChanges{ 0 } {}
+
+unsigned int ObjectCuller::add(const Bounds& worldBounds) {
+    // the padding objects have a radius so negative that they are outside of every plane
+    unsigned int padded = padToSimdWidth(m_count + 1);
+    if (padded > m_radius.size()) {
+        for (std::vector<float>* values : { &m_centerX, &m_centerY, &m_centerZ, &m_extentX, &m_extentY, &m_extentZ }) {
+            values->resize(padded, 0.0f);
+        }
+        m_radius.resize(padded, -std::numeric_limits<float>::max());
+    }
+    store(m_count, worldBounds);
+    m_isMoved.push_back(0);
+    track(m_count);
+    return m_count++;
+}
+
+void ObjectCuller::set(unsigned int object, const Bounds& worldBounds) {
+    track(object);
+    store(object, worldBounds);
+}
+
+Bounds ObjectCuller::getBounds(unsigned int object) const {
+    return { glm::vec3(m_centerX[object], m_centerY[object], m_centerZ[object]),
+        glm::vec3(m_extentX[object], m_extentY[object], m_extentZ[object]), m_radius[object] };
+}
+
+void ObjectCuller::store(unsigned int object, const Bounds& worldBounds) {
+    m_centerX[object] = worldBounds.m_center.x;
+    m_centerY[object] = worldBounds.m_center.y;
+    m_centerZ[object] = worldBounds.m_center.z;
+    m_extentX[object] = worldBounds.m_extents.x;
+    m_extentY[object] = worldBounds.m_extents.y;
+    m_extentZ[object] = worldBounds.m_extents.z;
+    m_radius[object] = worldBounds.m_radius;
+}
+
+// counts the change, and remembers where the object was for the tree if there is one
+void ObjectCuller::track(unsigned int object) {
+    ++m_changes;
+    if (m_tree.getObjectCount() > 0 && !m_isMoved[object]) {
+        m_isMoved[object] = 1;
+        m_moved.push_back(object);
+        m_movedFrom.push_back(glm::vec3(m_centerX[object], m_centerY[object], m_centerZ[object]));
+    }
+}
+
+void ObjectCuller::clear() {
+    for (std::vector<float>* values : { &m_centerX, &m_centerY, &m_centerZ, &m_extentX, &m_extentY, &m_extentZ,
+        &m_radius }) {
+        values->clear();
+    }
+    m_count = 0;
+    m_changes = 0;
+    m_lastVisible = 0;
+    m_tree.clear();
+    m_moved.clear();
+    m_movedFrom.clear();
+    m_isMoved.clear();
+    m_treeChanges = 0;
+}
+
+// Returns true if the tree pays off for this cull(), after building it or moving the
+// objects that changed since the last one. Otherwise drops it
+bool ObjectCuller::updateTree() {
+    bool inUse = m_tree.getObjectCount() > 0;
+    unsigned int slack = inUse ? 2 : 1;
+    bool paysOff = m_count >= TREE_OBJECTS && m_lastVisible <= slack * (m_count / TREE_VISIBLE_DIVISOR)
+        && m_changes <= slack * (m_count / TREE_CHANGE_DIVISOR);
+    m_changes = 0;
+    if (!paysOff) {
+        if (inUse) {
+            m_tree.clear();
+            for (unsigned int object : m_moved) {
+                m_isMoved[object] = 0;
+            }
+            m_moved.clear();
+            m_movedFrom.clear();
+            m_treeChanges = 0;
+        }
+        return false;
+    }
+    if (!inUse) {
+        for (unsigned int i = 0; i < m_count; ++i) {
+            m_tree.insert(i, getBounds(i));
+        }
+        m_tree.compact();
+        return true;
+    }
+    for (unsigned int i = 0; i < m_moved.size(); ++i) {
+        unsigned int object = m_moved[i];
+        m_isMoved[object] = 0;
+        Bounds bounds = getBounds(object);
+        if (m_tree.move(object, bounds, bounds.m_center - m_movedFrom[i])) {
+            ++m_treeChanges;
+        }
+    }
+    m_moved.clear();
+    m_movedFrom.clear();
+    if (m_treeChanges >= m_count / COMPACT_DIVISOR) {
+        m_tree.compact();
+        m_treeChanges = 0;
+    }
+    return true;
+}
+
+// An object is culled if it is completely outside of one plane. For every plane the
+// smaller of the sphere's radius and the box's projected radius is used, the same
+// test as intersectsFrustum()
+void ObjectCuller::cullScalar(const Frustum& frustum, std::vector<unsigned int>& visible) const {
+    for (unsigned int i = 0; i < m_count; ++i) {
+        if (intersectsFrustum(frustum, getBounds(i))) {
+            visible.push_back(i);
+        }
+    }
+}
+
+// the index of the lowest set bit: the bit times a de Bruijn sequence has different
+// top 6 bits for each of the 64 bits
+static unsigned int lowestBit(unsigned long long bits) {
+    static const unsigned char INDICES[64] = {
+        0, 1, 48, 2, 57, 49, 28, 3, 61, 58, 50, 42, 38, 29, 17, 4, 62, 55, 59, 36, 53, 51, 43, 22, 45, 39, 33, 30,
+        24, 18, 12, 5, 63, 47, 56, 27, 60, 41, 37, 16, 54, 35, 52, 21, 44, 32, 23, 11, 46, 26, 40, 15, 34, 20, 31,
+        10, 25, 14, 19, 9, 13, 8, 7, 6 };
+    return INDICES[((bits & (~bits + 1)) * 0x03F79D71B4CB0A89ull) >> 58];
+}
+
+// The views of consecutive calls are mostly alike, so the last call's result tells
+// whether the tree pays off. The tree finds the objects in no particular order, they
+// are marked in a bit set that is then read 64 objects at a time, which is faster
+// than sorting them
+void ObjectCuller::cull(const Frustum& frustum, std::vector<unsigned int>& visible) {
+    size_t first = visible.size();
+    if (!updateTree()) {
+        cullLinear(frustum, visible);
+        m_lastVisible = static_cast<unsigned int>(visible.size() - first);
+        return;
+    }
+    m_found.clear();
+    m_tree.queryFrustum(frustum, m_found);
+    m_marks.resize((m_count + 63) / 64, 0);
+    for (unsigned int object : m_found) {
+        m_marks[object / 64] |= 1ull << (object % 64);
+    }
+    for (unsigned int word = 0; word < m_marks.size(); ++word) {
+        for (unsigned long long bits = m_marks[word]; bits != 0; bits &= bits - 1) {
+            visible.push_back(word * 64 + lowestBit(bits));
+        }
+        m_marks[word] = 0;
+    }
+    m_lastVisible = static_cast<unsigned int>(m_found.size());
+}
+
+void ObjectCuller::cullLinear(const Frustum& frustum, std::vector<unsigned int>& visible) const {
+#if USE_AVX
+    for (unsigned int i = 0; i < m_count; i += AVX_WIDTH) {
+        __m256 centerX = _mm256_loadu_ps(&m_centerX[i]);
+        __m256 centerY = _mm256_loadu_ps(&m_centerY[i]);
+        __m256 centerZ = _mm256_loadu_ps(&m_centerZ[i]);
+        __m256 extentX = _mm256_loadu_ps(&m_extentX[i]);
+        __m256 extentY = _mm256_loadu_ps(&m_extentY[i]);
+        __m256 extentZ = _mm256_loadu_ps(&m_extentZ[i]);
+        __m256 radius = _mm256_loadu_ps(&m_radius[i]);
+        __m256 culled = _mm256_setzero_ps();
+        for (const glm::vec4& plane : frustum.m_planes) {
+            // summed in the same order as the scalar path, so both give the same results
+            __m256 distance = _mm256_add_ps(_mm256_add_ps(
+                _mm256_add_ps(_mm256_mul_ps(_mm256_set1_ps(plane.x), centerX),
+                    _mm256_mul_ps(_mm256_set1_ps(plane.y), centerY)),
+                _mm256_mul_ps(_mm256_set1_ps(plane.z), centerZ)), _mm256_set1_ps(plane.w));
+            __m256 boxRadius = _mm256_add_ps(
+                _mm256_add_ps(_mm256_mul_ps(_mm256_set1_ps(std::abs(plane.x)), extentX),
+                    _mm256_mul_ps(_mm256_set1_ps(std::abs(plane.y)), extentY)),
+                _mm256_mul_ps(_mm256_set1_ps(std::abs(plane.z)), extentZ));
+            __m256 limit = _mm256_sub_ps(_mm256_setzero_ps(), _mm256_min_ps(radius, boxRadius));
+            culled = _mm256_or_ps(culled, _mm256_cmp_ps(distance, limit, _CMP_LT_OQ));
+        }
+        int culledMask = _mm256_movemask_ps(culled);
+        for (unsigned int lane = 0; lane < AVX_WIDTH; ++lane) {
+            if (!(culledMask & (1 << lane))) {
+                visible.push_back(i + lane);
+            }
+        }
+    }
+#elif USE_SSE
+    __m128 planeX[6], planeY[6], planeZ[6], planeW[6];
+    __m128 absPlaneX[6], absPlaneY[6], absPlaneZ[6];
+    for (unsigned int p = 0; p < 6; ++p) {
+        const glm::vec4& plane = frustum.m_planes[p];
+        planeX[p] = _mm_set1_ps(plane.x);
+        planeY[p] = _mm_set1_ps(plane.y);
+        planeZ[p] = _mm_set1_ps(plane.z);
+        planeW[p] = _mm_set1_ps(plane.w);
+        absPlaneX[p] = _mm_set1_ps(std::abs(plane.x));
+        absPlaneY[p] = _mm_set1_ps(std::abs(plane.y));
+        absPlaneZ[p] = _mm_set1_ps(std::abs(plane.z));
+    }
+    for (unsigned int i = 0; i < m_count; i += SSE_WIDTH) {
+        __m128 centerX = _mm_loadu_ps(&m_centerX[i]);
+        __m128 centerY = _mm_loadu_ps(&m_centerY[i]);
+        __m128 centerZ = _mm_loadu_ps(&m_centerZ[i]);
+        __m128 extentX = _mm_loadu_ps(&m_extentX[i]);
+        __m128 extentY = _mm_loadu_ps(&m_extentY[i]);
+        __m128 extentZ = _mm_loadu_ps(&m_extentZ[i]);
+        __m128 radius = _mm_loadu_ps(&m_radius[i]);
+        __m128 culled = _mm_setzero_ps();
+        for (unsigned int p = 0; p < 6; ++p) {
+            // summed in the same order as the scalar path, so both give the same results
+            __m128 distance = _mm_add_ps(_mm_add_ps(_mm_add_ps(_mm_mul_ps(planeX[p], centerX),
+                _mm_mul_ps(planeY[p], centerY)), _mm_mul_ps(planeZ[p], centerZ)), planeW[p]);
+            __m128 boxRadius = _mm_add_ps(_mm_add_ps(_mm_mul_ps(absPlaneX[p], extentX),
+                _mm_mul_ps(absPlaneY[p], extentY)), _mm_mul_ps(absPlaneZ[p], extentZ));
+            __m128 limit = _mm_sub_ps(_mm_setzero_ps(), _mm_min_ps(radius, boxRadius));
+            culled = _mm_or_ps(culled, _mm_cmplt_ps(distance, limit));
+        }
+        int culledMask = _mm_movemask_ps(culled);
+        for (unsigned int lane = 0; lane < SSE_WIDTH; ++lane) {
+            if (!(culledMask & (1 << lane))) {
+                visible.push_back(i + lane);
+            }
+        }
+    }
+#else
+    cullScalar(frustum, visible);
+#endif
+}
+
+unsigned int ObjectCuller::getCount() const {
+    return m_count;
+}
@@ -0,0 +1,67 @@
+#ifndef OBJECT_CULLER_H_INCLUDED
+#define OBJECT_CULLER_H_INCLUDED
+
+#include "Bounds.h"
+#include "BoundsTree.h"
+#include "Frustum.h"
+
+#include <glm/glm.hpp>
+
+#include <vector>
+
+// Frustum culls many objects per call. The world space bounds of the objects are
+// kept as a structure of arrays so that SSE (or AVX) tests 4 (or 8) objects at
+// once. Objects are referred to by the index add() returned.
+//
+// cull() also keeps a BoundsTree of the objects while it pays off, and then only
+// tests the parts of the tree that reach into the frustum. A node of the tree costs
+// about as much as 5 objects of the arrays, and moving an object in the tree as much
+// as about 60, so the tree is used from TREE_OBJECTS objects on while the last cull()
+// found at most 1 / TREE_VISIBLE_DIVISOR of them and at most 1 / TREE_CHANGE_DIVISOR
+// were added or set since. Otherwise the tree is dropped and add() and set() only
+// write the arrays. Building the tree costs about as much as culling a few hundred
+// times, so a tree in use is only dropped once twice those limits are passed.
+class ObjectCuller {
+	std::vector<float> m_centerX, m_centerY, m_centerZ;
+	std::vector<float> m_extentX, m_extentY, m_extentZ;
+	std::vector<float> m_radius;
+	unsigned int m_count;
+	unsigned int m_changes;                     // objects added or set since the last cull()
+	unsigned int m_lastVisible;                 // the objects the last cull() found
+
+	BoundsTree m_tree;                          // empty while cull() doesn't use it
+	std::vector<unsigned int> m_moved;          // the objects the tree hasn't been told about yet
+	std::vector<glm::vec3> m_movedFrom;         // their centers when they were added or first set
+	std::vector<unsigned char> m_isMoved;       // 1 for the objects in m_moved
+	unsigned int m_treeChanges;                 // objects the tree reinserted since it was compacted
+	std::vector<unsigned int> m_found;          // the tree's result, in the tree's order
+	std::vector<unsigned long long> m_marks;    // a bit for every found object while they are sorted
+
+	Bounds getBounds(unsigned int object) const;
+	void store(unsigned int object, const Bounds& worldBounds);
+	void track(unsigned int object);
+	bool updateTree();
+
+public:
+	// fewer objects are faster to test one by one than to look up in the tree
+	static const unsigned int TREE_OBJECTS = 4096;
+	static const unsigned int TREE_VISIBLE_DIVISOR = 32;
+	static const unsigned int TREE_CHANGE_DIVISOR = 128;
+
+	ObjectCuller();
+
+	unsigned int add(const Bounds& worldBounds);
+	void set(unsigned int object, const Bounds& worldBounds);
+	void clear();
+
+	// Appends the indices of the objects that intersect the frustum, in ascending order.
+	// Builds, updates or drops the tree first
+	void cull(const Frustum& frustum, std::vector<unsigned int>& visible);
+	// tests every object with SIMD, what cull() does when the tree doesn't pay off
+	void cullLinear(const Frustum& frustum, std::vector<unsigned int>& visible) const;
+	void cullScalar(const Frustum& frustum, std::vector<unsigned int>& visible) const;
+
+	unsigned int getCount() const;
+};
+
+#endif
@@ -0,0 +1,261 @@
+#include "OcclusionCuller.h"
+#include "Bounds.h"
+#include "JobSystem.h"
+#include "Simd.h"
+
+#include <glm/glm.hpp>
+
+#include <algorithm>
+#include <cmath>
+#include <limits>
+#include <vector>
+
+// triangles and boxes with a vertex this close to the camera plane aren't projected
+const float MIN_CLIP_W = 1e-5f;
+
+OcclusionCuller::OcclusionCuller(unsigned int width, unsigned int height, JobSystem* jobs)
+    : m_width{ (width + SSE_WIDTH - 1) / SSE_WIDTH * SSE_WIDTH }, m_height{ height }, m_jobs{ jobs },
+    m_viewProjection{ 1.0f } {
+    unsigned int levelWidth = m_width;
+    unsigned int levelHeight = m_height;
+    while (true) {
+        m_levelSizes.emplace_back(levelWidth, levelHeight);
+        m_levels.emplace_back(levelWidth * levelHeight, 1.0f);
+        if (levelWidth == 1 && levelHeight == 1) {
+            break;
+        }
+        levelWidth = (levelWidth + 1) / 2;
+        levelHeight = (levelHeight + 1) / 2;
+    }
+}
+
+void OcclusionCuller::beginFrame(const glm::mat4& viewProjection) {
+    m_viewProjection = viewProjection;
+    m_occluders.clear();
+}
+
+void OcclusionCuller::addOccluder(const float* positions, unsigned int vertexCount, unsigned int stride,
+    const unsigned int* indices, unsigned int indexCount, const glm::mat4& model) {
+    m_occluders.push_back({ positions, vertexCount, stride, indices, indexCount, model });
+}
+
+void OcclusionCuller::setupTriangles() {
+    m_triangles.clear();
+    const glm::vec2 scale(m_width * 0.5f, m_height * 0.5f);
+    for (const Occluder& occluder : m_occluders) {
+        glm::mat4 modelViewProjection = m_viewProjection * occluder.m_model;
+        m_clipPositions.resize(occluder.m_vertexCount);
+        const char* data = reinterpret_cast<const char*>(occluder.m_positions);
+        for (unsigned int v = 0; v < occluder.m_vertexCount; ++v) {
+            const float* position = reinterpret_cast<const float*>(data + v * occluder.m_stride);
+            m_clipPositions[v] = modelViewProjection * glm::vec4(position[0], position[1], position[2], 1.0f);
+        }
+
+        for (unsigned int i = 0; i + 2 < occluder.m_indexCount; i += 3) {
+            glm::vec3 screen[3];
+            bool clipped = false;
+            for (int k = 0; k < 3 && !clipped; ++k) {
+                const glm::vec4& clip = m_clipPositions[occluder.m_indices[i + k]];
+                clipped = clip.w < MIN_CLIP_W || clip.z < -clip.w;
+                glm::vec3 ndc = glm::vec3(clip) / clip.w;
+                screen[k] = glm::vec3((glm::vec2(ndc) + 1.0f) * scale, ndc.z * 0.5f + 0.5f);
+            }
+            if (clipped) {
+                continue;
+            }
+            // counter clockwise triangles face the camera, like the default glFrontFace
+            float area = (screen[1].x - screen[0].x) * (screen[2].y - screen[0].y)
+                - (screen[1].y - screen[0].y) * (screen[2].x - screen[0].x);
+            if (area <= 0.0f) {
+                continue;
+            }
+
+            ScreenTriangle triangle;
+            glm::vec3 minimum = glm::min(glm::min(screen[0], screen[1]), screen[2]);
+            glm::vec3 maximum = glm::max(glm::max(screen[0], screen[1]), screen[2]);
+            triangle.m_minX = std::max(0, static_cast<int>(std::floor(minimum.x)));
+            triangle.m_minY = std::max(0, static_cast<int>(std::floor(minimum.y)));
+            triangle.m_maxX = std::min(static_cast<int>(m_width) - 1, static_cast<int>(std::floor(maximum.x)));
+            triangle.m_maxY = std::min(static_cast<int>(m_height) - 1, static_cast<int>(std::floor(maximum.y)));
+            if (triangle.m_minX > triangle.m_maxX || triangle.m_minY > triangle.m_maxY || minimum.z > 1.0f) {
+                continue;
+            }
+
+            // the edge from a to b is positive on its left: (b - a) x (p - a)
+            float depthX = 0.0f;
+            float depthY = 0.0f;
+            float depthConstant = 0.0f;
+            for (int k = 0; k < 3; ++k) {
+                const glm::vec3& a = screen[k];
+                const glm::vec3& b = screen[(k + 1) % 3];
+                triangle.m_edgeX[k] = a.y - b.y;
+                triangle.m_edgeY[k] = b.x - a.x;
+                triangle.m_edgeConstant[k] = (b.y - a.y) * a.x - (b.x - a.x) * a.y;
+                // the edge function divided by the area is the weight of the opposite vertex
+                float opposite = screen[(k + 2) % 3].z / area;
+                depthX += triangle.m_edgeX[k] * opposite;
+                depthY += triangle.m_edgeY[k] * opposite;
+                depthConstant += triangle.m_edgeConstant[k] * opposite;
+            }
+            triangle.m_depthX = depthX;
+            triangle.m_depthY = depthY;
+            triangle.m_depthConstant = depthConstant;
+            m_triangles.push_back(triangle);
+        }
+    }
+}
+
+// Every pixel whose center is inside of a triangle gets the nearer of its depth and
+// the triangle's depth there. Bands of rows don't share pixels, so they need no locks.
+void OcclusionCuller::rasterizeRows(unsigned int firstRow, unsigned int endRow) {
+    std::vector<float>& depth = m_levels[0];
+    std::fill(depth.begin() + firstRow * m_width, depth.begin() + endRow * m_width, 1.0f);
+    for (const ScreenTriangle& triangle : m_triangles) {
+        int minY = std::max(triangle.m_minY, static_cast<int>(firstRow));
+        int maxY = std::min(triangle.m_maxY, static_cast<int>(endRow) - 1);
+        int minX = triangle.m_minX / SSE_WIDTH * SSE_WIDTH;
+        for (int y = minY; y <= maxY; ++y) {
+            float* row = depth.data() + y * m_width;
+            float centerY = y + 0.5f;
+#if USE_SSE
+            __m128 rowEdges[3];
+            __m128 edgeX[3];
+            for (int k = 0; k < 3; ++k) {
+                rowEdges[k] = _mm_set1_ps(triangle.m_edgeY[k] * centerY + triangle.m_edgeConstant[k]);
+                edgeX[k] = _mm_set1_ps(triangle.m_edgeX[k]);
+            }
+            __m128 rowDepth = _mm_set1_ps(triangle.m_depthY * centerY + triangle.m_depthConstant);
+            __m128 depthX = _mm_set1_ps(triangle.m_depthX);
+            __m128 zero = _mm_setzero_ps();
+            for (int x = minX; x <= triangle.m_maxX; x += SSE_WIDTH) {
+                __m128 centerX = _mm_add_ps(_mm_set1_ps(x + 0.5f), _mm_set_ps(3.0f, 2.0f, 1.0f, 0.0f));
+                __m128 inside = _mm_cmpge_ps(_mm_add_ps(_mm_mul_ps(edgeX[0], centerX), rowEdges[0]), zero);
+                for (int k = 1; k < 3; ++k) {
+                    __m128 edge = _mm_add_ps(_mm_mul_ps(edgeX[k], centerX), rowEdges[k]);
+                    inside = _mm_and_ps(inside, _mm_cmpge_ps(edge, zero));
+                }
+                if (_mm_movemask_ps(inside) == 0) {
+                    continue;
+                }
+                __m128 triangleDepth = _mm_add_ps(_mm_mul_ps(depthX, centerX), rowDepth);
+                __m128 previous = _mm_loadu_ps(row + x);
+                __m128 nearest = _mm_min_ps(previous, triangleDepth);
+                _mm_storeu_ps(row + x, _mm_or_ps(_mm_and_ps(inside, nearest), _mm_andnot_ps(inside, previous)));
+            }
+#else
+            for (int x = minX; x <= triangle.m_maxX; ++x) {
+                float centerX = x + 0.5f;
+                bool inside = true;
+                for (int k = 0; k < 3; ++k) {
+                    float edge = triangle.m_edgeX[k] * centerX
+                        + (triangle.m_edgeY[k] * centerY + triangle.m_edgeConstant[k]);
+                    inside = inside && edge >= 0.0f;
+                }
+                if (inside) {
+                    float triangleDepth = triangle.m_depthX * centerX
+                        + (triangle.m_depthY * centerY + triangle.m_depthConstant);
+                    row[x] = std::min(row[x], triangleDepth);
+                }
+            }
+#endif
+        }
+    }
+}
+
+void OcclusionCuller::buildPyramid() {
+    for (unsigned int level = 1; level < m_levels.size(); ++level) {
+        const std::vector<float>& below = m_levels[level - 1];
+        glm::uvec2 belowSize = m_levelSizes[level - 1];
+        glm::uvec2 size = m_levelSizes[level];
+        std::vector<float>& depth = m_levels[level];
+        for (unsigned int y = 0; y < size.y; ++y) {
+            unsigned int y0 = y * 2;
+            unsigned int y1 = std::min(y0 + 1, belowSize.y - 1);
+            for (unsigned int x = 0; x < size.x; ++x) {
+                unsigned int x0 = x * 2;
+                unsigned int x1 = std::min(x0 + 1, belowSize.x - 1);
+                depth[y * size.x + x] = std::max({ below[y0 * belowSize.x + x0], below[y0 * belowSize.x + x1],
+                    below[y1 * belowSize.x + x0], below[y1 * belowSize.x + x1] });
+            }
+        }
+    }
+}
+
+void OcclusionCuller::rasterize() {
+    setupTriangles();
+    if (m_jobs) {
+        // every band goes through all triangles, so there are only two bands per thread
+        // to even out triangles that cover some bands more than others
+        unsigned int bands = m_jobs->getThreadCount() * 2;
+        m_jobs->parallelFor(m_height, (m_height + bands - 1) / bands, [this](unsigned int begin, unsigned int end) {
+            rasterizeRows(begin, end);
+        });
+    } else {
+        rasterizeRows(0, m_height);
+    }
+    buildPyramid();
+}
+
+bool OcclusionCuller::isVisible(const Bounds& worldBounds) const {
+    glm::vec3 minimum(std::numeric_limits<float>::max());
+    glm::vec3 maximum(-std::numeric_limits<float>::max());
+    for (int corner = 0; corner < 8; ++corner) {
+        glm::vec3 sign((corner & 1) ? 1.0f : -1.0f, (corner & 2) ? 1.0f : -1.0f, (corner & 4) ? 1.0f : -1.0f);
+        glm::vec4 clip = m_viewProjection * glm::vec4(worldBounds.m_center + sign * worldBounds.m_extents, 1.0f);
+        if (clip.w < MIN_CLIP_W || clip.z < -clip.w) {
+            return true;
+        }
+        glm::vec3 ndc = glm::vec3(clip) / clip.w;
+        minimum = glm::min(minimum, ndc);
+        maximum = glm::max(maximum, ndc);
+    }
+    float nearestDepth = minimum.z * 0.5f + 0.5f;
+    glm::vec2 scale(m_width * 0.5f, m_height * 0.5f);
+    glm::vec2 screenMin = (glm::vec2(minimum) + 1.0f) * scale;
+    glm::vec2 screenMax = (glm::vec2(maximum) + 1.0f) * scale;
+    if (screenMax.x < 0.0f || screenMax.y < 0.0f || screenMin.x >= m_width || screenMin.y >= m_height) {
+        // outside of the screen, that's for frustum culling to decide
+        return true;
+    }
+    int minX = std::max(0, static_cast<int>(screenMin.x));
+    int minY = std::max(0, static_cast<int>(screenMin.y));
+    int maxX = std::min(static_cast<int>(m_width) - 1, static_cast<int>(screenMax.x));
+    int maxY = std::min(static_cast<int>(m_height) - 1, static_cast<int>(screenMax.y));
+
+    // the level where the bounds cover at most 2 texels along each axis (3 if unaligned)
+    int size = std::max(maxX - minX, maxY - minY) + 1;
+    unsigned int level = 0;
+    while ((size >> level) > 2 && level + 1 < m_levels.size()) {
+        ++level;
+    }
+    const std::vector<float>& depth = m_levels[level];
+    unsigned int levelWidth = m_levelSizes[level].x;
+    for (int y = minY >> level; y <= (maxY >> level); ++y) {
+        for (int x = minX >> level; x <= (maxX >> level); ++x) {
+            if (depth[y * levelWidth + x] >= nearestDepth) {
+                return true;
+            }
+        }
+    }
+    return false;
+}
+
+void OcclusionCuller::setJobSystem(JobSystem* jobs) {
+    m_jobs = jobs;
+}
+
+unsigned int OcclusionCuller::getTriangleCount() const {
+    return static_cast<unsigned int>(m_triangles.size());
+}
+
+const std::vector<float>& OcclusionCuller::getDepth() const {
+    return m_levels[0];
+}
+
+unsigned int OcclusionCuller::getWidth() const {
+    return m_width;
+}
+
+unsigned int OcclusionCuller::getHeight() const {
+    return m_height;
+}
@@ -0,0 +1,79 @@
+#ifndef OCCLUSION_CULLER_H_INCLUDED
+#define OCCLUSION_CULLER_H_INCLUDED
+
+#include "Bounds.h"
+
+#include <glm/glm.hpp>
+
+#include <vector>
+
+class JobSystem;
+
+// Occlusion culling on the CPU. Occluders (big, simple meshes like walls) are
+// rasterized into a small depth buffer with SSE, 4 pixels at a time. The rows are
+// split into bands that are rasterized as separate jobs. A depth pyramid is
+// built from the result, where every texel has the farthest depth of the texels
+// below it, so the bounds of an object can be tested against a few texels of the
+// level that matches their size on the screen.
+//
+// Depths are in [0, 1] like in the default depth buffer, 1 is the far plane.
+// Triangles that cross the near plane are left out and objects that cross it are
+// always visible, both can only make fewer objects occluded.
+class OcclusionCuller {
+	struct Occluder {
+		const float* m_positions;
+		unsigned int m_vertexCount;
+		unsigned int m_stride;
+		const unsigned int* m_indices;
+		unsigned int m_indexCount;
+		glm::mat4 m_model;
+	};
+
+	// a triangle in screen space, ready to be rasterized
+	struct ScreenTriangle {
+		float m_edgeX[3], m_edgeY[3], m_edgeConstant[3];   // edge functions, positive inside
+		float m_depthX, m_depthY, m_depthConstant;          // depth plane
+		int m_minX, m_maxX, m_minY, m_maxY;                 // pixels touched, inclusive
+	};
+
+	unsigned int m_width;
+	unsigned int m_height;
+	JobSystem* m_jobs;
+	glm::mat4 m_viewProjection;
+	std::vector<Occluder> m_occluders;
+	std::vector<ScreenTriangle> m_triangles;
+	std::vector<glm::vec4> m_clipPositions;
+	// level 0 is the rasterized depth buffer, every following level has half the size
+	std::vector<std::vector<float>> m_levels;
+	std::vector<glm::uvec2> m_levelSizes;
+
+	void setupTriangles();
+	void rasterizeRows(unsigned int firstRow, unsigned int endRow);
+	void buildPyramid();
+
+public:
+	// the width is rounded up to a multiple of 4, without a job system all rows are
+	// rasterized on the calling thread
+	OcclusionCuller(unsigned int width = 256, unsigned int height = 128, JobSystem* jobs = nullptr);
+
+	// forgets the occluders of the last frame
+	void beginFrame(const glm::mat4& viewProjection);
+	// Positions are read with stride bytes between them. The data has to stay valid
+	// until rasterize() was called.
+	void addOccluder(const float* positions, unsigned int vertexCount, unsigned int stride,
+		const unsigned int* indices, unsigned int indexCount, const glm::mat4& model);
+	// rasterizes the occluders and builds the depth pyramid
+	void rasterize();
+
+	// false if the bounds are completely behind the occluders
+	bool isVisible(const Bounds& worldBounds) const;
+
+	void setJobSystem(JobSystem* jobs);
+	unsigned int getTriangleCount() const;
+	// the rasterized depth, row by row from the bottom of the screen
+	const std::vector<float>& getDepth() const;
+	unsigned int getWidth() const;
+	unsigned int getHeight() const;
+};
+
+#endif
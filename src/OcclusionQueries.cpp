@@ -0,0 +1,165 @@
+#include "OcclusionQueries.h"
+#include "ShaderProgram.h"
+#include "Bounds.h"
+#include "GLExtensions.h"
+#include "GLState.h"
+#include "RenderQueue.h"
+
+#include <glad/glad.h>
+#include <glm/glm.hpp>
+#include <glm/gtc/matrix_transform.hpp>
+
+#include <vector>
+
+// the corners of the unit box, corner i is at -1 or 1 depending on bits 0, 1 and 2 of i
+const float BOX_VERTICES[] = {
+    -1.0f, -1.0f, -1.0f,   1.0f, -1.0f, -1.0f,  -1.0f,  1.0f, -1.0f,   1.0f,  1.0f, -1.0f,
+    -1.0f, -1.0f,  1.0f,   1.0f, -1.0f,  1.0f,  -1.0f,  1.0f,  1.0f,   1.0f,  1.0f,  1.0f,
+};
+
+// counter clockwise seen from outside
+const unsigned char BOX_INDICES[] = {
+    0, 6, 2, 0, 4, 6,   1, 3, 7, 1, 7, 5,
+    0, 1, 5, 0, 5, 4,   2, 7, 3, 2, 6, 7,
+    0, 3, 1, 0, 2, 3,   4, 5, 7, 4, 7, 6,
+};
+
+// a camera this close to a box could have the box's faces cut off by the near plane
+const float NEAR_MARGIN = 0.2f;
+
+OcclusionQueries::OcclusionQueries(const ShaderProgram* boxShader, unsigned int visibleInterval)
+    : m_boxShader{ boxShader }, m_visibleInterval{ visibleInterval > 0 ? visibleInterval : 1 },
+      m_cameraPosition{ 0.0f }, m_frame{ 0 }, m_queriesIssued{ 0 } {
+    // a conservative query is allowed to count samples that a precise one would not, never fewer
+    m_queryTarget = GLExtensions::supportsConservativeOcclusionQueries() ? GL_ANY_SAMPLES_PASSED_CONSERVATIVE
+                                                                         : GL_ANY_SAMPLES_PASSED;
+
+    glGenVertexArrays(1, &m_vertexArrayID);
+    GLState::bindVertexArray(m_vertexArrayID);
+    glGenBuffers(1, &m_vertexBufferID);
+    GLState::bindBuffer(GL_ARRAY_BUFFER, m_vertexBufferID);
+    glBufferData(GL_ARRAY_BUFFER, sizeof(BOX_VERTICES), BOX_VERTICES, GL_STATIC_DRAW);
+    glGenBuffers(1, &m_indexBufferID);
+    GLState::bindBuffer(GL_ELEMENT_ARRAY_BUFFER, m_indexBufferID);
+    glBufferData(GL_ELEMENT_ARRAY_BUFFER, sizeof(BOX_INDICES), BOX_INDICES, GL_STATIC_DRAW);
+    glEnableVertexAttribArray(0);
+    glVertexAttribPointer(0, 3, GL_FLOAT, false, 3 * sizeof(float), nullptr);
+    GLState::bindVertexArray(0);
+    GLState::bindBuffer(GL_ARRAY_BUFFER, 0);
+}
+
+OcclusionQueries::~OcclusionQueries() {
+    for (const PendingQuery& pending : m_pending) {
+        m_freeQueries.push_back(pending.m_query);
+    }
+    if (!m_freeQueries.empty()) {
+        glDeleteQueries(static_cast<int>(m_freeQueries.size()), m_freeQueries.data());
+    }
+    GLState::forgetVertexArray(m_vertexArrayID);
+    GLState::forgetBuffer(m_vertexBufferID);
+    GLState::forgetBuffer(m_indexBufferID);
+    glDeleteVertexArrays(1, &m_vertexArrayID);
+    glDeleteBuffers(1, &m_vertexBufferID);
+    glDeleteBuffers(1, &m_indexBufferID);
+}
+
+unsigned int OcclusionQueries::addObject(const Bounds& worldBounds) {
+    // new objects are visible until a query says otherwise, and their first queries are spread over the frames
+    unsigned int object = static_cast<unsigned int>(m_objects.size());
+    m_objects.push_back({ worldBounds, 0, 0, m_frame + object % m_visibleInterval, true });
+    return object;
+}
+
+void OcclusionQueries::setBounds(unsigned int object, const Bounds& worldBounds) {
+    m_objects[object].m_bounds = worldBounds;
+}
+
+void OcclusionQueries::beginFrame(const glm::vec3& cameraPosition) {
+    ++m_frame;
+    m_cameraPosition = cameraPosition;
+    m_queriesIssued = 0;
+
+    // results arrive in the order the queries were issued, so stop at the first one that isn't there yet
+    while (!m_pending.empty()) {
+        const PendingQuery& pending = m_pending.front();
+        unsigned int available = 0;
+        glGetQueryObjectuiv(pending.m_query, GL_QUERY_RESULT_AVAILABLE, &available);
+        if (!available) {
+            break;
+        }
+        unsigned int samplesPassed = 0;
+        glGetQueryObjectuiv(pending.m_query, GL_QUERY_RESULT, &samplesPassed);
+        Object& object = m_objects[pending.m_object];
+        object.m_visible = samplesPassed != 0;
+        object.m_pendingQuery = 0;
+        object.m_nextQueryFrame = m_frame + m_visibleInterval;
+        m_freeQueries.push_back(pending.m_query);
+        m_pending.pop_front();
+    }
+}
+
+OcclusionResult OcclusionQueries::test(unsigned int object) {
+    Object& current = m_objects[object];
+    bool tested = current.m_lastTestFrame + 1 >= m_frame;
+    current.m_lastTestFrame = m_frame;
+    if (current.m_pendingQuery) {
+        return { true, current.m_pendingQuery };
+    }
+
+    // the box of an object around the camera is clipped and can't be queried
+    glm::vec3 offset = glm::abs(m_cameraPosition - current.m_bounds.m_center);
+    if (glm::all(glm::lessThanEqual(offset, current.m_bounds.m_extents + NEAR_MARGIN))) {
+        current.m_visible = true;
+        return { true, 0 };
+    }
+    if (!tested) {
+        current.m_visible = true;
+        current.m_nextQueryFrame = m_frame;
+    }
+    if (!current.m_visible || m_frame >= current.m_nextQueryFrame) {
+        m_queryQueue.push_back(object);
+    }
+    return { current.m_visible, 0 };
+}
+
+void OcclusionQueries::issueQueries() {
+    if (m_queryQueue.empty()) {
+        return;
+    }
+    GLState::setColorMask(false);
+    GLState::setDepthMask(false);
+    m_boxShader->bind();
+    GLState::bindVertexArray(m_vertexArrayID);
+    setPrimitiveRestart(GL_TRIANGLES, GL_UNSIGNED_BYTE);
+    for (unsigned int index : m_queryQueue) {
+        Object& object = m_objects[index];
+        unsigned int query;
+        if (m_freeQueries.empty()) {
+            glGenQueries(1, &query);
+        } else {
+            query = m_freeQueries.back();
+            m_freeQueries.pop_back();
+        }
+        glm::mat4 model = glm::scale(glm::translate(glm::mat4(1.0f), object.m_bounds.m_center),
+            object.m_bounds.m_extents);
+        m_boxShader->addUniformMat4f("u_model", model);
+        glBeginQuery(m_queryTarget, query);
+        glDrawElements(GL_TRIANGLES, sizeof(BOX_INDICES), GL_UNSIGNED_BYTE, nullptr);
+        glEndQuery(m_queryTarget);
+        object.m_pendingQuery = query;
+        m_pending.push_back({ query, index });
+    }
+    GLState::bindVertexArray(0);
+    GLState::setDepthMask(true);
+    GLState::setColorMask(true);
+    m_queriesIssued += static_cast<unsigned int>(m_queryQueue.size());
+    m_queryQueue.clear();
+}
+
+unsigned int OcclusionQueries::getQueriesIssued() const {
+    return m_queriesIssued;
+}
+
+unsigned int OcclusionQueries::getPendingQueries() const {
+    return static_cast<unsigned int>(m_pending.size());
+}
@@ -0,0 +1,78 @@
+#ifndef OCCLUSION_QUERIES_H_INCLUDED
+#define OCCLUSION_QUERIES_H_INCLUDED
+
+#include "ShaderProgram.h"
+#include "Bounds.h"
+
+#include <glm/glm.hpp>
+
+#include <deque>
+#include <vector>
+
+// what to do with an object this frame
+struct OcclusionResult {
+	bool m_draw;
+	unsigned int m_conditionQuery;  // if not 0, draw conditionally on this query (see Mesh::render)
+};
+
+// Occlusion culling on the GPU with occlusion queries on the bounding boxes of
+// objects, using temporal coherence like CHC++ (Mattausch et al.). Query results
+// are only read once they are available, so the CPU never waits for the GPU:
+//  - objects that were visible are drawn and tested again every few frames
+//    (spread over the frames, so not all of them are tested at once)
+//  - objects that were occluded are not drawn, but tested every frame
+//  - objects whose query is still in flight are drawn conditionally on it, so
+//    the GPU skips them if the query found the box occluded
+// Objects that weren't looked at in the last frame (for example because they
+// were frustum culled) are treated as visible, so they can't pop in late.
+//
+// The queries of a frame are issued together by issueQueries(), after the
+// visible objects were drawn, so the depth buffer contains the occluders.
+class OcclusionQueries {
+	struct Object {
+		Bounds m_bounds;
+		unsigned int m_pendingQuery;    // 0 if no query is in flight
+		unsigned int m_lastTestFrame;   // the last frame test() was called for the object
+		unsigned int m_nextQueryFrame;  // when a visible object is queried again
+		bool m_visible;                 // the last result
+	};
+
+	struct PendingQuery {
+		unsigned int m_query;
+		unsigned int m_object;
+	};
+
+	const ShaderProgram* m_boxShader;
+	unsigned int m_vertexArrayID;
+	unsigned int m_vertexBufferID;
+	unsigned int m_indexBufferID;
+	unsigned int m_queryTarget;
+	unsigned int m_visibleInterval;
+	std::vector<Object> m_objects;
+	std::deque<PendingQuery> m_pending;   // in the order they were issued, which is the order results arrive
+	std::vector<unsigned int> m_freeQueries;
+	std::vector<unsigned int> m_queryQueue;
+	glm::vec3 m_cameraPosition;
+	unsigned int m_frame;
+	unsigned int m_queriesIssued;
+
+public:
+	// the box shader draws positions at location 0 with u_model and the camera block
+	explicit OcclusionQueries(const ShaderProgram* boxShader, unsigned int visibleInterval = 8);
+	~OcclusionQueries();
+
+	unsigned int addObject(const Bounds& worldBounds);
+	void setBounds(unsigned int object, const Bounds& worldBounds);
+
+	// collects the results that are available without waiting
+	void beginFrame(const glm::vec3& cameraPosition);
+	// decides whether to draw the object and queues a query for it if it's due
+	OcclusionResult test(unsigned int object);
+	// draws the bounding boxes of the queued objects with color and depth writes off
+	void issueQueries();
+
+	unsigned int getQueriesIssued() const;
+	unsigned int getPendingQueries() const;
+};
+
+#endif
@@ -0,0 +1,133 @@
+#include "PageFile.h"
+#include "MipGenerator.h"
+
+#include <algorithm>
+#include <cstring>
+#include <filesystem>
+#include <fstream>
+#include <iostream>
+#include <string>
+#include <system_error>
+#include <vector>
+
+const unsigned int PAGE_FILE_VERSION = 1;
+
+// Like the mip cache, written as it is in memory and only read on the machine that made
+// it. The pages follow the header level by level, row by row.
+struct PageFileHeader {
+    char m_magic[4];
+    unsigned int m_version;
+    unsigned long long m_sourceSize;
+    long long m_sourceTime;
+    unsigned int m_pageSize;
+    unsigned int m_border;
+    unsigned int m_width;
+    unsigned int m_height;
+};
+
+static bool isSameSource(const PageFileHeader& a, const PageFileHeader& b) {
+    return std::memcmp(a.m_magic, b.m_magic, 4) == 0 && a.m_version == b.m_version
+        && a.m_sourceSize == b.m_sourceSize && a.m_sourceTime == b.m_sourceTime && a.m_pageSize == b.m_pageSize
+        && a.m_border == b.m_border;
+}
+
+static unsigned long long getPageOffset(const VirtualTextureLayout& layout, PageID page) {
+    unsigned long long index = 0;
+    unsigned int pagesX, pagesY;
+    for (unsigned int level = 0; level < getPageLevel(page); ++level) {
+        getPageCount(layout, level, pagesX, pagesY);
+        index += pagesX * pagesY;
+    }
+    getPageCount(layout, getPageLevel(page), pagesX, pagesY);
+    index += getPageY(page) * pagesX + getPageX(page);
+    return sizeof(PageFileHeader) + index * layout.m_pageSize * layout.m_pageSize * 4;
+}
+
+static bool writePageFile(const std::string& pagePath, const PageFileHeader& header, const MipChain& chain,
+    const VirtualTextureLayout& layout) {
+    std::ofstream file(pagePath, std::ios::binary);
+    file.write(reinterpret_cast<const char*>(&header), sizeof(header));
+    const unsigned int payload = getPagePayload(layout);
+    const int border = static_cast<int>(layout.m_border);
+    std::vector<unsigned char> texels(layout.m_pageSize * layout.m_pageSize * 4);
+    for (unsigned int level = 0; level < layout.m_levels; ++level) {
+        unsigned int sourceLevel = std::min(level, static_cast<unsigned int>(chain.m_levels.size()) - 1);
+        const int width = static_cast<int>(std::max(1u, chain.m_width >> sourceLevel));
+        const int height = static_cast<int>(std::max(1u, chain.m_height >> sourceLevel));
+        const unsigned char* pixels = chain.m_levels[sourceLevel].data();
+        unsigned int pagesX, pagesY;
+        getPageCount(layout, level, pagesX, pagesY);
+        for (unsigned int pageY = 0; pageY < pagesY; ++pageY) {
+            for (unsigned int pageX = 0; pageX < pagesX; ++pageX) {
+                for (unsigned int y = 0; y < layout.m_pageSize; ++y) {
+                    int sourceY = std::min(std::max(static_cast<int>(pageY * payload + y) - border, 0), height - 1);
+                    for (unsigned int x = 0; x < layout.m_pageSize; ++x) {
+                        int sourceX = std::min(std::max(static_cast<int>(pageX * payload + x) - border, 0),
+                            width - 1);
+                        std::memcpy(&texels[(y * layout.m_pageSize + x) * 4], &pixels[(sourceY * width + sourceX) * 4],
+                            4);
+                    }
+                }
+                file.write(reinterpret_cast<const char*>(texels.data()), texels.size());
+            }
+        }
+    }
+    if (!file) {
+        std::cerr << "Failed to write " << pagePath << '\n';
+        return false;
+    }
+    return true;
+}
+
+bool loadPageFile(const std::string& imagePath, unsigned int pageSize, unsigned int border,
+    VirtualTextureLayout& layout, JobSystem* jobs) {
+    PageFileHeader key;
+    std::memset(&key, 0, sizeof(key));
+    std::memcpy(key.m_magic, "PAGE", 4);
+    key.m_version = PAGE_FILE_VERSION;
+    key.m_pageSize = pageSize;
+    key.m_border = border;
+    std::error_code error;
+    key.m_sourceSize = std::filesystem::file_size(imagePath, error);
+    if (!error) {
+        key.m_sourceTime = std::filesystem::last_write_time(imagePath, error).time_since_epoch().count();
+    }
+    if (error) {
+        return false;
+    }
+    const std::string pagePath = getPageFilePath(imagePath);
+    {
+        std::ifstream file(pagePath, std::ios::binary);
+        PageFileHeader header;
+        if (file.read(reinterpret_cast<char*>(&header), sizeof(header)) && isSameSource(header, key)) {
+            return computeVirtualTextureLayout(header.m_width, header.m_height, pageSize, border, layout);
+        }
+    }
+
+    MipChain chain;
+    if (!loadMipChain(imagePath, MIP_FILTER_KAISER, true, chain, jobs)) {
+        return false;
+    }
+    if (!computeVirtualTextureLayout(chain.m_width, chain.m_height, pageSize, border, layout)) {
+        std::cerr << imagePath << " is too large for a virtual texture with " << pageSize << " texel pages\n";
+        return false;
+    }
+    key.m_width = chain.m_width;
+    key.m_height = chain.m_height;
+    return writePageFile(pagePath, key, chain, layout);
+}
+
+std::string getPageFilePath(const std::string& imagePath) {
+    return imagePath + ".pages";
+}
+
+bool readPage(std::ifstream& file, const VirtualTextureLayout& layout, PageID page,
+    std::vector<unsigned char>& texels) {
+    if (!isValidPage(layout, page)) {
+        return false;
+    }
+    texels.resize(layout.m_pageSize * layout.m_pageSize * 4);
+    file.clear();
+    file.seekg(static_cast<std::streamoff>(getPageOffset(layout, page)));
+    return static_cast<bool>(file.read(reinterpret_cast<char*>(texels.data()), texels.size()));
+}
@@ -0,0 +1,25 @@
+#ifndef PAGE_FILE_H_INCLUDED
+#define PAGE_FILE_H_INCLUDED
+
+#include "VirtualPages.h"
+
+#include <fstream>
+#include <string>
+#include <vector>
+
+class JobSystem;
+
+// Makes the page file of an image (getPageFilePath()) from its mip chain (see
+// loadMipChain()), unless it was already made from the same file with the same page
+// size. It holds every page of every level, pageSize x pageSize RGBA texels with the
+// border taken from the texels around the page (repeating the edges of the level).
+// false if the image can't be loaded or doesn't fit the page table.
+bool loadPageFile(const std::string& imagePath, unsigned int pageSize, unsigned int border,
+	VirtualTextureLayout& layout, JobSystem* jobs = nullptr);
+std::string getPageFilePath(const std::string& imagePath);
+
+// reads one page, every thread that reads pages needs its own stream
+bool readPage(std::ifstream& file, const VirtualTextureLayout& layout, PageID page,
+	std::vector<unsigned char>& texels);
+
+#endif
@@ -0,0 +1,104 @@
+#include "RangeAllocator.h"
+
+#include <algorithm>
+#include <iterator>
+#include <vector>
+
+RangeAllocator::RangeAllocator() : m_end{ 0 } {}
+
+unsigned int RangeAllocator::allocate(unsigned int count) {
+    // use the first hole that is large enough, otherwise append at the end
+    GeometryRange range = { m_end, count };
+    auto hole = std::find_if(m_freeRanges.begin(), m_freeRanges.end(), [count](const GeometryRange& free) {
+        return free.m_count >= count;
+    });
+    if (hole != m_freeRanges.end()) {
+        range.m_first = hole->m_first;
+        hole->m_first += count;
+        hole->m_count -= count;
+        if (hole->m_count == 0) {
+            m_freeRanges.erase(hole);
+        }
+    } else {
+        m_end += count;
+    }
+
+    if (m_unusedHandles.empty()) {
+        m_handles.push_back(range);
+        return static_cast<unsigned int>(m_handles.size() - 1);
+    }
+    unsigned int handle = m_unusedHandles.back();
+    m_unusedHandles.pop_back();
+    m_handles[handle] = range;
+    return handle;
+}
+
+void RangeAllocator::free(unsigned int handle) {
+    GeometryRange range = m_handles[handle];
+    m_handles[handle].m_count = 0;
+    m_unusedHandles.push_back(handle);
+
+    // insert the range into the sorted free list, merging it with its neighbors
+    auto next = std::lower_bound(m_freeRanges.begin(), m_freeRanges.end(), range,
+        [](const GeometryRange& a, const GeometryRange& b) { return a.m_first < b.m_first; });
+    if (next != m_freeRanges.end() && range.m_first + range.m_count == next->m_first) {
+        range.m_count += next->m_count;
+        next = m_freeRanges.erase(next);
+    }
+    if (next != m_freeRanges.begin()) {
+        auto previous = std::prev(next);
+        if (previous->m_first + previous->m_count == range.m_first) {
+            range.m_first = previous->m_first;
+            range.m_count += previous->m_count;
+            next = m_freeRanges.erase(previous);
+        }
+    }
+
+    // a hole at the end is not a hole
+    if (range.m_first + range.m_count == m_end) {
+        m_end = range.m_first;
+    } else {
+        m_freeRanges.insert(next, range);
+    }
+}
+
+const GeometryRange& RangeAllocator::get(unsigned int handle) const {
+    return m_handles[handle];
+}
+
+unsigned int RangeAllocator::getEnd() const {
+    return m_end;
+}
+
+unsigned int RangeAllocator::getUsed() const {
+    unsigned int holes = 0;
+    for (const GeometryRange& range : m_freeRanges) {
+        holes += range.m_count;
+    }
+    return m_end - holes;
+}
+
+std::vector<RangeAllocator::Move> RangeAllocator::compact() {
+    // pack the live ranges in their current order
+    std::vector<unsigned int> order;
+    for (unsigned int handle = 0; handle < m_handles.size(); ++handle) {
+        if (m_handles[handle].m_count > 0) {
+            order.push_back(handle);
+        }
+    }
+    std::sort(order.begin(), order.end(), [this](unsigned int a, unsigned int b) {
+        return m_handles[a].m_first < m_handles[b].m_first;
+    });
+
+    std::vector<Move> moves;
+    unsigned int end = 0;
+    for (unsigned int handle : order) {
+        GeometryRange& range = m_handles[handle];
+        moves.push_back({ range.m_first, end, range.m_count });
+        range.m_first = end;
+        end += range.m_count;
+    }
+    m_freeRanges.clear();
+    m_end = end;
+    return moves;
+}
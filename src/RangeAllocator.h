@@ -0,0 +1,38 @@
+#ifndef RANGE_ALLOCATOR_H_INCLUDED
+#define RANGE_ALLOCATOR_H_INCLUDED
+
+#include <vector>
+
+// where an allocation currently lives inside an arena buffer (in elements, not bytes)
+struct GeometryRange {
+	unsigned int m_first;
+	unsigned int m_count;
+};
+
+// First-fit allocator of element ranges inside one buffer, the bookkeeping of a
+// GeometryArena (which moves the data), so it runs without a context.
+class RangeAllocator {
+	std::vector<GeometryRange> m_freeRanges;   // sorted by m_first, never adjacent to each other
+	std::vector<GeometryRange> m_handles;      // m_count == 0 for unused handles
+	std::vector<unsigned int> m_unusedHandles;
+	unsigned int m_end;                        // one past the last allocated element
+
+public:
+	struct Move {
+		unsigned int m_from;
+		unsigned int m_to;
+		unsigned int m_count;
+	};
+
+	RangeAllocator();
+	unsigned int allocate(unsigned int count);
+	void free(unsigned int handle);
+	const GeometryRange& get(unsigned int handle) const;
+	unsigned int getEnd() const;
+	unsigned int getUsed() const;
+	// Packs the allocations in their current order, the moves are sorted by m_from and
+	// m_to never comes after m_from. The buffer must be moved along.
+	std::vector<Move> compact();
+};
+
+#endif
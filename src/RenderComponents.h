@@ -0,0 +1,51 @@
+#ifndef RENDER_COMPONENTS_H_INCLUDED
+#define RENDER_COMPONENTS_H_INCLUDED
+
+#include "Bounds.h"
+
+#include <glm/glm.hpp>
+#include <glm/gtc/quaternion.hpp>
+
+class Mesh;
+
+// The components of renderable entities (see EntityRegistry and RenderSystems.h).
+// They are plain data, systems do all the work.
+
+struct TransformComponent {
+	glm::vec3 m_position;
+	glm::quat m_rotation;
+	glm::vec3 m_scale;
+	glm::mat4 m_world;
+	unsigned char m_dirty;      // set after changing the position, rotation or scale
+	unsigned char m_changed;    // m_world was recomputed in the last updateTransforms()
+};
+
+struct MeshComponent {
+	const Mesh* m_mesh;
+};
+
+struct MaterialComponent {
+	unsigned int m_material;    // index into the material colors of the batched shader
+};
+
+struct BoundsComponent {
+	Bounds m_local;
+	Bounds m_world;
+	unsigned char m_changed;    // m_world was recomputed in the last updateBounds()
+};
+
+struct LightComponent {
+	glm::vec3 m_color;
+	float m_radius;
+};
+
+inline TransformComponent makeTransform(const glm::vec3& position, const glm::quat& rotation = glm::quat(1.0f,
+	0.0f, 0.0f, 0.0f), const glm::vec3& scale = glm::vec3(1.0f)) {
+	return { position, rotation, scale, glm::mat4(1.0f), 1, 0 };
+}
+
+inline BoundsComponent makeBounds(const Bounds& local) {
+	return { local, local, 1 };
+}
+
+#endif
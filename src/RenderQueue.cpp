@@ -0,0 +1,143 @@
+#include "RenderQueue.h"
+#include "ShaderProgram.h"
+#include "Texture.h"
+#include "GLState.h"
+#include "GeometryArena.h"
+
+#include <glad/glad.h>
+#include <glm/glm.hpp>
+
+#include <algorithm>
+#include <cstring>
+#include <vector>
+
+// layout of the 64 bit sort key (most significant bits first):
+//   opaque:      [translucent:1][program:14][material:14][vertex array:14][depth:21]
+//   translucent: [translucent:1][inverted depth:21][program:14][material:14][vertex array:14]
+// opaque draws are grouped by state and drawn front to back within a group,
+// translucent draws must be drawn back to front regardless of state
+const unsigned long long ID_BITS = 14;
+const unsigned long long DEPTH_BITS = 21;
+const unsigned long long ID_MASK = (1ull << ID_BITS) - 1;
+const unsigned long long DEPTH_MASK = (1ull << DEPTH_BITS) - 1;
+
+// positive floats compare the same way as their bit patterns do, so the top
+// bits of the float are a cheap order-preserving quantization of the depth
+static unsigned long long quantizeDepth(float depth) {
+    depth = std::max(depth, 0.0f);
+    unsigned int bits;
+    std::memcpy(&bits, &depth, sizeof(float));
+    return (bits >> (32 - DEPTH_BITS)) & DEPTH_MASK;
+}
+
+static unsigned int getMaterialID(const DrawPacket& packet) {
+    if (!packet.m_textures || packet.m_textures->empty()) {
+        return 0;
+    }
+    return packet.m_textures->front()->getID();
+}
+
+static bool sameTextures(const DrawPacket& a, const DrawPacket& b) {
+    if (a.m_textures == b.m_textures) {
+        return true;
+    }
+    if (!a.m_textures || !b.m_textures) {
+        return false;
+    }
+    return *a.m_textures == *b.m_textures;
+}
+
+void setPrimitiveRestart(unsigned int primitive, unsigned int indexType) {
+    // strips are separated by restart indices, lists may contain that value as a real index
+    bool strips = primitive == GL_TRIANGLE_STRIP;
+    GLState::setCapability(GL_PRIMITIVE_RESTART, strips);
+    if (strips) {
+        GLState::setPrimitiveRestartIndex(getRestartIndex(indexType));
+    }
+}
+
+RenderQueue::RenderQueue() : m_view{ 1.0f }, m_stateChanges{ 0 } {}
+
+void RenderQueue::setViewMatrix(const glm::mat4& view) {
+    m_view = view;
+}
+
+void RenderQueue::submit(const DrawPacket& packet) {
+    m_packets.push_back(packet);
+    DrawPacket& added = m_packets.back();
+
+    // the camera looks down the negative z axis in view space
+    glm::vec4 viewPos = m_view * added.m_model[3];
+    added.m_depth = -viewPos.z;
+}
+
+unsigned long long RenderQueue::makeSortKey(const DrawPacket& packet) const {
+    unsigned long long program = packet.m_shader->getID() & ID_MASK;
+    unsigned long long material = getMaterialID(packet) & ID_MASK;
+    unsigned long long vertexArray = packet.m_vertexArrayID & ID_MASK;
+    unsigned long long depth = quantizeDepth(packet.m_depth);
+    unsigned long long state = (program << (2 * ID_BITS)) | (material << ID_BITS) | vertexArray;
+
+    if (packet.m_translucent) {
+        return (1ull << 63) | ((DEPTH_MASK - depth) << (3 * ID_BITS)) | state;
+    }
+    return (state << DEPTH_BITS) | depth;
+}
+
+void RenderQueue::flush() {
+    m_sortEntries.clear();
+    m_sortEntries.reserve(m_packets.size());
+    for (unsigned int i = 0; i < m_packets.size(); ++i) {
+        m_sortEntries.push_back({ makeSortKey(m_packets[i]), i });
+    }
+    std::sort(m_sortEntries.begin(), m_sortEntries.end(), [](const SortEntry& a, const SortEntry& b) {
+        return a.m_key < b.m_key;
+    });
+
+    // only change the state that differs from the previous packet
+    m_stateChanges = 0;
+    const DrawPacket* previous = nullptr;
+    for (const SortEntry& entry : m_sortEntries) {
+        const DrawPacket& packet = m_packets[entry.m_packetIndex];
+        if (!previous || previous->m_shader != packet.m_shader) {
+            packet.m_shader->bind();
+            ++m_stateChanges;
+        }
+        if (!previous || previous->m_vertexArrayID != packet.m_vertexArrayID) {
+            GLState::bindVertexArray(packet.m_vertexArrayID);
+            ++m_stateChanges;
+        }
+        if (packet.m_textures && (!previous || !sameTextures(*previous, packet))) {
+            for (const Texture* texture : *packet.m_textures) {
+                texture->bind();
+            }
+            ++m_stateChanges;
+        }
+        setPrimitiveRestart(packet.m_primitive, packet.m_indexType);
+        const void* offsetPtr = reinterpret_cast<const void*>(packet.m_indexOffset);
+        if (packet.m_conditionQuery) {
+            // without waiting for the result, the draw is done if it's not there yet
+            glBeginConditionalRender(packet.m_conditionQuery, GL_QUERY_NO_WAIT);
+        }
+        if (packet.m_instanceCount > 0) {
+            // instanced submeshes read their model matrices from the instance buffer
+            glDrawElementsInstancedBaseVertex(packet.m_primitive, packet.m_indexCount, packet.m_indexType, offsetPtr,
+                packet.m_instanceCount, packet.m_baseVertex);
+        } else {
+            packet.m_shader->addUniformMat4f("u_model", packet.m_model);
+            glDrawElementsBaseVertex(packet.m_primitive, packet.m_indexCount, packet.m_indexType, offsetPtr,
+                packet.m_baseVertex);
+        }
+        if (packet.m_conditionQuery) {
+            glEndConditionalRender();
+        }
+        previous = &packet;
+    }
+    GLState::bindVertexArray(0);
+
+    m_packets.clear();
+}
+
+unsigned int RenderQueue::getStateChanges() const {
+    return m_stateChanges;
+}
\ No newline at end of file
@@ -0,0 +1,58 @@
+#ifndef RENDER_QUEUE_H_INCLUDED
+#define RENDER_QUEUE_H_INCLUDED
+
+#include "ShaderProgram.h"
+#include "Texture.h"
+
+#include <glm/glm.hpp>
+
+#include <vector>
+
+// Everything needed to issue one glDrawElements call. Meshes fill these in
+// instead of drawing immediately, and the RenderQueue submits them in an
+// order that minimizes the number of OpenGL state changes.
+struct DrawPacket {
+	unsigned int m_vertexArrayID;
+	unsigned int m_indexCount;
+	unsigned long long m_indexOffset;              // in bytes from the start of the index buffer
+	int m_baseVertex;                              // added to every index
+	unsigned int m_indexType;                      // GL_UNSIGNED_BYTE, GL_UNSIGNED_SHORT or GL_UNSIGNED_INT
+	unsigned int m_primitive;                      // GL_TRIANGLES or GL_TRIANGLE_STRIP
+	const ShaderProgram* m_shader;
+	const std::vector<const Texture*>* m_textures; // may be nullptr
+	glm::mat4 m_model;
+	float m_depth;                                 // view space distance, filled in by the queue
+	unsigned int m_instanceCount;                  // 0 for a regular (not instanced) draw
+	unsigned int m_conditionQuery;                 // drawn only if this occlusion query passed, 0 for always
+	bool m_translucent;
+};
+
+// enables primitive restart with the right restart index for strips, disables it otherwise
+void setPrimitiveRestart(unsigned int primitive, unsigned int indexType);
+
+class RenderQueue {
+
+	struct SortEntry {
+		unsigned long long m_key;
+		unsigned int m_packetIndex;
+	};
+
+	std::vector<DrawPacket> m_packets;
+	std::vector<SortEntry> m_sortEntries;
+	glm::mat4 m_view;
+	unsigned int m_stateChanges;
+
+public:
+	RenderQueue();
+
+	void setViewMatrix(const glm::mat4& view);
+	void submit(const DrawPacket& packet);
+	void flush();
+
+	unsigned int getStateChanges() const;
+
+private:
+	unsigned long long makeSortKey(const DrawPacket& packet) const;
+};
+
+#endif
\ No newline at end of file
@@ -0,0 +1,108 @@
+#include "RenderSystems.h"
+#include "RenderComponents.h"
+#include "Bounds.h"
+#include "JobSystem.h"
+
+#include <glm/glm.hpp>
+#include <glm/gtc/quaternion.hpp>
+
+#include <functional>
+#include <vector>
+
+glm::mat4 computeTransformMatrix(const TransformComponent& transform) {
+    // without multiplying the matrices
+    glm::mat3 rotation = glm::mat3_cast(transform.m_rotation);
+    return glm::mat4(glm::vec4(rotation[0] * transform.m_scale.x, 0.0f), glm::vec4(rotation[1] * transform.m_scale.y,
+        0.0f), glm::vec4(rotation[2] * transform.m_scale.z, 0.0f), glm::vec4(transform.m_position, 1.0f));
+}
+
+// components per job, enough that scheduling a job costs much less than its work
+const unsigned int SYSTEM_GRAIN_SIZE = 4096;
+
+static void forRanges(JobSystem* jobs, unsigned int count,
+    const std::function<void(unsigned int, unsigned int)>& function) {
+    if (jobs) {
+        jobs->parallelFor(count, SYSTEM_GRAIN_SIZE, function);
+    } else {
+        function(0, count);
+    }
+}
+
+void updateTransforms(EntityRegistry& registry, JobSystem* jobs) {
+    ComponentPool<TransformComponent>& pool = registry.getPool<TransformComponent>();
+    TransformComponent* transforms = pool.getComponents();
+    forRanges(jobs, pool.size(), [transforms](unsigned int begin, unsigned int end) {
+        for (unsigned int i = begin; i < end; ++i) {
+            TransformComponent& transform = transforms[i];
+            transform.m_changed = transform.m_dirty;
+            if (!transform.m_dirty) {
+                continue;
+            }
+            transform.m_dirty = 0;
+            transform.m_world = computeTransformMatrix(transform);
+        }
+    });
+}
+
+void updateBounds(EntityRegistry& registry, JobSystem* jobs) {
+    const ComponentPool<TransformComponent>& transforms = registry.getPool<TransformComponent>();
+    ComponentPool<BoundsComponent>& pool = registry.getPool<BoundsComponent>();
+    const Entity* entities = pool.getEntities();
+    BoundsComponent* bounds = pool.getComponents();
+    forRanges(jobs, pool.size(), [&transforms, entities, bounds](unsigned int begin, unsigned int end) {
+        for (unsigned int i = begin; i < end; ++i) {
+            bounds[i].m_changed = 0;
+            if (transforms.has(entities[i])) {
+                const TransformComponent& transform = transforms.get(entities[i]);
+                if (transform.m_changed) {
+                    bounds[i].m_world = transformBounds(bounds[i].m_local, transform.m_world);
+                    bounds[i].m_changed = 1;
+                }
+            }
+        }
+    });
+}
+
+void EntityCuller::update(const EntityRegistry& registry) {
+    const ComponentPool<BoundsComponent>& pool = registry.getPool<BoundsComponent>();
+    const Entity* entities = pool.getEntities();
+    const BoundsComponent* bounds = pool.getComponents();
+
+    // removing swaps the last bounds into the hole, so the same count with the same
+    // entities in the same places means nothing moved
+    bool same = m_entities.size() == pool.size();
+    for (unsigned int i = 0; same && i < pool.size(); ++i) {
+        same = m_entities[i] == entities[i];
+    }
+    if (!same) {
+        m_culler.clear();
+        m_entities.assign(entities, entities + pool.size());
+        for (unsigned int i = 0; i < pool.size(); ++i) {
+            m_culler.add(bounds[i].m_world);
+        }
+        return;
+    }
+    for (unsigned int i = 0; i < pool.size(); ++i) {
+        if (bounds[i].m_changed) {
+            m_culler.set(i, bounds[i].m_world);
+        }
+    }
+}
+
+void EntityCuller::cull(const Frustum& frustum, std::vector<Entity>& visible) {
+    m_visible.clear();
+    m_culler.cull(frustum, m_visible);
+    for (unsigned int i : m_visible) {
+        visible.push_back(m_entities[i]);
+    }
+}
+
+void gatherLights(const EntityRegistry& registry, std::vector<LightData>& lights) {
+    lights.clear();
+    const ComponentPool<TransformComponent>& transforms = registry.getPool<TransformComponent>();
+    registry.each<LightComponent>([&transforms, &lights](Entity entity, const LightComponent& light) {
+        if (transforms.has(entity)) {
+            lights.push_back({ glm::vec3(transforms.get(entity).m_world[3]), light.m_color, light.m_radius });
+        }
+    });
+}
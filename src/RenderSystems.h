@@ -0,0 +1,53 @@
+#ifndef RENDER_SYSTEMS_H_INCLUDED
+#define RENDER_SYSTEMS_H_INCLUDED
+
+#include "EntityRegistry.h"
+#include "Frustum.h"
+#include "ObjectCuller.h"
+
+#include <glm/glm.hpp>
+
+#include <vector>
+
+class JobSystem;
+
+// The systems that prepare renderable entities for a frame, in the order they run.
+// Each one walks the packed array of one component pool. With a job system the
+// transform and bounds updates are split into ranges of the pool that run as jobs.
+
+struct TransformComponent;
+
+// translation * rotation * scale
+glm::mat4 computeTransformMatrix(const TransformComponent& transform);
+
+// recomputes the world matrices of the transforms that are dirty
+void updateTransforms(EntityRegistry& registry, JobSystem* jobs = nullptr);
+
+// recomputes the world bounds of the entities whose transform changed
+void updateBounds(EntityRegistry& registry, JobSystem* jobs = nullptr);
+
+// Frustum culls all entities with bounds. The world bounds are copied into an
+// ObjectCuller, but only the ones that changed unless entities were added or removed.
+// Many entities also go into its BoundsTree, so a rebuild after adding or removing
+// entities costs more than the culling.
+class EntityCuller {
+	ObjectCuller m_culler;
+	std::vector<Entity> m_entities;     // the entity of every object in the culler
+	std::vector<unsigned int> m_visible;
+
+public:
+	void update(const EntityRegistry& registry);
+	// appends the visible entities, in the order of the bounds pool
+	void cull(const Frustum& frustum, std::vector<Entity>& visible);
+};
+
+struct LightData {
+	glm::vec3 m_position;
+	glm::vec3 m_color;
+	float m_radius;
+};
+
+// replaces lights with the position and color of every entity with a light
+void gatherLights(const EntityRegistry& registry, std::vector<LightData>& lights);
+
+#endif
@@ -0,0 +1,290 @@
+#include "SceneGraph.h"
+#include "JobSystem.h"
+
+#include <glm/glm.hpp>
+#include <glm/gtc/quaternion.hpp>
+
+#include <algorithm>
+#include <iostream>
+#include <vector>
+
+const unsigned int SceneGraph::NO_NODE;
+
+// subtrees with fewer nodes than this are never split up into more jobs
+const unsigned int MIN_TASK_NODES = 256;
+
+// keeps only the values at the indices in order, in that order
+template <typename T>
+static void permute(std::vector<T>& values, const std::vector<unsigned int>& order) {
+    std::vector<T> sorted;
+    sorted.reserve(order.size());
+    for (unsigned int index : order) {
+        sorted.push_back(values[index]);
+    }
+    values.swap(sorted);
+}
+
+SceneGraph::SceneGraph(JobSystem* jobs) : m_orderDirty{ false }, m_jobs{ jobs } {}
+
+unsigned int SceneGraph::createNode(unsigned int parent, const glm::vec3& position, const glm::quat& rotation,
+    const glm::vec3& scale) {
+    unsigned int handle;
+    if (m_freeHandles.empty()) {
+        handle = static_cast<unsigned int>(m_nodes.size());
+        m_nodes.push_back(NO_NODE);
+    } else {
+        handle = m_freeHandles.back();
+        m_freeHandles.pop_back();
+    }
+
+    // appending keeps parents before their children, but the subtree of the parent
+    // is only one range again once the nodes are sorted in the next update
+    unsigned int node = static_cast<unsigned int>(m_handles.size());
+    m_nodes[handle] = node;
+    m_parents.push_back(parent == NO_NODE ? NO_NODE : m_nodes[parent]);
+    m_subtreeEnds.push_back(node + 1);
+    m_positions.push_back(position);
+    m_rotations.push_back(rotation);
+    m_scales.push_back(scale);
+    m_dirty.push_back(1);
+    m_changed.push_back(0);
+    m_worldMatrices.emplace_back(1.0f);
+    m_handles.push_back(handle);
+    m_orderDirty = true;
+    return handle;
+}
+
+void SceneGraph::destroyNode(unsigned int handle) {
+    // the descendants are dropped when the nodes are sorted, they can't be reached from a root anymore
+    unsigned int node = m_nodes[handle];
+    m_handles[node] = NO_NODE;
+    m_nodes[handle] = NO_NODE;
+    m_freeHandles.push_back(handle);
+    m_orderDirty = true;
+}
+
+void SceneGraph::setParent(unsigned int handle, unsigned int parent) {
+    unsigned int node = m_nodes[handle];
+    unsigned int parentNode = parent == NO_NODE ? NO_NODE : m_nodes[parent];
+    for (unsigned int ancestor = parentNode; ancestor != NO_NODE; ancestor = m_parents[ancestor]) {
+        if (ancestor == node) {
+            std::cerr << "Scene graph node " << handle << " can't be a child of its own descendant " << parent << "\n";
+            return;
+        }
+    }
+    m_parents[node] = parentNode;
+    m_dirty[node] = 1;
+    m_orderDirty = true;
+}
+
+void SceneGraph::setPosition(unsigned int handle, const glm::vec3& position) {
+    unsigned int node = m_nodes[handle];
+    m_positions[node] = position;
+    m_dirty[node] = 1;
+}
+
+void SceneGraph::setRotation(unsigned int handle, const glm::quat& rotation) {
+    unsigned int node = m_nodes[handle];
+    m_rotations[node] = rotation;
+    m_dirty[node] = 1;
+}
+
+void SceneGraph::setScale(unsigned int handle, const glm::vec3& scale) {
+    unsigned int node = m_nodes[handle];
+    m_scales[node] = scale;
+    m_dirty[node] = 1;
+}
+
+const glm::vec3& SceneGraph::getPosition(unsigned int handle) const {
+    return m_positions[m_nodes[handle]];
+}
+
+const glm::quat& SceneGraph::getRotation(unsigned int handle) const {
+    return m_rotations[m_nodes[handle]];
+}
+
+const glm::vec3& SceneGraph::getScale(unsigned int handle) const {
+    return m_scales[m_nodes[handle]];
+}
+
+// Puts the nodes in depth first order (keeping the order of siblings) and drops the
+// destroyed ones together with their descendants
+void SceneGraph::sortNodes() {
+    const unsigned int count = static_cast<unsigned int>(m_handles.size());
+    std::vector<unsigned int> firstChild(count + 1, 0);
+    for (unsigned int i = 0; i < count; ++i) {
+        if (m_handles[i] != NO_NODE && m_parents[i] != NO_NODE) {
+            ++firstChild[m_parents[i] + 1];
+        }
+    }
+    for (unsigned int i = 0; i < count; ++i) {
+        firstChild[i + 1] += firstChild[i];
+    }
+    std::vector<unsigned int> children(firstChild[count]);
+    std::vector<unsigned int> filled(firstChild.begin(), firstChild.end() - 1);
+    for (unsigned int i = 0; i < count; ++i) {
+        if (m_handles[i] != NO_NODE && m_parents[i] != NO_NODE) {
+            children[filled[m_parents[i]]++] = i;
+        }
+    }
+
+    std::vector<unsigned int> order;
+    order.reserve(count);
+    std::vector<unsigned int> stack;
+    for (unsigned int root = 0; root < count; ++root) {
+        if (m_handles[root] == NO_NODE || m_parents[root] != NO_NODE) {
+            continue;
+        }
+        stack.push_back(root);
+        while (!stack.empty()) {
+            unsigned int node = stack.back();
+            stack.pop_back();
+            order.push_back(node);
+            for (unsigned int k = firstChild[node + 1]; k > firstChild[node]; --k) {
+                stack.push_back(children[k - 1]);
+            }
+        }
+    }
+
+    // the handles of the descendants of destroyed nodes are freed here
+    std::vector<unsigned int> newIndices(count, NO_NODE);
+    for (unsigned int i = 0; i < order.size(); ++i) {
+        newIndices[order[i]] = i;
+    }
+    for (unsigned int i = 0; i < count; ++i) {
+        if (newIndices[i] == NO_NODE && m_handles[i] != NO_NODE) {
+            m_nodes[m_handles[i]] = NO_NODE;
+            m_freeHandles.push_back(m_handles[i]);
+        }
+    }
+
+    permute(m_positions, order);
+    permute(m_rotations, order);
+    permute(m_scales, order);
+    permute(m_dirty, order);
+    permute(m_changed, order);
+    permute(m_worldMatrices, order);
+    permute(m_handles, order);
+    permute(m_parents, order);
+    const unsigned int sortedCount = static_cast<unsigned int>(order.size());
+    for (unsigned int i = 0; i < sortedCount; ++i) {
+        if (m_parents[i] != NO_NODE) {
+            m_parents[i] = newIndices[m_parents[i]];
+        }
+        m_nodes[m_handles[i]] = i;
+    }
+
+    // children come after their parent, so walking backwards finishes every subtree before its parent
+    m_subtreeEnds.assign(sortedCount, 0);
+    for (unsigned int i = sortedCount; i-- > 0;) {
+        m_subtreeEnds[i] = std::max(m_subtreeEnds[i], i + 1);
+        if (m_parents[i] != NO_NODE) {
+            m_subtreeEnds[m_parents[i]] = std::max(m_subtreeEnds[m_parents[i]], m_subtreeEnds[i]);
+        }
+    }
+    m_orderDirty = false;
+}
+
+// Starts with one task per root. The biggest task is split into its root node, which
+// is updated before the tasks, and one task per child, until all tasks are small
+// enough to be spread over the threads of the job system evenly.
+void SceneGraph::splitIntoTasks() {
+    m_serialNodes.clear();
+    m_tasks.clear();
+    const unsigned int count = static_cast<unsigned int>(m_handles.size());
+    for (unsigned int root = 0; root < count; root = m_subtreeEnds[root]) {
+        m_tasks.push_back(root);
+    }
+    const unsigned int threadCount = m_jobs ? m_jobs->getThreadCount() : 1;
+    const unsigned int maxTaskNodes = std::max(MIN_TASK_NODES, count / (threadCount * 4));
+    while (threadCount > 1) {
+        auto biggest = std::max_element(m_tasks.begin(), m_tasks.end(), [this](unsigned int a, unsigned int b) {
+            return m_subtreeEnds[a] - a < m_subtreeEnds[b] - b;
+        });
+        if (biggest == m_tasks.end() || m_subtreeEnds[*biggest] - *biggest <= maxTaskNodes) {
+            break;
+        }
+        unsigned int node = *biggest;
+        m_tasks.erase(biggest);
+        m_serialNodes.push_back(node);
+        for (unsigned int child = node + 1; child < m_subtreeEnds[node]; child = m_subtreeEnds[child]) {
+            m_tasks.push_back(child);
+        }
+    }
+    std::sort(m_serialNodes.begin(), m_serialNodes.end());
+    std::sort(m_tasks.begin(), m_tasks.end());
+}
+
+void SceneGraph::updateNode(unsigned int node) {
+    unsigned int parent = m_parents[node];
+    bool changed = m_dirty[node] || (parent != NO_NODE && m_changed[parent]);
+    m_changed[node] = changed ? 1 : 0;
+    if (!changed) {
+        return;
+    }
+    m_dirty[node] = 0;
+
+    // translation * rotation * scale, without multiplying the matrices
+    glm::mat3 rotation = glm::mat3_cast(m_rotations[node]);
+    const glm::vec3& scale = m_scales[node];
+    glm::mat4 local(glm::vec4(rotation[0] * scale.x, 0.0f), glm::vec4(rotation[1] * scale.y, 0.0f),
+        glm::vec4(rotation[2] * scale.z, 0.0f), glm::vec4(m_positions[node], 1.0f));
+    m_worldMatrices[node] = parent == NO_NODE ? local : m_worldMatrices[parent] * local;
+}
+
+void SceneGraph::updateTasks() {
+    for (unsigned int node : m_serialNodes) {
+        updateNode(node);
+    }
+
+    // one job per task, the calling thread works on them too while it waits
+    JobCounter counter;
+    for (unsigned int task : m_tasks) {
+        m_jobs->run([this, task]() {
+            for (unsigned int node = task; node < m_subtreeEnds[task]; ++node) {
+                updateNode(node);
+            }
+        }, &counter);
+    }
+    m_jobs->wait(counter);
+}
+
+void SceneGraph::update() {
+    if (m_orderDirty) {
+        sortNodes();
+        splitIntoTasks();
+    }
+    if (!m_jobs || m_jobs->getThreadCount() == 1) {
+        for (unsigned int node = 0; node < m_handles.size(); ++node) {
+            updateNode(node);
+        }
+    } else {
+        updateTasks();
+    }
+}
+
+const glm::mat4& SceneGraph::getWorldMatrix(unsigned int handle) const {
+    return m_worldMatrices[m_nodes[handle]];
+}
+
+bool SceneGraph::hasChanged(unsigned int handle) const {
+    return m_changed[m_nodes[handle]] != 0;
+}
+
+const glm::mat4* SceneGraph::getWorldMatrices() const {
+    return m_worldMatrices.data();
+}
+
+unsigned int SceneGraph::getNode(unsigned int handle) const {
+    return m_nodes[handle];
+}
+
+unsigned int SceneGraph::getNodeCount() const {
+    return static_cast<unsigned int>(m_handles.size());
+}
+
+void SceneGraph::setJobSystem(JobSystem* jobs) {
+    m_jobs = jobs;
+    // the tasks are split up again for the new number of threads
+    m_orderDirty = true;
+}
@@ -0,0 +1,85 @@
+#ifndef SCENE_GRAPH_H_INCLUDED
+#define SCENE_GRAPH_H_INCLUDED
+
+#include <glm/glm.hpp>
+#include <glm/gtc/quaternion.hpp>
+
+#include <vector>
+
+class JobSystem;
+
+// A transform hierarchy. The local position, rotation and scale of the nodes are
+// stored as a structure of arrays, sorted depth first, so parents come before their
+// children and every subtree is one contiguous range. update() walks the arrays once
+// and only recomputes the world matrices of changed nodes and their descendants.
+// Subtrees that don't depend on each other are updated as separate jobs.
+//
+// Nodes are referred to by handles, which stay the same when the nodes are sorted
+// again after the hierarchy changed. The world matrices are stored in node order in
+// one array, so they can be uploaded to the GPU with one copy.
+class SceneGraph {
+public:
+	static const unsigned int NO_NODE = 0xFFFFFFFF;
+
+private:
+	// indexed by node, in depth first order
+	std::vector<unsigned int> m_parents;        // index of the parent, NO_NODE for roots
+	std::vector<unsigned int> m_subtreeEnds;    // one past the last node of the subtree
+	std::vector<glm::vec3> m_positions;
+	std::vector<glm::quat> m_rotations;
+	std::vector<glm::vec3> m_scales;
+	std::vector<unsigned char> m_dirty;         // the local transform changed since the last update
+	std::vector<unsigned char> m_changed;       // the world matrix was recomputed in the last update
+	std::vector<glm::mat4> m_worldMatrices;
+	std::vector<unsigned int> m_handles;        // the handle of every node
+
+	std::vector<unsigned int> m_nodes;          // the node of every handle, NO_NODE if it's free
+	std::vector<unsigned int> m_freeHandles;
+	bool m_orderDirty;                          // nodes were added, removed or moved to another parent
+
+	// nodes updated before the tasks, then subtrees that can be updated in parallel
+	std::vector<unsigned int> m_serialNodes;
+	std::vector<unsigned int> m_tasks;
+	JobSystem* m_jobs;
+
+	void sortNodes();
+	void splitIntoTasks();
+	void updateNode(unsigned int node);
+	void updateTasks();
+
+public:
+	// without a job system all nodes are updated on the calling thread
+	explicit SceneGraph(JobSystem* jobs = nullptr);
+
+	// returns the handle of the new node, parent is a handle or NO_NODE for a root
+	unsigned int createNode(unsigned int parent = NO_NODE, const glm::vec3& position = glm::vec3(0.0f),
+		const glm::quat& rotation = glm::quat(1.0f, 0.0f, 0.0f, 0.0f), const glm::vec3& scale = glm::vec3(1.0f));
+	// removes the node and all of its descendants
+	void destroyNode(unsigned int handle);
+	// keeps the node's local transform, so it moves with its new parent
+	void setParent(unsigned int handle, unsigned int parent);
+
+	void setPosition(unsigned int handle, const glm::vec3& position);
+	void setRotation(unsigned int handle, const glm::quat& rotation);
+	void setScale(unsigned int handle, const glm::vec3& scale);
+	const glm::vec3& getPosition(unsigned int handle) const;
+	const glm::quat& getRotation(unsigned int handle) const;
+	const glm::vec3& getScale(unsigned int handle) const;
+
+	// recomputes the world matrices of changed nodes and their descendants
+	void update();
+
+	// valid after update()
+	const glm::mat4& getWorldMatrix(unsigned int handle) const;
+	// true if the world matrix was recomputed by the last update()
+	bool hasChanged(unsigned int handle) const;
+	// all world matrices in node order, see getNode()
+	const glm::mat4* getWorldMatrices() const;
+	// the index of the node in getWorldMatrices(), changes when the hierarchy changes
+	unsigned int getNode(unsigned int handle) const;
+	unsigned int getNodeCount() const;
+
+	void setJobSystem(JobSystem* jobs);
+};
+
+#endif
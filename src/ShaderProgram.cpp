@@ -1,5 +1,7 @@
 #include "ShaderProgram.h"
 #include "Texture.h"
+#include "TextureArray.h"
+#include "GLState.h"
 
 #include <glad/glad.h>
 #include <glm/glm.hpp>
@@ -27,6 +29,7 @@ ShaderProgram::ShaderProgram(const std::string& vertexFilePath, const std::strin
 }
 
 ShaderProgram::~ShaderProgram() {
+    GLState::forgetProgram(m_shaderProgramID);
     glDeleteProgram(m_shaderProgramID);
 }
 
@@ -51,11 +54,13 @@ void ShaderProgram::compileAndLink() const {
 
     glLinkProgram(m_shaderProgramID);
 
-    // make sure the shader program linked successfully
-    glValidateProgram(m_shaderProgramID);
-    glGetProgramiv(m_shaderProgramID, GL_VALIDATE_STATUS, &success);
+    // make sure the shader program linked successfully. glValidateProgram() would also check
+    // the current state, where samplers of different types still share unit 0 until they are set
+    glGetProgramiv(m_shaderProgramID, GL_LINK_STATUS, &success);
     if (!success) {
-        std::cerr << "Shader Program Linking Failed\n";
+        char infoLog[512] = { 0 };
+        glGetProgramInfoLog(m_shaderProgramID, 512, nullptr, infoLog);
+        std::cerr << "Shader Program Linking Failed\n" << infoLog << '\n';
     }
 }
 
@@ -74,11 +79,15 @@ std::string ShaderProgram::parseShader(const std::string& filePath) const {
 }
 
 void ShaderProgram::bind() const {
-    glUseProgram(m_shaderProgramID);
+    GLState::useProgram(m_shaderProgramID);
 }
 
 void ShaderProgram::unbind() const {
-    glUseProgram(0);
+    GLState::useProgram(0);
+}
+
+unsigned int ShaderProgram::getID() const {
+    return m_shaderProgramID;
 }
 
 void ShaderProgram::addTexture(const Texture* texture, const std::string& name) {
@@ -87,37 +96,52 @@ void ShaderProgram::addTexture(const Texture* texture, const std::string& name)
     addUniform1i(name, texture->getSlot());
 }
 
-void ShaderProgram::addUniform1f(const std::string& name, float v0) {
+void ShaderProgram::addTexture(const TextureArray* textures, const std::string& name) {
+    bind();
+    textures->bind();
+    addUniform1i(name, textures->getSlot());
+}
+
+void ShaderProgram::bindUniformBlock(const std::string& name, unsigned int binding) const {
+    unsigned int blockIndex = glGetUniformBlockIndex(m_shaderProgramID, name.c_str());
+    if (blockIndex == GL_INVALID_INDEX) {
+        std::cerr << "The Uniform Block " + name + " does not exist!\n";
+        return;
+    }
+    glUniformBlockBinding(m_shaderProgramID, blockIndex, binding);
+}
+
+void ShaderProgram::addUniform1f(const std::string& name, float v0) const {
     bind();
     glUniform1f(getUniformLocation(name), v0);
 }
 
-void ShaderProgram::addUniform2f(const std::string& name, float v0, float v1) {
+void ShaderProgram::addUniform2f(const std::string& name, float v0, float v1) const {
     bind();
     glUniform2f(getUniformLocation(name), v0, v1);
 }
 
-void ShaderProgram::addUniform3f(const std::string& name, float v0, float v1, float v2) {
+void ShaderProgram::addUniform3f(const std::string& name, float v0, float v1, float v2) const {
     bind();
     glUniform3f(getUniformLocation(name), v0, v1, v2);
 }
 
-void ShaderProgram::addUniform4f(const std::string& name, float v0, float v1, float v2, float v3) {
+void ShaderProgram::addUniform4f(const std::string& name, float v0, float v1, float v2, float v3) const {
     bind();
     glUniform4f(getUniformLocation(name), v0, v1, v2, v3);
 }
 
-void ShaderProgram::addUniform1i(const std::string& name, int value) {
+void ShaderProgram::addUniform1i(const std::string& name, int value) const {
     bind();
     glUniform1i(getUniformLocation(name), value);
 }
 
-void ShaderProgram::addUniformMat4f(const std::string& name, const glm::mat4& matrix) {
+void ShaderProgram::addUniformMat4f(const std::string& name, const glm::mat4& matrix) const {
     bind();
     glUniformMatrix4fv(getUniformLocation(name), 1, GL_FALSE, glm::value_ptr(matrix));
 }
 
-int ShaderProgram::getUniformLocation(const std::string& name) {
+int ShaderProgram::getUniformLocation(const std::string& name) const {
     auto cachedLocation = m_uniformLocationCache.find(name);
     if (cachedLocation != m_uniformLocationCache.end()) {
         return cachedLocation->second;
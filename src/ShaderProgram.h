@@ -9,6 +9,8 @@
 #include <vector>
 #include <unordered_map>
 
+class TextureArray;
+
 class ShaderProgram {
 
 	struct Shader {
@@ -19,7 +21,7 @@ class ShaderProgram {
 
 	std::vector<Shader> m_shaders;
 	unsigned int m_shaderProgramID;
-	std::unordered_map<std::string, int> m_uniformLocationCache;
+	mutable std::unordered_map<std::string, int> m_uniformLocationCache;
 
 public:
 	ShaderProgram(const std::string& vertexFilePath, const std::string& fragmentFilePath);
@@ -27,19 +29,22 @@ public:
 
 	void bind() const;
 	void unbind() const;
+	unsigned int getID() const;
 	void addTexture(const Texture* texture, const std::string& name);
+	void addTexture(const TextureArray* textures, const std::string& name);
+	void bindUniformBlock(const std::string& name, unsigned int binding) const;
 
-	void addUniform1f(const std::string& name, float v0);
-	void addUniform2f(const std::string& name, float v0, float v1);
-	void addUniform3f(const std::string& name, float v0, float v1, float v2);
-	void addUniform4f(const std::string& name, float v0, float v1, float v2, float v3);
-	void addUniform1i(const std::string& name, int value);
-	void addUniformMat4f(const std::string& name, const glm::mat4& matrix);
+	void addUniform1f(const std::string& name, float v0) const;
+	void addUniform2f(const std::string& name, float v0, float v1) const;
+	void addUniform3f(const std::string& name, float v0, float v1, float v2) const;
+	void addUniform4f(const std::string& name, float v0, float v1, float v2, float v3) const;
+	void addUniform1i(const std::string& name, int value) const;
+	void addUniformMat4f(const std::string& name, const glm::mat4& matrix) const;
 
 private:
 	void compileAndLink() const;
 	std::string parseShader(const std::string& filePath) const;
-	int getUniformLocation(const std::string& name);
+	int getUniformLocation(const std::string& name) const;
 };
 
 #endif
\ No newline at end of file
@@ -0,0 +1,28 @@
+#ifndef SIMD_H_INCLUDED
+#define SIMD_H_INCLUDED
+
+// SSE is part of every x86-64 CPU, other targets use the scalar code paths.
+// AVX is only used when the compiler targets it (-mavx or /arch:AVX)
+#if defined(__SSE__) || defined(_M_X64) || (defined(_M_IX86_FP) && _M_IX86_FP >= 1)
+#define USE_SSE 1
+#include <xmmintrin.h>
+#else
+#define USE_SSE 0
+#endif
+
+#if defined(__AVX__)
+#define USE_AVX 1
+#include <immintrin.h>
+#else
+#define USE_AVX 0
+#endif
+
+const unsigned int SSE_WIDTH = 4;
+const unsigned int AVX_WIDTH = 8;
+
+// SoA arrays are padded to a multiple of the widest SIMD width, so the SIMD loops need no remainder loop
+inline unsigned int padToSimdWidth(unsigned int count) {
+	return (count + AVX_WIDTH - 1) / AVX_WIDTH * AVX_WIDTH;
+}
+
+#endif
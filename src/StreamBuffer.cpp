@@ -0,0 +1,150 @@
+#include "StreamBuffer.h"
+#include "GLExtensions.h"
+#include "GLState.h"
+
+#include <glad/glad.h>
+
+#include <iostream>
+
+// how long to wait for the GPU to finish with a segment before complaining (in nanoseconds)
+const GLuint64 FENCE_TIMEOUT = 1000000000;
+
+StreamBuffer::StreamBuffer(unsigned int target, unsigned int segmentSize)
+    : m_bufferID{ 0 }, m_target{ target }, m_segmentSize{ segmentSize }, m_segment{ STREAM_BUFFER_FRAMES - 1 },
+      m_head{ 0 }, m_persistentData{ nullptr }, m_mapped{ false }, m_generation{ 0 } {
+    for (GLsync& fence : m_fences) {
+        fence = nullptr;
+    }
+    create();
+}
+
+StreamBuffer::~StreamBuffer() {
+    destroy();
+}
+
+void StreamBuffer::create() {
+    const unsigned int totalSize = m_segmentSize * STREAM_BUFFER_FRAMES;
+    glGenBuffers(1, &m_bufferID);
+    ++m_generation;
+    GLState::bindBuffer(m_target, m_bufferID);
+    if (GLExtensions::supportsBufferStorage()) {
+        const GLbitfield flags = GL_MAP_WRITE_BIT | GL_MAP_PERSISTENT_BIT | GL_MAP_COHERENT_BIT;
+        GLExtensions::bufferStorage(m_target, totalSize, nullptr, flags);
+        m_persistentData = static_cast<unsigned char*>(glMapBufferRange(m_target, 0, totalSize, flags));
+    } else {
+        glBufferData(m_target, totalSize, nullptr, GL_STREAM_DRAW);
+    }
+}
+
+void StreamBuffer::destroy() {
+    unmap();
+    for (GLsync& fence : m_fences) {
+        if (fence) {
+            glDeleteSync(fence);
+            fence = nullptr;
+        }
+    }
+    if (m_persistentData) {
+        GLState::bindBuffer(m_target, m_bufferID);
+        glUnmapBuffer(m_target);
+        m_persistentData = nullptr;
+    }
+    GLState::forgetBuffer(m_bufferID);
+    glDeleteBuffers(1, &m_bufferID);
+}
+
+void StreamBuffer::beginFrame(unsigned int bytesNeeded) {
+    if (bytesNeeded > m_segmentSize) {
+        // deleting a buffer the GPU still reads from is safe, OpenGL keeps
+        // the storage alive until those draws are done
+        destroy();
+        m_segmentSize = bytesNeeded + bytesNeeded / 2;
+        m_segment = STREAM_BUFFER_FRAMES - 1;
+        create();
+    }
+
+    m_segment = (m_segment + 1) % STREAM_BUFFER_FRAMES;
+    m_head = 0;
+
+    if (m_persistentData) {
+        // wait until the GPU is done with the draws from STREAM_BUFFER_FRAMES frames ago
+        GLsync& fence = m_fences[m_segment];
+        if (fence) {
+            GLenum result = glClientWaitSync(fence, GL_SYNC_FLUSH_COMMANDS_BIT, FENCE_TIMEOUT);
+            if (result == GL_TIMEOUT_EXPIRED || result == GL_WAIT_FAILED) {
+                std::cerr << "Stream buffer segment " << m_segment << " is still in use by the GPU\n";
+            }
+            glDeleteSync(fence);
+            fence = nullptr;
+        }
+    } else if (m_segment == 0) {
+        // give the old storage back to the driver instead of waiting for it
+        GLState::bindBuffer(m_target, m_bufferID);
+        glBufferData(m_target, m_segmentSize * STREAM_BUFFER_FRAMES, nullptr, GL_STREAM_DRAW);
+    }
+}
+
+void StreamBuffer::endFrame() {
+    unmap();
+    if (m_persistentData) {
+        GLsync& fence = m_fences[m_segment];
+        if (fence) {
+            glDeleteSync(fence);
+        }
+        fence = glFenceSync(GL_SYNC_GPU_COMMANDS_COMPLETE, 0);
+    }
+}
+
+// align relative to the start of the buffer (alignment does not have to be a power of 2)
+static unsigned int alignOffset(unsigned int offset, unsigned int alignment) {
+    return (offset + alignment - 1) / alignment * alignment;
+}
+
+bool StreamBuffer::hasSpace(unsigned int size, unsigned int alignment) const {
+    const unsigned int segmentStart = m_segment * m_segmentSize;
+    return alignOffset(segmentStart + m_head, alignment) + size <= segmentStart + m_segmentSize;
+}
+
+StreamAllocation StreamBuffer::allocate(unsigned int size, unsigned int alignment) {
+    unmap();
+
+    const unsigned int segmentStart = m_segment * m_segmentSize;
+    const unsigned int offset = alignOffset(segmentStart + m_head, alignment);
+    if (offset + size > segmentStart + m_segmentSize) {
+        std::cerr << "Stream buffer allocation of " << size << " bytes does not fit into the frame's "
+                  << m_segmentSize << " bytes\n";
+        return { nullptr, 0, 0 };
+    }
+    m_head = offset + size - segmentStart;
+
+    if (m_persistentData) {
+        return { m_persistentData + offset, offset, size };
+    }
+
+    // this range is not used by any pending draw (the buffer was orphaned before it was reused)
+    GLState::bindBuffer(m_target, m_bufferID);
+    const GLbitfield flags = GL_MAP_WRITE_BIT | GL_MAP_UNSYNCHRONIZED_BIT | GL_MAP_INVALIDATE_RANGE_BIT;
+    void* data = glMapBufferRange(m_target, offset, size, flags);
+    m_mapped = data != nullptr;
+    return { data, offset, size };
+}
+
+void StreamBuffer::unmap() {
+    if (m_mapped) {
+        GLState::bindBuffer(m_target, m_bufferID);
+        glUnmapBuffer(m_target);
+        m_mapped = false;
+    }
+}
+
+unsigned int StreamBuffer::getID() const {
+    return m_bufferID;
+}
+
+unsigned int StreamBuffer::getGeneration() const {
+    return m_generation;
+}
+
+bool StreamBuffer::isPersistent() const {
+    return m_persistentData != nullptr;
+}
\ No newline at end of file
@@ -0,0 +1,60 @@
+#ifndef STREAM_BUFFER_H_INCLUDED
+#define STREAM_BUFFER_H_INCLUDED
+
+#include <glad/glad.h>
+
+// a piece of a stream buffer that can be written to for the current frame
+struct StreamAllocation {
+	void* m_data;           // nullptr if the allocation did not fit
+	unsigned int m_offset;  // in bytes from the start of the buffer
+	unsigned int m_size;
+};
+
+// the number of frames the CPU may get ahead of the GPU
+const unsigned int STREAM_BUFFER_FRAMES = 3;
+
+// A ring buffer for data that is rewritten every frame (dynamic vertices, uniform
+// blocks, indirect draw commands). It is split into one segment per frame in
+// flight, so the CPU writes one segment while the GPU reads the others.
+// If the context supports glBufferStorage, the buffer stays persistently mapped and
+// fences make sure a segment is not overwritten while the GPU still reads from it.
+// Otherwise ranges are mapped unsynchronized and the whole buffer is orphaned
+// whenever the ring wraps around, which lets the driver do the synchronization.
+class StreamBuffer {
+	unsigned int m_bufferID;
+	unsigned int m_target;
+	unsigned int m_segmentSize;
+	unsigned int m_segment;
+	unsigned int m_head;                    // next free byte in the current segment
+	unsigned char* m_persistentData;        // nullptr when not persistently mapped
+	GLsync m_fences[STREAM_BUFFER_FRAMES];
+	bool m_mapped;
+	unsigned int m_generation;              // counts the buffers created, see getGeneration()
+
+public:
+	StreamBuffer(unsigned int target, unsigned int segmentSize);
+	~StreamBuffer();
+	StreamBuffer(const StreamBuffer&) = delete;
+	StreamBuffer& operator=(const StreamBuffer&) = delete;
+
+	// call once before allocating the frame's data and once after the draws that read it
+	void beginFrame(unsigned int bytesNeeded = 0);
+	void endFrame();
+
+	StreamAllocation allocate(unsigned int size, unsigned int alignment);
+	bool hasSpace(unsigned int size, unsigned int alignment) const;
+	// must be called after writing an allocation and before the GPU reads it
+	void unmap();
+
+	unsigned int getID() const;
+	// changes whenever the buffer is recreated to grow. A new buffer can get the ID of the
+	// deleted one, so whatever refers to the buffer (like a buffer texture) must compare this
+	unsigned int getGeneration() const;
+	bool isPersistent() const;
+
+private:
+	void create();
+	void destroy();
+};
+
+#endif
\ No newline at end of file
@@ -0,0 +1,71 @@
+#include "SystemScheduler.h"
+#include "JobSystem.h"
+
+#include <chrono>
+#include <functional>
+#include <iostream>
+#include <string>
+#include <vector>
+
+SystemScheduler::SystemScheduler(JobSystem* jobs) : m_jobs{ jobs } {}
+
+void SystemScheduler::addSystem(const std::string& name, const std::function<void()>& update,
+    unsigned long long reads, unsigned long long writes) {
+    // a system joins the last stage if it doesn't touch what that stage writes, and that stage doesn't read
+    // or write what it writes
+    bool conflict = m_stageStarts.empty();
+    for (unsigned int i = m_stageStarts.empty() ? 0 : m_stageStarts.back(); i < m_systems.size(); ++i) {
+        const System& other = m_systems[i];
+        conflict = conflict || ((reads | writes) & other.m_writes) || (writes & other.m_reads);
+    }
+    if (conflict) {
+        m_stageStarts.push_back(static_cast<unsigned int>(m_systems.size()));
+    }
+    m_systems.push_back({ name, update, reads, writes, 0.0 });
+}
+
+void SystemScheduler::runSystem(System& system) {
+    auto start = std::chrono::steady_clock::now();
+    system.m_update();
+    std::chrono::duration<double, std::milli> duration = std::chrono::steady_clock::now() - start;
+    system.m_milliseconds = duration.count();
+}
+
+void SystemScheduler::run() {
+    for (unsigned int stage = 0; stage < m_stageStarts.size(); ++stage) {
+        unsigned int first = m_stageStarts[stage];
+        unsigned int end = stage + 1 < m_stageStarts.size() ? m_stageStarts[stage + 1]
+                                                             : static_cast<unsigned int>(m_systems.size());
+        if (!m_jobs) {
+            for (unsigned int i = first; i < end; ++i) {
+                runSystem(m_systems[i]);
+            }
+            continue;
+        }
+        // the calling thread runs the first system of the stage itself
+        JobCounter counter;
+        for (unsigned int i = first + 1; i < end; ++i) {
+            System& system = m_systems[i];
+            m_jobs->run([this, &system]() {
+                runSystem(system);
+            }, &counter);
+        }
+        runSystem(m_systems[first]);
+        m_jobs->wait(counter);
+    }
+}
+
+unsigned int SystemScheduler::getStageCount() const {
+    return static_cast<unsigned int>(m_stageStarts.size());
+}
+
+void SystemScheduler::printTimings() const {
+    for (unsigned int stage = 0; stage < m_stageStarts.size(); ++stage) {
+        unsigned int end = stage + 1 < m_stageStarts.size() ? m_stageStarts[stage + 1]
+                                                             : static_cast<unsigned int>(m_systems.size());
+        for (unsigned int i = m_stageStarts[stage]; i < end; ++i) {
+            std::cout << "stage " << stage << ": " << m_systems[i].m_name << " " << m_systems[i].m_milliseconds
+                      << " ms\n";
+        }
+    }
+}
@@ -0,0 +1,42 @@
+#ifndef SYSTEM_SCHEDULER_H_INCLUDED
+#define SYSTEM_SCHEDULER_H_INCLUDED
+
+#include <functional>
+#include <string>
+#include <vector>
+
+class JobSystem;
+
+// Runs the per-frame systems in the order they were added. Every system says which
+// component types it reads and writes (see EntityRegistry::getComponentMask). Systems
+// that follow each other and don't write what the others read or write form a stage,
+// and the systems of a stage run as separate jobs.
+class SystemScheduler {
+	struct System {
+		std::string m_name;
+		std::function<void()> m_update;
+		unsigned long long m_reads;
+		unsigned long long m_writes;
+		double m_milliseconds;          // how long the last run took
+	};
+
+	std::vector<System> m_systems;
+	std::vector<unsigned int> m_stageStarts;   // the first system of every stage
+	JobSystem* m_jobs;
+
+	void runSystem(System& system);
+
+public:
+	// without a job system the systems run one after the other on the calling thread
+	explicit SystemScheduler(JobSystem* jobs = nullptr);
+
+	void addSystem(const std::string& name, const std::function<void()>& update, unsigned long long reads,
+		unsigned long long writes);
+	void run();
+
+	unsigned int getStageCount() const;
+	// prints how long every system took in the last run
+	void printTimings() const;
+};
+
+#endif
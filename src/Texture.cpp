@@ -1,9 +1,15 @@
 #include "Texture.h"
+#include "GLExtensions.h"
+#include "GLState.h"
+#include "Ktx2.h"
+#include "MipGenerator.h"
+#include "TextureCompression.h"
 
 #include <glad/glad.h>
-#include "stb_image/stb_image.h"
 
+#include <algorithm>
 #include <iostream>
+#include <string>
 
 Texture::Texture(const std::string& filePath, unsigned int slot) : m_textureSlot{ slot } {
 	// create and bind the texture
@@ -11,49 +17,109 @@ Texture::Texture(const std::string& filePath, unsigned int slot) : m_textureSlot
 	bind();
 
 	// texture filtering (for when image is too large or small)
-	glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_NEAREST);
+	// minified textures blend the two closest mip levels, so far away surfaces neither
+	// shimmer nor read texels spread all over memory
+	glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_LINEAR_MIPMAP_LINEAR);
 	glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_LINEAR);
 
 	// texture wrapping (for when texture coordinates are outside of [0, 1])
 	glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_S, GL_CLAMP_TO_EDGE);
 	glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_T, GL_CLAMP_TO_EDGE);
 
-	// the image data from stbi_load starts at the top left 
-	// but OpenGL reads images from the bottom left
-	stbi_set_flip_vertically_on_load(1);
-
-	// use stbi_image library to convert the image into a char*
-	// I will always set the number of channels to 4 (RGBA)
-	// the third int (the Bytes Per Pixel of the original image) is not used
-	int width, height, BPP;
-	unsigned char* data = stbi_load(filePath.c_str(), &width, &height, &BPP, 4);
-
-	// if the conversion was successful, generate the texture
-	if (data) {
-		glTexImage2D(GL_TEXTURE_2D, 0, GL_RGBA, width, height, 0, GL_RGBA, GL_UNSIGNED_BYTE, data);
-		// a mipmap is used for large and complex textures on small or faraway objects
-		glGenerateMipmap(GL_TEXTURE_2D);
-		stbi_image_free(data);
+	const std::string compressedExtension = ".ktx2";
+	if (filePath.size() > compressedExtension.size() &&
+		filePath.compare(filePath.size() - compressedExtension.size(), std::string::npos, compressedExtension) == 0) {
+		loadCompressed(filePath);
 	} else {
+		loadImage(filePath);
+	}
+
+	unbind();
+}
+
+void Texture::loadImage(const std::string& filePath) {
+	// the mips are made on the CPU once (a better filter than most drivers use for
+	// glGenerateMipmap) and read from a file next to the image after that
+	MipChain chain;
+	if (!loadMipChain(filePath, MIP_FILTER_KAISER, true, chain)) {
+		std::cerr << "Failed to load texture at " << filePath << '\n';
+		return;
+	}
+
+	unsigned int levels = static_cast<unsigned int>(chain.m_levels.size());
+	for (unsigned int level = 0; level < levels; ++level) {
+		glTexImage2D(GL_TEXTURE_2D, level, GL_RGBA8, std::max(1u, chain.m_width >> level),
+			std::max(1u, chain.m_height >> level), 0, GL_RGBA, GL_UNSIGNED_BYTE, chain.m_levels[level].data());
+	}
+}
+
+void Texture::loadCompressed(const std::string& filePath) {
+	CompressedTexture texture;
+	if (!readKtx2File(filePath, texture)) {
 		std::cerr << "Failed to load texture at " << filePath << '\n';
+		return;
+	}
+
+	GLenum internalFormat = 0;
+	bool supported = true;
+	switch (texture.m_format) {
+	case FORMAT_BC1:
+		internalFormat = GL_COMPRESSED_RGB_S3TC_DXT1_EXT;
+		supported = GLExtensions::supportsS3TC();
+		break;
+	case FORMAT_BC3:
+		internalFormat = GL_COMPRESSED_RGBA_S3TC_DXT5_EXT;
+		supported = GLExtensions::supportsS3TC();
+		break;
+	case FORMAT_BC4:
+		internalFormat = GL_COMPRESSED_RED_RGTC1;
+		break;
+	case FORMAT_BC5:
+		internalFormat = GL_COMPRESSED_RG_RGTC2;
+		break;
+	case FORMAT_BC7:
+		internalFormat = GL_COMPRESSED_RGBA_BPTC_UNORM;
+		supported = GLExtensions::supportsBPTC();
+		break;
+	default:
+		internalFormat = GL_COMPRESSED_RGB8_ETC2;
+		supported = GLExtensions::supportsETC2();
+		break;
+	}
+	if (!supported) {
+		std::cerr << "The GPU can't sample " << getFormatInfo(texture.m_format).m_name << " textures like "
+			<< filePath << '\n';
+		return;
 	}
 
-	glBindTexture(GL_TEXTURE_2D, 0);
+	// the blocks go to the GPU as they are, so the texture takes as much memory there as on disk
+	unsigned int levels = static_cast<unsigned int>(texture.m_levels.size());
+	for (unsigned int level = 0; level < levels; ++level) {
+		glCompressedTexImage2D(GL_TEXTURE_2D, level, internalFormat, std::max(1u, texture.m_width >> level),
+			std::max(1u, texture.m_height >> level), 0, static_cast<GLsizei>(texture.m_levels[level].size()),
+			texture.m_levels[level].data());
+	}
+	// a file without every level down to 1x1 would leave the texture incomplete otherwise
+	glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAX_LEVEL, levels - 1);
 }
 
 Texture::~Texture() {
+	GLState::forgetTexture(m_textureID);
 	glDeleteTextures(1, &m_textureID);
 }
 
 void Texture::bind() const {
-	glActiveTexture(GL_TEXTURE0 + m_textureSlot);
-	glBindTexture(GL_TEXTURE_2D, m_textureID);
+	GLState::bindTexture(m_textureSlot, GL_TEXTURE_2D, m_textureID);
 }
 
 void Texture::unbind() const {
-	glBindTexture(GL_TEXTURE_2D, 0);
+	GLState::bindTexture(m_textureSlot, GL_TEXTURE_2D, 0);
 }
 
 unsigned int Texture::getSlot() const {
 	return m_textureSlot;
+}
+
+unsigned int Texture::getID() const {
+	return m_textureID;
 }
\ No newline at end of file
@@ -7,6 +7,10 @@ class Texture {
 	unsigned int m_textureID;
 	unsigned int m_textureSlot;
 
+	void loadImage(const std::string& filePath);
+	// .ktx2 files hold block compressed mip chains which are uploaded as they are
+	void loadCompressed(const std::string& filePath);
+
 public:
 	Texture(const std::string& filePath, unsigned int slot);
 	~Texture();
@@ -14,6 +18,7 @@ public:
 	void bind() const;
 	void unbind() const;
 	unsigned int getSlot() const;
+	unsigned int getID() const;
 };
 
 #endif
\ No newline at end of file
@@ -0,0 +1,173 @@
+#include "TextureArray.h"
+#include "AtlasPacker.h"
+#include "GLExtensions.h"
+#include "GLState.h"
+#include "MipGenerator.h"
+
+#include <glad/glad.h>
+
+#include <algorithm>
+#include <cstring>
+#include <iostream>
+#include <vector>
+
+const unsigned int TextureArray::ATLAS_PADDED_LEVELS;
+const unsigned int TextureArray::ATLAS_PADDING;
+
+static unsigned int countMipLevels(unsigned int size) {
+    unsigned int levels = 1;
+    for (; size > 1; size /= 2) {
+        ++levels;
+    }
+    return levels;
+}
+
+TextureArray::TextureArray(unsigned int layerSize, unsigned int layerCount, unsigned int mipLevels,
+    unsigned int slot)
+    : m_textureID{ 0 }, m_textureSlot{ slot }, m_layerSize{ layerSize }, m_layerCount{ layerCount },
+    m_mipLevels{ mipLevels == 0 ? countMipLevels(layerSize) : std::min(mipLevels, countMipLevels(layerSize)) },
+    m_usedLayers{ 0 } {
+    glGenTextures(1, &m_textureID);
+    bind();
+    glTexParameteri(GL_TEXTURE_2D_ARRAY, GL_TEXTURE_MIN_FILTER, GL_LINEAR_MIPMAP_LINEAR);
+    glTexParameteri(GL_TEXTURE_2D_ARRAY, GL_TEXTURE_MAG_FILTER, GL_LINEAR);
+    glTexParameteri(GL_TEXTURE_2D_ARRAY, GL_TEXTURE_WRAP_S, GL_CLAMP_TO_EDGE);
+    glTexParameteri(GL_TEXTURE_2D_ARRAY, GL_TEXTURE_WRAP_T, GL_CLAMP_TO_EDGE);
+    glTexParameteri(GL_TEXTURE_2D_ARRAY, GL_TEXTURE_MAX_LEVEL, m_mipLevels - 1);
+    if (GLExtensions::supportsTextureStorage()) {
+        GLExtensions::texStorage3D(GL_TEXTURE_2D_ARRAY, m_mipLevels, GL_RGBA8, layerSize, layerSize, layerCount);
+    } else {
+        for (unsigned int level = 0; level < m_mipLevels; ++level) {
+            unsigned int size = std::max(1u, layerSize >> level);
+            glTexImage3D(GL_TEXTURE_2D_ARRAY, level, GL_RGBA8, size, size, layerCount, 0, GL_RGBA, GL_UNSIGNED_BYTE,
+                nullptr);
+        }
+    }
+    unbind();
+}
+
+TextureArray::~TextureArray() {
+    GLState::forgetTexture(m_textureID);
+    glDeleteTextures(1, &m_textureID);
+}
+
+void TextureArray::uploadLevel(const MipChain& chain, unsigned int sourceLevel, unsigned int level, unsigned int x,
+    unsigned int y, unsigned int layer, unsigned int padding) {
+    unsigned int width = std::max(1u, chain.m_width >> sourceLevel);
+    unsigned int height = std::max(1u, chain.m_height >> sourceLevel);
+    const unsigned char* pixels = chain.m_levels[sourceLevel].data();
+    if (padding == 0) {
+        glTexSubImage3D(GL_TEXTURE_2D_ARRAY, level, x, y, layer, width, height, 1, GL_RGBA, GL_UNSIGNED_BYTE, pixels);
+        return;
+    }
+    // the border repeats the edge texels, so filtering at the edge sees what clamping would give
+    unsigned int paddedWidth = width + 2 * padding;
+    unsigned int paddedHeight = height + 2 * padding;
+    std::vector<unsigned char> padded(paddedWidth * paddedHeight * 4);
+    for (unsigned int py = 0; py < paddedHeight; ++py) {
+        unsigned int sy = std::min(std::max(py, padding) - padding, height - 1);
+        for (unsigned int px = 0; px < paddedWidth; ++px) {
+            unsigned int sx = std::min(std::max(px, padding) - padding, width - 1);
+            std::memcpy(&padded[(py * paddedWidth + px) * 4], &pixels[(sy * width + sx) * 4], 4);
+        }
+    }
+    glTexSubImage3D(GL_TEXTURE_2D_ARRAY, level, x - padding, y - padding, layer, paddedWidth, paddedHeight, 1,
+        GL_RGBA, GL_UNSIGNED_BYTE, padded.data());
+}
+
+bool TextureArray::add(const MipChain& chain, TextureRegion& region) {
+    const unsigned int levelCount = static_cast<unsigned int>(chain.m_levels.size());
+    if (levelCount == 0) {
+        return false;
+    }
+    unsigned int first = 0;
+    auto width = [&chain](unsigned int level) {
+        return std::max(1u, chain.m_width >> level);
+    };
+    auto height = [&chain](unsigned int level) {
+        return std::max(1u, chain.m_height >> level);
+    };
+    // larger textures start at the first level that fits
+    while (first + 1 < levelCount && (width(first) > m_layerSize || height(first) > m_layerSize)) {
+        ++first;
+    }
+
+    if (width(first) == m_layerSize && height(first) == m_layerSize) {
+        if (m_usedLayers == m_layerCount) {
+            std::cerr << "The texture array has no free layer left\n";
+            return false;
+        }
+        region.m_layer = m_usedLayers++;
+        region.m_rect = glm::vec4(0.0f, 0.0f, 1.0f, 1.0f);
+        region.m_maxLevel = std::min(m_mipLevels, levelCount - first) - 1;
+        bind();
+        for (unsigned int level = 0; level <= region.m_maxLevel; ++level) {
+            uploadLevel(chain, first + level, level, 0, 0, region.m_layer, 0);
+        }
+        unbind();
+        return true;
+    }
+
+    // packed textures also need room for their border
+    while (first + 1 < levelCount && (width(first) + 2 * ATLAS_PADDING > m_layerSize
+        || height(first) + 2 * ATLAS_PADDING > m_layerSize)) {
+        ++first;
+    }
+    if (width(first) + 2 * ATLAS_PADDING > m_layerSize || height(first) + 2 * ATLAS_PADDING > m_layerSize) {
+        std::cerr << "The texture array's layers are too small for atlases\n";
+        return false;
+    }
+    // slots are rounded up to the padding, so packed textures start on texels that are
+    // still whole texels in all padded levels
+    unsigned int slotWidth = (width(first) + 3 * ATLAS_PADDING - 1) / ATLAS_PADDING * ATLAS_PADDING;
+    unsigned int slotHeight = (height(first) + 3 * ATLAS_PADDING - 1) / ATLAS_PADDING * ATLAS_PADDING;
+    unsigned int x = 0, y = 0;
+    const Atlas* atlas = nullptr;
+    for (Atlas& candidate : m_atlases) {
+        if (candidate.m_packer.insert(slotWidth, slotHeight, x, y)) {
+            atlas = &candidate;
+            break;
+        }
+    }
+    if (!atlas) {
+        if (m_usedLayers == m_layerCount) {
+            std::cerr << "The texture array has no room left\n";
+            return false;
+        }
+        m_atlases.push_back({ m_usedLayers++, SkylinePacker(m_layerSize, m_layerSize) });
+        m_atlases.back().m_packer.insert(slotWidth, slotHeight, x, y);
+        atlas = &m_atlases.back();
+    }
+    x += ATLAS_PADDING;
+    y += ATLAS_PADDING;
+
+    region.m_layer = atlas->m_layer;
+    region.m_rect = glm::vec4(x, y, width(first), height(first)) / static_cast<float>(m_layerSize);
+    region.m_maxLevel = std::min({ m_mipLevels, levelCount - first, ATLAS_PADDED_LEVELS }) - 1;
+    bind();
+    for (unsigned int level = 0; level <= region.m_maxLevel; ++level) {
+        uploadLevel(chain, first + level, level, x >> level, y >> level, region.m_layer, ATLAS_PADDING >> level);
+    }
+    unbind();
+    return true;
+}
+
+void TextureArray::bind() const {
+    GLState::bindTexture(m_textureSlot, GL_TEXTURE_2D_ARRAY, m_textureID);
+}
+
+void TextureArray::unbind() const {
+    GLState::bindTexture(m_textureSlot, GL_TEXTURE_2D_ARRAY, 0);
+}
+
+unsigned int TextureArray::getSlot() const {
+    return m_textureSlot;
+}
+
+unsigned int TextureArray::getID() const {
+    return m_textureID;
+}
+
+unsigned int TextureArray::getUsedLayers() const {
+    return m_usedLayers;
+}
@@ -0,0 +1,67 @@
+#ifndef TEXTURE_ARRAY_H_INCLUDED
+#define TEXTURE_ARRAY_H_INCLUDED
+
+#include "AtlasPacker.h"
+#include "MipGenerator.h"
+
+#include <glm/glm.hpp>
+
+#include <vector>
+
+// where a texture ended up in a TextureArray, shaders sample it at
+// vec3(uv * m_rect.zw + m_rect.xy, m_layer) no deeper than mip level m_maxLevel
+struct TextureRegion {
+	unsigned int m_layer;
+	glm::vec4 m_rect;       // offset and size in texture coordinates of the layer
+	unsigned int m_maxLevel;
+};
+
+// Many RGBA textures behind one GL_TEXTURE_2D_ARRAY, so draws that use different
+// textures need no binds in between and can be batched. Textures the size of a layer
+// get a layer of their own, smaller ones are packed into shared atlas layers with a
+// border of repeated edge texels, and larger ones are added from the first mip level
+// that fits. The border keeps the first ATLAS_PADDED_LEVELS mip levels from blending
+// in their neighbours. Below those, packed textures would share texels, so they only
+// have ATLAS_PADDED_LEVELS levels and shaders clamp the level to the region's
+// m_maxLevel (the array's GL_TEXTURE_MAX_LEVEL is shared with the full layers). Packed
+// textures only clamp (they can't repeat).
+class TextureArray {
+	struct Atlas {
+		unsigned int m_layer;
+		SkylinePacker m_packer;
+	};
+
+	unsigned int m_textureID;
+	unsigned int m_textureSlot;
+	unsigned int m_layerSize;
+	unsigned int m_layerCount;
+	unsigned int m_mipLevels;
+	unsigned int m_usedLayers;
+	std::vector<Atlas> m_atlases;
+
+	void uploadLevel(const MipChain& chain, unsigned int sourceLevel, unsigned int level, unsigned int x,
+		unsigned int y, unsigned int layer, unsigned int padding);
+
+public:
+	static const unsigned int ATLAS_PADDED_LEVELS = 4;
+	// border texels around packed textures, which is one at the last padded level
+	static const unsigned int ATLAS_PADDING = 1 << (ATLAS_PADDED_LEVELS - 1);
+
+	// layerCount layers of layerSize x layerSize with mipLevels levels each (0 for all down to 1x1)
+	TextureArray(unsigned int layerSize, unsigned int layerCount, unsigned int mipLevels, unsigned int slot);
+	~TextureArray();
+	TextureArray(const TextureArray&) = delete;
+	TextureArray& operator=(const TextureArray&) = delete;
+
+	// false (with a message on std::cerr) if there's no room left
+	bool add(const MipChain& chain, TextureRegion& region);
+
+	void bind() const;
+	void unbind() const;
+	unsigned int getSlot() const;
+	unsigned int getID() const;
+	// layers holding a texture or an atlas
+	unsigned int getUsedLayers() const;
+};
+
+#endif
@@ -0,0 +1,881 @@
+#include "TextureCompression.h"
+#include "JobSystem.h"
+#include "MipGenerator.h"
+#include "Simd.h"
+
+#include <algorithm>
+#include <cctype>
+#include <cmath>
+#include <cstring>
+#include <limits>
+#include <string>
+#include <vector>
+
+static const CompressedFormatInfo FORMAT_INFOS[FORMAT_COUNT] = {
+    { "BC1", 8, 3 },
+    { "BC3", 16, 4 },
+    { "BC4", 8, 1 },
+    { "BC5", 16, 2 },
+    { "BC7", 16, 4 },
+    { "ETC2", 8, 3 },
+};
+
+// the weights of the second endpoint for the 16 colors of a BC7 block with 4 bit indices
+static const int BC7_WEIGHTS[16] = { 0, 4, 9, 13, 17, 21, 26, 30, 34, 38, 43, 47, 51, 55, 60, 64 };
+
+// the intensity modifiers of the ETC1 tables, a pixel adds one of +a, +b, -a or -b
+static const int ETC_MODIFIERS[8][2] = {
+    { 2, 8 }, { 5, 17 }, { 9, 29 }, { 13, 42 }, { 18, 60 }, { 24, 80 }, { 33, 106 }, { 47, 183 }
+};
+
+// the distances between the paint colors of the ETC2 T and H modes
+static const int ETC_DISTANCES[8] = { 3, 6, 11, 16, 23, 32, 41, 64 };
+
+// the 16 pixels of a block as a structure of arrays, pixel y * 4 + x
+struct Block {
+    float m_channels[4][16];
+};
+
+const CompressedFormatInfo& getFormatInfo(CompressedFormat format) {
+    return FORMAT_INFOS[format];
+}
+
+bool findFormat(const std::string& name, CompressedFormat& format) {
+    std::string upper = name;
+    std::transform(upper.begin(), upper.end(), upper.begin(), [](unsigned char c) {
+        return static_cast<char>(std::toupper(c));
+    });
+    for (int i = 0; i < FORMAT_COUNT; ++i) {
+        if (upper == FORMAT_INFOS[i].m_name) {
+            format = static_cast<CompressedFormat>(i);
+            return true;
+        }
+    }
+    return false;
+}
+
+unsigned int getCompressedSize(CompressedFormat format, unsigned int width, unsigned int height) {
+    return (width + 3) / 4 * ((height + 3) / 4) * FORMAT_INFOS[format].m_blockBytes;
+}
+
+static void loadBlock(const unsigned char* rgba, unsigned int width, unsigned int height, unsigned int blockX,
+    unsigned int blockY, Block& block) {
+    for (unsigned int y = 0; y < 4; ++y) {
+        unsigned int row = std::min(blockY * 4 + y, height - 1);
+        for (unsigned int x = 0; x < 4; ++x) {
+            const unsigned char* pixel = rgba + (row * width + std::min(blockX * 4 + x, width - 1)) * 4;
+            for (unsigned int c = 0; c < 4; ++c) {
+                block.m_channels[c][y * 4 + x] = pixel[c];
+            }
+        }
+    }
+}
+
+// moves count channels starting at first to the front and clears the others, so the
+// distances only count the channels a block format keeps
+static Block selectChannels(const Block& block, unsigned int first, unsigned int count) {
+    Block selected;
+    std::memset(&selected, 0, sizeof(Block));
+    for (unsigned int c = 0; c < count; ++c) {
+        std::memcpy(selected.m_channels[c], block.m_channels[first + c], sizeof(selected.m_channels[c]));
+    }
+    return selected;
+}
+
+// Picks the nearest of count palette colors for every pixel and returns the summed
+// squared error. The SSE version compares 4 pixels against one palette color at a time.
+static float findNearest(const Block& block, const float (*palette)[4], unsigned int count,
+    unsigned char* indices) {
+#if USE_SSE
+    __m128 total = _mm_setzero_ps();
+    for (unsigned int first = 0; first < 16; first += SSE_WIDTH) {
+        __m128 channels[4];
+        for (unsigned int c = 0; c < 4; ++c) {
+            channels[c] = _mm_loadu_ps(&block.m_channels[c][first]);
+        }
+        __m128 best = _mm_set1_ps(std::numeric_limits<float>::max());
+        __m128 bestIndex = _mm_setzero_ps();
+        for (unsigned int i = 0; i < count; ++i) {
+            __m128 distance = _mm_setzero_ps();
+            for (unsigned int c = 0; c < 4; ++c) {
+                __m128 difference = _mm_sub_ps(channels[c], _mm_set1_ps(palette[i][c]));
+                distance = _mm_add_ps(distance, _mm_mul_ps(difference, difference));
+            }
+            __m128 closer = _mm_cmplt_ps(distance, best);
+            best = _mm_min_ps(distance, best);
+            bestIndex = _mm_or_ps(_mm_and_ps(closer, _mm_set1_ps(static_cast<float>(i))),
+                _mm_andnot_ps(closer, bestIndex));
+        }
+        total = _mm_add_ps(total, best);
+        float found[SSE_WIDTH];
+        _mm_storeu_ps(found, bestIndex);
+        for (unsigned int k = 0; k < SSE_WIDTH; ++k) {
+            indices[first + k] = static_cast<unsigned char>(found[k]);
+        }
+    }
+    float sums[SSE_WIDTH];
+    _mm_storeu_ps(sums, total);
+    return sums[0] + sums[1] + sums[2] + sums[3];
+#else
+    float total = 0.0f;
+    for (unsigned int pixel = 0; pixel < 16; ++pixel) {
+        float best = std::numeric_limits<float>::max();
+        for (unsigned int i = 0; i < count; ++i) {
+            float distance = 0.0f;
+            for (unsigned int c = 0; c < 4; ++c) {
+                float difference = block.m_channels[c][pixel] - palette[i][c];
+                distance += difference * difference;
+            }
+            if (distance < best) {
+                best = distance;
+                indices[pixel] = static_cast<unsigned char>(i);
+            }
+        }
+        total += best;
+    }
+    return total;
+#endif
+}
+
+// the ends of the line through the pixels along their principal axis (found with a
+// few power iterations on the covariance matrix)
+static void findEndpoints(const Block& block, unsigned int channels, float start[4], float end[4]) {
+    float mean[4] = { 0.0f, 0.0f, 0.0f, 0.0f };
+    float minimum[4], maximum[4];
+    for (unsigned int c = 0; c < 4; ++c) {
+        minimum[c] = 255.0f;
+        maximum[c] = 0.0f;
+        for (unsigned int i = 0; i < 16; ++i) {
+            mean[c] += block.m_channels[c][i] / 16.0f;
+            minimum[c] = std::min(minimum[c], block.m_channels[c][i]);
+            maximum[c] = std::max(maximum[c], block.m_channels[c][i]);
+        }
+    }
+    float covariance[4][4] = {};
+    for (unsigned int i = 0; i < 16; ++i) {
+        for (unsigned int a = 0; a < channels; ++a) {
+            for (unsigned int b = 0; b < channels; ++b) {
+                covariance[a][b] += (block.m_channels[a][i] - mean[a]) * (block.m_channels[b][i] - mean[b]);
+            }
+        }
+    }
+    float axis[4] = { 0.0f, 0.0f, 0.0f, 0.0f };
+    for (unsigned int c = 0; c < channels; ++c) {
+        axis[c] = maximum[c] - minimum[c];
+    }
+    for (int iteration = 0; iteration < 8; ++iteration) {
+        float next[4] = { 0.0f, 0.0f, 0.0f, 0.0f };
+        float length = 0.0f;
+        for (unsigned int a = 0; a < channels; ++a) {
+            for (unsigned int b = 0; b < channels; ++b) {
+                next[a] += covariance[a][b] * axis[b];
+            }
+            length = std::max(length, std::abs(next[a]));
+        }
+        if (length < 1e-6f) {
+            break;
+        }
+        for (unsigned int c = 0; c < channels; ++c) {
+            axis[c] = next[c] / length;
+        }
+    }
+    float lengthSquared = 0.0f;
+    for (unsigned int c = 0; c < channels; ++c) {
+        lengthSquared += axis[c] * axis[c];
+    }
+    float low = 0.0f, high = 0.0f;
+    if (lengthSquared > 1e-12f) {
+        low = std::numeric_limits<float>::max();
+        high = -std::numeric_limits<float>::max();
+        for (unsigned int i = 0; i < 16; ++i) {
+            float t = 0.0f;
+            for (unsigned int c = 0; c < channels; ++c) {
+                t += (block.m_channels[c][i] - mean[c]) * axis[c];
+            }
+            low = std::min(low, t / lengthSquared);
+            high = std::max(high, t / lengthSquared);
+        }
+    }
+    for (unsigned int c = 0; c < 4; ++c) {
+        start[c] = std::min(255.0f, std::max(0.0f, mean[c] + axis[c] * low));
+        end[c] = std::min(255.0f, std::max(0.0f, mean[c] + axis[c] * high));
+    }
+}
+
+// the endpoints that fit the pixels best for the indices, where index i mixes in
+// weights[i] of the second endpoint (least squares), false if they can't be solved
+static bool fitEndpoints(const Block& block, unsigned int channels, const unsigned char* indices,
+    const float* weights, float start[4], float end[4]) {
+    float aa = 0.0f, ab = 0.0f, bb = 0.0f;
+    float ax[4] = { 0.0f, 0.0f, 0.0f, 0.0f };
+    float bx[4] = { 0.0f, 0.0f, 0.0f, 0.0f };
+    for (unsigned int i = 0; i < 16; ++i) {
+        float b = weights[indices[i]];
+        float a = 1.0f - b;
+        aa += a * a;
+        ab += a * b;
+        bb += b * b;
+        for (unsigned int c = 0; c < channels; ++c) {
+            ax[c] += a * block.m_channels[c][i];
+            bx[c] += b * block.m_channels[c][i];
+        }
+    }
+    float determinant = aa * bb - ab * ab;
+    if (std::abs(determinant) < 1e-6f) {
+        return false;
+    }
+    for (unsigned int c = 0; c < channels; ++c) {
+        start[c] = std::min(255.0f, std::max(0.0f, (bb * ax[c] - ab * bx[c]) / determinant));
+        end[c] = std::min(255.0f, std::max(0.0f, (aa * bx[c] - ab * ax[c]) / determinant));
+    }
+    return true;
+}
+
+static unsigned int quantize(float value, unsigned int bits) {
+    unsigned int levels = (1u << bits) - 1;
+    return static_cast<unsigned int>(std::lround(std::min(255.0f, std::max(0.0f, value)) * levels / 255.0f));
+}
+
+static unsigned int expand(unsigned int value, unsigned int bits) {
+    return (value << (8 - bits)) | (value >> (2 * bits - 8));
+}
+
+static unsigned int packRgb565(const float color[4]) {
+    return (quantize(color[0], 5) << 11) | (quantize(color[1], 6) << 5) | quantize(color[2], 5);
+}
+
+static void unpackRgb565(unsigned int packed, float color[4]) {
+    color[0] = static_cast<float>(expand(packed >> 11, 5));
+    color[1] = static_cast<float>(expand((packed >> 5) & 63, 6));
+    color[2] = static_cast<float>(expand(packed & 31, 5));
+    color[3] = 0.0f;
+}
+
+// BC1 color in 4 color mode (the first endpoint is larger), which BC3 also uses
+static void encodeBc1(const Block& block, unsigned char* out) {
+    const float weights[4] = { 0.0f, 1.0f, 1.0f / 3.0f, 2.0f / 3.0f };
+    float start[4], end[4];
+    findEndpoints(block, 3, start, end);
+    float bestError = std::numeric_limits<float>::max();
+    for (int iteration = 0; iteration < 3; ++iteration) {
+        unsigned int color0 = packRgb565(start);
+        unsigned int color1 = packRgb565(end);
+        if (color0 < color1) {
+            std::swap(color0, color1);
+        }
+        float palette[4][4];
+        unpackRgb565(color0, palette[0]);
+        unpackRgb565(color1, palette[1]);
+        for (unsigned int c = 0; c < 4; ++c) {
+            palette[2][c] = (2.0f * palette[0][c] + palette[1][c]) / 3.0f;
+            palette[3][c] = (palette[0][c] + 2.0f * palette[1][c]) / 3.0f;
+        }
+        // equal endpoints would switch to 3 color mode, so only the first color is used
+        unsigned char indices[16];
+        float error = findNearest(block, palette, color0 == color1 ? 1 : 4, indices);
+        if (error < bestError) {
+            bestError = error;
+            unsigned int bits = 0;
+            for (unsigned int i = 0; i < 16; ++i) {
+                bits |= static_cast<unsigned int>(indices[i]) << (i * 2);
+            }
+            out[0] = static_cast<unsigned char>(color0);
+            out[1] = static_cast<unsigned char>(color0 >> 8);
+            out[2] = static_cast<unsigned char>(color1);
+            out[3] = static_cast<unsigned char>(color1 >> 8);
+            for (unsigned int k = 0; k < 4; ++k) {
+                out[4 + k] = static_cast<unsigned char>(bits >> (k * 8));
+            }
+        }
+        if (color0 == color1 || !fitEndpoints(block, 3, indices, weights, start, end)) {
+            break;
+        }
+    }
+}
+
+// one channel with 8 interpolated values, trying endpoints a little inside of the range
+static void encodeBc4(const Block& block, unsigned char* out) {
+    float minimum = 255.0f, maximum = 0.0f;
+    for (unsigned int i = 0; i < 16; ++i) {
+        minimum = std::min(minimum, block.m_channels[0][i]);
+        maximum = std::max(maximum, block.m_channels[0][i]);
+    }
+    int low = static_cast<int>(minimum);
+    int high = static_cast<int>(maximum);
+    if (low == high) {
+        // 6 value mode with all pixels on the first endpoint
+        std::memset(out, 0, 8);
+        out[0] = out[1] = static_cast<unsigned char>(low);
+        return;
+    }
+    float bestError = std::numeric_limits<float>::max();
+    for (int highInset = 0; highInset < 3; ++highInset) {
+        for (int lowInset = 0; lowInset < 3; ++lowInset) {
+            int value0 = high - highInset * (high - low) / 16;
+            int value1 = low + lowInset * (high - low) / 16;
+            if (value0 <= value1) {
+                continue;
+            }
+            float palette[8][4] = {};
+            palette[0][0] = static_cast<float>(value0);
+            palette[1][0] = static_cast<float>(value1);
+            for (int i = 2; i < 8; ++i) {
+                palette[i][0] = ((8 - i) * value0 + (i - 1) * value1) / 7.0f;
+            }
+            unsigned char indices[16];
+            float error = findNearest(block, palette, 8, indices);
+            if (error < bestError) {
+                bestError = error;
+                unsigned long long bits = 0;
+                for (unsigned int i = 0; i < 16; ++i) {
+                    bits |= static_cast<unsigned long long>(indices[i]) << (i * 3);
+                }
+                out[0] = static_cast<unsigned char>(value0);
+                out[1] = static_cast<unsigned char>(value1);
+                for (unsigned int k = 0; k < 6; ++k) {
+                    out[2 + k] = static_cast<unsigned char>(bits >> (k * 8));
+                }
+            }
+        }
+    }
+}
+
+// writes bits into a block starting at the lowest bit of the first byte
+class BitWriter {
+    unsigned char* m_out;
+    unsigned int m_position;
+
+public:
+    explicit BitWriter(unsigned char* out) : m_out{ out }, m_position{ 0 } {}
+
+    void write(unsigned int value, unsigned int bits) {
+        for (unsigned int i = 0; i < bits; ++i, ++m_position) {
+            if (value & (1u << i)) {
+                m_out[m_position / 8] |= static_cast<unsigned char>(1u << (m_position % 8));
+            }
+        }
+    }
+};
+
+class BitReader {
+    const unsigned char* m_in;
+    unsigned int m_position;
+
+public:
+    explicit BitReader(const unsigned char* in) : m_in{ in }, m_position{ 0 } {}
+
+    unsigned int read(unsigned int bits) {
+        unsigned int value = 0;
+        for (unsigned int i = 0; i < bits; ++i, ++m_position) {
+            value |= ((m_in[m_position / 8] >> (m_position % 8)) & 1u) << i;
+        }
+        return value;
+    }
+};
+
+// BC7 mode 6: one pair of RGBA endpoints with 7 bits per channel and a shared lowest
+// bit per endpoint, and 4 bit indices
+static void encodeBc7(const Block& block, unsigned char* out) {
+    float weights[16];
+    for (unsigned int i = 0; i < 16; ++i) {
+        weights[i] = BC7_WEIGHTS[i] / 64.0f;
+    }
+    float start[4], end[4];
+    findEndpoints(block, 4, start, end);
+
+    float bestError = std::numeric_limits<float>::max();
+    unsigned int bestEndpoints[2][4] = {};
+    unsigned int bestBits[2] = { 0, 0 };
+    unsigned char bestIndices[16] = {};
+    for (int iteration = 0; iteration < 2; ++iteration) {
+        for (unsigned int bit0 = 0; bit0 < 2; ++bit0) {
+            for (unsigned int bit1 = 0; bit1 < 2; ++bit1) {
+                unsigned int endpoints[2][4];
+                float ends[2][4];
+                for (unsigned int c = 0; c < 4; ++c) {
+                    endpoints[0][c] = std::min(127u, static_cast<unsigned int>(std::max(0L,
+                        std::lround((start[c] - bit0) / 2.0f))));
+                    endpoints[1][c] = std::min(127u, static_cast<unsigned int>(std::max(0L,
+                        std::lround((end[c] - bit1) / 2.0f))));
+                    ends[0][c] = static_cast<float>(endpoints[0][c] * 2 + bit0);
+                    ends[1][c] = static_cast<float>(endpoints[1][c] * 2 + bit1);
+                }
+                float palette[16][4];
+                for (unsigned int i = 0; i < 16; ++i) {
+                    for (unsigned int c = 0; c < 4; ++c) {
+                        palette[i][c] = static_cast<float>(((64 - BC7_WEIGHTS[i]) * static_cast<int>(ends[0][c])
+                            + BC7_WEIGHTS[i] * static_cast<int>(ends[1][c]) + 32) >> 6);
+                    }
+                }
+                unsigned char indices[16];
+                float error = findNearest(block, palette, 16, indices);
+                if (error < bestError) {
+                    bestError = error;
+                    std::memcpy(bestEndpoints, endpoints, sizeof(endpoints));
+                    bestBits[0] = bit0;
+                    bestBits[1] = bit1;
+                    std::memcpy(bestIndices, indices, sizeof(indices));
+                }
+            }
+        }
+        if (!fitEndpoints(block, 4, bestIndices, weights, start, end)) {
+            break;
+        }
+    }
+
+    // the highest bit of the first pixel's index isn't stored, it has to be 0
+    if (bestIndices[0] >= 8) {
+        for (unsigned int c = 0; c < 4; ++c) {
+            std::swap(bestEndpoints[0][c], bestEndpoints[1][c]);
+        }
+        std::swap(bestBits[0], bestBits[1]);
+        for (unsigned char& index : bestIndices) {
+            index = static_cast<unsigned char>(15 - index);
+        }
+    }
+    std::memset(out, 0, 16);
+    BitWriter writer(out);
+    writer.write(1u << 6, 7);
+    for (unsigned int c = 0; c < 4; ++c) {
+        writer.write(bestEndpoints[0][c], 7);
+        writer.write(bestEndpoints[1][c], 7);
+    }
+    writer.write(bestBits[0], 1);
+    writer.write(bestBits[1], 1);
+    writer.write(bestIndices[0], 3);
+    for (unsigned int i = 1; i < 16; ++i) {
+        writer.write(bestIndices[i], 4);
+    }
+}
+
+static int clampByte(int value) {
+    return std::min(255, std::max(0, value));
+}
+
+// the pixel index values of ETC select +a, +b, -a and -b
+static int getEtcModifier(unsigned int table, unsigned int index) {
+    int modifier = ETC_MODIFIERS[table][index & 1];
+    return index >= 2 ? -modifier : modifier;
+}
+
+// ETC1 blocks, which are also valid ETC2 blocks: two halves of 2x4 (or 4x2 if flipped)
+// pixels with a base color each, either both 4 bits per channel or 5 bits and a 3 bit
+// difference, and per pixel one of four intensity changes from a table
+static void encodeEtc(const Block& block, unsigned char* out) {
+    unsigned long long bestBlock = 0;
+    int bestError = std::numeric_limits<int>::max();
+    for (unsigned int flip = 0; flip < 2; ++flip) {
+        float average[2][3] = {};
+        for (unsigned int i = 0; i < 16; ++i) {
+            unsigned int half = flip ? (i / 4 >= 2) : (i % 4 >= 2);
+            for (unsigned int c = 0; c < 3; ++c) {
+                average[half][c] += block.m_channels[c][i] / 8.0f;
+            }
+        }
+        unsigned int quantized[2][3];
+        bool differential = true;
+        for (unsigned int c = 0; c < 3; ++c) {
+            quantized[0][c] = quantize(average[0][c], 5);
+            quantized[1][c] = quantize(average[1][c], 5);
+            int difference = static_cast<int>(quantized[1][c]) - static_cast<int>(quantized[0][c]);
+            differential = differential && difference >= -4 && difference <= 3;
+        }
+        int base[2][3];
+        for (unsigned int half = 0; half < 2; ++half) {
+            for (unsigned int c = 0; c < 3; ++c) {
+                if (!differential) {
+                    quantized[half][c] = quantize(average[half][c], 4);
+                }
+                base[half][c] = static_cast<int>(expand(quantized[half][c], differential ? 5 : 4));
+            }
+        }
+
+        int error = 0;
+        unsigned int tables[2] = { 0, 0 };
+        unsigned int pixelIndices[16] = {};
+        for (unsigned int half = 0; half < 2; ++half) {
+            int bestHalfError = std::numeric_limits<int>::max();
+            for (unsigned int table = 0; table < 8; ++table) {
+                int halfError = 0;
+                unsigned int indices[16] = {};
+                for (unsigned int i = 0; i < 16; ++i) {
+                    if ((flip ? (i / 4 >= 2) : (i % 4 >= 2)) != (half == 1)) {
+                        continue;
+                    }
+                    int bestPixelError = std::numeric_limits<int>::max();
+                    for (unsigned int index = 0; index < 4; ++index) {
+                        int pixelError = 0;
+                        for (unsigned int c = 0; c < 3; ++c) {
+                            int difference = clampByte(base[half][c] + getEtcModifier(table, index))
+                                - static_cast<int>(block.m_channels[c][i]);
+                            pixelError += difference * difference;
+                        }
+                        if (pixelError < bestPixelError) {
+                            bestPixelError = pixelError;
+                            indices[i] = index;
+                        }
+                    }
+                    halfError += bestPixelError;
+                }
+                if (halfError < bestHalfError) {
+                    bestHalfError = halfError;
+                    tables[half] = table;
+                    for (unsigned int i = 0; i < 16; ++i) {
+                        if ((flip ? (i / 4 >= 2) : (i % 4 >= 2)) == (half == 1)) {
+                            pixelIndices[i] = indices[i];
+                        }
+                    }
+                }
+            }
+            error += bestHalfError;
+        }
+        if (error >= bestError) {
+            continue;
+        }
+        bestError = error;
+
+        unsigned long long bits = 0;
+        // one byte per channel: 5 bits and the difference, or both halves with 4 bits
+        for (unsigned int c = 0; c < 3; ++c) {
+            unsigned int channel = differential ? (quantized[0][c] << 3) | ((quantized[1][c] - quantized[0][c]) & 7)
+                                                : (quantized[0][c] << 4) | quantized[1][c];
+            bits |= static_cast<unsigned long long>(channel) << (56 - c * 8);
+        }
+        bits |= static_cast<unsigned long long>(tables[0]) << 37;
+        bits |= static_cast<unsigned long long>(tables[1]) << 34;
+        bits |= static_cast<unsigned long long>(differential ? 1 : 0) << 33;
+        bits |= static_cast<unsigned long long>(flip) << 32;
+        // the pixel indices are stored column by column
+        for (unsigned int i = 0; i < 16; ++i) {
+            unsigned int position = (i % 4) * 4 + i / 4;
+            bits |= static_cast<unsigned long long>(pixelIndices[i] >> 1) << (16 + position);
+            bits |= static_cast<unsigned long long>(pixelIndices[i] & 1) << position;
+        }
+        bestBlock = bits;
+    }
+    for (unsigned int k = 0; k < 8; ++k) {
+        out[k] = static_cast<unsigned char>(bestBlock >> (56 - k * 8));
+    }
+}
+
+static void encodeBlock(const Block& block, CompressedFormat format, unsigned char* out) {
+    switch (format) {
+    case FORMAT_BC1:
+        encodeBc1(selectChannels(block, 0, 3), out);
+        break;
+    case FORMAT_BC3:
+        encodeBc4(selectChannels(block, 3, 1), out);
+        encodeBc1(selectChannels(block, 0, 3), out + 8);
+        break;
+    case FORMAT_BC4:
+        encodeBc4(selectChannels(block, 0, 1), out);
+        break;
+    case FORMAT_BC5:
+        encodeBc4(selectChannels(block, 0, 1), out);
+        encodeBc4(selectChannels(block, 1, 1), out + 8);
+        break;
+    case FORMAT_BC7:
+        encodeBc7(block, out);
+        break;
+    case FORMAT_ETC2:
+        encodeEtc(block, out);
+        break;
+    default:
+        break;
+    }
+}
+
+void compressImage(const unsigned char* rgba, unsigned int width, unsigned int height, CompressedFormat format,
+    unsigned char* blocks, JobSystem* jobs) {
+    const unsigned int blocksX = (width + 3) / 4;
+    const unsigned int blocksY = (height + 3) / 4;
+    const unsigned int blockBytes = FORMAT_INFOS[format].m_blockBytes;
+    auto compressRows = [=](unsigned int firstRow, unsigned int endRow) {
+        Block block;
+        for (unsigned int y = firstRow; y < endRow; ++y) {
+            for (unsigned int x = 0; x < blocksX; ++x) {
+                loadBlock(rgba, width, height, x, y, block);
+                encodeBlock(block, format, blocks + (y * blocksX + x) * blockBytes);
+            }
+        }
+    };
+    if (jobs) {
+        jobs->parallelFor(blocksY, 1, compressRows);
+    } else {
+        compressRows(0, blocksY);
+    }
+}
+
+static void decodeBc1(const unsigned char* in, unsigned char pixels[16][4], bool alwaysFourColors) {
+    unsigned int color0 = in[0] | (in[1] << 8);
+    unsigned int color1 = in[2] | (in[3] << 8);
+    float palette[4][4];
+    unpackRgb565(color0, palette[0]);
+    unpackRgb565(color1, palette[1]);
+    bool fourColors = alwaysFourColors || color0 > color1;
+    for (unsigned int c = 0; c < 3; ++c) {
+        if (fourColors) {
+            palette[2][c] = (2.0f * palette[0][c] + palette[1][c]) / 3.0f;
+            palette[3][c] = (palette[0][c] + 2.0f * palette[1][c]) / 3.0f;
+        } else {
+            palette[2][c] = (palette[0][c] + palette[1][c]) / 2.0f;
+            palette[3][c] = 0.0f;
+        }
+    }
+    for (unsigned int i = 0; i < 16; ++i) {
+        unsigned int index = (in[4 + i / 4] >> ((i % 4) * 2)) & 3;
+        for (unsigned int c = 0; c < 3; ++c) {
+            pixels[i][c] = static_cast<unsigned char>(std::lround(palette[index][c]));
+        }
+        pixels[i][3] = (!fourColors && index == 3) ? 0 : 255;
+    }
+}
+
+static void decodeBc4(const unsigned char* in, unsigned char pixels[16][4], unsigned int channel) {
+    int value0 = in[0];
+    int value1 = in[1];
+    float palette[8];
+    palette[0] = static_cast<float>(value0);
+    palette[1] = static_cast<float>(value1);
+    for (int i = 2; i < 8; ++i) {
+        if (value0 > value1) {
+            palette[i] = ((8 - i) * value0 + (i - 1) * value1) / 7.0f;
+        } else if (i < 6) {
+            palette[i] = ((6 - i) * value0 + (i - 1) * value1) / 5.0f;
+        } else {
+            palette[i] = i == 6 ? 0.0f : 255.0f;
+        }
+    }
+    unsigned long long bits = 0;
+    for (unsigned int k = 0; k < 6; ++k) {
+        bits |= static_cast<unsigned long long>(in[2 + k]) << (k * 8);
+    }
+    for (unsigned int i = 0; i < 16; ++i) {
+        pixels[i][channel] = static_cast<unsigned char>(std::lround(palette[(bits >> (i * 3)) & 7]));
+    }
+}
+
+static void decodeBc7(const unsigned char* in, unsigned char pixels[16][4]) {
+    if ((in[0] & 0x7F) != 0x40) {
+        for (unsigned int i = 0; i < 16; ++i) {
+            pixels[i][0] = 255;
+            pixels[i][1] = 0;
+            pixels[i][2] = 255;
+            pixels[i][3] = 255;
+        }
+        return;
+    }
+    BitReader reader(in);
+    reader.read(7);
+    int endpoints[2][4];
+    for (unsigned int c = 0; c < 4; ++c) {
+        endpoints[0][c] = static_cast<int>(reader.read(7)) << 1;
+        endpoints[1][c] = static_cast<int>(reader.read(7)) << 1;
+    }
+    unsigned int bit0 = reader.read(1);
+    unsigned int bit1 = reader.read(1);
+    for (unsigned int c = 0; c < 4; ++c) {
+        endpoints[0][c] |= bit0;
+        endpoints[1][c] |= bit1;
+    }
+    for (unsigned int i = 0; i < 16; ++i) {
+        unsigned int index = reader.read(i == 0 ? 3 : 4);
+        for (unsigned int c = 0; c < 4; ++c) {
+            pixels[i][c] = static_cast<unsigned char>(((64 - BC7_WEIGHTS[index]) * endpoints[0][c]
+                + BC7_WEIGHTS[index] * endpoints[1][c] + 32) >> 6);
+        }
+    }
+}
+
+// bits high down to low of an ETC block, bit 63 is the first bit of the first byte
+static unsigned int getEtcBits(unsigned long long bits, unsigned int high, unsigned int low) {
+    return static_cast<unsigned int>((bits >> low) & ((1ull << (high - low + 1)) - 1));
+}
+
+// the pixel indices are stored column by column, the high bits after the low ones
+static unsigned int getEtcIndex(unsigned long long bits, unsigned int pixel) {
+    unsigned int position = (pixel % 4) * 4 + pixel / 4;
+    return (getEtcBits(bits, 16 + position, 16 + position) << 1) | getEtcBits(bits, position, position);
+}
+
+// The T and H modes: two 4 bit colors and a distance make four paint colors, which the
+// pixel indices choose from directly. T uses the first color and the second one moved
+// by the distance both ways, H both colors moved both ways.
+static void decodeEtcPaint(unsigned long long bits, bool hMode, unsigned char pixels[16][4]) {
+    unsigned int colors[2][3];
+    unsigned int distanceIndex;
+    if (!hMode) {
+        colors[0][0] = (getEtcBits(bits, 60, 59) << 2) | getEtcBits(bits, 57, 56);
+        colors[0][1] = getEtcBits(bits, 55, 52);
+        colors[0][2] = getEtcBits(bits, 51, 48);
+        colors[1][0] = getEtcBits(bits, 47, 44);
+        colors[1][1] = getEtcBits(bits, 43, 40);
+        colors[1][2] = getEtcBits(bits, 39, 36);
+        distanceIndex = (getEtcBits(bits, 35, 34) << 1) | getEtcBits(bits, 32, 32);
+    } else {
+        colors[0][0] = getEtcBits(bits, 62, 59);
+        colors[0][1] = (getEtcBits(bits, 58, 56) << 1) | getEtcBits(bits, 52, 52);
+        colors[0][2] = (getEtcBits(bits, 51, 51) << 3) | getEtcBits(bits, 49, 47);
+        colors[1][0] = getEtcBits(bits, 46, 43);
+        colors[1][1] = getEtcBits(bits, 42, 39);
+        colors[1][2] = getEtcBits(bits, 38, 35);
+        // the order of the colors holds the lowest bit of the distance
+        unsigned int first = (colors[0][0] << 8) | (colors[0][1] << 4) | colors[0][2];
+        unsigned int second = (colors[1][0] << 8) | (colors[1][1] << 4) | colors[1][2];
+        distanceIndex = (getEtcBits(bits, 34, 34) << 2) | (getEtcBits(bits, 32, 32) << 1) | (first >= second ? 1 : 0);
+    }
+    const int distance = ETC_DISTANCES[distanceIndex];
+    int paint[4][3];
+    for (unsigned int c = 0; c < 3; ++c) {
+        int first = static_cast<int>(expand(colors[0][c], 4));
+        int second = static_cast<int>(expand(colors[1][c], 4));
+        paint[0][c] = hMode ? clampByte(first + distance) : first;
+        paint[1][c] = hMode ? clampByte(first - distance) : clampByte(second + distance);
+        paint[2][c] = hMode ? clampByte(second + distance) : second;
+        paint[3][c] = clampByte(second - distance);
+    }
+    for (unsigned int i = 0; i < 16; ++i) {
+        unsigned int index = getEtcIndex(bits, i);
+        for (unsigned int c = 0; c < 3; ++c) {
+            pixels[i][c] = static_cast<unsigned char>(paint[index][c]);
+        }
+        pixels[i][3] = 255;
+    }
+}
+
+// The planar mode: the colors at the block's origin, at x = 4 and at y = 4 (6, 7 and 6
+// bits for red, green and blue), interpolated over the pixels.
+static void decodeEtcPlanar(unsigned long long bits, unsigned char pixels[16][4]) {
+    const unsigned int channelBits[3] = { 6, 7, 6 };
+    unsigned int origin[3] = { getEtcBits(bits, 62, 57),
+        (getEtcBits(bits, 56, 56) << 6) | getEtcBits(bits, 54, 49),
+        (getEtcBits(bits, 48, 48) << 5) | (getEtcBits(bits, 44, 43) << 3) | getEtcBits(bits, 41, 39) };
+    unsigned int horizontal[3] = { (getEtcBits(bits, 38, 34) << 1) | getEtcBits(bits, 32, 32),
+        getEtcBits(bits, 31, 25), getEtcBits(bits, 24, 19) };
+    unsigned int vertical[3] = { getEtcBits(bits, 18, 13), getEtcBits(bits, 12, 6), getEtcBits(bits, 5, 0) };
+    for (unsigned int c = 0; c < 3; ++c) {
+        const int o = static_cast<int>(expand(origin[c], channelBits[c]));
+        const int h = static_cast<int>(expand(horizontal[c], channelBits[c]));
+        const int v = static_cast<int>(expand(vertical[c], channelBits[c]));
+        for (unsigned int i = 0; i < 16; ++i) {
+            const int x = static_cast<int>(i % 4);
+            const int y = static_cast<int>(i / 4);
+            pixels[i][c] = static_cast<unsigned char>(clampByte((x * (h - o) + y * (v - o) + 4 * o + 2) >> 2));
+        }
+    }
+    for (unsigned int i = 0; i < 16; ++i) {
+        pixels[i][3] = 255;
+    }
+}
+
+static void decodeEtc(const unsigned char* in, unsigned char pixels[16][4]) {
+    unsigned long long bits = 0;
+    for (unsigned int k = 0; k < 8; ++k) {
+        bits = (bits << 8) | in[k];
+    }
+    bool differential = (bits >> 33) & 1;
+    bool flip = (bits >> 32) & 1;
+    int base[2][3];
+    for (unsigned int c = 0; c < 3; ++c) {
+        unsigned int channel = static_cast<unsigned int>((bits >> (56 - c * 8)) & 255);
+        if (differential) {
+            int value = static_cast<int>(channel >> 3);
+            int difference = static_cast<int>(channel & 7);
+            difference = difference >= 4 ? difference - 8 : difference;
+            if (value + difference < 0 || value + difference > 31) {
+                // ETC1 never overflows, ETC2 uses that for the T (red), H (green) and planar (blue) modes
+                if (c == 2) {
+                    decodeEtcPlanar(bits, pixels);
+                } else {
+                    decodeEtcPaint(bits, c == 1, pixels);
+                }
+                return;
+            }
+            base[0][c] = static_cast<int>(expand(value, 5));
+            base[1][c] = static_cast<int>(expand(value + difference, 5));
+        } else {
+            base[0][c] = static_cast<int>(expand(channel >> 4, 4));
+            base[1][c] = static_cast<int>(expand(channel & 15, 4));
+        }
+    }
+    unsigned int tables[2] = { static_cast<unsigned int>((bits >> 37) & 7),
+        static_cast<unsigned int>((bits >> 34) & 7) };
+    for (unsigned int i = 0; i < 16; ++i) {
+        unsigned int half = flip ? (i / 4 >= 2) : (i % 4 >= 2);
+        unsigned int index = getEtcIndex(bits, i);
+        for (unsigned int c = 0; c < 3; ++c) {
+            pixels[i][c] = static_cast<unsigned char>(clampByte(base[half][c] + getEtcModifier(tables[half], index)));
+        }
+        pixels[i][3] = 255;
+    }
+}
+
+void decompressImage(const unsigned char* blocks, unsigned int width, unsigned int height, CompressedFormat format,
+    unsigned char* rgba) {
+    const unsigned int blocksX = (width + 3) / 4;
+    const unsigned int blocksY = (height + 3) / 4;
+    const unsigned int blockBytes = FORMAT_INFOS[format].m_blockBytes;
+    for (unsigned int blockY = 0; blockY < blocksY; ++blockY) {
+        for (unsigned int blockX = 0; blockX < blocksX; ++blockX) {
+            const unsigned char* in = blocks + (blockY * blocksX + blockX) * blockBytes;
+            unsigned char pixels[16][4];
+            for (unsigned int i = 0; i < 16; ++i) {
+                pixels[i][0] = pixels[i][1] = pixels[i][2] = 0;
+                pixels[i][3] = 255;
+            }
+            switch (format) {
+            case FORMAT_BC1:
+                decodeBc1(in, pixels, false);
+                break;
+            case FORMAT_BC3:
+                decodeBc1(in + 8, pixels, true);
+                decodeBc4(in, pixels, 3);
+                break;
+            case FORMAT_BC4:
+                decodeBc4(in, pixels, 0);
+                break;
+            case FORMAT_BC5:
+                decodeBc4(in, pixels, 0);
+                decodeBc4(in + 8, pixels, 1);
+                break;
+            case FORMAT_BC7:
+                decodeBc7(in, pixels);
+                break;
+            case FORMAT_ETC2:
+                decodeEtc(in, pixels);
+                break;
+            default:
+                break;
+            }
+            for (unsigned int y = 0; y < 4 && blockY * 4 + y < height; ++y) {
+                for (unsigned int x = 0; x < 4 && blockX * 4 + x < width; ++x) {
+                    std::memcpy(rgba + ((blockY * 4 + y) * width + blockX * 4 + x) * 4, pixels[y * 4 + x], 4);
+                }
+            }
+        }
+    }
+}
+
+CompressedTexture compressTexture(const unsigned char* rgba, unsigned int width, unsigned int height,
+    CompressedFormat format, bool mipmaps, JobSystem* jobs) {
+    CompressedTexture texture;
+    texture.m_format = format;
+    texture.m_width = width;
+    texture.m_height = height;
+    if (!mipmaps) {
+        texture.m_levels.emplace_back(getCompressedSize(format, width, height));
+        compressImage(rgba, width, height, format, texture.m_levels.back().data(), jobs);
+        return texture;
+    }
+    // one and two channel formats hold data like heights or normals, not sRGB colors
+    bool srgb = getFormatInfo(format).m_channels >= 3;
+    MipChain chain = generateMipChain(rgba, width, height, MIP_FILTER_KAISER, srgb, jobs);
+    for (unsigned int level = 0; level < chain.m_levels.size(); ++level) {
+        unsigned int levelWidth = std::max(1u, width >> level);
+        unsigned int levelHeight = std::max(1u, height >> level);
+        texture.m_levels.emplace_back(getCompressedSize(format, levelWidth, levelHeight));
+        compressImage(chain.m_levels[level].data(), levelWidth, levelHeight, format, texture.m_levels.back().data(),
+            jobs);
+    }
+    return texture;
+}
@@ -0,0 +1,54 @@
+#ifndef TEXTURE_COMPRESSION_H_INCLUDED
+#define TEXTURE_COMPRESSION_H_INCLUDED
+
+#include <string>
+#include <vector>
+
+class JobSystem;
+
+// GPU block compression formats. All of them store 4x4 pixel blocks in 8 or 16 bytes,
+// blocks over the edge of the image repeat its last row and column.
+enum CompressedFormat {
+	FORMAT_BC1,     // RGB, 4 bits per pixel
+	FORMAT_BC3,     // RGBA (BC1 color and BC4 alpha), 8 bits per pixel
+	FORMAT_BC4,     // R, 4 bits per pixel
+	FORMAT_BC5,     // RG (two BC4 blocks), 8 bits per pixel
+	FORMAT_BC7,     // RGBA, 8 bits per pixel (the encoder only writes mode 6)
+	FORMAT_ETC2,    // RGB, 4 bits per pixel (the encoder only writes the ETC1 compatible modes)
+	FORMAT_COUNT
+};
+
+struct CompressedFormatInfo {
+	const char* m_name;
+	unsigned int m_blockBytes;
+	unsigned int m_channels;    // how many of R, G, B and A the format keeps
+};
+
+const CompressedFormatInfo& getFormatInfo(CompressedFormat format);
+// accepts the names of getFormatInfo() in any case, false if there is none
+bool findFormat(const std::string& name, CompressedFormat& format);
+unsigned int getCompressedSize(CompressedFormat format, unsigned int width, unsigned int height);
+
+// a compressed mip chain, level 0 first
+struct CompressedTexture {
+	CompressedFormat m_format;
+	unsigned int m_width;
+	unsigned int m_height;
+	std::vector<std::vector<unsigned char>> m_levels;
+};
+
+// Compresses width * height RGBA pixels into getCompressedSize() bytes of blocks. With
+// a job system, rows of blocks are compressed as separate jobs.
+void compressImage(const unsigned char* rgba, unsigned int width, unsigned int height, CompressedFormat format,
+	unsigned char* blocks, JobSystem* jobs = nullptr);
+// decodes everything compressImage() writes and every ETC2 block (including the T, H
+// and planar modes the encoder doesn't use), other BC7 modes come out magenta
+void decompressImage(const unsigned char* blocks, unsigned int width, unsigned int height, CompressedFormat format,
+	unsigned char* rgba);
+
+// compresses the image and, if mipmaps is set, every smaller level down to 1x1 (made
+// with generateMipChain() and its Kaiser filter)
+CompressedTexture compressTexture(const unsigned char* rgba, unsigned int width, unsigned int height,
+	CompressedFormat format, bool mipmaps, JobSystem* jobs = nullptr);
+
+#endif
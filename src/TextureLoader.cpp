@@ -0,0 +1,265 @@
+#include "TextureLoader.h"
+#include "GLExtensions.h"
+#include "GLState.h"
+#include "MipGenerator.h"
+
+#include <glad/glad.h>
+
+#include <algorithm>
+#include <chrono>
+#include <cstring>
+#include <iostream>
+#include <iterator>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <utility>
+#include <vector>
+
+// the unit textures are bound to while they are created
+const unsigned int UPLOAD_TEXTURE_UNIT = 0;
+
+static void setTextureParameters() {
+    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_LINEAR_MIPMAP_LINEAR);
+    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_LINEAR);
+    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_S, GL_CLAMP_TO_EDGE);
+    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_T, GL_CLAMP_TO_EDGE);
+}
+
+TextureLoader::TextureLoader(unsigned int threadCount, unsigned int uploadBytesPerFrame)
+    : m_pendingCount{ 0 }, m_placeholderID{ 0 }, m_uploadBytesPerFrame{ uploadBytesPerFrame }, m_stop{ false } {
+    const unsigned char gray[4] = { 128, 128, 128, 255 };
+    glGenTextures(1, &m_placeholderID);
+    GLState::bindTexture(UPLOAD_TEXTURE_UNIT, GL_TEXTURE_2D, m_placeholderID);
+    setTextureParameters();
+    glTexImage2D(GL_TEXTURE_2D, 0, GL_RGBA8, 1, 1, 0, GL_RGBA, GL_UNSIGNED_BYTE, gray);
+    GLState::bindTexture(UPLOAD_TEXTURE_UNIT, GL_TEXTURE_2D, 0);
+
+    if (threadCount == 0) {
+        threadCount = std::max(2u, std::thread::hardware_concurrency()) - 1;
+    }
+    for (unsigned int i = 0; i < threadCount; ++i) {
+        m_threads.emplace_back(&TextureLoader::decodeLoop, this);
+    }
+}
+
+TextureLoader::~TextureLoader() {
+    {
+        std::lock_guard<std::mutex> lock(m_mutex);
+        m_stop = true;
+    }
+    m_wake.notify_all();
+    for (std::thread& thread : m_threads) {
+        thread.join();
+    }
+    for (const Upload& upload : m_uploads) {
+        glDeleteSync(upload.m_fence);
+        GLState::forgetTexture(upload.m_textureID);
+        glDeleteTextures(1, &upload.m_textureID);
+    }
+    for (const PixelBuffer& buffer : m_pixelBuffers) {
+        GLState::forgetBuffer(buffer.m_bufferID);
+        glDeleteBuffers(1, &buffer.m_bufferID);
+    }
+    for (const LoadingTexture& texture : m_textures) {
+        if (texture.m_textureID != 0) {
+            GLState::forgetTexture(texture.m_textureID);
+            glDeleteTextures(1, &texture.m_textureID);
+        }
+    }
+    GLState::forgetTexture(m_placeholderID);
+    glDeleteTextures(1, &m_placeholderID);
+}
+
+void TextureLoader::decodeLoop() {
+    while (true) {
+        DecodeRequest request;
+        {
+            std::unique_lock<std::mutex> lock(m_mutex);
+            m_wake.wait(lock, [this]() {
+                return m_stop || !m_requests.empty();
+            });
+            if (m_stop) {
+                return;
+            }
+            request = m_requests.front();
+            m_requests.pop_front();
+        }
+
+        auto start = std::chrono::steady_clock::now();
+        DecodedImage image{ request.m_handle, {}, 0.0 };
+        loadMipChain(request.m_path, MIP_FILTER_KAISER, true, image.m_chain);
+        std::chrono::duration<double, std::milli> duration = std::chrono::steady_clock::now() - start;
+        image.m_decodeMilliseconds = duration.count();
+
+        std::lock_guard<std::mutex> lock(m_mutex);
+        m_decoded.push_back(std::move(image));
+    }
+}
+
+TextureHandle TextureLoader::load(const std::string& filePath) {
+    TextureHandle handle = static_cast<TextureHandle>(m_textures.size());
+    m_textures.push_back({ filePath, 0, std::chrono::steady_clock::now(), 0.0, 0.0, false });
+    ++m_pendingCount;
+    {
+        std::lock_guard<std::mutex> lock(m_mutex);
+        m_requests.push_back({ handle, filePath });
+    }
+    m_wake.notify_one();
+    return handle;
+}
+
+unsigned int TextureLoader::acquirePixelBuffer(unsigned int size) {
+    for (unsigned int i = 0; i < m_pixelBuffers.size(); ++i) {
+        if (!m_pixelBuffers[i].m_inUse && m_pixelBuffers[i].m_size >= size) {
+            m_pixelBuffers[i].m_inUse = true;
+            return i;
+        }
+    }
+    PixelBuffer buffer{ 0, size, true };
+    glGenBuffers(1, &buffer.m_bufferID);
+    GLState::bindBuffer(GL_PIXEL_UNPACK_BUFFER, buffer.m_bufferID);
+    glBufferData(GL_PIXEL_UNPACK_BUFFER, size, nullptr, GL_STREAM_DRAW);
+    m_pixelBuffers.push_back(buffer);
+    return static_cast<unsigned int>(m_pixelBuffers.size() - 1);
+}
+
+void TextureLoader::startUpload(const DecodedImage& image) {
+    LoadingTexture& texture = m_textures[image.m_handle];
+    texture.m_decodeMilliseconds = image.m_decodeMilliseconds;
+    const MipChain& chain = image.m_chain;
+    if (chain.m_levels.empty()) {
+        std::cerr << "Failed to load texture at " << texture.m_path << '\n';
+        texture.m_failed = true;
+        --m_pendingCount;
+        return;
+    }
+
+    // the copy into the pixel buffer is the only time the CPU touches the pixels here,
+    // the transfer into the texture happens when the GPU gets to it
+    unsigned int size = 0;
+    for (const std::vector<unsigned char>& level : chain.m_levels) {
+        size += static_cast<unsigned int>(level.size());
+    }
+    unsigned int pixelBuffer = acquirePixelBuffer(size);
+    GLState::bindBuffer(GL_PIXEL_UNPACK_BUFFER, m_pixelBuffers[pixelBuffer].m_bufferID);
+    unsigned char* data = static_cast<unsigned char*>(glMapBufferRange(GL_PIXEL_UNPACK_BUFFER, 0, size,
+        GL_MAP_WRITE_BIT | GL_MAP_INVALIDATE_BUFFER_BIT));
+    bool mapped = data != nullptr;
+    if (mapped) {
+        unsigned int offset = 0;
+        for (const std::vector<unsigned char>& level : chain.m_levels) {
+            std::memcpy(data + offset, level.data(), level.size());
+            offset += static_cast<unsigned int>(level.size());
+        }
+        // false if the buffer's memory was lost while it was mapped
+        mapped = glUnmapBuffer(GL_PIXEL_UNPACK_BUFFER) == GL_TRUE;
+    }
+    if (!mapped) {
+        // the placeholder stays bound instead of a texture with undefined contents
+        std::cerr << "Failed to map the pixel buffer for " << texture.m_path << '\n';
+        GLState::bindBuffer(GL_PIXEL_UNPACK_BUFFER, 0);
+        m_pixelBuffers[pixelBuffer].m_inUse = false;
+        texture.m_failed = true;
+        --m_pendingCount;
+        return;
+    }
+
+    unsigned int textureID = 0;
+    glGenTextures(1, &textureID);
+    GLState::bindTexture(UPLOAD_TEXTURE_UNIT, GL_TEXTURE_2D, textureID);
+    setTextureParameters();
+    unsigned int levels = static_cast<unsigned int>(chain.m_levels.size());
+    if (GLExtensions::supportsTextureStorage()) {
+        GLExtensions::texStorage2D(GL_TEXTURE_2D, levels, GL_RGBA8, chain.m_width, chain.m_height);
+    } else {
+        for (unsigned int level = 0; level < levels; ++level) {
+            glTexImage2D(GL_TEXTURE_2D, level, GL_RGBA8, std::max(1u, chain.m_width >> level),
+                std::max(1u, chain.m_height >> level), 0, GL_RGBA, GL_UNSIGNED_BYTE, nullptr);
+        }
+    }
+    // with a pixel unpack buffer bound, the data pointer is an offset into it
+    size_t offset = 0;
+    for (unsigned int level = 0; level < levels; ++level) {
+        glTexSubImage2D(GL_TEXTURE_2D, level, 0, 0, std::max(1u, chain.m_width >> level),
+            std::max(1u, chain.m_height >> level), GL_RGBA, GL_UNSIGNED_BYTE, reinterpret_cast<void*>(offset));
+        offset += chain.m_levels[level].size();
+    }
+    GLState::bindTexture(UPLOAD_TEXTURE_UNIT, GL_TEXTURE_2D, 0);
+    // other texture uploads would read from the pixel buffer while it's bound
+    GLState::bindBuffer(GL_PIXEL_UNPACK_BUFFER, 0);
+
+    m_uploads.push_back({ image.m_handle, textureID, pixelBuffer, glFenceSync(GL_SYNC_GPU_COMMANDS_COMPLETE, 0) });
+}
+
+void TextureLoader::finishUploads() {
+    for (unsigned int i = 0; i < m_uploads.size();) {
+        Upload& upload = m_uploads[i];
+        GLenum status = glClientWaitSync(upload.m_fence, 0, 0);
+        if (status != GL_ALREADY_SIGNALED && status != GL_CONDITION_SATISFIED) {
+            ++i;
+            continue;
+        }
+        glDeleteSync(upload.m_fence);
+        m_pixelBuffers[upload.m_pixelBuffer].m_inUse = false;
+        LoadingTexture& texture = m_textures[upload.m_handle];
+        texture.m_textureID = upload.m_textureID;
+        std::chrono::duration<double, std::milli> latency = std::chrono::steady_clock::now() - texture.m_requested;
+        texture.m_latencyMilliseconds = latency.count();
+        --m_pendingCount;
+        upload = m_uploads.back();
+        m_uploads.pop_back();
+    }
+}
+
+void TextureLoader::update() {
+    finishUploads();
+    {
+        std::lock_guard<std::mutex> lock(m_mutex);
+        m_ready.insert(m_ready.end(), std::make_move_iterator(m_decoded.begin()),
+            std::make_move_iterator(m_decoded.end()));
+        m_decoded.clear();
+    }
+    unsigned int uploadedBytes = 0;
+    while (!m_ready.empty() && (uploadedBytes == 0 || uploadedBytes < m_uploadBytesPerFrame)) {
+        const DecodedImage& image = m_ready.front();
+        unsigned int imageBytes = 0;
+        for (const std::vector<unsigned char>& level : image.m_chain.m_levels) {
+            imageBytes += static_cast<unsigned int>(level.size());
+        }
+        uploadedBytes += std::max(1u, imageBytes);
+        startUpload(image);
+        m_ready.pop_front();
+    }
+}
+
+void TextureLoader::bind(TextureHandle handle, unsigned int slot) const {
+    GLState::bindTexture(slot, GL_TEXTURE_2D, getID(handle));
+}
+
+unsigned int TextureLoader::getID(TextureHandle handle) const {
+    unsigned int textureID = m_textures[handle].m_textureID;
+    return textureID != 0 ? textureID : m_placeholderID;
+}
+
+bool TextureLoader::isLoaded(TextureHandle handle) const {
+    return m_textures[handle].m_textureID != 0;
+}
+
+unsigned int TextureLoader::getPendingCount() const {
+    return m_pendingCount;
+}
+
+void TextureLoader::printLatencies() const {
+    for (const LoadingTexture& texture : m_textures) {
+        std::cout << texture.m_path << ": ";
+        if (texture.m_failed) {
+            std::cout << "failed\n";
+        } else if (texture.m_textureID == 0) {
+            std::cout << "still loading\n";
+        } else {
+            std::cout << "decoded in " << texture.m_decodeMilliseconds << " ms, usable after "
+                << texture.m_latencyMilliseconds << " ms\n";
+        }
+    }
+}
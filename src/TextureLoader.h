@@ -0,0 +1,103 @@
+#ifndef TEXTURE_LOADER_H_INCLUDED
+#define TEXTURE_LOADER_H_INCLUDED
+
+#include "MipGenerator.h"
+
+#include <glad/glad.h>
+
+#include <chrono>
+#include <condition_variable>
+#include <deque>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <vector>
+
+// refers to a texture of a TextureLoader
+typedef unsigned int TextureHandle;
+
+// Loads textures without blocking the frame. Images and their mips (see loadMipChain())
+// are decoded on the loader's own threads (not the frame's job system, so a long
+// decode never ends up in a frame waiting for its jobs). update() copies decoded
+// images into pixel buffer objects and starts the transfers into immutable texture
+// storage, and a fence tells when the GPU is done with them. Until then a texture binds
+// as a 1x1 gray placeholder.
+class TextureLoader {
+	struct LoadingTexture {
+		std::string m_path;
+		unsigned int m_textureID;               // 0 until the upload finished
+		std::chrono::steady_clock::time_point m_requested;
+		double m_decodeMilliseconds;
+		double m_latencyMilliseconds;           // from load() until the texture was usable
+		bool m_failed;
+	};
+
+	struct DecodeRequest {
+		TextureHandle m_handle;
+		std::string m_path;
+	};
+
+	struct DecodedImage {
+		TextureHandle m_handle;
+		MipChain m_chain;                       // no levels if decoding failed
+		double m_decodeMilliseconds;
+	};
+
+	struct PixelBuffer {
+		unsigned int m_bufferID;
+		unsigned int m_size;
+		bool m_inUse;
+	};
+
+	struct Upload {
+		TextureHandle m_handle;
+		unsigned int m_textureID;
+		unsigned int m_pixelBuffer;             // index into m_pixelBuffers
+		GLsync m_fence;
+	};
+
+	std::vector<LoadingTexture> m_textures;    // by handle
+	unsigned int m_pendingCount;
+	unsigned int m_placeholderID;
+	unsigned int m_uploadBytesPerFrame;
+	std::vector<PixelBuffer> m_pixelBuffers;   // reused for later uploads
+	std::vector<Upload> m_uploads;
+	std::deque<DecodedImage> m_ready;          // decoded, waiting for the upload budget
+
+	// shared with the decode threads
+	std::mutex m_mutex;
+	std::condition_variable m_wake;
+	std::deque<DecodeRequest> m_requests;
+	std::vector<DecodedImage> m_decoded;
+	bool m_stop;
+	std::vector<std::thread> m_threads;
+
+	void decodeLoop();
+	unsigned int acquirePixelBuffer(unsigned int size);
+	void startUpload(const DecodedImage& image);
+	void finishUploads();
+
+public:
+	// needs a current context, 0 threads means one per core besides the GL thread
+	explicit TextureLoader(unsigned int threadCount = 0, unsigned int uploadBytesPerFrame = 8 * 1024 * 1024);
+	~TextureLoader();
+	TextureLoader(const TextureLoader&) = delete;
+	TextureLoader& operator=(const TextureLoader&) = delete;
+
+	// returns at once, the image is decoded in the background
+	TextureHandle load(const std::string& filePath);
+	// call once per frame on the GL thread: starts uploads (at least one, then until the
+	// per frame budget is used up) and makes finished textures usable
+	void update();
+
+	void bind(TextureHandle handle, unsigned int slot) const;
+	// the placeholder's ID until the texture is loaded
+	unsigned int getID(TextureHandle handle) const;
+	bool isLoaded(TextureHandle handle) const;
+	// textures that are neither loaded nor failed
+	unsigned int getPendingCount() const;
+	// how long decoding and the whole load took for every texture
+	void printLatencies() const;
+};
+
+#endif
@@ -0,0 +1,257 @@
+#include "TextureManager.h"
+#include "GLExtensions.h"
+#include "GLState.h"
+#include "MipGenerator.h"
+
+#include <glad/glad.h>
+#include "stb_image/stb_image.h"
+
+#include <algorithm>
+#include <iostream>
+#include <string>
+#include <vector>
+
+// textures are created on this unit, the allocator's units only hold textures for draws
+const unsigned int UPLOAD_TEXTURE_UNIT = 0;
+
+TextureUnitAllocator::TextureUnitAllocator(unsigned int firstUnit, unsigned int unitCount)
+    : m_firstUnit{ firstUnit }, m_units(unitCount, Unit{ GL_TEXTURE_2D, 0, 0 }), m_draw{ 1 } {
+}
+
+void TextureUnitAllocator::beginDraw() {
+    ++m_draw;
+}
+
+bool TextureUnitAllocator::bind(unsigned int target, unsigned int textureID, unsigned int& unit) {
+    unsigned int found = 0;
+    for (unsigned int i = 0; i < m_units.size(); ++i) {
+        if (m_units[i].m_target == target && m_units[i].m_textureID == textureID) {
+            m_units[i].m_lastUsed = m_draw;
+            unit = m_firstUnit + i;
+            return true;
+        }
+        if (m_units[i].m_lastUsed < m_units[found].m_lastUsed) {
+            found = i;
+        }
+    }
+    if (m_units[found].m_lastUsed == m_draw) {
+        std::cerr << "A draw binds more than " << m_units.size() << " textures\n";
+        return false;
+    }
+    Unit& freed = m_units[found];
+    if (freed.m_target != target) {
+        GLState::bindTexture(m_firstUnit + found, freed.m_target, 0);
+    }
+    freed = { target, textureID, m_draw };
+    GLState::bindTexture(m_firstUnit + found, target, textureID);
+    unit = m_firstUnit + found;
+    return true;
+}
+
+void TextureUnitAllocator::forget(unsigned int textureID) {
+    for (Unit& unit : m_units) {
+        if (unit.m_textureID == textureID) {
+            unit.m_textureID = 0;
+            unit.m_lastUsed = 0;
+        }
+    }
+}
+
+TextureManager::TextureManager(unsigned long long budgetBytes, unsigned int firstUnit, unsigned int unitCount)
+    : m_residency{ budgetBytes }, m_units{ firstUnit, unitCount }, m_placeholderID{ 0 }, m_copyFramebuffer{ 0 } {
+    const unsigned char gray[4] = { 128, 128, 128, 255 };
+    glGenTextures(1, &m_placeholderID);
+    GLState::bindTexture(UPLOAD_TEXTURE_UNIT, GL_TEXTURE_2D, m_placeholderID);
+    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_NEAREST);
+    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_NEAREST);
+    glTexImage2D(GL_TEXTURE_2D, 0, GL_RGBA8, 1, 1, 0, GL_RGBA, GL_UNSIGNED_BYTE, gray);
+    GLState::bindTexture(UPLOAD_TEXTURE_UNIT, GL_TEXTURE_2D, 0);
+}
+
+TextureManager::~TextureManager() {
+    for (unsigned int texture = 0; texture < m_textures.size(); ++texture) {
+        release(texture);
+    }
+    GLState::forgetTexture(m_placeholderID);
+    glDeleteTextures(1, &m_placeholderID);
+    if (m_copyFramebuffer != 0) {
+        glDeleteFramebuffers(1, &m_copyFramebuffer);
+    }
+}
+
+ManagedTexture TextureManager::add(const std::string& filePath) {
+    int width = 0, height = 0, channels = 0;
+    bool failed = !stbi_info(filePath.c_str(), &width, &height, &channels) || width <= 0 || height <= 0;
+    if (failed) {
+        std::cerr << "Failed to load texture at " << filePath << '\n';
+        width = height = 1;
+    }
+    m_textures.push_back({ filePath, static_cast<unsigned int>(width), static_cast<unsigned int>(height), 0, 0, 0,
+        failed });
+    ManagedTexture texture = m_residency.add(static_cast<unsigned int>(width), static_cast<unsigned int>(height));
+    if (failed) {
+        m_residency.drop(texture);
+    }
+    return texture;
+}
+
+void TextureManager::beginFrame() {
+    m_residency.nextFrame();
+    sync(true);
+    // what was bound since the last frame, update() skips it if it was evicted again since
+    for (ManagedTexture texture : m_pendingLoads) {
+        update(texture, true);
+    }
+    m_pendingLoads.clear();
+}
+
+void TextureManager::beginDraw() {
+    m_units.beginDraw();
+}
+
+bool TextureManager::bind(ManagedTexture texture, unsigned int& unit) {
+    m_residency.request(texture);
+    sync(false);
+    const Entry& entry = m_textures[texture];
+    return m_units.bind(GL_TEXTURE_2D, entry.m_textureID != 0 ? entry.m_textureID : m_placeholderID, unit);
+}
+
+void TextureManager::setBudget(unsigned long long budgetBytes) {
+    m_residency.setBudget(budgetBytes);
+    sync(false);
+}
+
+void TextureManager::sync(bool load) {
+    m_changed.clear();
+    m_residency.takeChanges(m_changed);
+    for (unsigned int texture : m_changed) {
+        update(texture, load);
+    }
+}
+
+void TextureManager::update(ManagedTexture texture, bool load) {
+    const Entry& entry = m_textures[texture];
+    if (entry.m_failed) {
+        return;
+    }
+    if (!m_residency.isResident(texture)) {
+        release(texture);
+        return;
+    }
+    unsigned int firstLevel = m_residency.getFirstLevel(texture);
+    if (entry.m_textureID != 0 && firstLevel >= entry.m_firstLevel) {
+        if (firstLevel > entry.m_firstLevel) {
+            trim(texture, firstLevel);
+        }
+    } else if (load) {
+        upload(texture, firstLevel);
+    } else if (std::find(m_pendingLoads.begin(), m_pendingLoads.end(), texture) == m_pendingLoads.end()) {
+        m_pendingLoads.push_back(texture);
+    }
+}
+
+unsigned int TextureManager::createTexture(unsigned int levels) {
+    unsigned int textureID = 0;
+    glGenTextures(1, &textureID);
+    GLState::bindTexture(UPLOAD_TEXTURE_UNIT, GL_TEXTURE_2D, textureID);
+    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_LINEAR_MIPMAP_LINEAR);
+    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_LINEAR);
+    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_S, GL_CLAMP_TO_EDGE);
+    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_T, GL_CLAMP_TO_EDGE);
+    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAX_LEVEL, levels - 1);
+    return textureID;
+}
+
+void TextureManager::upload(ManagedTexture texture, unsigned int firstLevel) {
+    Entry& entry = m_textures[texture];
+    MipChain chain;
+    if (!loadMipChain(entry.m_path, MIP_FILTER_KAISER, true, chain) || chain.m_levels.empty()) {
+        std::cerr << "Failed to load texture at " << entry.m_path << '\n';
+        release(texture);
+        entry.m_failed = true;
+        m_residency.drop(texture);
+        return;
+    }
+    release(texture);
+    firstLevel = std::min(firstLevel, static_cast<unsigned int>(chain.m_levels.size()) - 1);
+    unsigned int levels = static_cast<unsigned int>(chain.m_levels.size()) - firstLevel;
+    entry.m_width = chain.m_width;
+    entry.m_height = chain.m_height;
+    entry.m_textureID = createTexture(levels);
+    entry.m_firstLevel = firstLevel;
+    entry.m_levels = levels;
+    for (unsigned int level = 0; level < levels; ++level) {
+        unsigned int sourceLevel = firstLevel + level;
+        glTexImage2D(GL_TEXTURE_2D, level, GL_RGBA8, std::max(1u, chain.m_width >> sourceLevel),
+            std::max(1u, chain.m_height >> sourceLevel), 0, GL_RGBA, GL_UNSIGNED_BYTE,
+            chain.m_levels[sourceLevel].data());
+    }
+    GLState::bindTexture(UPLOAD_TEXTURE_UNIT, GL_TEXTURE_2D, 0);
+}
+
+void TextureManager::trim(ManagedTexture texture, unsigned int firstLevel) {
+    Entry& entry = m_textures[texture];
+    firstLevel = std::min(firstLevel, entry.m_firstLevel + entry.m_levels - 1);
+    const unsigned int dropped = firstLevel - entry.m_firstLevel;
+    const unsigned int levels = entry.m_levels - dropped;
+    unsigned int textureID = createTexture(levels);
+    for (unsigned int level = 0; level < levels; ++level) {
+        glTexImage2D(GL_TEXTURE_2D, level, GL_RGBA8, std::max(1u, entry.m_width >> (firstLevel + level)),
+            std::max(1u, entry.m_height >> (firstLevel + level)), 0, GL_RGBA, GL_UNSIGNED_BYTE, nullptr);
+    }
+    if (GLExtensions::supportsCopyImage()) {
+        for (unsigned int level = 0; level < levels; ++level) {
+            GLExtensions::copyImageSubData(entry.m_textureID, GL_TEXTURE_2D, level + dropped, 0, 0, 0, textureID,
+                GL_TEXTURE_2D, level, 0, 0, 0, std::max(1u, entry.m_width >> (firstLevel + level)),
+                std::max(1u, entry.m_height >> (firstLevel + level)), 1);
+        }
+    } else {
+        // the levels are read through a framebuffer into the texture bound for the upload
+        if (m_copyFramebuffer == 0) {
+            glGenFramebuffers(1, &m_copyFramebuffer);
+        }
+        int readFramebuffer = 0;
+        glGetIntegerv(GL_READ_FRAMEBUFFER_BINDING, &readFramebuffer);
+        glBindFramebuffer(GL_READ_FRAMEBUFFER, m_copyFramebuffer);
+        for (unsigned int level = 0; level < levels; ++level) {
+            glFramebufferTexture2D(GL_READ_FRAMEBUFFER, GL_COLOR_ATTACHMENT0, GL_TEXTURE_2D, entry.m_textureID,
+                level + dropped);
+            glCopyTexSubImage2D(GL_TEXTURE_2D, level, 0, 0, 0, 0, std::max(1u, entry.m_width >> (firstLevel + level)),
+                std::max(1u, entry.m_height >> (firstLevel + level)));
+        }
+        glFramebufferTexture2D(GL_READ_FRAMEBUFFER, GL_COLOR_ATTACHMENT0, GL_TEXTURE_2D, 0, 0);
+        glBindFramebuffer(GL_READ_FRAMEBUFFER, readFramebuffer);
+    }
+    GLState::bindTexture(UPLOAD_TEXTURE_UNIT, GL_TEXTURE_2D, 0);
+    release(texture);
+    entry.m_textureID = textureID;
+    entry.m_firstLevel = firstLevel;
+    entry.m_levels = levels;
+}
+
+void TextureManager::release(ManagedTexture texture) {
+    Entry& entry = m_textures[texture];
+    if (entry.m_textureID == 0) {
+        return;
+    }
+    m_units.forget(entry.m_textureID);
+    GLState::forgetTexture(entry.m_textureID);
+    glDeleteTextures(1, &entry.m_textureID);
+    entry.m_textureID = 0;
+}
+
+const TextureResidency& TextureManager::getResidency() const {
+    return m_residency;
+}
+
+void TextureManager::printStatistics() const {
+    unsigned int resident = 0;
+    for (unsigned int texture = 0; texture < m_textures.size(); ++texture) {
+        resident += m_residency.isResident(texture) ? 1 : 0;
+    }
+    const double megabyte = 1024.0 * 1024.0;
+    std::cout << "Textures: " << resident << " of " << m_textures.size() << " resident, "
+        << m_residency.getResidentBytes() / megabyte << " of " << m_residency.getBudget() / megabyte << " MB, "
+        << m_residency.getLoads() << " loads, " << m_residency.getEvictions() << " evictions, "
+        << m_residency.getDroppedLevels() << " dropped mip levels\n";
+}
@@ -0,0 +1,97 @@
+#ifndef TEXTURE_MANAGER_H_INCLUDED
+#define TEXTURE_MANAGER_H_INCLUDED
+
+#include "TextureResidency.h"
+
+#include <string>
+#include <vector>
+
+// refers to a texture of a TextureManager
+typedef unsigned int ManagedTexture;
+
+// Hands out the texture units firstUnit to firstUnit + unitCount - 1. A texture that is
+// still bound to one of them keeps its unit, otherwise it gets the unit that went
+// unused for the most draws. Units used by the current draw are never taken away.
+class TextureUnitAllocator {
+	struct Unit {
+		unsigned int m_target;
+		unsigned int m_textureID;
+		unsigned long long m_lastUsed;  // draw
+	};
+
+	unsigned int m_firstUnit;
+	std::vector<Unit> m_units;
+	unsigned long long m_draw;
+
+public:
+	TextureUnitAllocator(unsigned int firstUnit, unsigned int unitCount);
+
+	// call before binding the textures of the next draw
+	void beginDraw();
+	// Sets unit to the one the texture is bound to, for the sampler uniform. False (with
+	// a message on std::cerr) if every unit is used by the current draw, nothing is bound then.
+	bool bind(unsigned int target, unsigned int textureID, unsigned int& unit);
+	// call before deleting a texture
+	void forget(unsigned int textureID);
+};
+
+// Owns RGBA image textures and keeps them within a GPU memory budget (see
+// TextureResidency for what is evicted or loses its top mip levels first). Textures are
+// only loaded when they are bound, so a scene never holds what it doesn't draw, and
+// they are loaded again (from the mip cache next to the image) when evicted ones are
+// needed again. Loads wait for the next beginFrame() so that bind() never reads a file,
+// until then a texture binds at the size it has or as a 1x1 gray texture. Textures that
+// lose top levels are copied into a smaller texture on the GPU instead of being loaded
+// again. Files that fail to load bind as the gray texture and don't count to the budget.
+class TextureManager {
+	struct Entry {
+		std::string m_path;
+		unsigned int m_width;
+		unsigned int m_height;
+		unsigned int m_textureID;       // 0 while not resident
+		unsigned int m_firstLevel;      // the image's mip level that is level 0 of the texture
+		unsigned int m_levels;          // of the texture
+		bool m_failed;
+	};
+
+	std::vector<Entry> m_textures;
+	TextureResidency m_residency;
+	TextureUnitAllocator m_units;
+	std::vector<unsigned int> m_changed;
+	std::vector<ManagedTexture> m_pendingLoads;
+	unsigned int m_placeholderID;
+	unsigned int m_copyFramebuffer;     // 0 until a trim needs it without copyImageSubData
+
+	// Brings the GL textures in line with what the residency decided. Evictions and trims
+	// are done right away, loads only with load set and queued otherwise.
+	void sync(bool load);
+	void update(ManagedTexture texture, bool load);
+	// a texture with the given levels, bound to the upload unit
+	unsigned int createTexture(unsigned int levels);
+	void upload(ManagedTexture texture, unsigned int firstLevel);
+	void trim(ManagedTexture texture, unsigned int firstLevel);
+	void release(ManagedTexture texture);
+
+public:
+	// needs a current context
+	TextureManager(unsigned long long budgetBytes, unsigned int firstUnit, unsigned int unitCount);
+	~TextureManager();
+	TextureManager(const TextureManager&) = delete;
+	TextureManager& operator=(const TextureManager&) = delete;
+
+	// only reads the image's size, nothing is loaded until the texture is bound
+	ManagedTexture add(const std::string& filePath);
+	// Call once per frame, textures bound in this frame are not evicted until the next
+	// one. Loads the textures bound since the last call.
+	void beginFrame();
+	void beginDraw();
+	// sets unit to the one the texture is bound to, false if the draw already uses every
+	// unit. A texture that isn't resident is loaded by the next beginFrame().
+	bool bind(ManagedTexture texture, unsigned int& unit);
+	void setBudget(unsigned long long budgetBytes);
+
+	const TextureResidency& getResidency() const;
+	void printStatistics() const;
+};
+
+#endif
@@ -0,0 +1,180 @@
+#include "TextureResidency.h"
+
+#include <algorithm>
+#include <vector>
+
+const unsigned int TextureResidency::MIN_TRIMMED_SIZE;
+const unsigned int TextureResidency::STALE_FRAMES;
+
+TextureResidency::TextureResidency(unsigned long long budgetBytes)
+    : m_budget{ budgetBytes }, m_residentBytes{ 0 }, m_frame{ 1 }, m_loads{ 0 }, m_evictions{ 0 },
+    m_droppedLevels{ 0 } {
+}
+
+unsigned long long TextureResidency::computeBytes(unsigned int width, unsigned int height, unsigned int firstLevel) {
+    unsigned long long bytes = 0;
+    for (unsigned int level = firstLevel;; ++level) {
+        unsigned long long levelWidth = std::max(1u, width >> std::min(level, 31u));
+        unsigned long long levelHeight = std::max(1u, height >> std::min(level, 31u));
+        bytes += levelWidth * levelHeight * 4;
+        if (levelWidth == 1 && levelHeight == 1) {
+            return bytes;
+        }
+    }
+}
+
+unsigned int TextureResidency::add(unsigned int width, unsigned int height) {
+    unsigned int levels = 1;
+    for (unsigned int size = std::max(width, height); size > 1; size /= 2) {
+        ++levels;
+    }
+    m_entries.push_back({ width, height, levels, levels, 0, false });
+    return static_cast<unsigned int>(m_entries.size() - 1);
+}
+
+unsigned long long TextureResidency::getBytes(const Entry& entry) const {
+    return entry.m_firstLevel < entry.m_levels ? computeBytes(entry.m_width, entry.m_height, entry.m_firstLevel) : 0;
+}
+
+void TextureResidency::setFirstLevel(unsigned int texture, unsigned int firstLevel) {
+    Entry& entry = m_entries[texture];
+    if (entry.m_firstLevel == firstLevel) {
+        return;
+    }
+    if (firstLevel == entry.m_levels) {
+        ++m_evictions;
+    } else if (firstLevel > entry.m_firstLevel) {
+        m_droppedLevels += firstLevel - entry.m_firstLevel;
+    } else {
+        ++m_loads;
+    }
+    m_residentBytes -= getBytes(entry);
+    entry.m_firstLevel = firstLevel;
+    m_residentBytes += getBytes(entry);
+    m_changed.push_back(texture);
+}
+
+unsigned int TextureResidency::findLeastRecentlyUsed(unsigned long long lastUsedBefore, bool trimmable) const {
+    unsigned int found = static_cast<unsigned int>(m_entries.size());
+    for (unsigned int i = 0; i < m_entries.size(); ++i) {
+        const Entry& entry = m_entries[i];
+        if (entry.m_firstLevel == entry.m_levels || entry.m_lastUsed >= lastUsedBefore) {
+            continue;
+        }
+        if (trimmable && (entry.m_firstLevel + 1 == entry.m_levels
+            || std::max(entry.m_width, entry.m_height) >> entry.m_firstLevel <= MIN_TRIMMED_SIZE)) {
+            continue;
+        }
+        if (found == m_entries.size() || entry.m_lastUsed < m_entries[found].m_lastUsed) {
+            found = i;
+        }
+    }
+    return found;
+}
+
+bool TextureResidency::makeRoom(unsigned long long extraBytes, unsigned long long lastUsedBefore) {
+    const unsigned int none = static_cast<unsigned int>(m_entries.size());
+    while (m_residentBytes + extraBytes > m_budget) {
+        unsigned int stale = findLeastRecentlyUsed(m_frame > STALE_FRAMES ? m_frame - STALE_FRAMES : 0, false);
+        if (stale != none) {
+            setFirstLevel(stale, m_entries[stale].m_levels);
+            continue;
+        }
+        unsigned int trimmed = findLeastRecentlyUsed(lastUsedBefore, true);
+        if (trimmed != none) {
+            setFirstLevel(trimmed, m_entries[trimmed].m_firstLevel + 1);
+            continue;
+        }
+        unsigned int evicted = findLeastRecentlyUsed(lastUsedBefore, false);
+        if (evicted != none) {
+            setFirstLevel(evicted, m_entries[evicted].m_levels);
+            continue;
+        }
+        return false;
+    }
+    return true;
+}
+
+unsigned int TextureResidency::request(unsigned int texture) {
+    Entry& entry = m_entries[texture];
+    entry.m_lastUsed = m_frame;
+    if (entry.m_firstLevel == 0 || entry.m_dropped) {
+        return entry.m_firstLevel;
+    }
+    // A texture that isn't resident can take memory from every texture not drawn in this
+    // frame. One that gets levels back only from those not drawn in the last frame either,
+    // otherwise textures drawn every frame would take each other's levels in turn.
+    const unsigned long long lastUsedBefore = entry.m_firstLevel == entry.m_levels ? m_frame : m_frame - 1;
+    unsigned long long freeable = 0;
+    for (const Entry& other : m_entries) {
+        if (other.m_lastUsed < lastUsedBefore) {
+            freeable += getBytes(other);
+        }
+    }
+    const unsigned long long current = getBytes(entry);
+    const unsigned long long kept = m_residentBytes - freeable - current;
+    // the largest level that can fit, the 1x1 level is made resident even over the budget
+    unsigned int level = 0;
+    while (level + 1 < entry.m_levels && kept + computeBytes(entry.m_width, entry.m_height, level) > m_budget) {
+        ++level;
+    }
+    if (level >= entry.m_firstLevel) {
+        return entry.m_firstLevel;
+    }
+    unsigned long long needed = computeBytes(entry.m_width, entry.m_height, level) - current;
+    makeRoom(needed, lastUsedBefore);
+    setFirstLevel(texture, level);
+    return level;
+}
+
+void TextureResidency::drop(unsigned int texture) {
+    m_entries[texture].m_dropped = true;
+    setFirstLevel(texture, m_entries[texture].m_levels);
+}
+
+void TextureResidency::nextFrame() {
+    ++m_frame;
+    makeRoom(0, m_frame);
+}
+
+void TextureResidency::setBudget(unsigned long long budgetBytes) {
+    m_budget = budgetBytes;
+    makeRoom(0, m_frame);
+}
+
+bool TextureResidency::isResident(unsigned int texture) const {
+    return m_entries[texture].m_firstLevel < m_entries[texture].m_levels;
+}
+
+unsigned int TextureResidency::getFirstLevel(unsigned int texture) const {
+    return m_entries[texture].m_firstLevel;
+}
+
+void TextureResidency::takeChanges(std::vector<unsigned int>& changed) {
+    changed.insert(changed.end(), m_changed.begin(), m_changed.end());
+    m_changed.clear();
+}
+
+unsigned long long TextureResidency::getBudget() const {
+    return m_budget;
+}
+
+unsigned long long TextureResidency::getResidentBytes() const {
+    return m_residentBytes;
+}
+
+unsigned int TextureResidency::getTextureCount() const {
+    return static_cast<unsigned int>(m_entries.size());
+}
+
+unsigned int TextureResidency::getLoads() const {
+    return m_loads;
+}
+
+unsigned int TextureResidency::getEvictions() const {
+    return m_evictions;
+}
+
+unsigned int TextureResidency::getDroppedLevels() const {
+    return m_droppedLevels;
+}
@@ -0,0 +1,81 @@
+#ifndef TEXTURE_RESIDENCY_H_INCLUDED
+#define TEXTURE_RESIDENCY_H_INCLUDED
+
+#include <vector>
+
+// Decides which mip levels of which textures are kept in GPU memory so that they fit
+// in a budget. It only does the bookkeeping (TextureManager moves the textures), so
+// the policy runs without a context. When a texture that is drawn needs room:
+// 1. textures unused for STALE_FRAMES frames are evicted, least recently used first
+// 2. the least recently used textures lose their top mip level, down to MIN_TRIMMED_SIZE
+// 3. the least recently used textures are evicted
+// Textures drawn in the current frame are never touched. If even that isn't enough,
+// the drawn texture itself is made resident from a smaller level, and it gets its
+// full resolution back when it's drawn again and the room can be taken from textures
+// drawn in neither this nor the last frame.
+class TextureResidency {
+	struct Entry {
+		unsigned int m_width;
+		unsigned int m_height;
+		unsigned int m_levels;          // of the full mip chain
+		unsigned int m_firstLevel;      // the largest resident level, m_levels if not resident
+		unsigned long long m_lastUsed;  // frame
+		bool m_dropped;                 // never made resident again
+	};
+
+	std::vector<Entry> m_entries;
+	std::vector<unsigned int> m_changed;
+	unsigned long long m_budget;
+	unsigned long long m_residentBytes;
+	unsigned long long m_frame;
+	unsigned int m_loads;
+	unsigned int m_evictions;
+	unsigned int m_droppedLevels;
+
+public:
+	// top mip levels are only dropped while a texture is larger than this
+	static const unsigned int MIN_TRIMMED_SIZE = 64;
+	static const unsigned int STALE_FRAMES = 120;
+
+	explicit TextureResidency(unsigned long long budgetBytes);
+
+	// a texture that isn't resident yet
+	unsigned int add(unsigned int width, unsigned int height);
+	// Call for every texture a draw of this frame uses. Returns the first mip level that
+	// should be resident, making room by trimming or evicting others if needed.
+	unsigned int request(unsigned int texture);
+	// evicts a texture that can't be loaded, and keeps it from being made resident again
+	void drop(unsigned int texture);
+	// call once per frame, also enforces a budget that was lowered
+	void nextFrame();
+	void setBudget(unsigned long long budgetBytes);
+
+	bool isResident(unsigned int texture) const;
+	unsigned int getFirstLevel(unsigned int texture) const;
+	// Appends the textures whose resident levels changed since the last call. A texture
+	// can be in there more than once, only its current state counts.
+	void takeChanges(std::vector<unsigned int>& changed);
+
+	unsigned long long getBudget() const;
+	unsigned long long getResidentBytes() const;
+	unsigned int getTextureCount() const;
+	// how often a texture was made resident or got levels back, was evicted, and lost a top level
+	unsigned int getLoads() const;
+	unsigned int getEvictions() const;
+	unsigned int getDroppedLevels() const;
+
+	// RGBA8 bytes of a width x height texture's levels from firstLevel down to 1x1
+	static unsigned long long computeBytes(unsigned int width, unsigned int height, unsigned int firstLevel);
+
+private:
+	unsigned long long getBytes(const Entry& entry) const;
+	void setFirstLevel(unsigned int texture, unsigned int firstLevel);
+	// frees memory until extraBytes more fit in the budget, only trimming or evicting
+	// textures last used before frame lastUsedBefore, false if it can't
+	bool makeRoom(unsigned long long extraBytes, unsigned long long lastUsedBefore);
+	// the least recently used resident texture before lastUsedBefore that can be
+	// trimmed (if trimmable is set), or m_entries.size()
+	unsigned int findLeastRecentlyUsed(unsigned long long lastUsedBefore, bool trimmable) const;
+};
+
+#endif
@@ -0,0 +1,93 @@
+#include "TriangleStrips.h"
+
+#include <unordered_map>
+#include <vector>
+
+// a directed edge a -> b as one key
+static unsigned long long edgeKey(unsigned int a, unsigned int b) {
+    return (static_cast<unsigned long long>(a) << 32) | b;
+}
+
+std::vector<unsigned int> convertToStrips(const unsigned int* indices, unsigned int count, unsigned int restartIndex) {
+    const unsigned int numTriangles = count / 3;
+
+    // every triangle (a, b, c) has the directed edges a->b, b->c and c->a. A triangle
+    // continues a strip if it contains the strip's last edge in the right direction
+    std::unordered_multimap<unsigned long long, unsigned int> edges;
+    std::vector<bool> used(numTriangles, false);
+    for (unsigned int t = 0; t < numTriangles; ++t) {
+        const unsigned int* tri = indices + t * 3;
+        if (tri[0] == tri[1] || tri[1] == tri[2] || tri[2] == tri[0]) {
+            used[t] = true;
+            continue;
+        }
+        for (unsigned int e = 0; e < 3; ++e) {
+            edges.emplace(edgeKey(tri[e], tri[(e + 1) % 3]), t);
+        }
+    }
+
+    // returns an unused triangle with the directed edge a->b and its third vertex
+    auto findNext = [&](unsigned int a, unsigned int b, unsigned int& third) -> bool {
+        auto range = edges.equal_range(edgeKey(a, b));
+        for (auto it = range.first; it != range.second; ++it) {
+            if (used[it->second]) {
+                continue;
+            }
+            const unsigned int* tri = indices + it->second * 3;
+            for (unsigned int e = 0; e < 3; ++e) {
+                if (tri[e] == a) {
+                    third = tri[(e + 2) % 3];
+                }
+            }
+            used[it->second] = true;
+            return true;
+        }
+        return false;
+    };
+
+    std::vector<unsigned int> strips;
+    for (unsigned int t = 0; t < numTriangles; ++t) {
+        if (used[t]) {
+            continue;
+        }
+        used[t] = true;
+        const unsigned int* tri = indices + t * 3;
+
+        // start with the rotation of the triangle that can be continued, if there is one
+        unsigned int rotation = 0;
+        for (unsigned int r = 0; r < 3; ++r) {
+            // the second triangle of a strip is wound (v2, v1, v3), so it needs the edge v2->v1
+            auto range = edges.equal_range(edgeKey(tri[(r + 2) % 3], tri[(r + 1) % 3]));
+            bool found = false;
+            for (auto it = range.first; it != range.second && !found; ++it) {
+                found = !used[it->second];
+            }
+            if (found) {
+                rotation = r;
+                break;
+            }
+        }
+
+        if (!strips.empty()) {
+            strips.push_back(restartIndex);
+        }
+        const unsigned int stripStart = static_cast<unsigned int>(strips.size());
+        strips.push_back(tri[rotation]);
+        strips.push_back(tri[(rotation + 1) % 3]);
+        strips.push_back(tri[(rotation + 2) % 3]);
+
+        // triangle i of a strip is (s[i], s[i+1], s[i+2]) for even i and (s[i+1], s[i], s[i+2]) for odd i
+        unsigned int third;
+        while (true) {
+            const unsigned int i = static_cast<unsigned int>(strips.size()) - 2 - stripStart;
+            const unsigned int last = strips.back();
+            const unsigned int secondLast = strips[strips.size() - 2];
+            bool found = i % 2 == 0 ? findNext(secondLast, last, third) : findNext(last, secondLast, third);
+            if (!found) {
+                break;
+            }
+            strips.push_back(third);
+        }
+    }
+    return strips;
+}
\ No newline at end of file
@@ -0,0 +1,13 @@
+#ifndef TRIANGLE_STRIPS_H_INCLUDED
+#define TRIANGLE_STRIPS_H_INCLUDED
+
+#include <vector>
+
+// Converts an indexed triangle list into triangle strips separated by restartIndex,
+// to be drawn as GL_TRIANGLE_STRIP with primitive restart enabled. The winding
+// order of every triangle is kept. Strips are grown greedily over shared edges,
+// so the result is usually much shorter than the list (but never longer than
+// 4 indices per triangle). Degenerate triangles are dropped.
+std::vector<unsigned int> convertToStrips(const unsigned int* indices, unsigned int count, unsigned int restartIndex);
+
+#endif
\ No newline at end of file
@@ -0,0 +1,61 @@
+#include "UniformBuffer.h"
+#include "StreamBuffer.h"
+#include "GLState.h"
+
+#include <glad/glad.h>
+
+#include <cstring>
+#include <iostream>
+
+// the number of updates that fit into one segment of the stream
+const unsigned int UPDATES_PER_SEGMENT = 16;
+
+static unsigned int getUniformBufferAlignment() {
+    int alignment = 0;
+    glGetIntegerv(GL_UNIFORM_BUFFER_OFFSET_ALIGNMENT, &alignment);
+    return alignment > 0 ? static_cast<unsigned int>(alignment) : 256;
+}
+
+static unsigned int alignUp(unsigned int size, unsigned int alignment) {
+    return (size + alignment - 1) / alignment * alignment;
+}
+
+UniformBuffer::UniformBuffer(unsigned int size, unsigned int binding)
+    : m_stream{ GL_UNIFORM_BUFFER, alignUp(size, getUniformBufferAlignment()) * UPDATES_PER_SEGMENT },
+      m_data(size, 0), m_binding{ binding }, m_offset{ 0 }, m_alignment{ getUniformBufferAlignment() } {
+    m_stream.beginFrame();
+    update(m_data.data(), size);
+}
+
+void UniformBuffer::bind() const {
+    GLState::bindBufferRange(GL_UNIFORM_BUFFER, m_binding, m_stream.getID(), m_offset,
+        static_cast<unsigned int>(m_data.size()));
+}
+
+void UniformBuffer::update(const void* data, unsigned int size, unsigned int offset) {
+    if (offset + size > m_data.size()) {
+        std::cerr << "Uniform buffer update of " << size << " bytes at offset " << offset
+                  << " does not fit into " << m_data.size() << " bytes\n";
+        return;
+    }
+    std::memcpy(m_data.data() + offset, data, size);
+
+    // the whole block is written to a fresh piece of the stream every time,
+    // moving on to the next segment once the current one is full
+    const unsigned int blockSize = static_cast<unsigned int>(m_data.size());
+    if (!m_stream.hasSpace(blockSize, m_alignment)) {
+        m_stream.endFrame();
+        m_stream.beginFrame();
+    }
+    StreamAllocation allocation = m_stream.allocate(blockSize, m_alignment);
+    if (allocation.m_data) {
+        std::memcpy(allocation.m_data, m_data.data(), blockSize);
+        m_stream.unmap();
+        m_offset = allocation.m_offset;
+        bind();
+    }
+}
+
+unsigned int UniformBuffer::getBinding() const {
+    return m_binding;
+}
\ No newline at end of file
@@ -0,0 +1,29 @@
+#ifndef UNIFORM_BUFFER_H_INCLUDED
+#define UNIFORM_BUFFER_H_INCLUDED
+
+#include "StreamBuffer.h"
+
+#include <vector>
+
+// A buffer backing a uniform block that is bound to a fixed binding point.
+// Every shader program that binds a block to the same point reads from it,
+// so the data only has to be uploaded once no matter how many programs use it.
+// Each update writes the whole block into a new piece of a stream buffer, so
+// updating it never waits for draws that still read the previous contents.
+// A segment of the stream holds several updates and is only fenced once it is full.
+class UniformBuffer {
+	StreamBuffer m_stream;
+	std::vector<unsigned char> m_data;  // the current contents of the block
+	unsigned int m_binding;
+	unsigned int m_offset;              // where the current contents are in the stream
+	unsigned int m_alignment;
+
+public:
+	UniformBuffer(unsigned int size, unsigned int binding);
+
+	void bind() const;
+	void update(const void* data, unsigned int size, unsigned int offset = 0);
+	unsigned int getBinding() const;
+};
+
+#endif
\ No newline at end of file
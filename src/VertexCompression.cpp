@@ -0,0 +1,200 @@
+#include "VertexCompression.h"
+#include "VertexLayout.h"
+
+#include <glad/glad.h>
+#include <glm/glm.hpp>
+#include <glm/gtc/packing.hpp>
+
+#include <algorithm>
+#include <cmath>
+#include <cstring>
+#include <iostream>
+#include <vector>
+
+HalfVec4 encodeHalfPosition(const glm::vec3& position) {
+    // w is 1 so the attribute can be read as a vec4 position as well
+    return { {
+        glm::packHalf1x16(position.x),
+        glm::packHalf1x16(position.y),
+        glm::packHalf1x16(position.z),
+        glm::packHalf1x16(1.0f),
+    } };
+}
+
+glm::vec3 decodeHalfPosition(const HalfVec4& position) {
+    return glm::vec3(glm::unpackHalf1x16(position.m_values[0]), glm::unpackHalf1x16(position.m_values[1]),
+        glm::unpackHalf1x16(position.m_values[2]));
+}
+
+PackedNormal encodePackedNormal(const glm::vec3& normal) {
+    // x is stored in the lowest 10 bits, which is what GL_INT_2_10_10_10_REV expects
+    return { glm::packSnorm3x10_1x2(glm::vec4(glm::normalize(normal), 0.0f)) };
+}
+
+glm::vec3 decodePackedNormal(const PackedNormal& normal) {
+    return glm::vec3(glm::unpackSnorm3x10_1x2(normal.m_value));
+}
+
+// folds the lower hemisphere of the octahedron over the upper one
+static glm::vec2 octahedralWrap(const glm::vec2& v) {
+    return (1.0f - glm::abs(glm::vec2(v.y, v.x))) * glm::vec2(v.x >= 0.0f ? 1.0f : -1.0f, v.y >= 0.0f ? 1.0f : -1.0f);
+}
+
+OctahedralNormal encodeOctahedralNormal(const glm::vec3& normal) {
+    glm::vec3 n = normal / (std::abs(normal.x) + std::abs(normal.y) + std::abs(normal.z));
+    glm::vec2 encoded = n.z >= 0.0f ? glm::vec2(n.x, n.y) : octahedralWrap(glm::vec2(n.x, n.y));
+    glm::uint32 packed = glm::packSnorm2x16(encoded);
+    return { { static_cast<short>(packed & 0xFFFF), static_cast<short>(packed >> 16) } };
+}
+
+glm::vec3 decodeOctahedralNormal(const OctahedralNormal& normal) {
+    glm::vec2 e = glm::max(glm::vec2(normal.m_values[0], normal.m_values[1]) / 32767.0f, -1.0f);
+    glm::vec3 n = glm::vec3(e.x, e.y, 1.0f - std::abs(e.x) - std::abs(e.y));
+    float t = std::max(-n.z, 0.0f);
+    n.x += n.x >= 0.0f ? -t : t;
+    n.y += n.y >= 0.0f ? -t : t;
+    return glm::normalize(n);
+}
+
+UNorm16Vec2 encodeTexCoord(const glm::vec2& texCoord) {
+    glm::uint32 packed = glm::packUnorm2x16(texCoord);
+    return { { static_cast<unsigned short>(packed & 0xFFFF), static_cast<unsigned short>(packed >> 16) } };
+}
+
+UNorm8Vec4 encodeColor(const glm::vec4& color) {
+    glm::uint32 packed = glm::packUnorm4x8(color);
+    return { {
+        static_cast<unsigned char>(packed & 0xFF),
+        static_cast<unsigned char>((packed >> 8) & 0xFF),
+        static_cast<unsigned char>((packed >> 16) & 0xFF),
+        static_cast<unsigned char>(packed >> 24),
+    } };
+}
+
+// how compressVertices() stores an attribute
+enum AttributeEncoding {
+    ENCODING_FLOAT,
+    ENCODING_HALF_POSITION,
+    ENCODING_PACKED_NORMAL,
+    ENCODING_TEX_COORD,
+};
+
+static glm::vec3 readVec3(const unsigned char* source) {
+    glm::vec3 value;
+    std::memcpy(&value, source, sizeof(value));
+    return value;
+}
+
+static glm::vec2 readVec2(const unsigned char* source) {
+    glm::vec2 value;
+    std::memcpy(&value, source, sizeof(value));
+    return value;
+}
+
+// the largest distance a position moves by when stored as half floats
+static float measureHalfPositionError(const unsigned char* source, unsigned int vertexCount, unsigned int stride,
+    unsigned int offset) {
+    float maxError = 0.0f;
+    for (unsigned int i = 0; i < vertexCount; ++i) {
+        const glm::vec3 position = readVec3(source + i * stride + offset);
+        glm::vec3 delta = glm::abs(decodeHalfPosition(encodeHalfPosition(position)) - position);
+        maxError = std::max({ maxError, delta.x, delta.y, delta.z });
+    }
+    return maxError;
+}
+
+static bool areTexCoords(const unsigned char* source, unsigned int vertexCount, unsigned int stride,
+    unsigned int offset) {
+    for (unsigned int i = 0; i < vertexCount; ++i) {
+        glm::vec2 texCoord = readVec2(source + i * stride + offset);
+        if (!(texCoord.x >= 0.0f && texCoord.x <= 1.0f && texCoord.y >= 0.0f && texCoord.y <= 1.0f)) {
+            return false;
+        }
+    }
+    return true;
+}
+
+VertexLayout compressVertices(const void* data, unsigned int vertexCount, const VertexLayout& layout,
+    float maxPositionError, std::vector<unsigned char>& compressed, QuantizationError& error) {
+    const unsigned char* source = static_cast<const unsigned char*>(data);
+    const std::vector<VertexAttribute>& attributes = layout.getAttributes();
+    const unsigned int stride = layout.getStride();
+    error = { 0.0f, 0.0f };
+    bool floats = !attributes.empty() && attributes[0].m_count == 3;
+    for (const VertexAttribute& attribute : attributes) {
+        floats = floats && attribute.m_type == GL_FLOAT && !attribute.m_normalized && !attribute.m_integer;
+    }
+    if (!floats) {
+        std::cerr << "Only vertices made of floats, starting with a 3 float position, can be compressed\n";
+        compressed.assign(source, source + static_cast<size_t>(vertexCount) * stride);
+        return layout;
+    }
+
+    // pick each attribute's encoding, then lay the compressed vertex out in the same order
+    std::vector<AttributeEncoding> encodings;
+    std::vector<VertexAttribute> compressedAttributes;
+    unsigned int compressedStride = 0;
+    for (unsigned int i = 0; i < attributes.size(); ++i) {
+        const VertexAttribute& attribute = attributes[i];
+        AttributeEncoding encoding = ENCODING_FLOAT;
+        VertexAttribute compressedAttribute = attribute;
+        unsigned int size = attribute.m_count * sizeof(float);
+        if (i == 0) {
+            float positionError = measureHalfPositionError(source, vertexCount, stride, attribute.m_offset);
+            if (positionError <= maxPositionError) {
+                encoding = ENCODING_HALF_POSITION;
+                compressedAttribute = VertexAttributeType<HalfVec4>::get();
+                size = sizeof(HalfVec4);
+                error.m_maxPositionError = positionError;
+            }
+        } else if (attribute.m_count == 3) {
+            encoding = ENCODING_PACKED_NORMAL;
+            compressedAttribute = VertexAttributeType<PackedNormal>::get();
+            size = sizeof(PackedNormal);
+        } else if (attribute.m_count == 2 && areTexCoords(source, vertexCount, stride, attribute.m_offset)) {
+            encoding = ENCODING_TEX_COORD;
+            compressedAttribute = VertexAttributeType<UNorm16Vec2>::get();
+            size = sizeof(UNorm16Vec2);
+        }
+        compressedAttribute.m_offset = compressedStride;
+        compressedStride += size;
+        encodings.push_back(encoding);
+        compressedAttributes.push_back(compressedAttribute);
+    }
+
+    compressed.assign(static_cast<size_t>(vertexCount) * compressedStride, 0);
+    for (unsigned int i = 0; i < vertexCount; ++i) {
+        const unsigned char* vertex = source + i * stride;
+        unsigned char* target = compressed.data() + static_cast<size_t>(i) * compressedStride;
+        for (unsigned int a = 0; a < attributes.size(); ++a) {
+            const unsigned char* value = vertex + attributes[a].m_offset;
+            unsigned char* compressedValue = target + compressedAttributes[a].m_offset;
+            switch (encodings[a]) {
+                case ENCODING_HALF_POSITION: {
+                    HalfVec4 position = encodeHalfPosition(readVec3(value));
+                    std::memcpy(compressedValue, &position, sizeof(position));
+                    break;
+                }
+                case ENCODING_PACKED_NORMAL: {
+                    // measure what was lost by decoding the normal again
+                    const glm::vec3 normal = glm::normalize(readVec3(value));
+                    PackedNormal packed = encodePackedNormal(normal);
+                    std::memcpy(compressedValue, &packed, sizeof(packed));
+                    float cosAngle = glm::dot(glm::normalize(decodePackedNormal(packed)), normal);
+                    float angle = glm::degrees(std::acos(std::clamp(cosAngle, -1.0f, 1.0f)));
+                    error.m_maxNormalAngle = std::max(error.m_maxNormalAngle, angle);
+                    break;
+                }
+                case ENCODING_TEX_COORD: {
+                    UNorm16Vec2 texCoord = encodeTexCoord(readVec2(value));
+                    std::memcpy(compressedValue, &texCoord, sizeof(texCoord));
+                    break;
+                }
+                default:
+                    std::memcpy(compressedValue, value, attributes[a].m_count * sizeof(float));
+                    break;
+            }
+        }
+    }
+    return VertexLayout(compressedAttributes, compressedStride);
+}
\ No newline at end of file
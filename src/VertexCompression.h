@@ -0,0 +1,37 @@
+#ifndef VERTEX_COMPRESSION_H_INCLUDED
+#define VERTEX_COMPRESSION_H_INCLUDED
+
+#include "VertexLayout.h"
+
+#include <glm/glm.hpp>
+
+#include <vector>
+
+// conversions between float data and the compact attribute types in VertexLayout.h
+HalfVec4 encodeHalfPosition(const glm::vec3& position);
+glm::vec3 decodeHalfPosition(const HalfVec4& position);
+PackedNormal encodePackedNormal(const glm::vec3& normal);
+glm::vec3 decodePackedNormal(const PackedNormal& normal);
+OctahedralNormal encodeOctahedralNormal(const glm::vec3& normal);
+glm::vec3 decodeOctahedralNormal(const OctahedralNormal& normal);
+UNorm16Vec2 encodeTexCoord(const glm::vec2& texCoord);
+UNorm8Vec4 encodeColor(const glm::vec4& color);
+
+// the largest differences between the original and the quantized data
+struct QuantizationError {
+	float m_maxPositionError;   // in the units of the positions, 0 if they stayed floats
+	float m_maxNormalAngle;     // in degrees
+};
+
+// Compresses vertices whose layout is made of floats (like { 3, 3, 2 }) into compressed
+// and returns the layout to draw them with. Attribute 0 is the position and becomes 4
+// half floats, unless that moves a vertex by more than maxPositionError (half floats
+// have 11 bits of precision, so positions far from the origin lose accuracy), then it
+// stays 3 floats. Other 3 float attributes are normals and get 10/10/10/2 bits, 2 float
+// attributes are texture coordinates and get 2 normalized shorts if they are all in
+// [0, 1]. Everything else stays floats. Other layouts are returned unchanged, with a
+// copy of the data and a message on std::cerr.
+VertexLayout compressVertices(const void* data, unsigned int vertexCount, const VertexLayout& layout,
+	float maxPositionError, std::vector<unsigned char>& compressed, QuantizationError& error);
+
+#endif
\ No newline at end of file
@@ -0,0 +1,95 @@
+#include "VertexLayout.h"
+
+#include <glad/glad.h>
+#include <glm/glm.hpp>
+#include <glm/gtc/packing.hpp>
+
+#include <algorithm>
+#include <cstring>
+#include <iostream>
+#include <initializer_list>
+#include <tuple>
+#include <vector>
+
+VertexAttribute VertexAttributeType<float>::get() { return { GL_FLOAT, 1, false, false, 0 }; }
+VertexAttribute VertexAttributeType<glm::vec2>::get() { return { GL_FLOAT, 2, false, false, 0 }; }
+VertexAttribute VertexAttributeType<glm::vec3>::get() { return { GL_FLOAT, 3, false, false, 0 }; }
+VertexAttribute VertexAttributeType<glm::vec4>::get() { return { GL_FLOAT, 4, false, false, 0 }; }
+VertexAttribute VertexAttributeType<HalfVec4>::get() { return { GL_HALF_FLOAT, 4, false, false, 0 }; }
+VertexAttribute VertexAttributeType<PackedNormal>::get() { return { GL_INT_2_10_10_10_REV, 4, true, false, 0 }; }
+VertexAttribute VertexAttributeType<OctahedralNormal>::get() { return { GL_SHORT, 2, true, false, 0 }; }
+VertexAttribute VertexAttributeType<UNorm16Vec2>::get() { return { GL_UNSIGNED_SHORT, 2, true, false, 0 }; }
+VertexAttribute VertexAttributeType<UNorm8Vec4>::get() { return { GL_UNSIGNED_BYTE, 4, true, false, 0 }; }
+
+VertexLayout::VertexLayout(std::initializer_list<unsigned int> floatCounts) : m_stride{ 0 } {
+    // tightly packed float attributes, in the order they are listed
+    for (unsigned int count : floatCounts) {
+        m_attributes.push_back({ GL_FLOAT, count, false, false, m_stride });
+        m_stride += count * sizeof(float);
+    }
+}
+
+VertexLayout::VertexLayout(const std::vector<VertexAttribute>& attributes, unsigned int stride)
+    : m_attributes{ attributes }, m_stride{ stride } {}
+
+const std::vector<VertexAttribute>& VertexLayout::getAttributes() const {
+    return m_attributes;
+}
+
+unsigned int VertexLayout::getStride() const {
+    return m_stride;
+}
+
+void VertexLayout::setupAttributes() const {
+    for (unsigned int i = 0; i < m_attributes.size(); ++i) {
+        const VertexAttribute& attribute = m_attributes[i];
+
+        // the offset is the number of bytes from the start of the vertex, but
+        // OpenGL reads this information in as a const void pointer
+        const void* offsetPtr = reinterpret_cast<const void*>(static_cast<unsigned long long>(attribute.m_offset));
+        glEnableVertexAttribArray(i);
+        if (attribute.m_integer) {
+            glVertexAttribIPointer(i, attribute.m_count, attribute.m_type, m_stride, offsetPtr);
+        } else {
+            glVertexAttribPointer(i, attribute.m_count, attribute.m_type, attribute.m_normalized, m_stride, offsetPtr);
+        }
+    }
+}
+
+glm::vec3 VertexLayout::readPosition(const void* vertex) const {
+    const VertexAttribute& attribute = m_attributes.front();
+    const char* data = static_cast<const char*>(vertex) + attribute.m_offset;
+    glm::vec3 position(0.0f);
+    unsigned int count = std::min(attribute.m_count, 3u);
+    for (unsigned int i = 0; i < count; ++i) {
+        if (attribute.m_type == GL_FLOAT) {
+            std::memcpy(&position[i], data + i * sizeof(float), sizeof(float));
+        } else if (attribute.m_type == GL_HALF_FLOAT) {
+            unsigned short half;
+            std::memcpy(&half, data + i * sizeof(unsigned short), sizeof(unsigned short));
+            position[i] = glm::unpackHalf1x16(half);
+        } else {
+            std::cerr << "Positions of type " << attribute.m_type << " can't be read\n";
+            break;
+        }
+    }
+    return position;
+}
+
+static auto asTuple(const VertexAttribute& attribute) {
+    return std::tie(attribute.m_type, attribute.m_count, attribute.m_normalized, attribute.m_integer,
+        attribute.m_offset);
+}
+
+bool VertexLayout::operator<(const VertexLayout& other) const {
+    if (m_stride != other.m_stride) {
+        return m_stride < other.m_stride;
+    }
+    return std::lexicographical_compare(m_attributes.begin(), m_attributes.end(),
+        other.m_attributes.begin(), other.m_attributes.end(),
+        [](const VertexAttribute& a, const VertexAttribute& b) { return asTuple(a) < asTuple(b); });
+}
+
+bool VertexLayout::operator==(const VertexLayout& other) const {
+    return !(*this < other) && !(other < *this);
+}
\ No newline at end of file
@@ -0,0 +1,97 @@
+#ifndef VERTEX_LAYOUT_H_INCLUDED
+#define VERTEX_LAYOUT_H_INCLUDED
+
+#include <glm/glm.hpp>
+
+#include <initializer_list>
+#include <vector>
+
+// compact attribute types for vertex structs (see VertexCompression.h for the conversions)
+struct HalfVec4 {               // 4 half floats, for positions (w is 1)
+	unsigned short m_values[4];
+};
+struct PackedNormal {           // signed normalized 10/10/10/2 bits (GL_INT_2_10_10_10_REV)
+	unsigned int m_value;
+};
+struct OctahedralNormal {       // 2 signed normalized shorts, decoded in the shader like decodeOctahedralNormal()
+	short m_values[2];
+};
+struct UNorm16Vec2 {            // 2 unsigned normalized shorts, for texture coordinates in [0, 1]
+	unsigned short m_values[2];
+};
+struct UNorm8Vec4 {             // 4 unsigned normalized bytes, for colors
+	unsigned char m_values[4];
+};
+
+// how one vertex attribute is stored in the vertex buffer
+struct VertexAttribute {
+	unsigned int m_type;        // GL_FLOAT, GL_HALF_FLOAT, GL_INT_2_10_10_10_REV, ...
+	unsigned int m_count;       // number of components
+	bool m_normalized;          // integer data is mapped to [0, 1] or [-1, 1] in the shader
+	bool m_integer;             // integer data is read as ints in the shader (glVertexAttribIPointer)
+	unsigned int m_offset;      // in bytes from the start of the vertex
+};
+
+// maps the type of a vertex struct member to its attribute description
+template <typename T> struct VertexAttributeType;
+template <> struct VertexAttributeType<float> { static VertexAttribute get(); };
+template <> struct VertexAttributeType<glm::vec2> { static VertexAttribute get(); };
+template <> struct VertexAttributeType<glm::vec3> { static VertexAttribute get(); };
+template <> struct VertexAttributeType<glm::vec4> { static VertexAttribute get(); };
+template <> struct VertexAttributeType<HalfVec4> { static VertexAttribute get(); };
+template <> struct VertexAttributeType<PackedNormal> { static VertexAttribute get(); };
+template <> struct VertexAttributeType<OctahedralNormal> { static VertexAttribute get(); };
+template <> struct VertexAttributeType<UNorm16Vec2> { static VertexAttribute get(); };
+template <> struct VertexAttributeType<UNorm8Vec4> { static VertexAttribute get(); };
+
+// The layout of the vertices in a vertex buffer. Attribute i is passed to the
+// shader at location i. A layout can be made from a list of float component
+// counts, like { 3, 3 } for a position and a normal, or derived from a vertex
+// struct with VertexLayout::of<&Vertex::m_position, &Vertex::m_normal>().
+class VertexLayout {
+	std::vector<VertexAttribute> m_attributes;
+	unsigned int m_stride;
+
+public:
+	VertexLayout(std::initializer_list<unsigned int> floatCounts);
+	VertexLayout(const std::vector<VertexAttribute>& attributes, unsigned int stride);
+
+	template <auto... Members>
+	static VertexLayout of();
+
+	const std::vector<VertexAttribute>& getAttributes() const;
+	unsigned int getStride() const;
+	// sets up the attribute pointers of the bound vertex array for the bound GL_ARRAY_BUFFER
+	void setupAttributes() const;
+	// reads attribute 0 of a vertex as a position, it must be made of floats or half floats
+	glm::vec3 readPosition(const void* vertex) const;
+
+	bool operator<(const VertexLayout& other) const;
+	bool operator==(const VertexLayout& other) const;
+
+private:
+	template <typename Vertex, typename Member>
+	static VertexAttribute describe(Member Vertex::* member);
+
+	template <typename T> struct ClassOf;
+	template <typename Vertex, typename Member> struct ClassOf<Member Vertex::*> { using Type = Vertex; };
+};
+
+template <typename Vertex, typename Member>
+VertexAttribute VertexLayout::describe(Member Vertex::* member) {
+	// the offset of a member is where it is inside an actual vertex
+	static const Vertex vertex {};
+	VertexAttribute attribute = VertexAttributeType<Member>::get();
+	const char* base = reinterpret_cast<const char*>(&vertex);
+	attribute.m_offset = static_cast<unsigned int>(reinterpret_cast<const char*>(&(vertex.*member)) - base);
+	return attribute;
+}
+
+template <auto... Members>
+VertexLayout VertexLayout::of() {
+	static_assert(sizeof...(Members) > 0, "a vertex needs at least one attribute");
+	using Vertex = typename ClassOf<decltype((Members, ...))>::Type;
+	return VertexLayout({ describe(Members)... }, sizeof(Vertex));
+}
+
+#endif
\ No newline at end of file
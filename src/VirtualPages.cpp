@@ -0,0 +1,249 @@
+#include "VirtualPages.h"
+
+#include <algorithm>
+#include <unordered_map>
+#include <vector>
+
+bool computeVirtualTextureLayout(unsigned int width, unsigned int height, unsigned int pageSize, unsigned int border,
+    VirtualTextureLayout& layout) {
+    if (width == 0 || height == 0 || 2 * border >= pageSize) {
+        return false;
+    }
+    unsigned int payload = pageSize - 2 * border;
+    unsigned int pages = std::max((width + payload - 1) / payload, (height + payload - 1) / payload);
+    if (pages > MAX_PAGES_PER_SIDE) {
+        return false;
+    }
+    layout = { width, height, pageSize, border, 1, 1 };
+    while (layout.m_tableSize < pages) {
+        layout.m_tableSize *= 2;
+        ++layout.m_levels;
+    }
+    return true;
+}
+
+unsigned int getPagePayload(const VirtualTextureLayout& layout) {
+    return layout.m_pageSize - 2 * layout.m_border;
+}
+
+void getPageCount(const VirtualTextureLayout& layout, unsigned int level, unsigned int& pagesX,
+    unsigned int& pagesY) {
+    unsigned int payload = getPagePayload(layout);
+    pagesX = (std::max(1u, layout.m_width >> level) + payload - 1) / payload;
+    pagesY = (std::max(1u, layout.m_height >> level) + payload - 1) / payload;
+}
+
+bool isValidPage(const VirtualTextureLayout& layout, PageID page) {
+    if (getPageLevel(page) >= layout.m_levels) {
+        return false;
+    }
+    unsigned int pagesX, pagesY;
+    getPageCount(layout, getPageLevel(page), pagesX, pagesY);
+    return getPageX(page) < pagesX && getPageY(page) < pagesY;
+}
+
+PageRequestAnalyser::PageRequestAnalyser(const VirtualTextureLayout& layout)
+    : m_layout{ layout }, m_levelPages(layout.m_levels) {
+    unsigned int offset = 0;
+    for (unsigned int level = 0; level < layout.m_levels; ++level) {
+        m_levelOffsets.push_back(offset);
+        unsigned int side = layout.m_tableSize >> level;
+        offset += side * side;
+    }
+    m_pixels.assign(offset, 0);
+}
+
+unsigned int PageRequestAnalyser::getIndex(PageID page) const {
+    unsigned int level = getPageLevel(page);
+    return m_levelOffsets[level] + getPageY(page) * (m_layout.m_tableSize >> level) + getPageX(page);
+}
+
+void PageRequestAnalyser::add(PageID page, unsigned int pixels) {
+    unsigned int& count = m_pixels[getIndex(page)];
+    if (count == 0) {
+        m_levelPages[getPageLevel(page)].push_back(page);
+    }
+    count += pixels;
+}
+
+const std::vector<PageRequest>& PageRequestAnalyser::analyse(const unsigned char* feedback,
+    unsigned int pixelCount) {
+    // neighbouring pixels mostly need the same page, so a page is only looked up when it changes
+    PageID run = NO_PAGE;
+    unsigned int runPixels = 0;
+    for (unsigned int i = 0; i < pixelCount; ++i) {
+        const unsigned char* pixel = feedback + i * 4;
+        PageID page = pixel[3] == 0 ? NO_PAGE : makePageID(pixel[2], pixel[0], pixel[1]);
+        if (page == run) {
+            ++runPixels;
+            continue;
+        }
+        if (run != NO_PAGE && isValidPage(m_layout, run)) {
+            add(run, runPixels);
+        }
+        run = page;
+        runPixels = 1;
+    }
+    if (run != NO_PAGE && isValidPage(m_layout, run)) {
+        add(run, runPixels);
+    }
+
+    // a level is complete before its pages are added to the level above
+    for (unsigned int level = 0; level + 1 < m_layout.m_levels; ++level) {
+        for (PageID page : m_levelPages[level]) {
+            add(makePageID(level + 1, getPageX(page) / 2, getPageY(page) / 2), m_pixels[getIndex(page)]);
+        }
+    }
+
+    m_requests.clear();
+    for (unsigned int level = m_layout.m_levels; level-- > 0;) {
+        size_t first = m_requests.size();
+        for (PageID page : m_levelPages[level]) {
+            unsigned int& pixels = m_pixels[getIndex(page)];
+            m_requests.push_back({ page, pixels });
+            pixels = 0;
+        }
+        m_levelPages[level].clear();
+        std::sort(m_requests.begin() + first, m_requests.end(), [](const PageRequest& a, const PageRequest& b) {
+            return a.m_pixels > b.m_pixels;
+        });
+    }
+    return m_requests;
+}
+
+PageCache::PageCache(unsigned int slotCount)
+    : m_slots(slotCount, Slot{ NO_PAGE, 0, false }), m_frame{ 1 }, m_usedSlots{ 0 }, m_evictions{ 0 } {
+}
+
+void PageCache::nextFrame() {
+    ++m_frame;
+}
+
+bool PageCache::touch(PageID page) {
+    auto found = m_pageSlots.find(page);
+    if (found == m_pageSlots.end()) {
+        return false;
+    }
+    m_slots[found->second].m_lastUsed = m_frame;
+    return true;
+}
+
+bool PageCache::findSlot(PageID page, unsigned int& slot) const {
+    auto found = m_pageSlots.find(page);
+    if (found == m_pageSlots.end()) {
+        return false;
+    }
+    slot = found->second;
+    return true;
+}
+
+bool PageCache::insert(PageID page, bool pinned, unsigned int& slot, PageID& evicted) {
+    unsigned int best = static_cast<unsigned int>(m_slots.size());
+    for (unsigned int i = 0; i < m_slots.size(); ++i) {
+        const Slot& candidate = m_slots[i];
+        if (candidate.m_page == NO_PAGE) {
+            best = i;
+            break;
+        }
+        if (!candidate.m_pinned && candidate.m_lastUsed < m_frame
+            && (best == m_slots.size() || candidate.m_lastUsed < m_slots[best].m_lastUsed)) {
+            best = i;
+        }
+    }
+    if (best == m_slots.size()) {
+        return false;
+    }
+    evicted = m_slots[best].m_page;
+    if (evicted != NO_PAGE) {
+        m_pageSlots.erase(evicted);
+        ++m_evictions;
+    } else {
+        ++m_usedSlots;
+    }
+    m_slots[best] = { page, m_frame, pinned };
+    m_pageSlots[page] = best;
+    slot = best;
+    return true;
+}
+
+unsigned int PageCache::getSlotCount() const {
+    return static_cast<unsigned int>(m_slots.size());
+}
+
+unsigned int PageCache::getUsedSlots() const {
+    return m_usedSlots;
+}
+
+unsigned int PageCache::getEvictions() const {
+    return m_evictions;
+}
+
+PageTable::PageTable(const VirtualTextureLayout& layout, unsigned int cacheColumns)
+    : m_layout{ layout }, m_cacheColumns{ cacheColumns } {
+    for (unsigned int level = 0; level < layout.m_levels; ++level) {
+        unsigned int side = layout.m_tableSize >> level;
+        m_levels.emplace_back(side * side * 4, 0);
+        m_changes.push_back({ 0, 0, side, side });
+    }
+}
+
+void PageTable::update(PageID page, const PageCache& cache) {
+    const unsigned int pageLevel = getPageLevel(page);
+    for (unsigned int level = pageLevel + 1; level-- > 0;) {
+        const unsigned int shift = pageLevel - level;
+        const unsigned int side = m_layout.m_tableSize >> level;
+        Rect rect{ getPageX(page) << shift, getPageY(page) << shift, std::min((getPageX(page) + 1) << shift, side),
+            std::min((getPageY(page) + 1) << shift, side) };
+        std::vector<unsigned char>& texels = m_levels[level];
+        for (unsigned int y = rect.m_minY; y < rect.m_maxY; ++y) {
+            for (unsigned int x = rect.m_minX; x < rect.m_maxX; ++x) {
+                unsigned char* texel = &texels[(y * side + x) * 4];
+                unsigned int slot;
+                if (cache.findSlot(makePageID(level, x, y), slot)) {
+                    texel[0] = static_cast<unsigned char>(slot % m_cacheColumns);
+                    texel[1] = static_cast<unsigned char>(slot / m_cacheColumns);
+                    texel[2] = static_cast<unsigned char>(level);
+                    texel[3] = 255;
+                } else if (level + 1 < m_layout.m_levels) {
+                    // the page above was redone before this level
+                    const unsigned int parentSide = side / 2;
+                    const unsigned char* parent = &m_levels[level + 1][((y / 2) * parentSide + x / 2) * 4];
+                    std::copy(parent, parent + 4, texel);
+                } else {
+                    texel[0] = texel[1] = texel[3] = 0;
+                    texel[2] = static_cast<unsigned char>(level);
+                }
+            }
+        }
+        Rect& changed = m_changes[level];
+        if (changed.m_minX >= changed.m_maxX) {
+            changed = rect;
+        } else {
+            changed = { std::min(changed.m_minX, rect.m_minX), std::min(changed.m_minY, rect.m_minY),
+                std::max(changed.m_maxX, rect.m_maxX), std::max(changed.m_maxY, rect.m_maxY) };
+        }
+    }
+}
+
+const std::vector<unsigned char>& PageTable::getLevel(unsigned int level) const {
+    return m_levels[level];
+}
+
+bool PageTable::getChangedRect(unsigned int level, unsigned int& x, unsigned int& y, unsigned int& width,
+    unsigned int& height) const {
+    const Rect& rect = m_changes[level];
+    if (rect.m_minX >= rect.m_maxX || rect.m_minY >= rect.m_maxY) {
+        return false;
+    }
+    x = rect.m_minX;
+    y = rect.m_minY;
+    width = rect.m_maxX - rect.m_minX;
+    height = rect.m_maxY - rect.m_minY;
+    return true;
+}
+
+void PageTable::clearChanges() {
+    for (Rect& rect : m_changes) {
+        rect = { 0, 0, 0, 0 };
+    }
+}
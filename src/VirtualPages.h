@@ -0,0 +1,144 @@
+#ifndef VIRTUAL_PAGES_H_INCLUDED
+#define VIRTUAL_PAGES_H_INCLUDED
+
+#include <unordered_map>
+#include <vector>
+
+// A page of a virtual texture is its level and its column and row in that level. The
+// feedback pass writes the same three values into the red, green and blue channels, so
+// a level has at most MAX_PAGES_PER_SIDE pages per side.
+typedef unsigned int PageID;
+
+const PageID NO_PAGE = 0xFFFFFFFF;
+const unsigned int MAX_PAGES_PER_SIDE = 256;
+
+inline PageID makePageID(unsigned int level, unsigned int x, unsigned int y) {
+	return level << 16 | y << 8 | x;
+}
+
+inline unsigned int getPageLevel(PageID page) {
+	return page >> 16;
+}
+
+inline unsigned int getPageX(PageID page) {
+	return page & 0xFF;
+}
+
+inline unsigned int getPageY(PageID page) {
+	return (page >> 8) & 0xFF;
+}
+
+// How a virtual texture is split into pages. Every page holds the same number of texels
+// of its level, so a page covers two by two pages of the level below it, and the page
+// table is a square power of two with one texel per page and one mip level per level.
+struct VirtualTextureLayout {
+	unsigned int m_width;           // texels of level 0
+	unsigned int m_height;
+	unsigned int m_pageSize;        // texels per side of a page, border included
+	unsigned int m_border;          // texels of the neighbouring pages around every page, for filtering
+	unsigned int m_tableSize;       // page table texels per side at level 0
+	unsigned int m_levels;          // the last one is a single page
+};
+
+// false if the texture needs more than MAX_PAGES_PER_SIDE pages per side or the border
+// leaves no room in the pages
+bool computeVirtualTextureLayout(unsigned int width, unsigned int height, unsigned int pageSize, unsigned int border,
+	VirtualTextureLayout& layout);
+// texels of its level a page shows, without the border
+unsigned int getPagePayload(const VirtualTextureLayout& layout);
+// the pages a level has, the page table has room for more
+void getPageCount(const VirtualTextureLayout& layout, unsigned int level, unsigned int& pagesX,
+	unsigned int& pagesY);
+bool isValidPage(const VirtualTextureLayout& layout, PageID page);
+
+struct PageRequest {
+	PageID m_page;
+	unsigned int m_pixels;          // feedback pixels that needed the page or one below it
+};
+
+// Turns the feedback pass's pixels into the pages to load. Every requested page also
+// requests the pages above it, so there is always a coarser page to fall back to while
+// the finer ones load, and the coarsest pages come first. Within a level pages that
+// cover more of the screen come first.
+class PageRequestAnalyser {
+	VirtualTextureLayout m_layout;
+	std::vector<unsigned int> m_levelOffsets;       // of every level in m_pixels
+	std::vector<unsigned int> m_pixels;             // by page, 0 for pages not requested
+	std::vector<std::vector<PageID>> m_levelPages;  // the requested pages of every level
+	std::vector<PageRequest> m_requests;
+
+	unsigned int getIndex(PageID page) const;
+	void add(PageID page, unsigned int pixels);
+
+public:
+	explicit PageRequestAnalyser(const VirtualTextureLayout& layout);
+
+	// feedback is pixelCount RGBA pixels with the page's x, y and level, and 0 alpha
+	// where nothing was drawn; invalid pages are ignored
+	const std::vector<PageRequest>& analyse(const unsigned char* feedback, unsigned int pixelCount);
+};
+
+// Which page is in which slot of the physical page texture. A new page replaces the one
+// that was used the longest time ago, pages used in the current frame and pinned pages
+// are never replaced.
+class PageCache {
+	struct Slot {
+		PageID m_page;                  // NO_PAGE while the slot is free
+		unsigned long long m_lastUsed;  // frame
+		bool m_pinned;
+	};
+
+	std::vector<Slot> m_slots;
+	std::unordered_map<PageID, unsigned int> m_pageSlots;
+	unsigned long long m_frame;
+	unsigned int m_usedSlots;
+	unsigned int m_evictions;
+
+public:
+	explicit PageCache(unsigned int slotCount);
+
+	void nextFrame();
+	// marks the page as used in this frame, false if it isn't cached
+	bool touch(PageID page);
+	bool findSlot(PageID page, unsigned int& slot) const;
+	// Finds a slot for a page that isn't cached yet. evicted is the page that was in the
+	// slot, or NO_PAGE. false if every slot is pinned or used in this frame.
+	bool insert(PageID page, bool pinned, unsigned int& slot, PageID& evicted);
+
+	unsigned int getSlotCount() const;
+	unsigned int getUsedSlots() const;
+	unsigned int getEvictions() const;
+};
+
+// The page table's texels: the slot (as column and row of the page texture) and the
+// level of the finest cached page at or above every page, and 255 alpha once anything
+// covers it. Only the texels below a page that was cached or evicted are redone, and
+// the changed rectangle of every level is kept for the upload.
+class PageTable {
+	struct Rect {
+		unsigned int m_minX;
+		unsigned int m_minY;
+		unsigned int m_maxX;            // exclusive
+		unsigned int m_maxY;
+	};
+
+	VirtualTextureLayout m_layout;
+	unsigned int m_cacheColumns;
+	std::vector<std::vector<unsigned char>> m_levels;
+	std::vector<Rect> m_changes;
+
+public:
+	// cacheColumns is how many pages fit in a row of the page texture
+	PageTable(const VirtualTextureLayout& layout, unsigned int cacheColumns);
+
+	// call after the page was cached or evicted
+	void update(PageID page, const PageCache& cache);
+	// m_tableSize >> level texels per side
+	const std::vector<unsigned char>& getLevel(unsigned int level) const;
+	// the part of a level that changed since clearChanges(), false if nothing did
+	bool getChangedRect(unsigned int level, unsigned int& x, unsigned int& y, unsigned int& width,
+		unsigned int& height) const;
+	void clearChanges();
+};
+
+#endif
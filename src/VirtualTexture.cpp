@@ -0,0 +1,323 @@
+#include "VirtualTexture.h"
+#include "GLState.h"
+#include "PageFile.h"
+#include "ShaderProgram.h"
+
+#include <glad/glad.h>
+
+#include <algorithm>
+#include <cmath>
+#include <fstream>
+#include <iostream>
+#include <mutex>
+#include <string>
+#include <utility>
+#include <vector>
+
+const unsigned int VirtualTexture::FEEDBACK_DIVISOR;
+const unsigned int VirtualTexture::PAGES_PER_UPDATE;
+const unsigned int VirtualTexture::MAX_PENDING_PAGES;
+
+VirtualTexture::VirtualTexture(const std::string& imagePath, unsigned int pageSize, unsigned int border,
+    unsigned int cacheColumns, unsigned int cacheRows, unsigned int cacheSlot, unsigned int tableSlot,
+    unsigned int threadCount, JobSystem* jobs)
+    : m_pagePath{ getPageFilePath(imagePath) }, m_layout{},
+    m_loaded{ loadPageFile(imagePath, pageSize, border, m_layout, jobs) },
+    m_cacheColumns{ std::min(cacheColumns, MAX_PAGES_PER_SIDE) },
+    m_cacheRows{ std::min(cacheRows, MAX_PAGES_PER_SIDE) },
+    m_cacheTextureID{ 0 }, m_tableTextureID{ 0 }, m_cacheSlot{ cacheSlot }, m_tableSlot{ tableSlot },
+    m_cache{ m_cacheColumns * m_cacheRows }, m_table{ m_layout, m_cacheColumns }, m_analyser{ m_layout },
+    m_feedbackFramebuffer{ 0 }, m_feedbackColor{ 0 }, m_feedbackDepth{ 0 }, m_feedbackWidth{ 0 },
+    m_feedbackHeight{ 0 }, m_readBuffers{}, m_readIndex{ 0 }, m_uploadedPages{ 0 }, m_droppedPages{ 0 },
+    m_lastRequestCount{ 0 }, m_stop{ false } {
+    if (!m_loaded) {
+        std::cerr << "Failed to load virtual texture " << imagePath << '\n';
+        return;
+    }
+
+    // the page texture has no mip levels, the pages of coarser levels are the mips
+    glGenTextures(1, &m_cacheTextureID);
+    GLState::bindTexture(m_cacheSlot, GL_TEXTURE_2D, m_cacheTextureID);
+    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_LINEAR);
+    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_LINEAR);
+    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_S, GL_CLAMP_TO_EDGE);
+    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_T, GL_CLAMP_TO_EDGE);
+    glTexImage2D(GL_TEXTURE_2D, 0, GL_RGBA8, m_cacheColumns * pageSize, m_cacheRows * pageSize, 0, GL_RGBA,
+        GL_UNSIGNED_BYTE, nullptr);
+
+    // the page table is read with texelFetch, one level per level of the virtual texture
+    glGenTextures(1, &m_tableTextureID);
+    GLState::bindTexture(m_tableSlot, GL_TEXTURE_2D, m_tableTextureID);
+    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_NEAREST_MIPMAP_NEAREST);
+    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_NEAREST);
+    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAX_LEVEL, m_layout.m_levels - 1);
+    for (unsigned int level = 0; level < m_layout.m_levels; ++level) {
+        unsigned int side = m_layout.m_tableSize >> level;
+        glTexImage2D(GL_TEXTURE_2D, level, GL_RGBA8, side, side, 0, GL_RGBA, GL_UNSIGNED_BYTE,
+            m_table.getLevel(level).data());
+    }
+    m_table.clearChanges();
+
+    LoadedPage coarsest{ makePageID(m_layout.m_levels - 1, 0, 0), {} };
+    std::ifstream file(m_pagePath, std::ios::binary);
+    if (!readPage(file, m_layout, coarsest.m_page, coarsest.m_texels)) {
+        std::cerr << "Failed to read the pages of " << imagePath << '\n';
+        coarsest.m_texels.clear();
+    }
+    uploadPage(coarsest, true);
+    uploadTable();
+
+    if (threadCount == 0) {
+        threadCount = std::max(2u, std::thread::hardware_concurrency()) - 1;
+    }
+    for (unsigned int i = 0; i < threadCount; ++i) {
+        m_threads.emplace_back(&VirtualTexture::loadLoop, this);
+    }
+}
+
+VirtualTexture::~VirtualTexture() {
+    {
+        std::lock_guard<std::mutex> lock(m_mutex);
+        m_stop = true;
+    }
+    m_wake.notify_all();
+    for (std::thread& thread : m_threads) {
+        thread.join();
+    }
+
+    for (ReadBuffer& buffer : m_readBuffers) {
+        if (buffer.m_bufferID != 0) {
+            GLState::forgetBuffer(buffer.m_bufferID);
+            glDeleteBuffers(1, &buffer.m_bufferID);
+        }
+    }
+    glDeleteFramebuffers(1, &m_feedbackFramebuffer);
+    glDeleteRenderbuffers(1, &m_feedbackColor);
+    glDeleteRenderbuffers(1, &m_feedbackDepth);
+    GLState::forgetTexture(m_cacheTextureID);
+    GLState::forgetTexture(m_tableTextureID);
+    glDeleteTextures(1, &m_cacheTextureID);
+    glDeleteTextures(1, &m_tableTextureID);
+}
+
+void VirtualTexture::loadLoop() {
+    std::ifstream file(m_pagePath, std::ios::binary);
+    while (true) {
+        PageID page;
+        {
+            std::unique_lock<std::mutex> lock(m_mutex);
+            m_wake.wait(lock, [this]() {
+                return m_stop || !m_requests.empty();
+            });
+            if (m_stop) {
+                return;
+            }
+            page = m_requests.front();
+            m_requests.pop_front();
+        }
+
+        LoadedPage loaded{ page, {} };
+        if (!readPage(file, m_layout, page, loaded.m_texels)) {
+            loaded.m_texels.clear();
+        }
+
+        std::lock_guard<std::mutex> lock(m_mutex);
+        m_readPages.push_back(std::move(loaded));
+    }
+}
+
+bool VirtualTexture::isLoaded() const {
+    return m_loaded;
+}
+
+void VirtualTexture::update() {
+    if (!m_loaded) {
+        return;
+    }
+    analyseFeedback();
+    {
+        std::lock_guard<std::mutex> lock(m_mutex);
+        for (LoadedPage& page : m_readPages) {
+            m_ready.push_back(std::move(page));
+        }
+        m_readPages.clear();
+    }
+    for (unsigned int i = 0; i < PAGES_PER_UPDATE && !m_ready.empty(); ++i) {
+        uploadPage(m_ready.front(), false);
+        m_pending.erase(m_ready.front().m_page);
+        m_ready.pop_front();
+    }
+    uploadTable();
+}
+
+void VirtualTexture::analyseFeedback() {
+    ReadBuffer& buffer = m_readBuffers[m_readIndex];
+    if (!buffer.m_pending) {
+        return;
+    }
+    buffer.m_pending = false;
+    const unsigned int pixelCount = buffer.m_width * buffer.m_height;
+    GLState::bindBuffer(GL_PIXEL_PACK_BUFFER, buffer.m_bufferID);
+    const unsigned char* pixels = static_cast<const unsigned char*>(glMapBufferRange(GL_PIXEL_PACK_BUFFER, 0,
+        pixelCount * 4, GL_MAP_READ_BIT));
+    if (!pixels) {
+        GLState::bindBuffer(GL_PIXEL_PACK_BUFFER, 0);
+        return;
+    }
+    const std::vector<PageRequest>& requests = m_analyser.analyse(pixels, pixelCount);
+    glUnmapBuffer(GL_PIXEL_PACK_BUFFER);
+    GLState::bindBuffer(GL_PIXEL_PACK_BUFFER, 0);
+    m_lastRequestCount = static_cast<unsigned int>(requests.size());
+
+    // requests that weren't read yet are replaced by the ones of the newer feedback
+    std::lock_guard<std::mutex> lock(m_mutex);
+    for (PageID page : m_requests) {
+        m_pending.erase(page);
+    }
+    m_requests.clear();
+    m_cache.nextFrame();
+    for (const PageRequest& request : requests) {
+        if (m_cache.touch(request.m_page) || m_pending.count(request.m_page) != 0) {
+            continue;
+        }
+        if (m_pending.size() < MAX_PENDING_PAGES) {
+            m_requests.push_back(request.m_page);
+            m_pending.insert(request.m_page);
+        }
+    }
+    m_wake.notify_all();
+}
+
+void VirtualTexture::uploadPage(const LoadedPage& page, bool pinned) {
+    unsigned int slot;
+    PageID evicted;
+    if (page.m_texels.empty() || m_cache.findSlot(page.m_page, slot)) {
+        return;
+    }
+    if (!m_cache.insert(page.m_page, pinned, slot, evicted)) {
+        // every page is needed by the current frame, a larger page texture would help
+        ++m_droppedPages;
+        return;
+    }
+    GLState::bindTexture(m_cacheSlot, GL_TEXTURE_2D, m_cacheTextureID);
+    glTexSubImage2D(GL_TEXTURE_2D, 0, (slot % m_cacheColumns) * m_layout.m_pageSize,
+        (slot / m_cacheColumns) * m_layout.m_pageSize, m_layout.m_pageSize, m_layout.m_pageSize, GL_RGBA,
+        GL_UNSIGNED_BYTE, page.m_texels.data());
+    if (evicted != NO_PAGE) {
+        m_table.update(evicted, m_cache);
+    }
+    m_table.update(page.m_page, m_cache);
+    ++m_uploadedPages;
+}
+
+void VirtualTexture::uploadTable() {
+    GLState::bindTexture(m_tableSlot, GL_TEXTURE_2D, m_tableTextureID);
+    for (unsigned int level = 0; level < m_layout.m_levels; ++level) {
+        unsigned int x, y, width, height;
+        if (!m_table.getChangedRect(level, x, y, width, height)) {
+            continue;
+        }
+        unsigned int side = m_layout.m_tableSize >> level;
+        glPixelStorei(GL_UNPACK_ROW_LENGTH, side);
+        glTexSubImage2D(GL_TEXTURE_2D, level, x, y, width, height, GL_RGBA, GL_UNSIGNED_BYTE,
+            &m_table.getLevel(level)[(y * side + x) * 4]);
+    }
+    glPixelStorei(GL_UNPACK_ROW_LENGTH, 0);
+    m_table.clearChanges();
+}
+
+void VirtualTexture::resizeFeedback(unsigned int width, unsigned int height) {
+    if (width == m_feedbackWidth && height == m_feedbackHeight) {
+        return;
+    }
+    m_feedbackWidth = width;
+    m_feedbackHeight = height;
+    if (m_feedbackFramebuffer == 0) {
+        glGenFramebuffers(1, &m_feedbackFramebuffer);
+        glGenRenderbuffers(1, &m_feedbackColor);
+        glGenRenderbuffers(1, &m_feedbackDepth);
+    }
+    glBindRenderbuffer(GL_RENDERBUFFER, m_feedbackColor);
+    glRenderbufferStorage(GL_RENDERBUFFER, GL_RGBA8, width, height);
+    glBindRenderbuffer(GL_RENDERBUFFER, m_feedbackDepth);
+    glRenderbufferStorage(GL_RENDERBUFFER, GL_DEPTH_COMPONENT24, width, height);
+    glBindRenderbuffer(GL_RENDERBUFFER, 0);
+    glBindFramebuffer(GL_FRAMEBUFFER, m_feedbackFramebuffer);
+    glFramebufferRenderbuffer(GL_FRAMEBUFFER, GL_COLOR_ATTACHMENT0, GL_RENDERBUFFER, m_feedbackColor);
+    glFramebufferRenderbuffer(GL_FRAMEBUFFER, GL_DEPTH_ATTACHMENT, GL_RENDERBUFFER, m_feedbackDepth);
+    if (glCheckFramebufferStatus(GL_FRAMEBUFFER) != GL_FRAMEBUFFER_COMPLETE) {
+        std::cerr << "The feedback framebuffer is incomplete\n";
+    }
+
+    // reads of the old size are dropped
+    for (ReadBuffer& buffer : m_readBuffers) {
+        if (buffer.m_bufferID == 0) {
+            glGenBuffers(1, &buffer.m_bufferID);
+        }
+        GLState::bindBuffer(GL_PIXEL_PACK_BUFFER, buffer.m_bufferID);
+        glBufferData(GL_PIXEL_PACK_BUFFER, width * height * 4, nullptr, GL_STREAM_READ);
+        buffer.m_width = width;
+        buffer.m_height = height;
+        buffer.m_pending = false;
+    }
+    GLState::bindBuffer(GL_PIXEL_PACK_BUFFER, 0);
+}
+
+void VirtualTexture::beginFeedback(unsigned int screenWidth, unsigned int screenHeight) {
+    if (!m_loaded) {
+        return;
+    }
+    resizeFeedback(std::max(1u, screenWidth / FEEDBACK_DIVISOR), std::max(1u, screenHeight / FEEDBACK_DIVISOR));
+    glBindFramebuffer(GL_FRAMEBUFFER, m_feedbackFramebuffer);
+    glViewport(0, 0, m_feedbackWidth, m_feedbackHeight);
+    // alpha 0 marks pixels where nothing was drawn
+    const float noPage[4] = { 0.0f, 0.0f, 0.0f, 0.0f };
+    const float farDepth = 1.0f;
+    glClearBufferfv(GL_COLOR, 0, noPage);
+    glClearBufferfv(GL_DEPTH, 0, &farDepth);
+}
+
+void VirtualTexture::endFeedback(unsigned int screenWidth, unsigned int screenHeight) {
+    if (!m_loaded) {
+        return;
+    }
+    ReadBuffer& buffer = m_readBuffers[m_readIndex];
+    GLState::bindBuffer(GL_PIXEL_PACK_BUFFER, buffer.m_bufferID);
+    glReadPixels(0, 0, buffer.m_width, buffer.m_height, GL_RGBA, GL_UNSIGNED_BYTE, nullptr);
+    GLState::bindBuffer(GL_PIXEL_PACK_BUFFER, 0);
+    buffer.m_pending = true;
+    m_readIndex = 1 - m_readIndex;
+
+    glBindFramebuffer(GL_FRAMEBUFFER, 0);
+    glViewport(0, 0, screenWidth, screenHeight);
+}
+
+void VirtualTexture::setUniforms(const ShaderProgram& shader, bool feedbackPass) const {
+    GLState::bindTexture(m_cacheSlot, GL_TEXTURE_2D, m_cacheTextureID);
+    GLState::bindTexture(m_tableSlot, GL_TEXTURE_2D, m_tableTextureID);
+    shader.addUniform1i("u_pageCache", m_cacheSlot);
+    shader.addUniform1i("u_pageTable", m_tableSlot);
+    shader.addUniform2f("u_virtualSize", static_cast<float>(m_layout.m_width), static_cast<float>(m_layout.m_height));
+    shader.addUniform2f("u_cacheSize", static_cast<float>(m_cacheColumns * m_layout.m_pageSize),
+        static_cast<float>(m_cacheRows * m_layout.m_pageSize));
+    shader.addUniform1f("u_pagePayload", static_cast<float>(getPagePayload(m_layout)));
+    shader.addUniform1f("u_pageBorder", static_cast<float>(m_layout.m_border));
+    shader.addUniform1f("u_maxLevel", static_cast<float>(m_layout.m_levels > 0 ? m_layout.m_levels - 1 : 0));
+    // derivatives in the smaller feedback framebuffer are larger, which the bias takes back
+    shader.addUniform1f("u_levelBias", feedbackPass ? -std::log2(static_cast<float>(FEEDBACK_DIVISOR)) : 0.0f);
+    shader.addUniform1i("u_feedbackPass", feedbackPass ? 1 : 0);
+}
+
+const VirtualTextureLayout& VirtualTexture::getLayout() const {
+    return m_layout;
+}
+
+unsigned int VirtualTexture::getPendingPages() const {
+    return static_cast<unsigned int>(m_pending.size());
+}
+
+void VirtualTexture::printStatistics() const {
+    std::cout << "Virtual texture: " << m_cache.getUsedSlots() << " of " << m_cache.getSlotCount()
+        << " pages cached, " << m_lastRequestCount << " requested, " << m_uploadedPages << " uploaded, "
+        << m_cache.getEvictions() << " evicted, " << m_droppedPages << " dropped\n";
+}
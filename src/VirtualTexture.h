@@ -0,0 +1,117 @@
+#ifndef VIRTUAL_TEXTURE_H_INCLUDED
+#define VIRTUAL_TEXTURE_H_INCLUDED
+
+#include "VirtualPages.h"
+
+#include <condition_variable>
+#include <deque>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <unordered_set>
+#include <vector>
+
+class JobSystem;
+class ShaderProgram;
+
+// A texture too large to keep resident, drawn from the pages of its page file (see
+// loadPageFile()) that are in a fixed size page texture. Objects using it are drawn
+// into a small feedback framebuffer first, with their shader writing the page every
+// pixel needs instead of a color. The feedback is read back through pixel buffers two
+// frames later (so the read never waits for the GPU), analysed into page requests, and
+// the missing pages are read on the texture's own threads. update() copies read pages
+// into the slots of the least recently used ones and updates the page table, which
+// sends every lookup to the finest page that is there. The coarsest page is loaded
+// up front and never replaced, so there always is something to draw.
+// See res/shaders/virtualTexture_fragment.glsl for the shader side.
+class VirtualTexture {
+	struct LoadedPage {
+		PageID m_page;
+		std::vector<unsigned char> m_texels;    // empty if the read failed
+	};
+
+	struct ReadBuffer {
+		unsigned int m_bufferID;
+		unsigned int m_width;
+		unsigned int m_height;
+		bool m_pending;                         // a read was started and not analysed yet
+	};
+
+	std::string m_pagePath;
+	VirtualTextureLayout m_layout;
+	bool m_loaded;
+	unsigned int m_cacheColumns;
+	unsigned int m_cacheRows;
+	unsigned int m_cacheTextureID;
+	unsigned int m_tableTextureID;
+	unsigned int m_cacheSlot;
+	unsigned int m_tableSlot;
+	PageCache m_cache;
+	PageTable m_table;
+	PageRequestAnalyser m_analyser;
+
+	unsigned int m_feedbackFramebuffer;
+	unsigned int m_feedbackColor;
+	unsigned int m_feedbackDepth;
+	unsigned int m_feedbackWidth;
+	unsigned int m_feedbackHeight;
+	ReadBuffer m_readBuffers[2];
+	unsigned int m_readIndex;               // written this frame, read before that
+
+	std::unordered_set<PageID> m_pending;   // requested and not uploaded yet
+	std::deque<LoadedPage> m_ready;         // read, waiting for the upload budget
+	unsigned int m_uploadedPages;
+	unsigned int m_droppedPages;
+	unsigned int m_lastRequestCount;
+
+	// shared with the loader threads
+	std::mutex m_mutex;
+	std::condition_variable m_wake;
+	std::deque<PageID> m_requests;
+	std::vector<LoadedPage> m_readPages;
+	bool m_stop;
+	std::vector<std::thread> m_threads;
+
+	void loadLoop();
+	void resizeFeedback(unsigned int width, unsigned int height);
+	void analyseFeedback();
+	void uploadPage(const LoadedPage& page, bool pinned);
+	void uploadTable();
+
+public:
+	// the feedback framebuffer is this many times smaller than the screen on both sides
+	static const unsigned int FEEDBACK_DIVISOR = 8;
+	// pages copied into the page texture per update()
+	static const unsigned int PAGES_PER_UPDATE = 16;
+	// pages requested from the loader threads at once
+	static const unsigned int MAX_PENDING_PAGES = 64;
+
+	// Needs a current context. The page texture has cacheColumns x cacheRows pages, and
+	// 0 threads means one per core besides the GL thread. Writes the page file first if
+	// it's missing or outdated, using the job system if there is one.
+	VirtualTexture(const std::string& imagePath, unsigned int pageSize, unsigned int border,
+		unsigned int cacheColumns, unsigned int cacheRows, unsigned int cacheSlot, unsigned int tableSlot,
+		unsigned int threadCount = 0, JobSystem* jobs = nullptr);
+	~VirtualTexture();
+	VirtualTexture(const VirtualTexture&) = delete;
+	VirtualTexture& operator=(const VirtualTexture&) = delete;
+
+	// false (with a message on std::cerr) if the page file couldn't be made
+	bool isLoaded() const;
+	// call once per frame before the feedback pass
+	void update();
+	// binds and clears the feedback framebuffer, then draw everything using the texture
+	// with setUniforms(shader, true)
+	void beginFeedback(unsigned int screenWidth, unsigned int screenHeight);
+	// starts reading the feedback back and binds the default framebuffer again
+	void endFeedback(unsigned int screenWidth, unsigned int screenHeight);
+	// binds the page and table textures and sets the shader's uniforms for the feedback or the normal pass
+	void setUniforms(const ShaderProgram& shader, bool feedbackPass) const;
+
+	const VirtualTextureLayout& getLayout() const;
+	// pages that were requested and aren't in the page texture yet
+	unsigned int getPendingPages() const;
+	void printStatistics() const;
+};
+
+#endif
@@ -0,0 +1,159 @@
+#include "VirtualTextureCheck.h"
+#include "GLState.h"
+#include "PageFile.h"
+#include "ShaderProgram.h"
+#include "VirtualTexture.h"
+
+#include <glad/glad.h>
+
+#include <algorithm>
+#include <chrono>
+#include <cstdlib>
+#include <fstream>
+#include <iostream>
+#include <string>
+#include <thread>
+#include <unordered_map>
+#include <vector>
+
+const std::string CHECK_VS = "res/shaders/virtualTextureCheck_vertex.glsl";
+const std::string CHECK_FS = "res/shaders/virtualTexture_fragment.glsl";
+// frames drawn at most before a level's pages must be in the page texture
+const unsigned int MAX_CHECK_FRAMES = 500;
+// linear filtering at texel centers may round differently from the texels
+const int MAX_TEXEL_DIFFERENCE = 1;
+
+struct CheckTarget {
+    unsigned int m_framebuffer;
+    unsigned int m_color;
+    unsigned int m_vertexArray;
+    unsigned int m_vertexBuffer;
+};
+
+static void drawQuad(const CheckTarget& target) {
+    GLState::bindVertexArray(target.m_vertexArray);
+    glDrawArrays(GL_TRIANGLE_STRIP, 0, 4);
+}
+
+// draws the level until the feedback asked for nothing more, then compares it with the page file
+static bool checkLevel(VirtualTexture& texture, const ShaderProgram& shader, const CheckTarget& target,
+    std::ifstream& pageFile, unsigned int level) {
+    const VirtualTextureLayout& layout = texture.getLayout();
+    const unsigned int width = std::max(1u, layout.m_width >> level);
+    const unsigned int height = std::max(1u, layout.m_height >> level);
+    glBindRenderbuffer(GL_RENDERBUFFER, target.m_color);
+    glRenderbufferStorage(GL_RENDERBUFFER, GL_RGBA8, width, height);
+    glBindRenderbuffer(GL_RENDERBUFFER, 0);
+
+    // the feedback of a frame is analysed two frames later
+    unsigned int frame = 0;
+    bool settled = false;
+    while (!settled && frame < MAX_CHECK_FRAMES) {
+        texture.update();
+        settled = frame >= 3 && texture.getPendingPages() == 0;
+        texture.beginFeedback(width, height);
+        texture.setUniforms(shader, true);
+        drawQuad(target);
+        texture.endFeedback(width, height);
+        glBindFramebuffer(GL_FRAMEBUFFER, target.m_framebuffer);
+        glViewport(0, 0, width, height);
+        texture.setUniforms(shader, false);
+        drawQuad(target);
+        glFinish();
+        if (!settled) {
+            // the loader threads may need the core
+            std::this_thread::sleep_for(std::chrono::milliseconds(1));
+        }
+        ++frame;
+    }
+
+    std::vector<unsigned char> pixels(width * height * 4);
+    glPixelStorei(GL_PACK_ALIGNMENT, 1);
+    glReadPixels(0, 0, width, height, GL_RGBA, GL_UNSIGNED_BYTE, pixels.data());
+    glPixelStorei(GL_PACK_ALIGNMENT, 4);
+    glBindFramebuffer(GL_FRAMEBUFFER, 0);
+
+    // texture coordinate 0 is the first row of the image and of the framebuffer
+    const unsigned int payload = getPagePayload(layout);
+    std::unordered_map<PageID, std::vector<unsigned char>> pages;
+    unsigned int wrongTexels = 0;
+    int largestDifference = 0;
+    for (unsigned int y = 0; y < height; ++y) {
+        for (unsigned int x = 0; x < width; ++x) {
+            PageID page = makePageID(level, x / payload, y / payload);
+            auto found = pages.find(page);
+            if (found == pages.end()) {
+                found = pages.emplace(page, std::vector<unsigned char>()).first;
+                if (!readPage(pageFile, layout, page, found->second)) {
+                    std::cerr << "Failed to read page " << page << " of the page file\n";
+                    return false;
+                }
+            }
+            const unsigned int inPageX = layout.m_border + x % payload;
+            const unsigned int inPageY = layout.m_border + y % payload;
+            const unsigned char* expected = &found->second[(inPageY * layout.m_pageSize + inPageX) * 4];
+            const unsigned char* drawn = &pixels[(y * width + x) * 4];
+            int difference = 0;
+            for (unsigned int channel = 0; channel < 3; ++channel) {
+                difference = std::max(difference, std::abs(expected[channel] - drawn[channel]));
+            }
+            largestDifference = std::max(largestDifference, difference);
+            if (difference > MAX_TEXEL_DIFFERENCE) {
+                ++wrongTexels;
+            }
+        }
+    }
+    bool passed = settled && wrongTexels == 0;
+    std::cout << "Level " << level << " (" << width << "x" << height << ", " << pages.size() << " pages): "
+        << (settled ? "resident" : "NOT resident") << " after " << frame << " frames, " << wrongTexels
+        << " wrong texels, largest difference " << largestDifference << (passed ? " OK" : " FAILED") << '\n';
+    return passed;
+}
+
+int checkVirtualTexture(const std::string& imagePath, unsigned int pageSize, unsigned int border,
+    unsigned int cachePagesPerSide, unsigned int cacheSlot, unsigned int tableSlot) {
+    VirtualTexture texture(imagePath, pageSize, border, cachePagesPerSide, cachePagesPerSide, cacheSlot, tableSlot);
+    std::ifstream pageFile(getPageFilePath(imagePath), std::ios::binary);
+    if (!texture.isLoaded() || !pageFile) {
+        return 1;
+    }
+    ShaderProgram shader(CHECK_VS, CHECK_FS);
+    shader.addUniform1i("u_unlit", 1);
+
+    CheckTarget target;
+    glGenFramebuffers(1, &target.m_framebuffer);
+    glGenRenderbuffers(1, &target.m_color);
+    glBindRenderbuffer(GL_RENDERBUFFER, target.m_color);
+    glRenderbufferStorage(GL_RENDERBUFFER, GL_RGBA8, 1, 1);
+    glBindRenderbuffer(GL_RENDERBUFFER, 0);
+    glBindFramebuffer(GL_FRAMEBUFFER, target.m_framebuffer);
+    glFramebufferRenderbuffer(GL_FRAMEBUFFER, GL_COLOR_ATTACHMENT0, GL_RENDERBUFFER, target.m_color);
+    glBindFramebuffer(GL_FRAMEBUFFER, 0);
+
+    const float quad[] = { -1.0f, -1.0f, 1.0f, -1.0f, -1.0f, 1.0f, 1.0f, 1.0f };
+    glGenVertexArrays(1, &target.m_vertexArray);
+    glGenBuffers(1, &target.m_vertexBuffer);
+    GLState::bindVertexArray(target.m_vertexArray);
+    GLState::bindBuffer(GL_ARRAY_BUFFER, target.m_vertexBuffer);
+    glBufferData(GL_ARRAY_BUFFER, sizeof(quad), quad, GL_STATIC_DRAW);
+    glEnableVertexAttribArray(0);
+    glVertexAttribPointer(0, 2, GL_FLOAT, GL_FALSE, 2 * sizeof(float), nullptr);
+
+    // the feedback pass uses the depth test like the scene does, the quad is all there is
+    GLState::setCapability(GL_DEPTH_TEST, true);
+    GLState::setCapability(GL_CULL_FACE, false);
+    bool passed = true;
+    for (unsigned int level = 0; level < texture.getLayout().m_levels; ++level) {
+        passed = checkLevel(texture, shader, target, pageFile, level) && passed;
+    }
+    texture.printStatistics();
+
+    GLState::forgetVertexArray(target.m_vertexArray);
+    GLState::forgetBuffer(target.m_vertexBuffer);
+    glDeleteVertexArrays(1, &target.m_vertexArray);
+    glDeleteBuffers(1, &target.m_vertexBuffer);
+    glDeleteFramebuffers(1, &target.m_framebuffer);
+    glDeleteRenderbuffers(1, &target.m_color);
+    std::cout << "Virtual texture check " << (passed ? "passed" : "FAILED") << '\n';
+    return passed ? 0 : 1;
+}
@@ -0,0 +1,15 @@
+#ifndef VIRTUAL_TEXTURE_CHECK_H_INCLUDED
+#define VIRTUAL_TEXTURE_CHECK_H_INCLUDED
+
+#include <string>
+
+// Checks the GPU side of VirtualTexture (run the program with --check-virtual-texture
+// <image>). Every level of the image is drawn into an offscreen framebuffer of the
+// level's size, one pixel per texel, through the feedback pass, the page streaming and
+// res/shaders/virtualTexture_fragment.glsl. The pixels read back are compared with the
+// texels of the page file. Needs a current context, returns a non-zero exit code if
+// any texel differs.
+int checkVirtualTexture(const std::string& imagePath, unsigned int pageSize, unsigned int border,
+	unsigned int cachePagesPerSide, unsigned int cacheSlot, unsigned int tableSlot);
+
+#endif